@@ -0,0 +1,129 @@
+#include "FUBatchReplay.h"
+//STL Includes
+#include <algorithm>
+#include <cstdio>
+//Local Includes
+#include "FUFloorEstimator.h"
+#include "FUFrameProcessor.h"
+#include "FULatency.h"
+#include "FURecording.h"
+#include "FUTrace.h"
+
+static const unsigned int DEFAULT_DETECTORS = FUGesture::ALL_DETECTORS & ~(FUGesture::PUSH | FUGesture::GRIP);
+/**
+ * @brief Events polled at once from the frame processor, more than a frame can queue
+ */
+static const size_t EVENT_BATCH_SIZE = 256;
+
+static long getFileSize(const std::string &filePath)
+{
+    std::FILE *file = std::fopen(filePath.c_str(), "rb");
+    if (file == nullptr)
+        return 0;
+    std::fseek(file, 0, SEEK_END);
+    const long size = std::ftell(file);
+    std::fclose(file);
+    return size;
+}
+
+/**
+ * @brief The SDK zeroes the whole floor plane when it can't see the floor
+ */
+static bool hasFloorPlane(const FUSkeleton::SkeletonFrame &frame)
+{
+    return frame.floorPlane.x != 0 || frame.floorPlane.y != 0 || frame.floorPlane.z != 0 || frame.floorPlane.w != 0;
+}
+
+FUBatchReplay::FUBatchReplay(int workerCount)
+    : mThreadPool(workerCount)
+    , mDetectors(DEFAULT_DETECTORS)
+    , mEstimateFloor(true)
+    , mRunTime(0)
+{
+}
+
+std::vector<FUBatchReplay::Result> FUBatchReplay::run(const std::vector<std::string> &filePaths)
+{
+    const int64_t startTime = FULatency::getTime();
+    std::vector<Result> results(filePaths.size());
+    //The longest recordings start first so that a long one doesn't run alone at the end
+    std::vector<std::pair<long, size_t>> order(filePaths.size());
+    for (size_t i = 0; i < filePaths.size(); i++)
+        order[i] = std::make_pair(-getFileSize(filePaths[i]), i);
+    std::sort(order.begin(), order.end());
+
+    const unsigned int detectors = mDetectors;
+    const bool estimateFloor = mEstimateFloor;
+    mThreadPool.parallelFor(static_cast<int>(order.size()), [&](int task) {
+        const size_t index = order[task].second;
+        results[index] = replay(filePaths[index], detectors, estimateFloor);
+    });
+    mRunTime = FULatency::getTime() - startTime;
+    return results;
+}
+
+FUBatchReplay::Result FUBatchReplay::replay(const std::string &filePath, unsigned int detectors, bool estimateFloor)
+{
+    FU_TRACE_SCOPE(FUTrace::DETECTORS, "FUBatchReplay::replay");
+    const int64_t startTime = FULatency::getTime();
+    Result result;
+    result.filePath = filePath;
+    result.skeletonFrameCount = 0;
+    result.depthFrameCount = 0;
+    result.recordedDuration = 0;
+    result.processingTime = 0;
+
+    FURecordingReader reader;
+    result.isOpened = reader.open(filePath.c_str());
+    if (!result.isOpened)
+        return result;
+    //The thread pool is busy with the replays, so the floor estimator runs on the replay's thread
+    FUFloorEstimator floorEstimator;
+    FUFrameProcessor processor;
+    processor.subscribe(FUGesture::ANY_PLAYER, detectors);
+    FUSkeleton::SkeletonFrame frame;
+    bool hasRecordedFloor = true;
+    int64_t firstTimeStamp = 0;
+    FUGesture::GestureEvent events[EVENT_BATCH_SIZE];
+
+    for (FURecording::RECORD_TYPE type = reader.readNext(); type != FURecording::NO_RECORD; type = reader.readNext()) {
+        if (type == FURecording::DEPTH_RECORD) {
+            result.depthFrameCount++;
+            if (estimateFloor && !hasRecordedFloor)
+                floorEstimator.update(reader.getDepthFrame());
+            continue;
+        }
+
+        frame = reader.getSkeletonFrame();
+        hasRecordedFloor = hasFloorPlane(frame);
+        if (!hasRecordedFloor && estimateFloor && floorEstimator.isValid()) {
+            const FUFloorEstimator::Plane &plane = floorEstimator.getPlane();
+            frame.floorPlane = FUMath::FUVector4<float>(plane.x, plane.y, plane.z, plane.w);
+        }
+        processor.processSkeletonFrame(frame);
+        for (size_t count = processor.pollEvents(events, EVENT_BATCH_SIZE); count > 0; count = processor.pollEvents(events, EVENT_BATCH_SIZE))
+            result.events.insert(result.events.end(), events, events + count);
+
+        if (result.skeletonFrameCount == 0)
+            firstTimeStamp = frame.timeStamp;
+        result.recordedDuration = frame.timeStamp - firstTimeStamp;
+        result.skeletonFrameCount++;
+    }
+    result.processingTime = FULatency::getTime() - startTime;
+    return result;
+}
+
+bool FUBatchReplay::writeEvents(const Result &result, const char *filePath)
+{
+    std::FILE *file = std::fopen(filePath, "w");
+    if (file == nullptr)
+        return false;
+    std::fprintf(file, "frameNumber,timeStamp,trackingID,detector,phase,hand\n");
+    for (size_t i = 0; i < result.events.size(); i++) {
+        const FUGesture::GestureEvent &event = result.events[i];
+        std::fprintf(file, "%u,%lld,%u,%s,%s,%d\n", event.frameNumber, static_cast<long long>(event.timeStamp), event.skeletonTrackingID,
+                     FUGesture::getDetectorName(event.detector), event.phase == FUGesture::EVENT_BEGAN ? "began" : "ended",
+                     static_cast<int>(event.handType));
+    }
+    return std::fclose(file) == 0;
+}
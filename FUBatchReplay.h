@@ -0,0 +1,96 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+#include <string>
+#include <vector>
+//Local Includes
+#include "FUGesture.h"
+#include "FUThreadPool.h"
+
+/**
+ * @brief Runs the detectors over recordings as fast as the CPU allows, for regression runs. Every recording is replayed on one
+ * thread with its own reader, frame processor and floor estimator, so the replays don't share any state and the events of a
+ * recording are the same on every run, whatever the number of threads. The recordings are handed to the threads of a pool,
+ * the longest ones first, and a thread that finishes takes the next recording that nobody started yet.
+ */
+class FUBatchReplay
+{
+public:
+    struct Result {
+        std::string filePath;
+        bool isOpened;
+        uint32_t skeletonFrameCount;
+        uint32_t depthFrameCount;
+        /**
+         * @brief Time between the first and the last skeleton frame in the recording, in milliseconds
+         */
+        int64_t recordedDuration;
+        /**
+         * @brief Time it took to replay the recording, in nanoseconds
+         */
+        int64_t processingTime;
+        std::vector<FUGesture::GestureEvent> events;
+
+        double getFramesPerSecond() const {return processingTime > 0 ? skeletonFrameCount * 1e9 / processingTime : 0;}
+        /**
+         * @brief Returns how many times faster than real time the recording was replayed.
+         * @return
+         */
+        double getSpeedup() const {return processingTime > 0 ? recordedDuration * 1e6 / processingTime : 0;}
+    };
+
+    /**
+     * @param workerCount --> See FUThreadPool
+     */
+    explicit FUBatchReplay(int workerCount = -1);
+    /**
+     * @brief Sets the detectors that are evaluated for every player. PUSH and GRIP need the interaction stream, which isn't
+     * recorded, so they never fire. All the others are evaluated by default.
+     * @param detectors --> A combination of FUGesture::DETECTORS
+     */
+    void setDetectors(unsigned int detectors) {mDetectors = detectors;}
+    unsigned int getDetectors() const {return mDetectors;}
+    /**
+     * @brief Enables estimating the floor from the recorded depth frames when the recorded skeleton frames have no floor
+     * plane, like FUKinectTool does. Enabled by default.
+     * @param enabled
+     */
+    void setFloorEstimationEnabled(bool enabled) {mEstimateFloor = enabled;}
+    int getThreadCount() const {return mThreadPool.getThreadCount();}
+    /**
+     * @brief Replays the recordings in parallel and returns when all of them are done.
+     * @param filePaths
+     * @return The results in the same order as filePaths
+     */
+    std::vector<Result> run(const std::vector<std::string> &filePaths);
+    /**
+     * @brief Returns the time that the last run() took, in nanoseconds.
+     * @return
+     */
+    int64_t getRunTime() const {return mRunTime;}
+    /**
+     * @brief Replays a single recording on the calling thread.
+     * @param filePath
+     * @param detectors --> A combination of FUGesture::DETECTORS
+     * @param estimateFloor --> See setFloorEstimationEnabled()
+     * @return
+     */
+    static Result replay(const std::string &filePath, unsigned int detectors, bool estimateFloor);
+    /**
+     * @brief Writes the events of a replay as CSV, one event per line, so the outputs of two releases can be diffed.
+     * @param result
+     * @param filePath
+     * @return false if the file can't be written
+     */
+    static bool writeEvents(const Result &result, const char *filePath);
+
+private:
+    FUThreadPool mThreadPool;
+    unsigned int mDetectors;
+    bool mEstimateFloor;
+    int64_t mRunTime;
+
+private:
+    FUBatchReplay(const FUBatchReplay&);
+    FUBatchReplay& operator=(const FUBatchReplay&);
+};
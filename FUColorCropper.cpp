@@ -0,0 +1,164 @@
+#include "FUColorCropper.h"
+//STL Includes
+#include <algorithm>
+#include <cstring>
+//Local Includes
+#include "FUSimd.h"
+#include "FUTrace.h"
+
+using namespace FUSkeleton;
+
+static const int DEFAULT_SIZE = 128;
+/**
+ * @brief The sums of the block columns are 16 bit, 255 * MAX_DOWNSCALE must fit
+ */
+static const int MAX_DOWNSCALE = 16;
+static const JOINT REGION_JOINTS[FUColorCropper::REGION_COUNT] = {HEAD, HAND_LEFT, HAND_RIGHT};
+
+FUColorCropper::FUColorCropper(int batchCount)
+    : mBatches(batchCount > 0 ? batchCount : 1)
+    , mNextBatch(0)
+    , mSize(0)
+    , mDownscale(1)
+    , mRegions(ALL_REGIONS)
+    , mDroppedCount(0)
+{
+    for (size_t i = 0; i < mBatches.size(); i++)
+        mBatches[i].isHeld = false;
+    configure(DEFAULT_SIZE, 1, ALL_REGIONS);
+}
+
+void FUColorCropper::configure(int size, int downscale, unsigned int regions)
+{
+    mSize = std::max(size, 1);
+    mDownscale = std::min(std::max(downscale, 1), MAX_DOWNSCALE);
+    mRegions = regions;
+    mColumnSums.resize(static_cast<size_t>(mSize) * mDownscale * 4);
+    const size_t cropByteCount = static_cast<size_t>(mSize) * mSize * 4;
+    for (size_t i = 0; i < mBatches.size(); i++) {
+        PooledBatch &pooledBatch = mBatches[i];
+        pooledBatch.pixels.resize(cropByteCount * MAX_CROPS);
+        pooledBatch.batch.size = mSize;
+        pooledBatch.batch.cropCount = 0;
+        for (int j = 0; j < MAX_CROPS; j++)
+            pooledBatch.batch.crops[j].pixels = &pooledBatch.pixels[cropByteCount * j];
+    }
+}
+
+const FUColorCropper::Batch* FUColorCropper::crop(const SkeletonFrame &skeletonFrame, const FURegistration &registration,
+                                                   const uint8_t *pixels, int width, int height, int pitch,
+                                                   uint32_t frameNumber, int64_t timeStamp)
+{
+    FU_TRACE_SCOPE(FUTrace::COLOR, "FUColorCropper::crop");
+    const int sourceSize = mSize * mDownscale;
+    if (!registration.isValid() || sourceSize > width || sourceSize > height)
+        return nullptr;
+    PooledBatch *pooledBatch = nullptr;
+    for (size_t i = 0; i < mBatches.size() && pooledBatch == nullptr; i++) {
+        PooledBatch &candidate = mBatches[(mNextBatch + i) % mBatches.size()];
+        if (!candidate.isHeld.load(std::memory_order_acquire))
+            pooledBatch = &candidate;
+    }
+    if (pooledBatch == nullptr) {
+        mDroppedCount++;
+        return nullptr;
+    }
+    mNextBatch = (pooledBatch - &mBatches[0] + 1) % mBatches.size();
+    pooledBatch->isHeld.store(true, std::memory_order_relaxed);
+
+    Batch &batch = pooledBatch->batch;
+    batch.frameNumber = frameNumber;
+    batch.timeStamp = timeStamp;
+    batch.cropCount = 0;
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        const SkeletonData &skeleton = skeletonFrame.skeletons[i];
+        if (skeleton.trackingState != SKELETON_TRACKED)
+            continue;
+        for (int region = 0; region < REGION_COUNT; region++) {
+            const JOINT joint = REGION_JOINTS[region];
+            float colorX = 0;
+            float colorY = 0;
+            if ((mRegions & (1 << region)) == 0 || skeleton.jointStates[joint] == JOINT_NOT_TRACKED
+                    || !registration.mapSkeletonPoint(skeleton.joints[joint], colorX, colorY))
+                continue;
+            uint8_t *output = &pooledBatch->pixels[static_cast<size_t>(mSize) * mSize * 4 * batch.cropCount];
+            Crop &crop = batch.crops[batch.cropCount++];
+            crop.trackingID = skeleton.trackingID;
+            crop.region = static_cast<REGIONS>(1 << region);
+            crop.x = std::min(std::max(static_cast<int>(colorX) - sourceSize / 2, 0), width - sourceSize);
+            crop.y = std::min(std::max(static_cast<int>(colorY) - sourceSize / 2, 0), height - sourceSize);
+            copyRegion(pixels, pitch, crop.x, crop.y, output);
+        }
+    }
+    return &batch;
+}
+
+void FUColorCropper::release(const Batch *batch)
+{
+    for (size_t i = 0; i < mBatches.size(); i++) {
+        if (&mBatches[i].batch == batch)
+            mBatches[i].isHeld.store(false, std::memory_order_release);
+    }
+}
+
+void FUColorCropper::copyRegion(const uint8_t *pixels, int pitch, int x, int y, uint8_t *output)
+{
+    const size_t rowByteCount = static_cast<size_t>(mSize) * 4;
+    if (mDownscale == 1) {
+        for (int row = 0; row < mSize; row++)
+            std::memcpy(output + rowByteCount * row, pixels + static_cast<ptrdiff_t>(pitch) * (y + row) + x * 4, rowByteCount);
+        return;
+    }
+    //Fixed point reciprocal of the pixel count of a block, instead of a division per channel
+    const int blockPixelCount = mDownscale * mDownscale;
+    const uint32_t reciprocal = ((1u << 16) + blockPixelCount / 2) / blockPixelCount;
+    const int sourceByteCount = mSize * mDownscale * 4;
+    uint16_t *columnSums = &mColumnSums[0];
+    for (int row = 0; row < mSize; row++) {
+        //The rows of the blocks are summed first, then the columns of every block
+        const uint8_t *block = pixels + static_cast<ptrdiff_t>(pitch) * (y + row * mDownscale) + x * 4;
+        std::memset(columnSums, 0, sourceByteCount * sizeof(uint16_t));
+        for (int blockRow = 0; blockRow < mDownscale; blockRow++) {
+            const uint8_t *source = block + static_cast<ptrdiff_t>(pitch) * blockRow;
+            int i = 0;
+#ifdef FU_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            for (; i + 16 <= sourceByteCount; i += 16) {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+                __m128i *sums = reinterpret_cast<__m128i*>(columnSums + i);
+                _mm_storeu_si128(sums, _mm_add_epi16(_mm_loadu_si128(sums), _mm_unpacklo_epi8(bytes, zero)));
+                _mm_storeu_si128(sums + 1, _mm_add_epi16(_mm_loadu_si128(sums + 1), _mm_unpackhi_epi8(bytes, zero)));
+            }
+#endif
+            for (; i < sourceByteCount; i++)
+                columnSums[i] += source[i];
+        }
+        uint8_t *destination = output + rowByteCount * row;
+        int column = 0;
+#ifdef FU_SSE2
+        //Two crop pixels at a time, the rounding of the fixed point product is taken from the top bit of its low half
+        const __m128i scale = _mm_set1_epi16(static_cast<short>(reciprocal));
+        for (; column + 2 <= mSize; column += 2) {
+            const uint16_t *sums = columnSums + column * mDownscale * 4;
+            __m128i left = _mm_setzero_si128();
+            __m128i right = _mm_setzero_si128();
+            for (int blockColumn = 0; blockColumn < mDownscale; blockColumn++) {
+                left = _mm_add_epi16(left, _mm_loadl_epi64(reinterpret_cast<const __m128i*>(sums + blockColumn * 4)));
+                right = _mm_add_epi16(right, _mm_loadl_epi64(reinterpret_cast<const __m128i*>(sums + (mDownscale + blockColumn) * 4)));
+            }
+            const __m128i blockSums = _mm_unpacklo_epi64(left, right);
+            const __m128i averages = _mm_add_epi16(_mm_mulhi_epu16(blockSums, scale), _mm_srli_epi16(_mm_mullo_epi16(blockSums, scale), 15));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(destination + column * 4), _mm_packus_epi16(averages, averages));
+        }
+#endif
+        for (; column < mSize; column++) {
+            const uint16_t *sums = columnSums + column * mDownscale * 4;
+            for (int channel = 0; channel < 4; channel++) {
+                uint32_t sum = 0;
+                for (int blockColumn = 0; blockColumn < mDownscale; blockColumn++)
+                    sum += sums[blockColumn * 4 + channel];
+                destination[column * 4 + channel] = static_cast<uint8_t>(std::min<uint32_t>((sum * reciprocal + (1u << 15)) >> 16, 255));
+            }
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+//STL Includes
+#include <atomic>
+#include <cstdint>
+#include <vector>
+//Local Includes
+#include "FURegistration.h"
+#include "FUSkeleton.h"
+
+/**
+ * @brief Cuts fixed size crops around the heads and the hands of the players out of a color frame, so that the models that
+ * only look at faces and hands get a few small images per player instead of the whole frame. The crops of a frame are
+ * written to a batch from a small pool, which the consumer holds until it calls release(), so the batches can be handed to
+ * another thread without a copy.
+ */
+class FUColorCropper
+{
+public:
+    enum REGIONS {
+        HEAD_REGION = 1 << 0,
+        LEFT_HAND_REGION = 1 << 1,
+        RIGHT_HAND_REGION = 1 << 2,
+        ALL_REGIONS = (1 << 3) - 1
+    };
+
+    static const int REGION_COUNT = 3;
+    static const int MAX_CROPS = FUSkeleton::MAX_SKELETONS * REGION_COUNT;
+
+    struct Crop {
+        uint32_t trackingID;
+        REGIONS region;
+        /**
+         * @brief Top left corner of the cropped area in the color frame. The area is moved inside the frame when the joint
+         * is close to an edge, so the joint isn't always at the center.
+         */
+        int x;
+        int y;
+        /**
+         * @brief Batch::size x Batch::size 32 bit BGRX pixels without padding
+         */
+        const uint8_t *pixels;
+    };
+
+    struct Batch {
+        uint32_t frameNumber;
+        int64_t timeStamp;
+        /**
+         * @brief Width and height of the crops in pixels
+         */
+        int size;
+        int cropCount;
+        Crop crops[MAX_CROPS];
+    };
+
+    /**
+     * @param batchCount --> Number of batches in the pool. A frame is dropped when all of them are held.
+     */
+    explicit FUColorCropper(int batchCount = 3);
+    /**
+     * @brief Sets the crop size and the regions. Call this while no batch is held.
+     * @param size --> Width and height of the crops in pixels, 128 by default
+     * @param downscale --> Each crop pixel is the average of downscale x downscale color pixels, 1 by default and 16 at most
+     * @param regions --> A combination of REGIONS, all of them by default
+     */
+    void configure(int size, int downscale, unsigned int regions);
+    int getSize() const {return mSize;}
+    int getDownscale() const {return mDownscale;}
+    /**
+     * @brief Crops the regions of the tracked players from a color frame.
+     * @param skeletonFrame --> The joints are mapped to the color frame with registration
+     * @param registration --> Its tables must be built
+     * @param pixels --> 32 bit BGRX pixels of the color frame
+     * @param width
+     * @param height
+     * @param pitch --> Bytes between the rows of pixels
+     * @param frameNumber --> Frame number of the color frame
+     * @param timeStamp --> Time stamp of the color frame
+     * @return A held batch, or nullptr if all the batches are held or the registration isn't valid
+     */
+    const Batch* crop(const FUSkeleton::SkeletonFrame &skeletonFrame, const FURegistration &registration, const uint8_t *pixels,
+                      int width, int height, int pitch, uint32_t frameNumber, int64_t timeStamp);
+    /**
+     * @brief Returns a batch to the pool. This can be called from any thread.
+     * @param batch
+     */
+    void release(const Batch *batch);
+    /**
+     * @brief Returns the number of frames that weren't cropped because all the batches were held.
+     * @return
+     */
+    size_t getDroppedCount() const {return mDroppedCount;}
+
+private:
+    struct PooledBatch {
+        Batch batch;
+        std::vector<uint8_t> pixels;
+        std::atomic<bool> isHeld;
+    };
+
+    std::vector<PooledBatch> mBatches;
+    size_t mNextBatch;
+    int mSize;
+    int mDownscale;
+    unsigned int mRegions;
+    size_t mDroppedCount;
+    /**
+     * @brief Sums of the channels of a row of blocks, for downscaling
+     */
+    std::vector<uint16_t> mColumnSums;
+
+private:
+    void copyRegion(const uint8_t *pixels, int pitch, int x, int y, uint8_t *output);
+    FUColorCropper(const FUColorCropper&);
+    FUColorCropper& operator=(const FUColorCropper&);
+};
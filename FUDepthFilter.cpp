@@ -0,0 +1,184 @@
+#include "FUDepthFilter.h"
+//STL Includes
+#include <cstdlib>
+#include <cstring>
+//Local Includes
+#include "FUSimd.h"
+#include "FUThreadPool.h"
+#include "FUTrace.h"
+
+//Number of rows processed by one task
+static const int BAND_HEIGHT = 16;
+//The history starts over when the time between two frames is longer than this, in milliseconds
+static const int64_t MAX_FRAME_INTERVAL = 100;
+
+FUDepthFilter::FUDepthFilter(FUThreadPool *threadPool)
+    : mThreadPool(threadPool)
+    , mTemporalThreshold(50)
+    , mMaxHoleWidth(16)
+    , mWidth(0)
+    , mHeight(0)
+    , mHistoryIndex(0)
+    , mHistoryLength(0)
+    , mFrame(nullptr)
+    , mLastTimeStamp(0)
+{
+    mFilteredFrame.pixels = nullptr;
+    mFilteredFrame.width = 0;
+    mFilteredFrame.height = 0;
+    mFilteredFrame.timeStamp = 0;
+}
+
+const FUDepthFrame& FUDepthFilter::process(const FUDepthFrame &frame)
+{
+    FU_TRACE_SCOPE(FUTrace::DEPTH, "FUDepthFilter::process");
+    if (frame.width != mWidth || frame.height != mHeight)
+        resize(frame.width, frame.height);
+    if (mHistoryLength > 0 && (frame.timeStamp < mLastTimeStamp || frame.timeStamp - mLastTimeStamp > MAX_FRAME_INTERVAL))
+        reset();
+    mLastTimeStamp = frame.timeStamp;
+
+    if (mHistoryLength == 0) {
+        //Without a history the frame is its own history, so the first frame is only hole filled
+        for (int y = 0; y < mHeight; y++) {
+            const FUDepthPixel *row = frame.pixels + y * mWidth;
+            uint16_t *smoothed = &mSmoothed[y * mWidth];
+            for (int x = 0; x < mWidth; x++)
+                smoothed[x] = row[x].depth;
+        }
+        for (int i = 0; i < HISTORY_SIZE; i++)
+            mHistory[i] = mSmoothed;
+        mHistoryLength = HISTORY_SIZE;
+    }
+
+    mFrame = &frame;
+    const int bandCount = (mHeight + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    if (mThreadPool) {
+        mThreadPool->parallelFor(bandCount, [this](int band) {
+            processRows(band * BAND_HEIGHT, band * BAND_HEIGHT + BAND_HEIGHT);
+        });
+    }
+    else {
+        processRows(0, mHeight);
+    }
+    mFrame = nullptr;
+    //The current frame replaced the older one in the history
+    mHistoryIndex = (mHistoryIndex + 1) % HISTORY_SIZE;
+    mFilteredFrame.timeStamp = frame.timeStamp;
+    return mFilteredFrame;
+}
+
+void FUDepthFilter::resize(int width, int height)
+{
+    mWidth = width;
+    mHeight = height;
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+    for (int i = 0; i < HISTORY_SIZE; i++)
+        mHistory[i].assign(pixelCount, 0);
+    mSmoothed.assign(pixelCount, 0);
+    mFiltered.assign(pixelCount, FUDepthPixel());
+    mFilteredFrame.pixels = mFiltered.empty() ? nullptr : &mFiltered[0];
+    mFilteredFrame.width = width;
+    mFilteredFrame.height = height;
+    mHistoryLength = 0;
+}
+
+void FUDepthFilter::processRows(int firstRow, int lastRow)
+{
+    if (lastRow > mHeight)
+        lastRow = mHeight;
+    uint16_t *older = &mHistory[mHistoryIndex][0];
+    uint16_t *newer = &mHistory[(mHistoryIndex + 1) % HISTORY_SIZE][0];
+    for (int y = firstRow; y < lastRow; y++) {
+        const size_t offset = static_cast<size_t>(y) * mWidth;
+        filterRow(mFrame->pixels + offset, older + offset, newer + offset, &mSmoothed[offset], &mFiltered[offset]);
+        fillHoles(&mFiltered[offset]);
+    }
+}
+
+void FUDepthFilter::filterRow(const FUDepthPixel *raw, uint16_t *older, uint16_t *newer, uint16_t *smoothed, FUDepthPixel *filtered)
+{
+    int x = 0;
+#ifdef FU_SSE2
+    //The depth is less than 2^15, so the signed 16 bit operations can be used
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i threshold = _mm_set1_epi16(static_cast<short>(mTemporalThreshold));
+    const __m128i lowHalf = _mm_set1_epi32(0xFFFF);
+    for (; x + 8 <= mWidth; x += 8) {
+        const __m128i rawLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + x));
+        const __m128i rawHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + x + 4));
+        const __m128i current = _mm_packs_epi32(_mm_srli_epi32(rawLow, 16), _mm_srli_epi32(rawHigh, 16));
+        const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(older + x));
+        const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(newer + x));
+        const __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(smoothed + x));
+
+        //Median of three
+        const __m128i median = _mm_max_epi16(_mm_min_epi16(current, first), _mm_min_epi16(_mm_max_epi16(current, first), second));
+        //The median is used for the unknown pixels and where the current value is close to it
+        const __m128i currentUnknown = _mm_cmpeq_epi16(current, zero);
+        const __m128i medianDifference = _mm_sub_epi16(median, current);
+        const __m128i medianClose = _mm_cmplt_epi16(_mm_max_epi16(medianDifference, _mm_sub_epi16(zero, medianDifference)), threshold);
+        const __m128i useMedian = _mm_or_si128(currentUnknown, medianClose);
+        const __m128i value = _mm_or_si128(_mm_and_si128(useMedian, median), _mm_andnot_si128(useMedian, current));
+        //Exponential smoothing with a weight of 1/2 where the value didn't move
+        const __m128i difference = _mm_sub_epi16(value, previous);
+        const __m128i still = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi16(value, zero), _mm_cmpeq_epi16(previous, zero)),
+                                               _mm_cmplt_epi16(_mm_max_epi16(difference, _mm_sub_epi16(zero, difference)), threshold));
+        const __m128i average = _mm_add_epi16(previous, _mm_srai_epi16(difference, 1));
+        const __m128i result = _mm_or_si128(_mm_and_si128(still, average), _mm_andnot_si128(still, value));
+
+        //The current frame replaces the older one in the history
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(older + x), current);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(smoothed + x), result);
+        //Depth in the upper half of the pixels, the player index of the raw frame in the lower half
+        const __m128i pixelsLow = _mm_or_si128(_mm_unpacklo_epi16(zero, result), _mm_and_si128(rawLow, lowHalf));
+        const __m128i pixelsHigh = _mm_or_si128(_mm_unpackhi_epi16(zero, result), _mm_and_si128(rawHigh, lowHalf));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(filtered + x), pixelsLow);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(filtered + x + 4), pixelsHigh);
+    }
+#endif
+    for (; x < mWidth; x++) {
+        const int current = raw[x].depth;
+        const int first = older[x];
+        const int second = newer[x];
+        const int previous = smoothed[x];
+        const int low = current < first ? current : first;
+        const int high = current < first ? first : current;
+        const int upper = high < second ? high : second;
+        const int median = low > upper ? low : upper;
+        const int value = current == 0 || std::abs(median - current) < mTemporalThreshold ? median : current;
+        const int difference = value - previous;
+        const bool isStill = value != 0 && previous != 0 && std::abs(difference) < mTemporalThreshold;
+        //An arithmetic shift to match the vectorized version
+        const int result = isStill ? previous + (difference >> 1) : value;
+
+        older[x] = static_cast<uint16_t>(current);
+        smoothed[x] = static_cast<uint16_t>(result);
+        filtered[x].playerIndex = raw[x].playerIndex;
+        filtered[x].depth = static_cast<uint16_t>(result);
+    }
+}
+
+void FUDepthFilter::fillHoles(FUDepthPixel *row)
+{
+    int x = 0;
+    while (x < mWidth) {
+        if (row[x].depth != 0) {
+            x++;
+            continue;
+        }
+        const int start = x;
+        while (x < mWidth && row[x].depth == 0)
+            x++;
+        if (x - start > mMaxHoleWidth)
+            continue;
+        //The farther neighbour, or the only one at the borders
+        const uint16_t left = start > 0 ? row[start - 1].depth : 0;
+        const uint16_t right = x < mWidth ? row[x].depth : 0;
+        const uint16_t depth = left > right ? left : right;
+        for (int i = start; i < x; i++) {
+            row[i].depth = depth;
+            row[i].playerIndex = 0;
+        }
+    }
+}
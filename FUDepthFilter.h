@@ -0,0 +1,72 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+#include <vector>
+//Local Includes
+#include "FUDepthFrame.h"
+
+class FUThreadPool;
+
+/**
+ * @brief Removes the flicker and the small holes of the raw depth frames before the other stages use them.
+ * Every pixel is first replaced with the median of its last three values, which also fills the holes that appear for a
+ * single frame, and then smoothed exponentially. Both are skipped where the depth changes by more than the temporal
+ * threshold so that moving edges don't lag. The remaining holes that are narrower than the maximum hole width are filled
+ * with the farther of their left and right neighbours, since the holes next to an edge are shadows on the background.
+ * The frame is processed in bands of rows on the thread pool. The buffers are only allocated when the frame size changes.
+ */
+class FUDepthFilter
+{
+public:
+    /**
+     * @param threadPool --> Used to process the bands of rows. It can be nullptr.
+     */
+    explicit FUDepthFilter(FUThreadPool *threadPool = nullptr);
+    /**
+     * @brief Pixels that change more than this between frames are moving and aren't filtered in time. The default is 50 mm.
+     * @param depthDifference --> In millimeters
+     */
+    void setTemporalThreshold(int depthDifference) {mTemporalThreshold = depthDifference;}
+    /**
+     * @brief Horizontal runs of unknown pixels that are wider than this aren't filled. The default is 16 pixels.
+     * @param pixelCount
+     */
+    void setMaxHoleWidth(int pixelCount) {mMaxHoleWidth = pixelCount;}
+    /**
+     * @brief Filters a frame. When the frame doesn't follow the previous one, e.g. frames were skipped, the history starts over.
+     * @param frame
+     * @return The filtered frame. The player indices are kept from the raw frame and the filled pixels don't belong to a
+     * player. It is valid until the next call.
+     */
+    const FUDepthFrame& process(const FUDepthFrame &frame);
+    const FUDepthFrame& getFilteredFrame() const {return mFilteredFrame;}
+    /**
+     * @brief Forgets the frame history.
+     */
+    void reset() {mHistoryLength = 0;}
+
+private:
+    static const int HISTORY_SIZE = 2;
+
+    FUThreadPool *mThreadPool;
+    int mTemporalThreshold;
+    int mMaxHoleWidth;
+    int mWidth;
+    int mHeight;
+    //The last two raw frames, mHistory[mHistoryIndex] is the older one
+    std::vector<uint16_t> mHistory[HISTORY_SIZE];
+    int mHistoryIndex;
+    int mHistoryLength;
+    //Temporally filtered depth of the last frame, before the holes are filled
+    std::vector<uint16_t> mSmoothed;
+    std::vector<FUDepthPixel> mFiltered;
+    FUDepthFrame mFilteredFrame;
+    const FUDepthFrame *mFrame;
+    int64_t mLastTimeStamp;
+
+private:
+    void resize(int width, int height);
+    void processRows(int firstRow, int lastRow);
+    void filterRow(const FUDepthPixel *raw, uint16_t *older, uint16_t *newer, uint16_t *smoothed, FUDepthPixel *filtered);
+    void fillHoles(FUDepthPixel *row);
+};
@@ -0,0 +1,32 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+
+/**
+ * @brief A depth pixel with the same layout as NUI_DEPTH_IMAGE_PIXEL, so the locked depth texture can be used without a copy.
+ */
+struct FUDepthPixel {
+    uint16_t playerIndex;//0 when the pixel doesn't belong to a player, 1-6 otherwise
+    uint16_t depth;//Distance to the camera plane in millimeters, 0 when unknown
+};
+
+/**
+ * @brief A view of a depth frame. The pixels aren't owned by the frame.
+ */
+struct FUDepthFrame {
+    const FUDepthPixel *pixels;
+    int width;
+    int height;
+    int64_t timeStamp;
+};
+
+/**
+ * @brief Returns the nominal focal length of the depth camera in pixels for the given frame width.
+ * @param width --> Width of the depth frame, 80, 320 or 640
+ * @return float
+ */
+inline float getDepthFocalLength(int width)
+{
+    //NUI_CAMERA_DEPTH_NOMINAL_FOCAL_LENGTH_IN_PIXELS is given for 320x240
+    return 285.63f * width / 320.f;
+}
@@ -0,0 +1,275 @@
+#include "FUDepthSegmentation.h"
+//STL Includes
+#include <algorithm>
+#include <climits>
+//Local Includes
+#include "FUSimd.h"
+#include "FUTrace.h"
+
+static void resetSegment(FUDepthSegmentation::Segment &segment)
+{
+    segment.pixelCount = 0;
+    segment.left = segment.top = segment.right = segment.bottom = 0;
+    segment.centroidX = segment.centroidY = segment.averageDepth = 0.f;
+}
+
+FUDepthSegmentation::FUDepthSegmentation()
+    : mWidth(0)
+    , mHeight(0)
+    , mMinimumForegroundDepth(500)
+    , mMaximumForegroundDepth(3500)
+    , mMinimumBlobSize(400)
+    , mBackground(nullptr)
+    , mBackgroundMargin(0)
+    , mBlobCount(0)
+{
+    for (int i = 0; i < MAX_PLAYERS; i++)
+        resetSegment(mPlayers[i]);
+}
+
+void FUDepthSegmentation::setForegroundRange(int minDepth, int maxDepth)
+{
+    //The vectorized comparisons are done on signed 16 bit values
+    mMinimumForegroundDepth = std::max(minDepth, 1);
+    mMaximumForegroundDepth = std::min(maxDepth, SHRT_MAX - 1);
+}
+
+void FUDepthSegmentation::setBackground(const uint16_t *background, int margin)
+{
+    mBackground = background;
+    mBackgroundMargin = margin;
+}
+
+void FUDepthSegmentation::resize(int width, int height)
+{
+    mWidth = width;
+    mHeight = height;
+    mPlayerMask.assign(width * height, 0);
+    //Every other pixel in the frame can start a run
+    const size_t maxRuns = static_cast<size_t>(width / 2 + 1) * height;
+    mRuns.reserve(maxRuns);
+    mRunParents.reserve(maxRuns);
+    mRootComponents.reserve(maxRuns);
+    mComponents.reserve(maxRuns);
+}
+
+void FUDepthSegmentation::process(const FUDepthFrame &frame)
+{
+    FU_TRACE_SCOPE(FUTrace::DEPTH, "FUDepthSegmentation::process");
+    if (frame.width != mWidth || frame.height != mHeight)
+        resize(frame.width, frame.height);
+    mRuns.clear();
+
+    Accumulator players[MAX_PLAYERS];
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        Accumulator &player = players[i];
+        player.pixelCount = player.sumX = player.sumY = player.sumDepth = 0;
+        player.left = player.top = INT_MAX;
+        player.right = player.bottom = -1;
+    }
+    for (int y = 0; y < frame.height; y++)
+        processRow(frame.pixels + y * frame.width, y, players);
+
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        const Accumulator &player = players[i];
+        Segment &segment = mPlayers[i];
+        if (player.pixelCount == 0) {
+            resetSegment(segment);
+            continue;
+        }
+        segment.pixelCount = static_cast<int>(player.pixelCount);
+        segment.left = player.left;
+        segment.top = player.top;
+        segment.right = player.right;
+        segment.bottom = player.bottom;
+        segment.centroidX = static_cast<float>(player.sumX) / player.pixelCount;
+        segment.centroidY = static_cast<float>(player.sumY) / player.pixelCount;
+        segment.averageDepth = static_cast<float>(player.sumDepth) / player.pixelCount;
+    }
+    labelBlobs(frame);
+}
+
+void FUDepthSegmentation::addPlayerPixel(Accumulator &player, int x, int y, int depth)
+{
+    player.pixelCount++;
+    player.sumX += x;
+    player.sumY += y;
+    player.sumDepth += depth;
+    player.left = std::min(player.left, x);
+    player.right = std::max(player.right, x);
+    player.top = std::min(player.top, y);
+    player.bottom = y;
+}
+
+void FUDepthSegmentation::processRow(const FUDepthPixel *row, int y, Accumulator *players)
+{
+    uint8_t *mask = &mPlayerMask[y * mWidth];
+    const uint16_t *background = mBackground ? mBackground + y * mWidth : nullptr;
+    int runStart = -1;
+    int x = 0;
+#ifdef FU_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowHalf = _mm_set1_epi32(0xFFFF);
+    const __m128i minDepth = _mm_set1_epi16(static_cast<short>(mMinimumForegroundDepth - 1));
+    const __m128i maxDepth = _mm_set1_epi16(static_cast<short>(mMaximumForegroundDepth + 1));
+    const __m128i margin = _mm_set1_epi16(static_cast<short>(mBackgroundMargin));
+    for (; x + 8 <= mWidth; x += 8) {
+        const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+        const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 4));
+        //Split the packed pixels to 8 player indices and 8 depths. Depths over SHRT_MAX saturate, they are never foreground.
+        const __m128i playerIndices = _mm_packs_epi32(_mm_and_si128(first, lowHalf), _mm_and_si128(second, lowHalf));
+        const __m128i depths = _mm_packs_epi32(_mm_srli_epi32(first, 16), _mm_srli_epi32(second, 16));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(mask + x), _mm_packus_epi16(playerIndices, zero));
+
+        const __m128i isPlayer = _mm_cmpgt_epi16(playerIndices, zero);
+        __m128i isForeground = _mm_andnot_si128(isPlayer,
+                                                _mm_and_si128(_mm_cmpgt_epi16(depths, minDepth), _mm_cmplt_epi16(depths, maxDepth)));
+        if (background) {
+            const __m128i backgroundDepths = _mm_loadu_si128(reinterpret_cast<const __m128i*>(background + x));
+            const __m128i isUnknown = _mm_cmpeq_epi16(backgroundDepths, zero);
+            const __m128i isCloser = _mm_cmplt_epi16(_mm_add_epi16(depths, margin), backgroundDepths);
+            isForeground = _mm_and_si128(isForeground, _mm_or_si128(isUnknown, isCloser));
+        }
+        //Two bits for every pixel
+        const int playerBits = _mm_movemask_epi8(isPlayer);
+        const int foregroundBits = _mm_movemask_epi8(isForeground);
+        if (playerBits != 0) {
+            for (int i = 0; i < 8; i++) {
+                if ((playerBits & (1 << (2 * i))) && mask[x + i] <= MAX_PLAYERS)
+                    addPlayerPixel(players[mask[x + i] - 1], x + i, y, row[x + i].depth);
+            }
+        }
+        if (foregroundBits == 0) {
+            if (runStart >= 0) {
+                addRun(y, runStart, x);
+                runStart = -1;
+            }
+        }
+        else if (foregroundBits == 0xFFFF) {
+            if (runStart < 0)
+                runStart = x;
+        }
+        else {
+            for (int i = 0; i < 8; i++) {
+                const bool isForegroundPixel = (foregroundBits & (1 << (2 * i))) != 0;
+                if (isForegroundPixel && runStart < 0)
+                    runStart = x + i;
+                else if (!isForegroundPixel && runStart >= 0) {
+                    addRun(y, runStart, x + i);
+                    runStart = -1;
+                }
+            }
+        }
+    }
+#endif
+    for (; x < mWidth; x++) {
+        const int playerIndex = row[x].playerIndex;
+        const int depth = row[x].depth;
+        mask[x] = static_cast<uint8_t>(playerIndex);
+        bool isForegroundPixel = false;
+        if (playerIndex > 0 && playerIndex <= MAX_PLAYERS)
+            addPlayerPixel(players[playerIndex - 1], x, y, depth);
+        else if (depth >= mMinimumForegroundDepth && depth <= mMaximumForegroundDepth)
+            isForegroundPixel = background == nullptr || background[x] == 0 || depth + mBackgroundMargin < background[x];
+        if (isForegroundPixel && runStart < 0)
+            runStart = x;
+        else if (!isForegroundPixel && runStart >= 0) {
+            addRun(y, runStart, x);
+            runStart = -1;
+        }
+    }
+    if (runStart >= 0)
+        addRun(y, runStart, mWidth);
+}
+
+void FUDepthSegmentation::addRun(int y, int start, int end)
+{
+    Run run = {y, start, end};
+    mRuns.push_back(run);
+}
+
+int FUDepthSegmentation::findRoot(int run)
+{
+    while (mRunParents[run] != run) {
+        //Path halving
+        mRunParents[run] = mRunParents[mRunParents[run]];
+        run = mRunParents[run];
+    }
+    return run;
+}
+
+void FUDepthSegmentation::labelBlobs(const FUDepthFrame &frame)
+{
+    const int runCount = static_cast<int>(mRuns.size());
+    mRunParents.resize(runCount);
+    for (int i = 0; i < runCount; i++)
+        mRunParents[i] = i;
+
+    //Union the runs that touch a run of the previous row, including diagonally
+    int previousRowFirst = 0, previousRowEnd = 0;
+    int currentRowFirst = 0;
+    for (int i = 0; i < runCount; i++) {
+        const Run &run = mRuns[i];
+        if (i == 0 || run.row != mRuns[i - 1].row) {
+            const bool isNextRow = i > 0 && run.row == mRuns[i - 1].row + 1;
+            previousRowFirst = isNextRow ? currentRowFirst : i;
+            previousRowEnd = i;
+            currentRowFirst = i;
+        }
+        while (previousRowFirst < previousRowEnd && mRuns[previousRowFirst].end < run.start)
+            previousRowFirst++;
+        for (int j = previousRowFirst; j < previousRowEnd && mRuns[j].start <= run.end; j++) {
+            const int root = findRoot(i);
+            const int otherRoot = findRoot(j);
+            if (root < otherRoot)
+                mRunParents[otherRoot] = root;
+            else if (otherRoot < root)
+                mRunParents[root] = otherRoot;
+        }
+    }
+
+    //Accumulate the statistics of every component
+    mRootComponents.assign(runCount, -1);
+    mComponents.clear();
+    for (int i = 0; i < runCount; i++) {
+        const Run &run = mRuns[i];
+        const int root = findRoot(i);
+        if (mRootComponents[root] < 0) {
+            mRootComponents[root] = static_cast<int>(mComponents.size());
+            Accumulator component = {0, 0, 0, 0, INT_MAX, INT_MAX, -1, -1};
+            mComponents.push_back(component);
+        }
+        Accumulator &component = mComponents[mRootComponents[root]];
+        const int length = run.end - run.start;
+        const FUDepthPixel *pixels = frame.pixels + run.row * frame.width;
+        for (int x = run.start; x < run.end; x++)
+            component.sumDepth += pixels[x].depth;
+        component.pixelCount += length;
+        component.sumX += static_cast<int64_t>(run.start + run.end - 1) * length / 2;
+        component.sumY += static_cast<int64_t>(run.row) * length;
+        component.left = std::min(component.left, run.start);
+        component.right = std::max(component.right, run.end - 1);
+        component.top = std::min(component.top, run.row);
+        component.bottom = std::max(component.bottom, run.row);
+    }
+
+    //Keep the largest blobs
+    std::sort(mComponents.begin(), mComponents.end(), [](const Accumulator &first, const Accumulator &second) {
+        return first.pixelCount > second.pixelCount;
+    });
+    mBlobCount = 0;
+    for (size_t i = 0; i < mComponents.size() && mBlobCount < MAX_BLOBS; i++) {
+        const Accumulator &component = mComponents[i];
+        if (component.pixelCount < mMinimumBlobSize)
+            break;
+        Segment &blob = mBlobs[mBlobCount++];
+        blob.pixelCount = static_cast<int>(component.pixelCount);
+        blob.left = component.left;
+        blob.top = component.top;
+        blob.right = component.right;
+        blob.bottom = component.bottom;
+        blob.centroidX = static_cast<float>(component.sumX) / component.pixelCount;
+        blob.centroidY = static_cast<float>(component.sumY) / component.pixelCount;
+        blob.averageDepth = static_cast<float>(component.sumDepth) / component.pixelCount;
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+#include <vector>
+//Local Includes
+#include "FUDepthFrame.h"
+
+/**
+ * @brief Extracts the per player masks and statistics from the player index bits of a depth frame, and labels the
+ * foreground pixels that don't belong to a player (carried objects, people that aren't tracked yet) as connected blobs.
+ * Both are done in a single pass over the frame. The buffers are only allocated when the frame size changes.
+ */
+class FUDepthSegmentation
+{
+public:
+    static const int MAX_PLAYERS = 6;
+    static const int MAX_BLOBS = 64;
+
+    /**
+     * @brief Statistics of a player or a blob. The bounding box is inclusive and in depth pixels.
+     */
+    struct Segment {
+        int pixelCount;
+        int left;
+        int top;
+        int right;
+        int bottom;
+        float centroidX;
+        float centroidY;
+        float averageDepth;//In millimeters
+    };
+
+public:
+    FUDepthSegmentation();
+    /**
+     * @brief Pixels that don't belong to a player are foreground when their depth is within this range. The default is
+     * 500-3500 mm.
+     * @param minDepth --> In millimeters
+     * @param maxDepth --> In millimeters
+     */
+    void setForegroundRange(int minDepth, int maxDepth);
+    /**
+     * @brief Blobs smaller than this are ignored. The default is 400 pixels.
+     * @param pixelCount
+     */
+    void setMinimumBlobSize(int pixelCount) {mMinimumBlobSize = pixelCount;}
+    /**
+     * @brief Sets a background depth image of the same size as the frames. When set, only the pixels that are at least margin
+     * closer than the background are foreground. Pass nullptr to remove it.
+     * @param background --> Depth in millimeters, 0 where unknown. It isn't copied.
+     * @param margin --> In millimeters
+     */
+    void setBackground(const uint16_t *background, int margin);
+    void process(const FUDepthFrame &frame);
+
+    /**
+     * @brief Returns the statistics of a player from the last processed frame.
+     * @param playerIndex --> 1-6, as in the player index bits of the depth frame
+     * @return Segment with a pixelCount of 0 if the player isn't in the frame
+     */
+    const Segment& getPlayerSegment(int playerIndex) const {return mPlayers[playerIndex - 1];}
+    /**
+     * @brief Returns the player index of every pixel of the last processed frame, 0 for the pixels that don't belong to a player.
+     * @return
+     */
+    const uint8_t* getPlayerMask() const {return mPlayerMask.empty() ? nullptr : &mPlayerMask[0];}
+    const Segment* getBlobs() const {return mBlobs;}
+    int getBlobCount() const {return mBlobCount;}
+
+private:
+    struct Run {
+        int row;
+        int start;
+        int end;//Exclusive
+    };
+
+    struct Accumulator {
+        int64_t pixelCount;
+        int64_t sumX;
+        int64_t sumY;
+        int64_t sumDepth;
+        int left;
+        int top;
+        int right;
+        int bottom;
+    };
+
+    int mWidth;
+    int mHeight;
+    int mMinimumForegroundDepth;
+    int mMaximumForegroundDepth;
+    int mMinimumBlobSize;
+    const uint16_t *mBackground;
+    int mBackgroundMargin;
+    std::vector<uint8_t> mPlayerMask;
+    std::vector<Run> mRuns;
+    std::vector<int> mRunParents;
+    std::vector<int> mRootComponents;
+    std::vector<Accumulator> mComponents;
+    Segment mPlayers[MAX_PLAYERS];
+    Segment mBlobs[MAX_BLOBS];
+    int mBlobCount;
+
+private:
+    void resize(int width, int height);
+    /**
+     * @brief Writes the player mask, accumulates the player statistics and finds the foreground runs of a row.
+     */
+    void processRow(const FUDepthPixel *row, int y, Accumulator *players);
+    void addPlayerPixel(Accumulator &player, int x, int y, int depth);
+    void addRun(int y, int start, int end);
+    int findRoot(int run);
+    void labelBlobs(const FUDepthFrame &frame);
+};
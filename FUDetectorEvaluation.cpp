@@ -0,0 +1,251 @@
+#include "FUDetectorEvaluation.h"
+//STL Includes
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+//Local Includes
+#include "FUBatchReplay.h"
+#include "FUFrameProcessor.h"
+#include "FULatency.h"
+#include "FURecording.h"
+
+using namespace FUSkeleton;
+
+static const unsigned int EVALUATED_DETECTORS = FUGesture::ALL_DETECTORS & ~(FUGesture::PUSH | FUGesture::GRIP);
+static const int DEFAULT_TOLERANCE = 5;
+/**
+ * @brief The frames are timed over and over until this much time passed, in nanoseconds, so short recordings are measured too
+ */
+static const int64_t MIN_TIMING_TIME = 5000000;
+
+/**
+ * @brief A range of frames in which a detector was active for a player. end is one past the last frame.
+ */
+struct Activation {
+    uint32_t trackingID;
+    size_t begin;
+    size_t end;
+};
+
+static int getDetectorIndex(FUGesture::DETECTORS detector)
+{
+    for (int i = 0; i < FUGesture::DETECTOR_COUNT; i++) {
+        if (detector == (1 << i))
+            return i;
+    }
+    return -1;
+}
+
+static bool isSamePlayer(const FUDetectorEvaluation::Label &label, uint32_t trackingID)
+{
+    return label.trackingID == 0 || label.trackingID == trackingID;
+}
+
+/**
+ * @brief Runs a detector over every tracked skeleton of the frames and returns the time it took.
+ * @param frames
+ * @param detector
+ * @param frameCount --> Number of frames that were evaluated, the frames are evaluated more than once
+ * @return
+ */
+static int64_t timeDetector(const std::vector<SkeletonFrame> &frames, FUGesture::DETECTORS detector, uint64_t &frameCount)
+{
+    frameCount = 0;
+    if (frames.empty())
+        return 0;
+    unsigned int activeCount = 0;
+    const int64_t startTime = FULatency::getTime();
+    int64_t elapsedTime = 0;
+    do {
+        FUPostureDetector::JumpState jumpStates[MAX_SKELETONS] = {};
+        for (size_t i = 0; i < frames.size(); i++) {
+            const SkeletonFrame &frame = frames[i];
+            for (int j = 0; j < MAX_SKELETONS; j++) {
+                const SkeletonData &skeleton = frame.skeletons[j];
+                if (skeleton.trackingState != SKELETON_TRACKED)
+                    continue;
+                if (detector == FUGesture::JUMPING)
+                    activeCount += FUPostureDetector::updateJump(jumpStates[j], skeleton, frame.floorPlane);
+                else
+                    activeCount += FUFrameProcessor::evaluateDetectors(skeleton, detector) != 0;
+            }
+        }
+        frameCount += frames.size();
+        elapsedTime = FULatency::getTime() - startTime;
+    } while (elapsedTime < MIN_TIMING_TIME);
+    //Keeps the compiler from dropping the loop
+    volatile unsigned int sink = activeCount;
+    (void)sink;
+    return elapsedTime;
+}
+
+FUDetectorEvaluation::FUDetectorEvaluation()
+    : mTolerance(DEFAULT_TOLERANCE)
+{
+    std::memset(mReports, 0, sizeof(mReports));
+    for (int i = 0; i < FUGesture::DETECTOR_COUNT; i++)
+        mReports[i].detector = static_cast<FUGesture::DETECTORS>(1 << i);
+}
+
+bool FUDetectorEvaluation::loadLabels(const char *filePath, std::vector<Label> &labels)
+{
+    std::FILE *file = std::fopen(filePath, "r");
+    if (file == nullptr)
+        return false;
+    bool isValid = true;
+    char line[256];
+    while (isValid && std::fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r' || line[0] == '\0')
+            continue;
+        char name[64];
+        long long beginTime = 0;
+        long long endTime = 0;
+        unsigned int trackingID = 0;
+        const int fieldCount = std::sscanf(line, " %63[^,],%lld,%lld,%u", name, &beginTime, &endTime, &trackingID);
+        Label label;
+        label.detector = static_cast<FUGesture::DETECTORS>(0);
+        for (int i = 0; i < FUGesture::DETECTOR_COUNT; i++) {
+            const FUGesture::DETECTORS detector = static_cast<FUGesture::DETECTORS>(1 << i);
+            if (std::strcmp(name, FUGesture::getDetectorName(detector)) == 0)
+                label.detector = detector;
+        }
+        isValid = fieldCount >= 3 && label.detector != 0 && beginTime <= endTime;
+        label.beginTime = beginTime;
+        label.endTime = endTime;
+        label.trackingID = fieldCount == 4 ? trackingID : 0;
+        if (isValid)
+            labels.push_back(label);
+    }
+    std::fclose(file);
+    return isValid;
+}
+
+bool FUDetectorEvaluation::addRecording(const char *recordingFilePath, const std::vector<Label> &labels)
+{
+    std::vector<SkeletonFrame> frames;
+    FURecordingReader reader;
+    if (!reader.open(recordingFilePath))
+        return false;
+    for (FURecording::RECORD_TYPE type = reader.readNext(); type != FURecording::NO_RECORD; type = reader.readNext()) {
+        if (type == FURecording::SKELETON_RECORD)
+            frames.push_back(reader.getSkeletonFrame());
+    }
+    reader.close();
+    const FUBatchReplay::Result result = FUBatchReplay::replay(recordingFilePath, EVALUATED_DETECTORS, true);
+    if (!result.isOpened)
+        return false;
+
+    std::vector<uint32_t> frameNumbers(frames.size());
+    std::vector<int64_t> timeStamps(frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        frameNumbers[i] = frames[i].frameNumber;
+        timeStamps[i] = frames[i].timeStamp;
+    }
+
+    //The events of a detector and a player alternate between began and ended, an activation that didn't end lasts until the
+    //end of the recording
+    std::vector<Activation> activations[FUGesture::DETECTOR_COUNT];
+    for (size_t i = 0; i < result.events.size(); i++) {
+        const FUGesture::GestureEvent &event = result.events[i];
+        const int detectorIndex = getDetectorIndex(event.detector);
+        if (detectorIndex < 0)
+            continue;
+        const size_t frame = std::lower_bound(frameNumbers.begin(), frameNumbers.end(), event.frameNumber) - frameNumbers.begin();
+        std::vector<Activation> &detectorActivations = activations[detectorIndex];
+        if (event.phase == FUGesture::EVENT_BEGAN) {
+            const Activation activation = {event.skeletonTrackingID, frame, frames.size()};
+            detectorActivations.push_back(activation);
+            continue;
+        }
+        for (size_t j = detectorActivations.size(); j > 0; j--) {
+            Activation &activation = detectorActivations[j - 1];
+            if (activation.trackingID == event.skeletonTrackingID) {
+                if (activation.end == frames.size())
+                    activation.end = frame;
+                break;
+            }
+        }
+    }
+
+    //The labels as frame ranges that are widened by the tolerance, the end is one past the last frame
+    std::vector<size_t> labelBegins(labels.size());
+    std::vector<size_t> labelEnds(labels.size());
+    for (size_t i = 0; i < labels.size(); i++) {
+        const size_t begin = std::lower_bound(timeStamps.begin(), timeStamps.end(), labels[i].beginTime) - timeStamps.begin();
+        const size_t end = std::upper_bound(timeStamps.begin(), timeStamps.end(), labels[i].endTime) - timeStamps.begin();
+        labelBegins[i] = begin;
+        labelEnds[i] = end;
+    }
+    const size_t tolerance = static_cast<size_t>(std::max(mTolerance, 0));
+
+    for (size_t i = 0; i < labels.size(); i++) {
+        const Label &label = labels[i];
+        const int detectorIndex = getDetectorIndex(label.detector);
+        DetectorReport &report = mReports[detectorIndex];
+        report.labelCount++;
+        const size_t begin = labelBegins[i] > tolerance ? labelBegins[i] - tolerance : 0;
+        const size_t end = labelEnds[i] + tolerance;
+        bool isDetected = false;
+        size_t activationBegin = 0;
+        const std::vector<Activation> &detectorActivations = activations[detectorIndex];
+        for (size_t j = 0; j < detectorActivations.size(); j++) {
+            const Activation &activation = detectorActivations[j];
+            if (activation.begin < end && activation.end > begin && isSamePlayer(label, activation.trackingID)
+                    && (!isDetected || activation.begin < activationBegin)) {
+                isDetected = true;
+                activationBegin = activation.begin;
+            }
+        }
+        if (isDetected && labelBegins[i] < labelEnds[i]) {
+            const uint32_t latency = activationBegin > labelBegins[i] ? static_cast<uint32_t>(activationBegin - labelBegins[i]) : 0;
+            report.detectedLabelCount++;
+            report.latencySum += latency;
+            report.maxLatency = std::max(report.maxLatency, latency);
+        }
+    }
+
+    for (int i = 0; i < FUGesture::DETECTOR_COUNT; i++) {
+        DetectorReport &report = mReports[i];
+        for (size_t j = 0; j < activations[i].size(); j++) {
+            const Activation &activation = activations[i][j];
+            bool isCorrect = false;
+            for (size_t k = 0; k < labels.size() && !isCorrect; k++) {
+                const size_t begin = labelBegins[k] > tolerance ? labelBegins[k] - tolerance : 0;
+                const size_t end = labelEnds[k] + tolerance;
+                isCorrect = labels[k].detector == report.detector && isSamePlayer(labels[k], activation.trackingID)
+                        && labelBegins[k] < labelEnds[k] && activation.begin < end && activation.end > begin;
+            }
+            report.activationCount++;
+            report.correctActivationCount += isCorrect;
+        }
+        if ((EVALUATED_DETECTORS & report.detector) != 0) {
+            uint64_t frameCount = 0;
+            report.evaluationTime += timeDetector(frames, report.detector, frameCount);
+            report.evaluatedFrameCount += frameCount;
+        }
+    }
+    return true;
+}
+
+const FUDetectorEvaluation::DetectorReport& FUDetectorEvaluation::getReport(FUGesture::DETECTORS detector) const
+{
+    const int detectorIndex = getDetectorIndex(detector);
+    return mReports[detectorIndex < 0 ? 0 : detectorIndex];
+}
+
+bool FUDetectorEvaluation::writeReport(const char *filePath) const
+{
+    std::FILE *file = std::fopen(filePath, "w");
+    if (file == nullptr)
+        return false;
+    std::fprintf(file, "detector,labels,detected,activations,correct,precision,recall,meanLatencyFrames,maxLatencyFrames,nsPerFrame\n");
+    for (int i = 0; i < FUGesture::DETECTOR_COUNT; i++) {
+        const DetectorReport &report = mReports[i];
+        if ((EVALUATED_DETECTORS & report.detector) == 0)
+            continue;
+        std::fprintf(file, "%s,%u,%u,%u,%u,%.4f,%.4f,%.2f,%u,%.1f\n", FUGesture::getDetectorName(report.detector), report.labelCount,
+                     report.detectedLabelCount, report.activationCount, report.correctActivationCount, report.getPrecision(),
+                     report.getRecall(), report.getMeanLatency(), report.maxLatency, report.getNanosecondsPerFrame());
+    }
+    return std::fclose(file) == 0;
+}
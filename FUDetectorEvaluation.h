@@ -0,0 +1,90 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+#include <string>
+#include <vector>
+//Local Includes
+#include "FUGesture.h"
+
+/**
+ * @brief Measures how well and how fast the detectors work on recordings with labeled time ranges. The detectors run through
+ * FUBatchReplay, so they see the same frames as in a regression run, and the results of every added recording are summed.
+ *
+ * An activation of a detector is correct if it overlaps a labeled range of the detector, and a labeled range is detected if an
+ * activation overlaps it. The ranges are widened by the tolerance on both sides for this, since the labels are never exact.
+ * The latency of a detected range is the number of frames from its start to the start of the activation, 0 if the detector
+ * was already active.
+ */
+class FUDetectorEvaluation
+{
+public:
+    /**
+     * @brief A time range in which a detector should be active.
+     */
+    struct Label {
+        FUGesture::DETECTORS detector;
+        int64_t beginTime;
+        int64_t endTime;
+        uint32_t trackingID;//0 if any player can be the one
+    };
+
+    struct DetectorReport {
+        FUGesture::DETECTORS detector;
+        uint32_t labelCount;
+        uint32_t detectedLabelCount;
+        uint32_t activationCount;
+        uint32_t correctActivationCount;
+        uint64_t latencySum;
+        uint32_t maxLatency;
+        /**
+         * @brief Time spent in the detector and the skeleton frames it ran on, for the time per frame
+         */
+        int64_t evaluationTime;
+        uint64_t evaluatedFrameCount;
+
+        double getPrecision() const {return activationCount > 0 ? static_cast<double>(correctActivationCount) / activationCount : 0;}
+        double getRecall() const {return labelCount > 0 ? static_cast<double>(detectedLabelCount) / labelCount : 0;}
+        double getMeanLatency() const {return detectedLabelCount > 0 ? static_cast<double>(latencySum) / detectedLabelCount : 0;}
+        double getNanosecondsPerFrame() const {return evaluatedFrameCount > 0 ? static_cast<double>(evaluationTime) / evaluatedFrameCount : 0;}
+    };
+
+    FUDetectorEvaluation();
+    /**
+     * @brief Sets how many frames an activation can be off from a labeled range and still match it. 5 by default.
+     * @param frameCount
+     */
+    void setTolerance(int frameCount) {mTolerance = frameCount;}
+    /**
+     * @brief Reads the labels of a recording. Every line of the file is "detector,beginTime,endTime" or
+     * "detector,beginTime,endTime,trackingID", where the detector is a name from FUGesture::getDetectorName() and the times are
+     * the time stamps of the recorded skeleton frames in milliseconds. Empty lines and the lines starting with # are skipped.
+     * @param filePath
+     * @param labels --> The labels are appended to this
+     * @return false if the file can't be read or a line is broken
+     */
+    static bool loadLabels(const char *filePath, std::vector<Label> &labels);
+    /**
+     * @brief Runs every detector over a recording, except PUSH and GRIP which need the interaction stream, and adds the results
+     * to the reports. The skeleton frames of the recording are kept in memory to time the detectors.
+     * @param recordingFilePath
+     * @param labels
+     * @return false if the recording can't be read
+     */
+    bool addRecording(const char *recordingFilePath, const std::vector<Label> &labels);
+    /**
+     * @brief Returns the summed report of a single detector.
+     * @param detector
+     * @return
+     */
+    const DetectorReport& getReport(FUGesture::DETECTORS detector) const;
+    /**
+     * @brief Writes the reports as CSV, one detector per line, so they can be compared between releases.
+     * @param filePath
+     * @return false if the file can't be written
+     */
+    bool writeReport(const char *filePath) const;
+
+private:
+    int mTolerance;
+    DetectorReport mReports[FUGesture::DETECTOR_COUNT];
+};
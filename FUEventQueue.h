@@ -0,0 +1,85 @@
+#pragma once
+//STL Includes
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief A fixed size, lock-free single producer/single consumer queue. The producer is the thread that processes the frames,
+ * e.g. the one that calls FUKinectTool::updateSensor(), and the consumer can be any other single thread. When the queue is full
+ * new items are dropped and counted instead of blocking the producer.
+ */
+template<class T, size_t Capacity>
+class FUEventQueue
+{
+    static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    FUEventQueue()
+        : mHead(0)
+        , mTail(0)
+        , mDroppedCount(0)
+    {
+    }
+
+    /**
+     * @brief Pushes an item to the end of the queue. Only the producer thread can call this.
+     * @param item
+     * @return false if the queue is full and the item is dropped
+     */
+    bool push(const T &item)
+    {
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHead.load(std::memory_order_acquire) == Capacity) {
+            mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        mItems[tail & (Capacity - 1)] = item;
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Pops the first item in the queue. Only the consumer thread can call this.
+     * @param item --> Output
+     * @return false if the queue is empty
+     */
+    bool pop(T &item)
+    {
+        return pop(&item, 1) == 1;
+    }
+
+    /**
+     * @brief Pops up to maxCount items with a single synchronization. Only the consumer thread can call this.
+     * @param items --> Output array that has room for at least maxCount items
+     * @param maxCount
+     * @return The number of items written to items
+     */
+    size_t pop(T *items, size_t maxCount)
+    {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        const size_t available = mTail.load(std::memory_order_acquire) - head;
+        const size_t count = available < maxCount ? available : maxCount;
+        for (size_t i = 0; i < count; i++)
+            items[i] = mItems[(head + i) & (Capacity - 1)];
+        mHead.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    size_t size() const
+    {
+        return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+    }
+
+    bool isEmpty() const {return size() == 0;}
+    /**
+     * @brief Returns the number of items that were dropped because the consumer didn't keep up.
+     * @return
+     */
+    size_t getDroppedCount() const {return mDroppedCount.load(std::memory_order_relaxed);}
+
+private:
+    T mItems[Capacity];
+    std::atomic<size_t> mHead;
+    std::atomic<size_t> mTail;
+    std::atomic<size_t> mDroppedCount;
+};
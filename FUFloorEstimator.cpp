@@ -0,0 +1,223 @@
+#include "FUFloorEstimator.h"
+//STL Includes
+#include <cmath>
+//Local Includes
+#include "FUThreadPool.h"
+#include "FUTrace.h"
+
+//Only every SAMPLE_STRIDE th pixel in both directions of the lower half of the frame is used
+static const int SAMPLE_STRIDE = 4;
+//Points farther than this are too noisy to be used
+static const int MAX_SAMPLE_DEPTH = 4500;
+static const float INLIER_DISTANCE = 0.03f;
+static const int HYPOTHESIS_COUNT = 256;
+static const int HYPOTHESIS_TASKS = 8;
+//The floor normal can't be tilted more than ~45 degrees from the camera's up axis
+static const float MIN_NORMAL_Y = 0.7f;
+//The plane must be at least this far below the camera
+static const float MIN_CAMERA_HEIGHT = 0.2f;
+//A plane must have at least this many inliers to be valid
+static const int MIN_INLIER_COUNT = 300;
+//When the current plane has less than this ratio of its inliers in a new frame, it has drifted
+static const float DRIFT_RATIO = 0.6f;
+//Weight of a new refinement in the running estimate
+static const float REFINE_WEIGHT = 0.2f;
+
+static uint32_t nextRandom(uint32_t &state)
+{
+    //xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+FUFloorEstimator::FUFloorEstimator(FUThreadPool *threadPool)
+    : mThreadPool(threadPool)
+    , mIsValid(false)
+    , mReferenceInlierCount(0)
+    , mEstimationCount(0)
+    , mFrameCount(0)
+{
+    Plane plane = {0.f, 0.f, 0.f, 0.f};
+    mPlane = plane;
+    mHypotheses.resize(HYPOTHESIS_TASKS);
+}
+
+void FUFloorEstimator::reset()
+{
+    mIsValid = false;
+    mReferenceInlierCount = 0;
+}
+
+bool FUFloorEstimator::update(const FUDepthFrame &frame)
+{
+    FU_TRACE_SCOPE(FUTrace::DEPTH, "FUFloorEstimator::update");
+    mFrameCount++;
+    collectSamples(frame);
+    if (mSamples.size() < static_cast<size_t>(MIN_INLIER_COUNT)) {
+        reset();
+        return false;
+    }
+    if (mIsValid) {
+        const int inlierCount = countInliers(mPlane);
+        if (inlierCount >= DRIFT_RATIO * mReferenceInlierCount) {
+            Plane refined = mPlane;
+            if (refine(refined)) {
+                mPlane.x += (refined.x - mPlane.x) * REFINE_WEIGHT;
+                mPlane.y += (refined.y - mPlane.y) * REFINE_WEIGHT;
+                mPlane.z += (refined.z - mPlane.z) * REFINE_WEIGHT;
+                mPlane.w += (refined.w - mPlane.w) * REFINE_WEIGHT;
+                const float length = std::sqrt(mPlane.x * mPlane.x + mPlane.y * mPlane.y + mPlane.z * mPlane.z);
+                mPlane.x /= length;
+                mPlane.y /= length;
+                mPlane.z /= length;
+                mPlane.w /= length;
+            }
+            //Let the reference follow slow changes in the scene, like people walking in
+            if (inlierCount > mReferenceInlierCount)
+                mReferenceInlierCount = inlierCount;
+            return true;
+        }
+    }
+    estimate();
+    return mIsValid;
+}
+
+void FUFloorEstimator::collectSamples(const FUDepthFrame &frame)
+{
+    mSamples.clear();
+    const float inverseFocalLength = 1.f / getDepthFocalLength(frame.width);
+    const float centerX = frame.width / 2.f;
+    const float centerY = frame.height / 2.f;
+    for (int v = frame.height / 2; v < frame.height; v += SAMPLE_STRIDE) {
+        const FUDepthPixel *row = frame.pixels + v * frame.width;
+        for (int u = 0; u < frame.width; u += SAMPLE_STRIDE) {
+            const FUDepthPixel &pixel = row[u];
+            //Players are never the floor
+            if (pixel.depth == 0 || pixel.depth > MAX_SAMPLE_DEPTH || pixel.playerIndex != 0)
+                continue;
+            const float z = pixel.depth * 0.001f;
+            Point point = {(u - centerX) * inverseFocalLength * z, -(v - centerY) * inverseFocalLength * z, z};
+            mSamples.push_back(point);
+        }
+    }
+}
+
+void FUFloorEstimator::estimate()
+{
+    mEstimationCount++;
+    const int hypothesesPerTask = HYPOTHESIS_COUNT / HYPOTHESIS_TASKS;
+    if (mThreadPool) {
+        mThreadPool->parallelFor(HYPOTHESIS_TASKS, [this, hypothesesPerTask](int task) {
+            mHypotheses[task] = runHypotheses(task, hypothesesPerTask);
+        });
+    }
+    else {
+        for (int task = 0; task < HYPOTHESIS_TASKS; task++)
+            mHypotheses[task] = runHypotheses(task, hypothesesPerTask);
+    }
+
+    const Hypothesis *best = &mHypotheses[0];
+    for (int task = 1; task < HYPOTHESIS_TASKS; task++) {
+        if (mHypotheses[task].inlierCount > best->inlierCount)
+            best = &mHypotheses[task];
+    }
+    if (best->inlierCount < MIN_INLIER_COUNT) {
+        reset();
+        return;
+    }
+    mPlane = best->plane;
+    refine(mPlane);
+    mReferenceInlierCount = countInliers(mPlane);
+    mIsValid = mReferenceInlierCount >= MIN_INLIER_COUNT;
+}
+
+FUFloorEstimator::Hypothesis FUFloorEstimator::runHypotheses(int task, int hypothesisCount) const
+{
+    Hypothesis best = {{0.f, 0.f, 0.f, 0.f}, 0};
+    //Seeded from the frame and the task, so the result doesn't depend on the thread count
+    uint32_t randomState = (mFrameCount * 2654435761u) ^ (static_cast<uint32_t>(task + 1) * 40503u);
+    if (randomState == 0)
+        randomState = 1;
+    const uint32_t sampleCount = static_cast<uint32_t>(mSamples.size());
+    for (int i = 0; i < hypothesisCount; i++) {
+        const Point &a = mSamples[nextRandom(randomState) % sampleCount];
+        const Point &b = mSamples[nextRandom(randomState) % sampleCount];
+        const Point &c = mSamples[nextRandom(randomState) % sampleCount];
+        //Normal of the triangle
+        const float abX = b.x - a.x, abY = b.y - a.y, abZ = b.z - a.z;
+        const float acX = c.x - a.x, acY = c.y - a.y, acZ = c.z - a.z;
+        float normalX = abY * acZ - abZ * acY;
+        float normalY = abZ * acX - abX * acZ;
+        float normalZ = abX * acY - abY * acX;
+        const float length = std::sqrt(normalX * normalX + normalY * normalY + normalZ * normalZ);
+        if (length < 1e-6f)
+            continue;
+        //Make the normal point up
+        const float sign = normalY < 0.f ? -1.f : 1.f;
+        normalX *= sign / length;
+        normalY *= sign / length;
+        normalZ *= sign / length;
+        if (normalY < MIN_NORMAL_Y)
+            continue;
+        Plane plane = {normalX, normalY, normalZ, -(normalX * a.x + normalY * a.y + normalZ * a.z)};
+        if (plane.w < MIN_CAMERA_HEIGHT)
+            continue;
+        const int inlierCount = countInliers(plane);
+        if (inlierCount > best.inlierCount) {
+            best.plane = plane;
+            best.inlierCount = inlierCount;
+        }
+    }
+    return best;
+}
+
+int FUFloorEstimator::countInliers(const Plane &plane) const
+{
+    int inlierCount = 0;
+    const size_t sampleCount = mSamples.size();
+    const Point *samples = sampleCount > 0 ? &mSamples[0] : nullptr;
+    for (size_t i = 0; i < sampleCount; i++) {
+        const float distance = plane.x * samples[i].x + plane.y * samples[i].y + plane.z * samples[i].z + plane.w;
+        inlierCount += std::fabs(distance) < INLIER_DISTANCE;
+    }
+    return inlierCount;
+}
+
+bool FUFloorEstimator::refine(Plane &plane) const
+{
+    //Normal equations of y = ax + bz + c
+    double sxx = 0, sxz = 0, sx = 0, szz = 0, sz = 0, n = 0, sxy = 0, szy = 0, sy = 0;
+    for (size_t i = 0; i < mSamples.size(); i++) {
+        const Point &p = mSamples[i];
+        const float distance = plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w;
+        if (std::fabs(distance) >= INLIER_DISTANCE)
+            continue;
+        sxx += p.x * p.x;
+        sxz += p.x * p.z;
+        sx += p.x;
+        szz += p.z * p.z;
+        sz += p.z;
+        n += 1;
+        sxy += p.x * p.y;
+        szy += p.z * p.y;
+        sy += p.y;
+    }
+    if (n < 3)
+        return false;
+    //Cramer's rule
+    const double determinant = sxx * (szz * n - sz * sz) - sxz * (sxz * n - sz * sx) + sx * (sxz * sz - szz * sx);
+    if (std::fabs(determinant) < 1e-12)
+        return false;
+    const double a = (sxy * (szz * n - sz * sz) - sxz * (szy * n - sz * sy) + sx * (szy * sz - szz * sy)) / determinant;
+    const double b = (sxx * (szy * n - sz * sy) - sxy * (sxz * n - sz * sx) + sx * (sxz * sy - szy * sx)) / determinant;
+    const double c = (sxx * (szz * sy - sz * szy) - sxz * (sxz * sy - sx * szy) + sxy * (sxz * sz - szz * sx)) / determinant;
+    //-ax + y - bz - c = 0
+    const double length = std::sqrt(a * a + 1.0 + b * b);
+    plane.x = static_cast<float>(-a / length);
+    plane.y = static_cast<float>(1.0 / length);
+    plane.z = static_cast<float>(-b / length);
+    plane.w = static_cast<float>(-c / length);
+    return true;
+}
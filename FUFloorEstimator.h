@@ -0,0 +1,84 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+#include <vector>
+//Local Includes
+#include "FUDepthFrame.h"
+
+class FUThreadPool;
+
+/**
+ * @brief Estimates the floor plane from the lower part of the depth frames, for when the SDK doesn't report one.
+ * The first estimate is found with RANSAC, with the hypotheses scored in parallel. After that every frame only checks
+ * that the plane still fits: if it does the plane is refined with a least squares fit of its inliers, if it doesn't
+ * RANSAC runs again.
+ */
+class FUFloorEstimator
+{
+public:
+    /**
+     * @brief ax + by + cz + w = 0 in skeleton space, with (a, b, c) pointing up. The same convention as vFloorClipPlane,
+     * so plugging a point in gives its height above the floor in meters.
+     */
+    struct Plane {
+        float x;
+        float y;
+        float z;
+        float w;
+    };
+
+public:
+    /**
+     * @param threadPool --> Used to score the RANSAC hypotheses. It can be nullptr.
+     */
+    explicit FUFloorEstimator(FUThreadPool *threadPool = nullptr);
+    /**
+     * @brief Updates the estimate with a new depth frame.
+     * @param frame
+     * @return true if there is a valid plane after the update
+     */
+    bool update(const FUDepthFrame &frame);
+    bool isValid() const {return mIsValid;}
+    const Plane& getPlane() const {return mPlane;}
+    /**
+     * @brief Forgets the current estimate, the next update runs RANSAC.
+     */
+    void reset();
+    /**
+     * @brief Returns how many times RANSAC ran, the rest of the updates were refinements.
+     * @return
+     */
+    int getEstimationCount() const {return mEstimationCount;}
+
+private:
+    struct Point {
+        float x;
+        float y;
+        float z;
+    };
+
+    struct Hypothesis {
+        Plane plane;
+        int inlierCount;
+    };
+
+    FUThreadPool *mThreadPool;
+    std::vector<Point> mSamples;
+    std::vector<Hypothesis> mHypotheses;
+    Plane mPlane;
+    bool mIsValid;
+    int mReferenceInlierCount;
+    int mEstimationCount;
+    uint32_t mFrameCount;
+
+private:
+    void collectSamples(const FUDepthFrame &frame);
+    void estimate();
+    Hypothesis runHypotheses(int task, int hypothesisCount) const;
+    int countInliers(const Plane &plane) const;
+    /**
+     * @brief Fits y = ax + bz + c to the inliers of the plane with least squares.
+     * @return false if the fit is degenerate
+     */
+    bool refine(Plane &plane) const;
+};
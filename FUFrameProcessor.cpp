@@ -0,0 +1,191 @@
+#include "FUFrameProcessor.h"
+//Local Includes
+#include "FUTrace.h"
+
+using namespace FUSkeleton;
+
+FUFrameProcessor::FUFrameProcessor()
+    : mSubscriptions()
+    , mAnyPlayerDetectors(0)
+    , mPlayers()
+{
+}
+
+void FUFrameProcessor::processSkeletonFrame(const SkeletonFrame &frame)
+{
+    FU_TRACE_SCOPE(FUTrace::DETECTORS, "FUFrameProcessor::processSkeletonFrame");
+    GestureEvent event = GestureEvent();
+    event.frameNumber = frame.frameNumber;
+    event.timeStamp = frame.timeStamp;
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        const SkeletonData &skeleton = frame.skeletons[i];
+        PlayerState &player = mPlayers[i];
+        const bool isTracked = skeleton.trackingState == SKELETON_TRACKED;
+        //The slot was taken by another player, so everything that was active for the previous one ends.
+        if (player.trackingID != 0 && (!isTracked || player.trackingID != skeleton.trackingID)) {
+            event.skeletonTrackingID = player.trackingID;
+            queueEvents(event, player.activeDetectors, 0);
+            //Tracking IDs aren't reused, so the subscription of a player that left would keep its slot forever. FUKinectTool
+            //latches the PUSH and GRIP subscriptions of the hands, so their EVENT_ENDED still comes with the next interaction frame.
+            if (!isTracking(frame, player.trackingID))
+                releaseSubscription(player.trackingID);
+            player.trackingID = 0;
+        }
+        if (!isTracked)
+            continue;
+        if (player.trackingID == 0) {
+            player.trackingID = skeleton.trackingID;
+            player.activeDetectors = 0;
+            player.bodyScale.reset();
+            player.jumpState.isAirborne = false;
+        }
+
+        player.bodyScale.update(skeleton.joints, skeleton.jointStates);
+        player.hasJumped = FUPostureDetector::updateJump(player.jumpState, skeleton, frame.floorPlane);
+        //PUSH and GRIP are queued per hand from the interaction stream
+        const unsigned int subscribed = getSubscribedDetectors(skeleton.trackingID) & ~(PUSH | GRIP);
+        unsigned int active = subscribed == 0 ? 0 : evaluateDetectors(skeleton, subscribed, player.bodyScale.getScale());
+        if ((subscribed & JUMPING) && player.jumpState.isAirborne)
+            active |= JUMPING;
+        event.skeletonTrackingID = skeleton.trackingID;
+        queueEvents(event, active ^ player.activeDetectors, active);
+        player.activeDetectors = active;
+    }
+}
+
+void FUFrameProcessor::queueEvents(GestureEvent &event, unsigned int detectors, unsigned int active)
+{
+    for (unsigned int detector = 1; detector <= detectors; detector <<= 1) {
+        if (detectors & detector) {
+            event.detector = static_cast<DETECTORS>(detector);
+            event.phase = (active & detector) ? EVENT_BEGAN : EVENT_ENDED;
+            mGestureEvents.push(event);
+        }
+    }
+}
+
+unsigned int FUFrameProcessor::evaluateDetectors(const SkeletonData &skeleton, unsigned int detectors, float bodyScale)
+{
+    unsigned int active = 0;
+    if ((detectors & RIGHT_HAND_UP) && FUPostureDetector::detectRightHandUpPosture(skeleton, bodyScale))
+        active |= RIGHT_HAND_UP;
+    if ((detectors & LEFT_HAND_UP) && FUPostureDetector::detectLeftHandUpPosture(skeleton, bodyScale))
+        active |= LEFT_HAND_UP;
+    if ((detectors & BOTH_HANDS_UP) && FUPostureDetector::detectBothHandsUp(skeleton, bodyScale))
+        active |= BOTH_HANDS_UP;
+    if ((detectors & LEFT_HAND_DOWN) && FUPostureDetector::detectLeftHandDownPosture(skeleton))
+        active |= LEFT_HAND_DOWN;
+    if ((detectors & RIGHT_HAND_DOWN) && FUPostureDetector::detectRightHandDownPosture(skeleton))
+        active |= RIGHT_HAND_DOWN;
+    if ((detectors & OPEN_RIGHT_ARM) && FUPostureDetector::detectOpenRightArm(skeleton, bodyScale))
+        active |= OPEN_RIGHT_ARM;
+    if ((detectors & OPEN_LEFT_ARM) && FUPostureDetector::detectOpenLeftArm(skeleton, bodyScale))
+        active |= OPEN_LEFT_ARM;
+    if ((detectors & OPEN_ARMS) && FUPostureDetector::detectOpenArms(skeleton, bodyScale))
+        active |= OPEN_ARMS;
+    if ((detectors & LEAN_RIGHT) && FUPostureDetector::detectLeanRight(skeleton, bodyScale))
+        active |= LEAN_RIGHT;
+    if ((detectors & LEAN_LEFT) && FUPostureDetector::detectLeanLeft(skeleton, bodyScale))
+        active |= LEAN_LEFT;
+    return active;
+}
+
+bool FUFrameProcessor::subscribe(uint32_t skeletonTrackingID, unsigned int detectors)
+{
+    detectors &= ALL_DETECTORS;
+    if (skeletonTrackingID == ANY_PLAYER) {
+        mAnyPlayerDetectors |= detectors;
+        return true;
+    }
+    DetectorSubscription *freeSubscription = nullptr;
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        DetectorSubscription &subscription = mSubscriptions[i];
+        if (subscription.detectors != 0 && subscription.trackingID == skeletonTrackingID) {
+            subscription.detectors |= detectors;
+            return true;
+        }
+        if (subscription.detectors == 0 && freeSubscription == nullptr)
+            freeSubscription = &subscription;
+    }
+    if (freeSubscription == nullptr)
+        return false;
+    freeSubscription->trackingID = skeletonTrackingID;
+    freeSubscription->detectors = detectors;
+    return true;
+}
+
+void FUFrameProcessor::unsubscribe(uint32_t skeletonTrackingID, unsigned int detectors)
+{
+    if (skeletonTrackingID == ANY_PLAYER) {
+        mAnyPlayerDetectors &= ~detectors;
+        return;
+    }
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        if (mSubscriptions[i].trackingID == skeletonTrackingID)
+            mSubscriptions[i].detectors &= ~detectors;
+    }
+}
+
+unsigned int FUFrameProcessor::getSubscribedDetectors(uint32_t skeletonTrackingID) const
+{
+    unsigned int detectors = mAnyPlayerDetectors;
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        if (mSubscriptions[i].trackingID == skeletonTrackingID)
+            detectors |= mSubscriptions[i].detectors;
+    }
+    return detectors;
+}
+
+bool FUFrameProcessor::isTracking(const SkeletonFrame &frame, uint32_t skeletonTrackingID)
+{
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        if (frame.skeletons[i].trackingState == SKELETON_TRACKED && frame.skeletons[i].trackingID == skeletonTrackingID)
+            return true;
+    }
+    return false;
+}
+
+void FUFrameProcessor::releaseSubscription(uint32_t skeletonTrackingID)
+{
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        if (mSubscriptions[i].trackingID == skeletonTrackingID) {
+            mSubscriptions[i].trackingID = 0;
+            mSubscriptions[i].detectors = 0;
+        }
+    }
+}
+
+const FUFrameProcessor::PlayerState* FUFrameProcessor::findPlayer(uint32_t skeletonTrackingID) const
+{
+    if (skeletonTrackingID == 0)
+        return nullptr;
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        if (mPlayers[i].trackingID == skeletonTrackingID)
+            return &mPlayers[i];
+    }
+    return nullptr;
+}
+
+float FUFrameProcessor::getBodyScale(uint32_t skeletonTrackingID) const
+{
+    const PlayerState *player = findPlayer(skeletonTrackingID);
+    return player ? player->bodyScale.getScale() : 1.f;
+}
+
+const FUBodyScale* FUFrameProcessor::getBodyProportions(uint32_t skeletonTrackingID) const
+{
+    const PlayerState *player = findPlayer(skeletonTrackingID);
+    return player ? &player->bodyScale : nullptr;
+}
+
+bool FUFrameProcessor::hasJumped(uint32_t skeletonTrackingID) const
+{
+    const PlayerState *player = findPlayer(skeletonTrackingID);
+    return player && player->hasJumped;
+}
+
+bool FUFrameProcessor::isAirborne(uint32_t skeletonTrackingID) const
+{
+    const PlayerState *player = findPlayer(skeletonTrackingID);
+    return player && player->jumpState.isAirborne;
+}
@@ -0,0 +1,139 @@
+#pragma once
+//Local Includes
+#include "FUEventQueue.h"
+#include "FUGesture.h"
+#include "FUPostureDetector.h"
+#include "FUSkeleton.h"
+
+/**
+ * @brief Runs the subscribed detectors over skeleton frames and queues their changes as GestureEvents. It keeps the per player
+ * state that the detectors need, the body scales and the jump states, so it only depends on plain skeleton frames and can
+ * run on recorded data as well as on the sensor.
+ */
+class FUFrameProcessor : public FUGesture
+{
+public:
+    FUFrameProcessor();
+    /**
+     * @brief Updates the player states with a skeleton frame, evaluates the subscribed detectors and queues the changes.
+     * PUSH and GRIP aren't evaluated here, they come from the interaction stream through queueEvent().
+     * @param frame
+     */
+    void processSkeletonFrame(const FUSkeleton::SkeletonFrame &frame);
+    /**
+     * @brief Returns the detectors in the given set that are active for a skeleton. JUMPING isn't included since it needs
+     * the jump state, see isAirborne().
+     * @param skeleton
+     * @param detectors --> A combination of DETECTORS
+     * @param bodyScale
+     * @return
+     */
+    static unsigned int evaluateDetectors(const FUSkeleton::SkeletonData &skeleton, unsigned int detectors, float bodyScale = 1.f);
+
+    /**
+     * @brief Subscribes to the given detectors for a player. Only the subscribed detectors are evaluated, once for every
+     * skeleton frame, and their changes are queued as GestureEvents. Call this from the thread that processes the frames.
+     * The subscription of a player is removed when the player leaves, after the EVENT_ENDED of its active detectors. The
+     * sensor gives a returning player a new tracking ID, so subscribe again when a new player shows up.
+     * @param skeletonTrackingID --> Tracking ID of the player or ANY_PLAYER
+     * @param detectors --> A combination of DETECTORS
+     * @return false if there's no room for another player subscription
+     */
+    bool subscribe(uint32_t skeletonTrackingID, unsigned int detectors);
+    /**
+     * @brief Removes the given detectors from the player's subscription. Detectors that were active end with an EVENT_ENDED.
+     * @param skeletonTrackingID --> Tracking ID of the player or ANY_PLAYER
+     * @param detectors --> A combination of DETECTORS
+     */
+    void unsubscribe(uint32_t skeletonTrackingID, unsigned int detectors);
+    /**
+     * @brief Returns the detectors that a player is subscribed to, including the ANY_PLAYER ones.
+     * @param skeletonTrackingID
+     * @return
+     */
+    unsigned int getSubscribedDetectors(uint32_t skeletonTrackingID) const;
+    /**
+     * @brief Queues an event that is detected outside of the skeleton frames, e.g. PUSH and GRIP. Only the thread that
+     * processes the frames can call this.
+     * @param event
+     */
+    void queueEvent(const GestureEvent &event) {mGestureEvents.push(event);}
+    /**
+     * @brief Pops the queued detector events. This can be called from a thread other than the one that processes the frames,
+     * as long as there is only one such thread.
+     * @param events --> Output array that has room for at least maxEvents events
+     * @param maxEvents
+     * @return The number of events written to events
+     */
+    size_t pollEvents(GestureEvent *events, size_t maxEvents) {return mGestureEvents.pop(events, maxEvents);}
+    /**
+     * @brief Returns the number of events that were dropped because pollEvents() wasn't called often enough.
+     * @return
+     */
+    size_t getDroppedEventCount() const {return mGestureEvents.getDroppedCount();}
+
+    /**
+     * @brief Returns the body scale of a player, see FUSkeleton::FUBodyScale.
+     * @param skeletonTrackingID
+     * @return 1 until enough bones of the player are measured, or if the player isn't tracked
+     */
+    float getBodyScale(uint32_t skeletonTrackingID) const;
+    /**
+     * @brief Returns the bone length estimates of a player.
+     * @param skeletonTrackingID
+     * @return nullptr if the player isn't tracked
+     */
+    const FUSkeleton::FUBodyScale* getBodyProportions(uint32_t skeletonTrackingID) const;
+    /**
+     * @brief Returns true if both feet of the player left the floor in the last skeleton frame.
+     * @param skeletonTrackingID
+     * @return
+     */
+    bool hasJumped(uint32_t skeletonTrackingID) const;
+    /**
+     * @brief Returns true from the frame that the player jumped until the frame that the player lands.
+     * @param skeletonTrackingID
+     * @return
+     */
+    bool isAirborne(uint32_t skeletonTrackingID) const;
+
+private:
+    struct DetectorSubscription {
+        uint32_t trackingID;
+        unsigned int detectors;
+    };
+
+    /**
+     * @brief State of the player in a skeleton slot. trackingID is 0 when the slot is empty.
+     */
+    struct PlayerState {
+        uint32_t trackingID;
+        unsigned int activeDetectors;
+        FUSkeleton::FUBodyScale bodyScale;
+        FUPostureDetector::JumpState jumpState;
+        bool hasJumped;
+    };
+
+    /**
+     * @brief Subscriptions for specific tracking IDs. Unused ones have the detectors set to 0.
+     */
+    DetectorSubscription mSubscriptions[FUSkeleton::MAX_SKELETONS];
+    unsigned int mAnyPlayerDetectors;
+    /**
+     * @brief Player states in the same order as the skeletons of the frames
+     */
+    PlayerState mPlayers[FUSkeleton::MAX_SKELETONS];
+    FUEventQueue<GestureEvent, 256> mGestureEvents;
+
+private:
+    const PlayerState* findPlayer(uint32_t skeletonTrackingID) const;
+    static bool isTracking(const FUSkeleton::SkeletonFrame &frame, uint32_t skeletonTrackingID);
+    /**
+     * @brief Frees the subscription slot of a player that left.
+     */
+    void releaseSubscription(uint32_t skeletonTrackingID);
+    /**
+     * @brief Queues an event for every detector in the set.
+     */
+    void queueEvents(GestureEvent &event, unsigned int detectors, unsigned int active);
+};
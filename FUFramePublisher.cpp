@@ -0,0 +1,311 @@
+#include "FUFramePublisher.h"
+//STL Includes
+#include <cstring>
+#include <new>
+#include <string>
+
+using namespace FUSharedFrame;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "The shared memory needs address free atomics");
+
+static const size_t CONTROL_SIZE = sizeof(Header) + sizeof(SlotInfo) * MAX_SLOTS + sizeof(ReaderInfo) * MAX_READERS;
+//Slots start on page boundaries so that the frames are aligned for any SIMD loads
+static const size_t SLOT_ALIGNMENT = 4096;
+static const uint32_t BYTES_PER_PIXEL = 4;
+
+static std::string getPixelsName(const char *name)
+{
+    return std::string(name) + ".pixels";
+}
+
+FUFramePublisher::FUFramePublisher()
+    : mControl()
+    , mPixels()
+    , mHeader(nullptr)
+    , mSlots(nullptr)
+    , mReaders(nullptr)
+    , mSlotData(nullptr)
+    , mFrameSize(0)
+    , mPublishedCount(0)
+    , mWritingSlot(-1)
+{
+}
+
+FUFramePublisher::~FUFramePublisher()
+{
+    close();
+}
+
+bool FUFramePublisher::open(const char *name, PIXEL_FORMAT format, int width, int height, int slotCount)
+{
+    close();
+    if (width <= 0 || height <= 0 || slotCount < 2 || slotCount > static_cast<int>(MAX_SLOTS))
+        return false;
+    mFrameSize = static_cast<size_t>(width) * height * BYTES_PER_PIXEL;
+    const size_t slotStride = (mFrameSize + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+    if (!mControl.create(name, CONTROL_SIZE) || !mPixels.create(getPixelsName(name).c_str(), slotStride * slotCount)) {
+        close();
+        return false;
+    }
+    uint8_t *control = static_cast<uint8_t*>(mControl.getData());
+    mHeader = new (control) Header;
+    mHeader->magic.store(0, std::memory_order_release);
+    mHeader->version = VERSION;
+    mHeader->format = format;
+    mHeader->width = width;
+    mHeader->height = height;
+    mHeader->bytesPerPixel = BYTES_PER_PIXEL;
+    mHeader->slotCount = slotCount;
+    mHeader->reserved = 0;
+    mHeader->slotStride = slotStride;
+    mHeader->publishedCount.store(0, std::memory_order_relaxed);
+    mHeader->droppedCount.store(0, std::memory_order_relaxed);
+    mHeader->latestSlot.store(0, std::memory_order_relaxed);
+    mHeader->reserved2 = 0;
+    mSlots = reinterpret_cast<SlotInfo*>(control + sizeof(Header));
+    for (uint32_t i = 0; i < MAX_SLOTS; i++) {
+        SlotInfo *slot = new (mSlots + i) SlotInfo;
+        slot->sequence.store(0, std::memory_order_relaxed);
+        slot->timeStamp = 0;
+        slot->frameNumber = 0;
+        slot->reserved = 0;
+    }
+    mReaders = reinterpret_cast<ReaderInfo*>(control + sizeof(Header) + sizeof(SlotInfo) * MAX_SLOTS);
+    for (uint32_t i = 0; i < MAX_READERS; i++) {
+        ReaderInfo *reader = new (mReaders + i) ReaderInfo;
+        reader->processID.store(0, std::memory_order_relaxed);
+        reader->reserved = 0;
+        reader->heldSequence.store(0, std::memory_order_relaxed);
+        reader->acquiringSequence.store(0, std::memory_order_relaxed);
+    }
+    mSlotData = static_cast<uint8_t*>(mPixels.getData());
+    mPublishedCount = 0;
+    mWritingSlot = -1;
+    mHeader->magic.store(MAGIC, std::memory_order_release);
+    return true;
+}
+
+void FUFramePublisher::close()
+{
+    if (mHeader != nullptr)
+        mHeader->magic.store(0, std::memory_order_release);
+    mControl.close();
+    mPixels.close();
+    mHeader = nullptr;
+    mSlots = nullptr;
+    mReaders = nullptr;
+    mSlotData = nullptr;
+}
+
+uint8_t* FUFramePublisher::beginFrame()
+{
+    if (mHeader == nullptr)
+        return nullptr;
+    if (mWritingSlot >= 0)
+        return mSlotData + mHeader->slotStride * mWritingSlot;
+    const uint32_t latestSlot = mHeader->latestSlot.load(std::memory_order_relaxed);
+    for (int attempt = 0; attempt < 2; attempt++) {
+        for (uint32_t i = 0; i < mHeader->slotCount; i++) {
+            if (i == latestSlot && mPublishedCount > 0)
+                continue;
+            SlotInfo &slot = mSlots[i];
+            const uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+            if (isHeld(sequence))
+                continue;
+            //A reader that holds the sequence after this store sees the 0 when it checks the slot again and lets it go. Both
+            //sides are sequentially consistent, so one of them always sees the other.
+            slot.sequence.store(0);
+            if (!isHeld(sequence)) {
+                mWritingSlot = static_cast<int>(i);
+                return mSlotData + mHeader->slotStride * i;
+            }
+            slot.sequence.store(sequence);
+        }
+        removeDeadReaders();
+    }
+    mHeader->droppedCount.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+void FUFramePublisher::endFrame(uint32_t frameNumber, int64_t timeStamp)
+{
+    if (mWritingSlot < 0)
+        return;
+    SlotInfo &slot = mSlots[mWritingSlot];
+    slot.timeStamp = timeStamp;
+    slot.frameNumber = frameNumber;
+    mPublishedCount++;
+    slot.sequence.store(mPublishedCount, std::memory_order_release);
+    mHeader->latestSlot.store(static_cast<uint32_t>(mWritingSlot), std::memory_order_release);
+    mHeader->publishedCount.store(mPublishedCount, std::memory_order_release);
+    mWritingSlot = -1;
+}
+
+bool FUFramePublisher::publish(const void *pixels, int pitch, uint32_t frameNumber, int64_t timeStamp)
+{
+    uint8_t *slot = beginFrame();
+    if (slot == nullptr)
+        return false;
+    const size_t rowSize = static_cast<size_t>(mHeader->width) * BYTES_PER_PIXEL;
+    if (static_cast<size_t>(pitch) == rowSize)
+        std::memcpy(slot, pixels, mFrameSize);
+    else {
+        const uint8_t *row = static_cast<const uint8_t*>(pixels);
+        for (uint32_t y = 0; y < mHeader->height; y++, row += pitch)
+            std::memcpy(slot + rowSize * y, row, rowSize);
+    }
+    endFrame(frameNumber, timeStamp);
+    return true;
+}
+
+uint64_t FUFramePublisher::getDroppedCount() const
+{
+    return mHeader ? mHeader->droppedCount.load(std::memory_order_relaxed) : 0;
+}
+
+bool FUFramePublisher::isHeld(uint64_t sequence) const
+{
+    if (sequence == 0)
+        return false;
+    for (uint32_t i = 0; i < MAX_READERS; i++) {
+        if (mReaders[i].heldSequence.load() == sequence || mReaders[i].acquiringSequence.load() == sequence)
+            return true;
+    }
+    return false;
+}
+
+void FUFramePublisher::removeDeadReaders()
+{
+    for (uint32_t i = 0; i < MAX_READERS; i++) {
+        ReaderInfo &reader = mReaders[i];
+        uint32_t processID = reader.processID.load(std::memory_order_relaxed);
+        if (processID == 0 || FUSharedMemory::isProcessAlive(processID))
+            continue;
+        reader.heldSequence.store(0);
+        reader.acquiringSequence.store(0);
+        reader.processID.compare_exchange_strong(processID, 0);
+    }
+}
+
+FUFrameReader::FUFrameReader()
+    : mControl()
+    , mPixels()
+    , mHeader(nullptr)
+    , mSlots(nullptr)
+    , mReader(nullptr)
+    , mSlotData(nullptr)
+    , mLastSequence(0)
+{
+}
+
+FUFrameReader::~FUFrameReader()
+{
+    close();
+}
+
+bool FUFrameReader::open(const char *name)
+{
+    close();
+    if (!mControl.open(name, false) || mControl.getSize() < CONTROL_SIZE) {
+        close();
+        return false;
+    }
+    uint8_t *control = static_cast<uint8_t*>(mControl.getData());
+    const Header *header = reinterpret_cast<const Header*>(control);
+    if (header->magic.load(std::memory_order_acquire) != MAGIC || header->version != VERSION || header->bytesPerPixel != BYTES_PER_PIXEL
+            || !mPixels.open(getPixelsName(name).c_str()) || mPixels.getSize() < header->slotStride * header->slotCount) {
+        close();
+        return false;
+    }
+    ReaderInfo *readers = reinterpret_cast<ReaderInfo*>(control + sizeof(Header) + sizeof(SlotInfo) * MAX_SLOTS);
+    const uint32_t processID = FUSharedMemory::getProcessID();
+    for (uint32_t i = 0; i < MAX_READERS && mReader == nullptr; i++) {
+        uint32_t freeID = 0;
+        if (readers[i].processID.compare_exchange_strong(freeID, processID))
+            mReader = readers + i;
+    }
+    if (mReader == nullptr) {
+        close();
+        return false;
+    }
+    mHeader = header;
+    mSlots = reinterpret_cast<const SlotInfo*>(control + sizeof(Header));
+    mSlotData = static_cast<const uint8_t*>(mPixels.getData());
+    mLastSequence = 0;
+    return true;
+}
+
+void FUFrameReader::close()
+{
+    if (mReader != nullptr) {
+        mReader->heldSequence.store(0);
+        mReader->acquiringSequence.store(0);
+        mReader->processID.store(0);
+    }
+    mControl.close();
+    mPixels.close();
+    mHeader = nullptr;
+    mSlots = nullptr;
+    mReader = nullptr;
+    mSlotData = nullptr;
+}
+
+bool FUFrameReader::acquireLatest(Frame &frame)
+{
+    //The publisher closed the pool, a new one has to be opened
+    if (mReader == nullptr || mHeader->magic.load(std::memory_order_relaxed) != MAGIC)
+        return false;
+    //The publisher skips the latest slot, so this only retries when it publishes more than a frame while we acquire one
+    for (int attempt = 0; attempt < 8; attempt++) {
+        const uint64_t publishedCount = mHeader->publishedCount.load(std::memory_order_acquire);
+        if (publishedCount == 0 || publishedCount == mLastSequence)
+            break;
+        const uint32_t slotIndex = mHeader->latestSlot.load(std::memory_order_acquire);
+        const SlotInfo &slot = mSlots[slotIndex];
+        const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == 0 || sequence <= mLastSequence)
+            continue;
+        //Same handshake as in FUFramePublisher::beginFrame()
+        mReader->acquiringSequence.store(sequence);
+        if (slot.sequence.load() != sequence)
+            continue;
+        mReader->heldSequence.store(sequence);
+        mReader->acquiringSequence.store(0);
+        frame.pixels = mSlotData + mHeader->slotStride * slotIndex;
+        frame.width = static_cast<int>(mHeader->width);
+        frame.height = static_cast<int>(mHeader->height);
+        frame.frameNumber = slot.frameNumber;
+        frame.timeStamp = slot.timeStamp;
+        frame.sequence = sequence;
+        mLastSequence = sequence;
+        return true;
+    }
+    mReader->acquiringSequence.store(0);
+    return false;
+}
+
+void FUFrameReader::release()
+{
+    if (mReader != nullptr)
+        mReader->heldSequence.store(0);
+}
+
+PIXEL_FORMAT FUFrameReader::getFormat() const
+{
+    return mHeader ? static_cast<PIXEL_FORMAT>(mHeader->format) : COLOR_BGRA;
+}
+
+int FUFrameReader::getWidth() const
+{
+    return mHeader ? static_cast<int>(mHeader->width) : 0;
+}
+
+int FUFrameReader::getHeight() const
+{
+    return mHeader ? static_cast<int>(mHeader->height) : 0;
+}
+
+uint64_t FUFrameReader::getDroppedCount() const
+{
+    return mHeader ? mHeader->droppedCount.load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,191 @@
+#pragma once
+//STL Includes
+#include <atomic>
+#include <cstdint>
+//Local Includes
+#include "FUSharedMemory.h"
+
+/**
+ * @brief The layout of the shared memory of FUFramePublisher. Every pool is two segments: the control segment "<name>" with the
+ * Header, MAX_SLOTS SlotInfos and MAX_READERS ReaderInfos, which the readers map writable, and the pixel segment
+ * "<name>.pixels" with slotCount frames of slotStride bytes, which the readers map read-only.
+ * A slot's sequence is the number of the frame in it, counting from 1, or 0 while the publisher writes it. A reader holds a
+ * frame by putting its sequence into its ReaderInfo, and the publisher never writes a slot that a reader holds or the slot of
+ * the latest frame.
+ */
+namespace FUSharedFrame
+{
+enum PIXEL_FORMAT {
+    DEPTH_PIXELS = 1,//FUDepthPixel, 4 bytes
+    COLOR_BGRA = 2//4 bytes
+};
+
+struct Header {
+    std::atomic<uint32_t> magic;//Set last, readers ignore the pool until it's MAGIC
+    uint32_t version;
+    uint32_t format;//PIXEL_FORMAT
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytesPerPixel;
+    uint32_t slotCount;
+    uint32_t reserved;
+    uint64_t slotStride;
+    std::atomic<uint64_t> publishedCount;
+    std::atomic<uint64_t> droppedCount;//Frames that weren't published because the readers held every free slot
+    std::atomic<uint32_t> latestSlot;
+    uint32_t reserved2;
+};
+
+struct SlotInfo {
+    std::atomic<uint64_t> sequence;
+    int64_t timeStamp;
+    uint32_t frameNumber;
+    uint32_t reserved;
+};
+
+/**
+ * @brief processID is 0 when the entry is free. acquiringSequence is the frame that the reader is about to hold, so the held
+ * frame stays valid if the new one can't be acquired.
+ */
+struct ReaderInfo {
+    std::atomic<uint32_t> processID;
+    uint32_t reserved;
+    std::atomic<uint64_t> heldSequence;
+    std::atomic<uint64_t> acquiringSequence;
+};
+
+const uint32_t MAGIC = 0x46465546;//"FUFF"
+const uint32_t VERSION = 1;
+const uint32_t MAX_SLOTS = 16;
+const uint32_t MAX_READERS = 16;
+const char* const DEFAULT_COLOR_NAME = "FUKinectColor";
+const char* const DEFAULT_DEPTH_NAME = "FUKinectDepth";
+}
+
+/**
+ * @brief Publishes color or depth frames to other processes through a pool of frame slots in shared memory. The frames are
+ * written into the slots once and the readers map them read-only, so no matter how many readers there are nothing else is copied.
+ * A reader holds one frame at a time; when the readers hold every slot that could be written, the frame is dropped instead of
+ * waiting for them.
+ */
+class FUFramePublisher
+{
+public:
+    FUFramePublisher();
+    ~FUFramePublisher();
+    /**
+     * @brief Creates the shared memory of the pool.
+     * @param name
+     * @param format
+     * @param width
+     * @param height
+     * @param slotCount --> Between 2 and MAX_SLOTS. The latest frame and every frame that a reader holds keep a slot busy, so use
+     * at least the number of readers that hold frames at the same time plus two.
+     * @return false if the shared memory can't be created
+     */
+    bool open(const char *name, FUSharedFrame::PIXEL_FORMAT format, int width, int height, int slotCount = 4);
+    void close();
+    bool isOpen() const {return mHeader != nullptr;}
+    /**
+     * @brief Returns a free slot to write the next frame into, width * height * bytesPerPixel bytes with no padding. The readers
+     * can't see it until endFrame().
+     * @return nullptr if the readers hold every free slot, the frame is counted as dropped
+     */
+    uint8_t* beginFrame();
+    /**
+     * @brief Publishes the frame that beginFrame() returned.
+     * @param frameNumber
+     * @param timeStamp
+     */
+    void endFrame(uint32_t frameNumber, int64_t timeStamp);
+    /**
+     * @brief Copies a frame into a free slot and publishes it.
+     * @param pixels
+     * @param pitch --> Bytes between the rows of pixels
+     * @param frameNumber
+     * @param timeStamp
+     * @return false if the frame was dropped
+     */
+    bool publish(const void *pixels, int pitch, uint32_t frameNumber, int64_t timeStamp);
+    uint64_t getPublishedCount() const {return mPublishedCount;}
+    uint64_t getDroppedCount() const;
+
+private:
+    FUSharedMemory mControl;
+    FUSharedMemory mPixels;
+    FUSharedFrame::Header *mHeader;
+    FUSharedFrame::SlotInfo *mSlots;
+    FUSharedFrame::ReaderInfo *mReaders;
+    uint8_t *mSlotData;
+    size_t mFrameSize;
+    uint64_t mPublishedCount;
+    int mWritingSlot;
+
+private:
+    bool isHeld(uint64_t sequence) const;
+    /**
+     * @brief Frees the entries of the readers whose process exited without closing the pool.
+     */
+    void removeDeadReaders();
+    FUFramePublisher(const FUFramePublisher&);
+    FUFramePublisher& operator=(const FUFramePublisher&);
+};
+
+/**
+ * @brief Reads the frames of an FUFramePublisher in another process, in place.
+ */
+class FUFrameReader
+{
+public:
+    /**
+     * @brief A frame that the reader holds. pixels stays valid and unchanged until the next acquireLatest(), release() or close().
+     */
+    struct Frame {
+        const uint8_t *pixels;
+        int width;
+        int height;
+        uint32_t frameNumber;
+        int64_t timeStamp;
+        uint64_t sequence;
+    };
+
+public:
+    FUFrameReader();
+    ~FUFrameReader();
+    /**
+     * @brief Maps a pool and takes one of its reader entries.
+     * @param name
+     * @return false if there's no pool with that name, it has a different layout or MAX_READERS readers already use it
+     */
+    bool open(const char *name);
+    void close();
+    bool isOpen() const {return mReader != nullptr;}
+    /**
+     * @brief Holds the latest frame if it's newer than the last one that was acquired, and releases the frame that was held.
+     * @param frame --> Output
+     * @return false if there's no newer frame, the held frame stays valid
+     */
+    bool acquireLatest(Frame &frame);
+    void release();
+    FUSharedFrame::PIXEL_FORMAT getFormat() const;
+    int getWidth() const;
+    int getHeight() const;
+    /**
+     * @brief Returns how many frames the publisher dropped because the readers held its slots.
+     * @return
+     */
+    uint64_t getDroppedCount() const;
+
+private:
+    FUSharedMemory mControl;
+    FUSharedMemory mPixels;
+    const FUSharedFrame::Header *mHeader;
+    const FUSharedFrame::SlotInfo *mSlots;
+    FUSharedFrame::ReaderInfo *mReader;
+    const uint8_t *mSlotData;
+    uint64_t mLastSequence;
+
+private:
+    FUFrameReader(const FUFrameReader&);
+    FUFrameReader& operator=(const FUFrameReader&);
+};
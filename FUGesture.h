@@ -0,0 +1,90 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+
+/**
+ * @brief The detector flags and the gesture events. FUFrameProcessor and FUKinectTool both inherit these, so they are
+ * available as e.g. FUKinectTool::RIGHT_HAND_UP.
+ */
+struct FUGesture
+{
+    /**
+     * @brief Detectors that can be subscribed to with subscribe(). These can be combined as bit flags.
+     */
+    enum DETECTORS {
+        RIGHT_HAND_UP = 1 << 0,
+        LEFT_HAND_UP = 1 << 1,
+        BOTH_HANDS_UP = 1 << 2,
+        LEFT_HAND_DOWN = 1 << 3,
+        RIGHT_HAND_DOWN = 1 << 4,
+        OPEN_RIGHT_ARM = 1 << 5,
+        OPEN_LEFT_ARM = 1 << 6,
+        OPEN_ARMS = 1 << 7,
+        PUSH = 1 << 8,
+        GRIP = 1 << 9,
+        LEAN_RIGHT = 1 << 10,
+        LEAN_LEFT = 1 << 11,
+        JUMPING = 1 << 12,
+        ALL_DETECTORS = (1 << 13) - 1
+    };
+    static const int DETECTOR_COUNT = 13;
+    static_assert(ALL_DETECTORS == (1 << DETECTOR_COUNT) - 1, "DETECTOR_COUNT must match the detector flags");
+
+    enum EVENT_PHASE {
+        EVENT_BEGAN,//The detector started returning true
+        EVENT_ENDED//The detector stopped returning true or the player left the scene
+    };
+
+    /**
+     * @brief Same values as NUI_HAND_TYPE
+     */
+    enum HAND_TYPE {
+        HAND_TYPE_NONE = 0,
+        HAND_TYPE_LEFT,
+        HAND_TYPE_RIGHT
+    };
+
+    /**
+     * @brief An edge triggered detector event. All the events of a skeleton frame are queued together. PUSH and GRIP
+     * events are queued per hand as the interaction frames arrive; for these EVENT_BEGAN is a press or a grip and EVENT_ENDED
+     * is the release. handType is HAND_TYPE_NONE for the posture events.
+     */
+    struct GestureEvent {
+        uint32_t skeletonTrackingID;
+        DETECTORS detector;
+        EVENT_PHASE phase;
+        HAND_TYPE handType;
+        uint32_t frameNumber;
+        int64_t timeStamp;
+    };
+
+    /**
+     * @brief Pass this as the tracking ID to subscribe() to subscribe for every tracked player.
+     */
+    static const uint32_t ANY_PLAYER = 0;
+
+    /**
+     * @brief Returns the name of a single detector in camel case, e.g. "rightHandUp", for the exported files.
+     * @param detector
+     * @return An empty string if it isn't a single detector
+     */
+    static const char* getDetectorName(DETECTORS detector)
+    {
+        switch (detector) {
+        case RIGHT_HAND_UP: return "rightHandUp";
+        case LEFT_HAND_UP: return "leftHandUp";
+        case BOTH_HANDS_UP: return "bothHandsUp";
+        case LEFT_HAND_DOWN: return "leftHandDown";
+        case RIGHT_HAND_DOWN: return "rightHandDown";
+        case OPEN_RIGHT_ARM: return "openRightArm";
+        case OPEN_LEFT_ARM: return "openLeftArm";
+        case OPEN_ARMS: return "openArms";
+        case PUSH: return "push";
+        case GRIP: return "grip";
+        case LEAN_RIGHT: return "leanRight";
+        case LEAN_LEFT: return "leanLeft";
+        case JUMPING: return "jumping";
+        default: return "";
+        }
+    }
+};
@@ -0,0 +1,202 @@
+#include "FUHandClassifier.h"
+//STL Includes
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+//Local Includes
+#include "FUSimd.h"
+#include "FUTrace.h"
+
+//Width of the region in meters, a bit more than an open hand
+static const float HAND_REGION_SIZE = 0.22f;
+//Radius of a closed hand in meters, used to reject segments that are too small
+static const float FIST_RADIUS = 0.045f;
+//Pixels farther than this from the hand depth can't be a part of the hand
+static const int DEPTH_BAND = 90;
+//Maximum depth difference between two neighbouring hand pixels
+static const int DEPTH_CONTINUITY = 25;
+//Size of the window around the joint that is searched for the seed pixel
+static const int SEED_RADIUS = 2;
+static const float OPEN_COMPACTNESS = 2.1f;
+static const float POINTING_EXTENT = 1.55f;
+static const float PI = 3.14159265f;
+
+FUHandClassifier::FUHandClassifier()
+{
+}
+
+FUHandClassifier::Result FUHandClassifier::classify(const FUDepthFrame &frame, int handX, int handY, int handDepth)
+{
+    FU_TRACE_SCOPE(FUTrace::DEPTH, "FUHandClassifier::classify");
+    Result result = {HAND_UNKNOWN, {0, 0.f, 0.f}};
+    if (frame.pixels == nullptr || handDepth <= 0)
+        return result;
+    const float focalLength = getDepthFocalLength(frame.width);
+    const int roiSize = static_cast<int>(HAND_REGION_SIZE * focalLength * 1000.f / handDepth);
+    if (roiSize < MIN_ROI_SIZE)
+        return result;
+    //A hand closer than about 1.3 m is sampled at every step th pixel to fit in the buffers
+    const int step = (roiSize + MAX_ROI_SIZE - 1) / MAX_ROI_SIZE;
+    const int radius = roiSize / 2;
+    //Clip the region to the frame. The region is in frame pixels, width and height are in samples.
+    const int left = handX - radius < 0 ? 0 : handX - radius;
+    const int top = handY - radius < 0 ? 0 : handY - radius;
+    const int right = handX + radius > frame.width ? frame.width : handX + radius;
+    const int bottom = handY + radius > frame.height ? frame.height : handY + radius;
+    const int width = (right - left + step - 1) / step;
+    const int height = (bottom - top + step - 1) / step;
+    if (width < MIN_ROI_SIZE || height < MIN_ROI_SIZE)
+        return result;
+
+    extractBandMask(frame, left, top, width, height, step, handDepth);
+
+    //The joint is not always on a hand pixel, take the closest one in depth around it
+    const int handColumn = (handX - left) / step;
+    const int handRow = (handY - top) / step;
+    int seed = -1;
+    int seedDifference = DEPTH_BAND;
+    for (int y = handRow - SEED_RADIUS; y <= handRow + SEED_RADIUS; y++) {
+        for (int x = handColumn - SEED_RADIUS; x <= handColumn + SEED_RADIUS; x++) {
+            if (x < 0 || x >= width || y < 0 || y >= height)
+                continue;
+            const int index = y * width + x;
+            if (mBandMask[index] == 0)
+                continue;
+            const int difference = std::abs(frame.pixels[(top + y * step) * frame.width + left + x * step].depth - handDepth);
+            if (difference < seedDifference) {
+                seedDifference = difference;
+                seed = index;
+            }
+        }
+    }
+    if (seed < 0)
+        return result;
+
+    const int area = growSegment(frame, left, top, width, height, step, seed, radius / step);
+    const float fistRadius = FIST_RADIUS * focalLength * 1000.f / handDepth / step;
+    if (area < 0.3f * PI * fistRadius * fistRadius)
+        return result;
+
+    //The features are scale independent, only the area is converted back to frame pixels
+    result.features = computeFeatures(width, height, area);
+    result.features.area = area * step * step;
+    if (result.features.compactness > OPEN_COMPACTNESS)
+        result.shape = HAND_OPEN;
+    else if (result.features.extent > POINTING_EXTENT)
+        result.shape = HAND_POINTING;
+    else
+        result.shape = HAND_CLOSED;
+    return result;
+}
+
+void FUHandClassifier::extractBandMask(const FUDepthFrame &frame, int left, int top, int width, int height, int step, int handDepth)
+{
+    const int minDepth = handDepth - DEPTH_BAND;
+    const int maxDepth = handDepth + DEPTH_BAND;
+    for (int y = 0; y < height; y++) {
+        const FUDepthPixel *row = frame.pixels + (top + y * step) * frame.width + left;
+        uint8_t *mask = mBandMask + y * width;
+        int x = 0;
+#ifdef FU_SSE2
+        const __m128i low = _mm_set1_epi32(minDepth);
+        const __m128i high = _mm_set1_epi32(maxDepth);
+        //Only a region that isn't sampled is contiguous
+        for (; step == 1 && x + 4 <= width; x += 4) {
+            //The depth is the upper half of every 32 bit pixel
+            const __m128i depth = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)), 16);
+            const __m128i inBand = _mm_and_si128(_mm_cmpgt_epi32(depth, low), _mm_cmplt_epi32(depth, high));
+            const int bits = _mm_movemask_ps(_mm_castsi128_ps(inBand));
+            mask[x] = bits & 1;
+            mask[x + 1] = (bits >> 1) & 1;
+            mask[x + 2] = (bits >> 2) & 1;
+            mask[x + 3] = (bits >> 3) & 1;
+        }
+#endif
+        for (; x < width; x++) {
+            const int depth = row[x * step].depth;
+            mask[x] = static_cast<uint8_t>(depth > minDepth && depth < maxDepth);
+        }
+    }
+}
+
+int FUHandClassifier::growSegment(const FUDepthFrame &frame, int left, int top, int width, int height, int step, int seed, int radius)
+{
+    std::memset(mSegment, 0, width * height);
+    //Pixels outside of the disc around the joint are most probably the forearm
+    const int centerX = seed % width;
+    const int centerY = seed / width;
+    const int radiusSquare = radius * radius;
+    //The samples are step pixels apart, so neighbouring depths can differ more
+    const int continuity = DEPTH_CONTINUITY * step;
+    int stackSize = 0;
+    int area = 0;
+    mStack[stackSize++] = static_cast<uint16_t>(seed);
+    mSegment[seed] = 1;
+    while (stackSize > 0) {
+        const int index = mStack[--stackSize];
+        area++;
+        const int x = index % width;
+        const int y = index / width;
+        const int depth = frame.pixels[(top + y * step) * frame.width + left + x * step].depth;
+        const int neighbours[4][2] = {{x - 1, y}, {x + 1, y}, {x, y - 1}, {x, y + 1}};
+        for (int i = 0; i < 4; i++) {
+            const int nx = neighbours[i][0];
+            const int ny = neighbours[i][1];
+            if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+                continue;
+            const int neighbour = ny * width + nx;
+            if (mSegment[neighbour] || !mBandMask[neighbour])
+                continue;
+            if ((nx - centerX) * (nx - centerX) + (ny - centerY) * (ny - centerY) > radiusSquare)
+                continue;
+            const int neighbourDepth = frame.pixels[(top + ny * step) * frame.width + left + nx * step].depth;
+            if (std::abs(neighbourDepth - depth) > continuity)
+                continue;
+            mSegment[neighbour] = 1;
+            mStack[stackSize++] = static_cast<uint16_t>(neighbour);
+        }
+    }
+    return area;
+}
+
+FUHandClassifier::HandFeatures FUHandClassifier::computeFeatures(int width, int height, int area) const
+{
+    HandFeatures features = {area, 0.f, 0.f};
+    //Centroid
+    int sumX = 0;
+    int sumY = 0;
+    for (int y = 0; y < height; y++) {
+        const uint8_t *row = mSegment + y * width;
+        int rowCount = 0;
+        for (int x = 0; x < width; x++) {
+            sumX += row[x] * x;
+            rowCount += row[x];
+        }
+        sumY += rowCount * y;
+    }
+    const float centroidX = static_cast<float>(sumX) / area;
+    const float centroidY = static_cast<float>(sumY) / area;
+
+    //Perimeter as the number of segment pixels that have a 4-neighbour outside of the segment
+    int perimeter = 0;
+    float maxDistanceSquare = 0.f;
+    for (int y = 0; y < height; y++) {
+        const uint8_t *row = mSegment + y * width;
+        const uint8_t *rowAbove = y > 0 ? row - width : nullptr;
+        const uint8_t *rowBelow = y + 1 < height ? row + width : nullptr;
+        const float dy = y - centroidY;
+        for (int x = 0; x < width; x++) {
+            if (row[x] == 0)
+                continue;
+            const int inside = (x > 0 ? row[x - 1] : 0) & (x + 1 < width ? row[x + 1] : 0)
+                    & (rowAbove ? rowAbove[x] : 0) & (rowBelow ? rowBelow[x] : 0);
+            perimeter += 1 - inside;
+            const float dx = x - centroidX;
+            const float distanceSquare = dx * dx + dy * dy;
+            maxDistanceSquare = distanceSquare > maxDistanceSquare ? distanceSquare : maxDistanceSquare;
+        }
+    }
+    features.compactness = perimeter * perimeter / (4.f * PI * area);
+    features.extent = std::sqrt(maxDistanceSquare) / std::sqrt(area / PI);
+    return features;
+}
@@ -0,0 +1,69 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+//Local Includes
+#include "FUDepthFrame.h"
+
+/**
+ * @brief Classifies a hand as open, closed or pointing from a small region of the depth frame around the hand joint.
+ * The hand is segmented from the region by depth continuity starting at the joint and the shape is decided from a few
+ * scale independent features of the segment. An instance keeps its working buffers, so it doesn't allocate, and it
+ * shouldn't be shared between threads.
+ */
+class FUHandClassifier
+{
+public:
+    enum HAND_SHAPE {
+        HAND_UNKNOWN,//The hand couldn't be segmented
+        HAND_OPEN,
+        HAND_CLOSED,
+        HAND_POINTING
+    };
+
+    struct HandFeatures {
+        int area;//Number of depth frame pixels in the segment
+        float compactness;//perimeter^2 / (4 * pi * area), close to 1 for a fist and grows with the spread fingers
+        float extent;//Farthest segment pixel from the centroid divided by the radius of a disc with the same area
+    };
+
+    struct Result {
+        HAND_SHAPE shape;
+        HandFeatures features;
+    };
+
+    /**
+     * @brief Limits of the region side in pixels. The region is sized to fit an open hand at the hand's depth, a larger region
+     * than MAX_ROI_SIZE is sampled at every Nth pixel so that it fits, which keeps the cost per hand fixed up close.
+     */
+    static const int MAX_ROI_SIZE = 96;
+    static const int MIN_ROI_SIZE = 8;
+
+public:
+    FUHandClassifier();
+    /**
+     * @brief Classifies the hand at the given depth pixel.
+     * @param frame --> Depth frame
+     * @param handX --> Hand joint projected into the depth frame
+     * @param handY --> Hand joint projected into the depth frame
+     * @param handDepth --> Depth of the hand joint in millimeters
+     * @return Result
+     */
+    Result classify(const FUDepthFrame &frame, int handX, int handY, int handDepth);
+
+private:
+    uint8_t mBandMask[MAX_ROI_SIZE * MAX_ROI_SIZE];
+    uint8_t mSegment[MAX_ROI_SIZE * MAX_ROI_SIZE];
+    uint16_t mStack[MAX_ROI_SIZE * MAX_ROI_SIZE];
+
+private:
+    /**
+     * @brief Marks the pixels of the region that are within the depth band around the hand depth.
+     */
+    void extractBandMask(const FUDepthFrame &frame, int left, int top, int width, int height, int step, int handDepth);
+    /**
+     * @brief Grows the hand segment from the seed over the band mask, following only continuous depth.
+     * @return Number of region pixels in the segment
+     */
+    int growSegment(const FUDepthFrame &frame, int left, int top, int width, int height, int step, int seed, int radius);
+    HandFeatures computeFeatures(int width, int height, int area) const;
+};
@@ -0,0 +1,397 @@
+#include "FUJpegEncoder.h"
+//STL Includes
+#include <cmath>
+//Local Includes
+#include "FUThreadPool.h"
+#include "FUTrace.h"
+
+//MCU rows per strip. Every strip costs a restart marker and a DC prediction reset, so a few bytes.
+static const int STRIP_MCU_ROWS = 2;
+static const int MCU_SIZE = 16;
+
+static const uint8_t ZIGZAG[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+//The quantization tables of Annex K of the standard, in natural order
+static const uint8_t LUMINANCE_QUANTIZATION[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55, 14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92, 49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99
+};
+static const uint8_t CHROMINANCE_QUANTIZATION[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99
+};
+
+//The Huffman tables of Annex K: the number of codes of every length from 1 to 16, then the symbols
+static const uint8_t DC_LUMINANCE_COUNTS[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t DC_CHROMINANCE_COUNTS[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static const uint8_t DC_SYMBOLS[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+static const uint8_t AC_LUMINANCE_COUNTS[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D};
+static const uint8_t AC_LUMINANCE_SYMBOLS[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81,
+    0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18,
+    0x19, 0x1A, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75,
+    0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99,
+    0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+    0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5,
+    0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA
+};
+static const uint8_t AC_CHROMINANCE_COUNTS[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static const uint8_t AC_CHROMINANCE_SYMBOLS[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08,
+    0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0, 0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25,
+    0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47,
+    0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74,
+    0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97,
+    0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA,
+    0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE2, 0xE3, 0xE4,
+    0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA
+};
+
+namespace {
+struct HuffmanTable {
+    uint16_t codes[256];
+    uint8_t sizes[256];
+};
+
+HuffmanTable createTable(const uint8_t *counts, const uint8_t *symbols)
+{
+    HuffmanTable table = HuffmanTable();
+    uint16_t code = 0;
+    int symbol = 0;
+    for (int length = 1; length <= 16; length++) {
+        for (int i = 0; i < counts[length - 1]; i++, symbol++, code++) {
+            table.codes[symbols[symbol]] = code;
+            table.sizes[symbols[symbol]] = static_cast<uint8_t>(length);
+        }
+        code <<= 1;
+    }
+    return table;
+}
+
+struct HuffmanTables {
+    HuffmanTable dcLuminance;
+    HuffmanTable dcChrominance;
+    HuffmanTable acLuminance;
+    HuffmanTable acChrominance;
+};
+
+const HuffmanTables& getHuffmanTables()
+{
+    static const HuffmanTables tables = {
+        createTable(DC_LUMINANCE_COUNTS, DC_SYMBOLS),
+        createTable(DC_CHROMINANCE_COUNTS, DC_SYMBOLS),
+        createTable(AC_LUMINANCE_COUNTS, AC_LUMINANCE_SYMBOLS),
+        createTable(AC_CHROMINANCE_COUNTS, AC_CHROMINANCE_SYMBOLS)
+    };
+    return tables;
+}
+
+/**
+ * @brief Writes the entropy coded data, with a 0 after every 0xFF byte so it can't be mistaken for a marker.
+ */
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<uint8_t> &output)
+        : mOutput(output)
+        , mBits(0)
+        , mBitCount(0)
+    {
+    }
+
+    void write(uint32_t bits, int count)
+    {
+        mBits = (mBits << count) | (bits & ((1u << count) - 1));
+        mBitCount += count;
+        while (mBitCount >= 8) {
+            mBitCount -= 8;
+            const uint8_t byte = static_cast<uint8_t>(mBits >> mBitCount);
+            mOutput.push_back(byte);
+            if (byte == 0xFF)
+                mOutput.push_back(0);
+        }
+    }
+
+    /**
+     * @brief Pads the last byte with ones, as the standard requires before a marker.
+     */
+    void flush()
+    {
+        if (mBitCount > 0)
+            write(0x7F, 8 - mBitCount);
+    }
+
+private:
+    std::vector<uint8_t> &mOutput;
+    uint32_t mBits;
+    int mBitCount;
+};
+
+/**
+ * @brief The AAN forward DCT of 8 values with the given stride. The outputs are scaled by the factors that the divisors undo.
+ */
+inline void transform(float *d, int stride)
+{
+    const float tmp0 = d[0] + d[stride * 7];
+    const float tmp7 = d[0] - d[stride * 7];
+    const float tmp1 = d[stride] + d[stride * 6];
+    const float tmp6 = d[stride] - d[stride * 6];
+    const float tmp2 = d[stride * 2] + d[stride * 5];
+    const float tmp5 = d[stride * 2] - d[stride * 5];
+    const float tmp3 = d[stride * 3] + d[stride * 4];
+    const float tmp4 = d[stride * 3] - d[stride * 4];
+
+    float tmp10 = tmp0 + tmp3;
+    const float tmp13 = tmp0 - tmp3;
+    float tmp11 = tmp1 + tmp2;
+    float tmp12 = tmp1 - tmp2;
+    d[0] = tmp10 + tmp11;
+    d[stride * 4] = tmp10 - tmp11;
+    const float z1 = (tmp12 + tmp13) * 0.707106781f;
+    d[stride * 2] = tmp13 + z1;
+    d[stride * 6] = tmp13 - z1;
+
+    tmp10 = tmp4 + tmp5;
+    tmp11 = tmp5 + tmp6;
+    tmp12 = tmp6 + tmp7;
+    const float z5 = (tmp10 - tmp12) * 0.382683433f;
+    const float z2 = 0.541196100f * tmp10 + z5;
+    const float z4 = 1.306562965f * tmp12 + z5;
+    const float z3 = tmp11 * 0.707106781f;
+    const float z11 = tmp7 + z3;
+    const float z13 = tmp7 - z3;
+    d[stride * 5] = z13 + z2;
+    d[stride * 3] = z13 - z2;
+    d[stride] = z11 + z4;
+    d[stride * 7] = z11 - z4;
+}
+
+inline int getBitCount(int value)
+{
+    int count = 0;
+    for (value = value < 0 ? -value : value; value != 0; value >>= 1)
+        count++;
+    return count;
+}
+
+/**
+ * @brief Transforms, quantizes and writes a block, and returns its DC coefficient for the prediction of the next one.
+ */
+int encodeBlock(BitWriter &writer, float *block, const float *divisors, int previousDC, const HuffmanTable &dcTable, const HuffmanTable &acTable)
+{
+    for (int i = 0; i < 64; i += 8)
+        transform(block + i, 1);
+    for (int i = 0; i < 8; i++)
+        transform(block + i, 8);
+    int coefficients[64];
+    for (int i = 0; i < 64; i++) {
+        const int index = ZIGZAG[i];
+        coefficients[i] = static_cast<int>(std::lrint(block[index] * divisors[index]));
+    }
+
+    const int dc = coefficients[0];
+    const int difference = dc - previousDC;
+    int bitCount = getBitCount(difference);
+    writer.write(dcTable.codes[bitCount], dcTable.sizes[bitCount]);
+    if (bitCount > 0)
+        writer.write(difference < 0 ? difference - 1 : difference, bitCount);
+
+    int last = 63;
+    while (last > 0 && coefficients[last] == 0)
+        last--;
+    int run = 0;
+    for (int i = 1; i <= last; i++) {
+        const int value = coefficients[i];
+        if (value == 0) {
+            run++;
+            continue;
+        }
+        for (; run >= 16; run -= 16)
+            writer.write(acTable.codes[0xF0], acTable.sizes[0xF0]);
+        bitCount = getBitCount(value);
+        const int symbol = (run << 4) | bitCount;
+        writer.write(acTable.codes[symbol], acTable.sizes[symbol]);
+        writer.write(value < 0 ? value - 1 : value, bitCount);
+        run = 0;
+    }
+    if (last < 63)
+        writer.write(acTable.codes[0x00], acTable.sizes[0x00]);
+    return dc;
+}
+
+void append16(std::vector<uint8_t> &output, int value)
+{
+    output.push_back(static_cast<uint8_t>(value >> 8));
+    output.push_back(static_cast<uint8_t>(value));
+}
+
+void appendHuffmanTable(std::vector<uint8_t> &output, int tableClass, int id, const uint8_t *counts, const uint8_t *symbols)
+{
+    int symbolCount = 0;
+    for (int i = 0; i < 16; i++)
+        symbolCount += counts[i];
+    append16(output, 0xFFC4);
+    append16(output, 2 + 1 + 16 + symbolCount);
+    output.push_back(static_cast<uint8_t>(tableClass << 4 | id));
+    output.insert(output.end(), counts, counts + 16);
+    output.insert(output.end(), symbols, symbols + symbolCount);
+}
+}
+
+FUJpegEncoder::FUJpegEncoder(FUThreadPool *threadPool)
+    : mThreadPool(threadPool)
+    , mQuality(0)
+{
+    setQuality(90);
+}
+
+void FUJpegEncoder::setQuality(int quality)
+{
+    quality = quality < 1 ? 1 : (quality > 100 ? 100 : quality);
+    mQuality = quality;
+    const int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    //The factors of the AAN DCT, cos(k * pi / 16) * sqrt(2) except for k = 0
+    static const float AAN_FACTORS[8] = {1.f, 1.387039845f, 1.306562965f, 1.175875602f, 1.f, 0.785694958f, 0.541196100f, 0.275899379f};
+    uint8_t luminance[64];
+    uint8_t chrominance[64];
+    for (int i = 0; i < 64; i++) {
+        const int luminanceValue = (LUMINANCE_QUANTIZATION[i] * scale + 50) / 100;
+        const int chrominanceValue = (CHROMINANCE_QUANTIZATION[i] * scale + 50) / 100;
+        luminance[i] = static_cast<uint8_t>(luminanceValue < 1 ? 1 : (luminanceValue > 255 ? 255 : luminanceValue));
+        chrominance[i] = static_cast<uint8_t>(chrominanceValue < 1 ? 1 : (chrominanceValue > 255 ? 255 : chrominanceValue));
+        const float factor = AAN_FACTORS[i / 8] * AAN_FACTORS[i % 8] * 8.f;
+        mLuminanceDivisors[i] = 1.f / (luminance[i] * factor);
+        mChrominanceDivisors[i] = 1.f / (chrominance[i] * factor);
+    }
+    for (int i = 0; i < 64; i++) {
+        mLuminanceTable[i] = luminance[ZIGZAG[i]];
+        mChrominanceTable[i] = chrominance[ZIGZAG[i]];
+    }
+}
+
+bool FUJpegEncoder::encode(const uint8_t *pixels, int width, int height, int pitch, std::vector<uint8_t> &output)
+{
+    FU_TRACE_SCOPE(FUTrace::IO, "FUJpegEncoder::encode");
+    if (pixels == nullptr || width <= 0 || height <= 0 || width > 65535 || height > 65535)
+        return false;
+    const int mcuColumns = (width + MCU_SIZE - 1) / MCU_SIZE;
+    const int mcuRows = (height + MCU_SIZE - 1) / MCU_SIZE;
+    const int stripCount = (mcuRows + STRIP_MCU_ROWS - 1) / STRIP_MCU_ROWS;
+    //The restart interval is a 16 bit MCU count
+    if (mcuColumns * STRIP_MCU_ROWS > 65535)
+        return false;
+    mStrips.resize(stripCount);
+    const auto encodeTask = [&](int strip) {
+        encodeStrip(pixels, width, height, pitch, strip, mStrips[strip]);
+    };
+    if (mThreadPool)
+        mThreadPool->parallelFor(stripCount, encodeTask);
+    else {
+        for (int i = 0; i < stripCount; i++)
+            encodeTask(i);
+    }
+
+    output.clear();
+    writeHeaders(width, height, mcuColumns * STRIP_MCU_ROWS, output);
+    for (int i = 0; i < stripCount; i++) {
+        if (i > 0)
+            append16(output, 0xFFD0 + (i - 1) % 8);
+        output.insert(output.end(), mStrips[i].begin(), mStrips[i].end());
+    }
+    append16(output, 0xFFD9);
+    return true;
+}
+
+void FUJpegEncoder::encodeStrip(const uint8_t *pixels, int width, int height, int pitch, int strip, std::vector<uint8_t> &output) const
+{
+    const HuffmanTables &tables = getHuffmanTables();
+    output.clear();
+    BitWriter writer(output);
+    int previousY = 0;
+    int previousCb = 0;
+    int previousCr = 0;
+    const int firstRow = strip * STRIP_MCU_ROWS * MCU_SIZE;
+    const int lastRow = firstRow + STRIP_MCU_ROWS * MCU_SIZE < height ? firstRow + STRIP_MCU_ROWS * MCU_SIZE : height;
+    for (int mcuY = firstRow; mcuY < lastRow; mcuY += MCU_SIZE) {
+        for (int mcuX = 0; mcuX < width; mcuX += MCU_SIZE) {
+            float y[4][64];
+            //Sums of the 2x2 pixels of every chroma sample, the color conversion is linear so they are converted once
+            float red[64] = {};
+            float green[64] = {};
+            float blue[64] = {};
+            for (int row = 0; row < MCU_SIZE; row++) {
+                //The edges are repeated to fill the MCUs that stick out of the image
+                const int sourceY = mcuY + row < height ? mcuY + row : height - 1;
+                const uint8_t *source = pixels + static_cast<ptrdiff_t>(pitch) * sourceY;
+                float *luminance = y[(row / 8) * 2] + (row % 8) * 8;
+                const int chromaRow = (row / 2) * 8;
+                for (int column = 0; column < MCU_SIZE; column++) {
+                    const int sourceX = mcuX + column < width ? mcuX + column : width - 1;
+                    const uint8_t *pixel = source + sourceX * 4;
+                    const float b = pixel[0];
+                    const float g = pixel[1];
+                    const float r = pixel[2];
+                    luminance[(column / 8) * 64 + column % 8] = 0.299f * r + 0.587f * g + 0.114f * b - 128.f;
+                    red[chromaRow + column / 2] += r;
+                    green[chromaRow + column / 2] += g;
+                    blue[chromaRow + column / 2] += b;
+                }
+            }
+            float cb[64];
+            float cr[64];
+            for (int i = 0; i < 64; i++) {
+                cb[i] = (-0.168736f * red[i] - 0.331264f * green[i] + 0.5f * blue[i]) * 0.25f;
+                cr[i] = (0.5f * red[i] - 0.418688f * green[i] - 0.081312f * blue[i]) * 0.25f;
+            }
+            for (int i = 0; i < 4; i++)
+                previousY = encodeBlock(writer, y[i], mLuminanceDivisors, previousY, tables.dcLuminance, tables.acLuminance);
+            previousCb = encodeBlock(writer, cb, mChrominanceDivisors, previousCb, tables.dcChrominance, tables.acChrominance);
+            previousCr = encodeBlock(writer, cr, mChrominanceDivisors, previousCr, tables.dcChrominance, tables.acChrominance);
+        }
+    }
+    writer.flush();
+}
+
+void FUJpegEncoder::writeHeaders(int width, int height, int restartInterval, std::vector<uint8_t> &output) const
+{
+    static const uint8_t JFIF[] = {0xFF, 0xD8, 0xFF, 0xE0, 0, 16, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+    output.insert(output.end(), JFIF, JFIF + sizeof(JFIF));
+    append16(output, 0xFFDB);
+    append16(output, 2 + 65 * 2);
+    output.push_back(0);
+    output.insert(output.end(), mLuminanceTable, mLuminanceTable + 64);
+    output.push_back(1);
+    output.insert(output.end(), mChrominanceTable, mChrominanceTable + 64);
+
+    append16(output, 0xFFC0);
+    append16(output, 8 + 3 * 3);
+    output.push_back(8);
+    append16(output, height);
+    append16(output, width);
+    output.push_back(3);
+    //Y is sampled 2x2, Cb and Cr 1x1
+    static const uint8_t COMPONENTS[9] = {1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1};
+    output.insert(output.end(), COMPONENTS, COMPONENTS + 9);
+
+    appendHuffmanTable(output, 0, 0, DC_LUMINANCE_COUNTS, DC_SYMBOLS);
+    appendHuffmanTable(output, 1, 0, AC_LUMINANCE_COUNTS, AC_LUMINANCE_SYMBOLS);
+    appendHuffmanTable(output, 0, 1, DC_CHROMINANCE_COUNTS, DC_SYMBOLS);
+    appendHuffmanTable(output, 1, 1, AC_CHROMINANCE_COUNTS, AC_CHROMINANCE_SYMBOLS);
+
+    append16(output, 0xFFDD);
+    append16(output, 4);
+    append16(output, restartInterval);
+
+    append16(output, 0xFFDA);
+    append16(output, 6 + 2 * 3);
+    output.push_back(3);
+    static const uint8_t SCAN_COMPONENTS[6] = {1, 0x00, 2, 0x11, 3, 0x11};
+    output.insert(output.end(), SCAN_COMPONENTS, SCAN_COMPONENTS + 6);
+    output.push_back(0);
+    output.push_back(63);
+    output.push_back(0);
+}
@@ -0,0 +1,57 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+#include <vector>
+
+class FUThreadPool;
+
+/**
+ * @brief A baseline JPEG encoder for the color frames, with 4:2:0 chroma subsampling and the standard Huffman tables.
+ * The image is split into strips of MCU rows that are encoded in parallel. Every strip starts after a restart marker, so the
+ * strips don't depend on each other and are only concatenated at the end.
+ */
+class FUJpegEncoder
+{
+public:
+    /**
+     * @param threadPool --> Encodes the strips. It can be nullptr.
+     */
+    explicit FUJpegEncoder(FUThreadPool *threadPool = nullptr);
+    /**
+     * @brief Sets the quality with the IJG scaling of the standard quantization tables.
+     * @param quality --> From 1 to 100
+     */
+    void setQuality(int quality);
+    int getQuality() const {return mQuality;}
+    /**
+     * @brief Encodes an image.
+     * @param pixels --> 32 bit BGRX pixels, the layout of the color stream
+     * @param width
+     * @param height
+     * @param pitch --> Bytes between the rows of pixels
+     * @param output --> The JPEG file
+     * @return false if the size isn't valid
+     */
+    bool encode(const uint8_t *pixels, int width, int height, int pitch, std::vector<uint8_t> &output);
+
+private:
+    FUThreadPool *mThreadPool;
+    int mQuality;
+    /**
+     * @brief Quantization tables in zigzag order, as they are written to the file
+     */
+    uint8_t mLuminanceTable[64];
+    uint8_t mChrominanceTable[64];
+    /**
+     * @brief Reciprocals of the quantization tables in natural order, with the scale factors of the DCT folded in
+     */
+    float mLuminanceDivisors[64];
+    float mChrominanceDivisors[64];
+    std::vector<std::vector<uint8_t>> mStrips;
+
+private:
+    void encodeStrip(const uint8_t *pixels, int width, int height, int pitch, int strip, std::vector<uint8_t> &output) const;
+    void writeHeaders(int width, int height, int restartInterval, std::vector<uint8_t> &output) const;
+    FUJpegEncoder(const FUJpegEncoder&);
+    FUJpegEncoder& operator=(const FUJpegEncoder&);
+};
@@ -1,5 +1,23 @@
 #include "FUKinectTool.h"
 
+static_assert(sizeof(FUDepthPixel) == sizeof(NUI_DEPTH_IMAGE_PIXEL), "FUDepthPixel must have the layout of NUI_DEPTH_IMAGE_PIXEL");
+static_assert(sizeof(FURegistration::ColorPoint) == sizeof(NUI_COLOR_IMAGE_POINT), "ColorPoint must have the layout of NUI_COLOR_IMAGE_POINT");
+static_assert(FUSkeleton::JOINT_COUNT == NUI_SKELETON_POSITION_COUNT && FUSkeleton::HAND_LEFT == NUI_SKELETON_POSITION_HAND_LEFT
+              && FUSkeleton::FOOT_RIGHT == NUI_SKELETON_POSITION_FOOT_RIGHT, "FUSkeleton::JOINT must be in the order of NUI_SKELETON_POSITION_INDEX");
+static_assert(FUSkeleton::JOINT_TRACKED == NUI_SKELETON_POSITION_TRACKED && FUSkeleton::JOINT_INFERRED == NUI_SKELETON_POSITION_INFERRED,
+              "FUSkeleton::JOINT_TRACKING_STATE must match NUI_SKELETON_POSITION_TRACKING_STATE");
+static_assert(FUSkeleton::SKELETON_TRACKED == NUI_SKELETON_TRACKED && FUSkeleton::SKELETON_POSITION_ONLY == NUI_SKELETON_POSITION_ONLY
+              && FUSkeleton::MAX_SKELETONS == NUI_SKELETON_COUNT, "FUSkeleton::SKELETON_TRACKING_STATE must match NUI_SKELETON_TRACKING_STATE");
+static_assert(FUGesture::HAND_TYPE_LEFT == NUI_HAND_TYPE_LEFT && FUGesture::HAND_TYPE_RIGHT == NUI_HAND_TYPE_RIGHT,
+              "FUGesture::HAND_TYPE must match NUI_HAND_TYPE");
+static_assert(sizeof(FUSharedSkeleton::Player().hands) / sizeof(FUSharedSkeleton::Hand) == NUI_USER_HANDPOINTER_COUNT,
+              "FUSharedSkeleton::Player must have room for the hand pointers of a user");
+
+/**
+ * @brief Frames the SDK keeps for the color and the depth streams
+ */
+static const DWORD STREAM_BUFFER_COUNT = 2;
+
 FUKinectTool::FUKinectTool(DWORD flags)
     : mSkeletonDataOne(nullptr)
     , mSkeletonDataTwo(nullptr)
@@ -7,28 +25,59 @@ FUKinectTool::FUKinectTool(DWORD flags)
     , mSaveScreenshot(false)
     , mColorWidth(1280)
     , mColorHeight(960)
+    , mDepthWidth(640)
+    , mDepthHeight(480)
     , mNuiInteractionClient(new NuiInteractionClient())
-    , mIsPressedPlayerOne(false)
-    , mIsPressedPlayerTwo(false)
-    , mIsGrippingPlayerOne(false)
-    , mIsGrippingPlayerTwo(false)
-    , mJumpedPlayerOne(false)
-    , mJumpedPlayerTwo(false)
     , mKinectErrorMessage(NO_PROBLEM)
     , mDWFlags(flags)
     , mSkeletonFrame()
-    , mVectorSkeletonOneHandPosition(0, 0)
-    , mVectorSkeletonTwoHandPosition(0, 0)
     , mSkeletonOneTrackingID(-1)
     , mSkeletonTwoTrackingID(-1)
     , mSkeletonLeftScene(SKELETONS::NONE)
+    , mCoreSkeletonFrame()
+    , mRecordDepth(false)
+    , mSkeletonPublisher()
+    , mColorPublisher()
+    , mDepthPublisher()
+    , mSkeletonSender()
+    , mSessionExporter()
+    , mExportFrame()
+    , mUserHands()
+    , mClassifyHands(false)
+    , mHandShapes()
+    , mSegmentDepth(false)
+    , mGeneratePointCloud(false)
+    , mPointCloudPlayerFilter(FUPointCloud::ALL_PIXELS)
+    , mRegisterFrames(false)
+    , mCoordinateMapper(nullptr)
+    , mCalibrationKey(0)
+    , mCropColor(false)
+    , mEstimateFloor(true)
+    , mFloorEstimator(&mThreadPool)
+    , mGateOnMotion(false)
+    , mFilterDepth(false)
+    , mDepthFilter(&mThreadPool)
+    , mSnapshotFormat(SNAPSHOT_JPEG)
+    , mJpegEncoder(&mThreadPool)
+    , mStreamSnapshotInterval(1000)
+    , mLastStreamSnapshotTime(0)
+    , mScheduleStreams(false)
 {
+    //The color stream runs at 12 frames per second at 1280x960. The skeleton and the interaction streams only keep the last frame.
+    mStreamStats[FULatency::SKELETON_STREAM].configure(1000.0 / 30, 1);
+    mStreamStats[FULatency::INTERACTION_STREAM].configure(1000.0 / 30, 1);
+    mStreamStats[FULatency::DEPTH_STREAM].configure(1000.0 / 30, STREAM_BUFFER_COUNT);
+    mStreamStats[FULatency::COLOR_STREAM].configure(1000.0 / 12, STREAM_BUFFER_COUNT);
     NuiSetDeviceStatusCallback(&FUKinectTool::StatusProcCallback, this);
     createFirstConnected();
 }
 
 FUKinectTool::~FUKinectTool(void)
 {
+    if (mCoordinateMapper) {
+        mCoordinateMapper->Release();
+        mCoordinateMapper = nullptr;
+    }
     if (mNuiSensor) {
         mNuiSensor->NuiShutdown();
         mNuiSensor->Release();
@@ -110,11 +159,9 @@ HRESULT FUKinectTool::createFirstConnected()
         // Get the status of the sensor, and if connected, then we can initialize it
         hr = nuiSensor->NuiStatus();
         if (hr == S_OK) {
-            if (mNuiSensor != nullptr) {
-                mNuiSensor->NuiShutdown();
-                mNuiSensor->Release();
-                mNuiSensor = nullptr;
-            }
+            //The coordinate mapper and its calibration key belong to the old sensor
+            if (mNuiSensor != nullptr)
+                safeReleaseSensor();
             mNuiSensor = std::move(nuiSensor);
             break;
         }
@@ -133,7 +180,7 @@ HRESULT FUKinectTool::createFirstConnected()
                         NUI_IMAGE_TYPE_COLOR,
                         NUI_IMAGE_RESOLUTION_1280x960,
                         0,
-                        2,
+                        STREAM_BUFFER_COUNT,
                         mHandleNextColorFrameEvent,
                         &mHandleColorStream);
             /**************************** Create Skeleton ****************************************/
@@ -146,11 +193,12 @@ HRESULT FUKinectTool::createFirstConnected()
             // Create an event that will be signaled when skeleton data is available
             mHandleNextDepthFrameEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
             // Open a skeleton stream to receive skeleton data
+            //The stream type has to match the initialization flag, only this one has the player indices
             hr = mNuiSensor->NuiImageStreamOpen(
-                        NUI_IMAGE_TYPE_DEPTH,
+                        hasPlayerIndex() ? NUI_IMAGE_TYPE_DEPTH_AND_PLAYER_INDEX : NUI_IMAGE_TYPE_DEPTH,
                         NUI_IMAGE_RESOLUTION_640x480,
                         0,
-                        2,
+                        STREAM_BUFFER_COUNT,
                         mHandleNextDepthFrameEvent,
                         &mHandleDepthStream);
 
@@ -170,98 +218,236 @@ HRESULT FUKinectTool::createFirstConnected()
 
 void FUKinectTool::updateSensor()
 {
-    // Wait for 0ms, just quickly test if it is time to process a skeleton
-    if (WaitForSingleObject(mHandleNextSkeletonEvent, 0) == WAIT_OBJECT_0)
+    FU_TRACE_SCOPE(FUTrace::SENSOR, "FUKinectTool::updateSensor");
+    //The depth frame updates the motion gate, so it's read first and the other streams follow the gate's decision on it
+    updateStream(FULatency::DEPTH_STREAM, true);
+    const bool shouldProcess = shouldProcessFrames();
+    if (!shouldProcess) {
+        mStreamStats[FULatency::SKELETON_STREAM].pause();
+        mStreamStats[FULatency::INTERACTION_STREAM].pause();
+        if (!mSaveScreenshot)
+            mStreamStats[FULatency::COLOR_STREAM].pause();
+    }
+    //Without the stream scheduler the other streams are processed in this order
+    static const FULatency::STREAM streamOrder[FULatency::STREAM_COUNT] = {
+        FULatency::SKELETON_STREAM, FULatency::COLOR_STREAM, FULatency::INTERACTION_STREAM, FULatency::DEPTH_STREAM
+    };
+    const FULatency::STREAM *order = mScheduleStreams ? mStreamScheduler.getOrder() : streamOrder;
+    for (int i = 0; i < FULatency::STREAM_COUNT; i++) {
+        if (order[i] != FULatency::DEPTH_STREAM)
+            updateStream(order[i], shouldProcess);
+    }
+    publishStreamSnapshots();
+}
+
+void FUKinectTool::updateStream(FULatency::STREAM stream, bool shouldProcess)
+{
+    //The depth stream is always read for the motion gate, and a pending screenshot is taken even while the gate is idle
+    const bool isForced = stream == FULatency::COLOR_STREAM && mSaveScreenshot;
+    if (!shouldProcess && !isForced && stream != FULatency::DEPTH_STREAM)
+        return;
+    // Wait for 0ms, just quickly test if it is time to process the stream
+    if (WaitForSingleObject(getStreamEvent(stream), 0) != WAIT_OBJECT_0)
+        return;
+    if (!mScheduleStreams) {
+        processStream(stream);
+        return;
+    }
+
+    const int64_t startTime = FULatency::getTime();
+    //The interaction stream and the motion gate need every depth frame, so a depth frame is always read and can't be deferred
+    const bool canDefer = stream != FULatency::DEPTH_STREAM;
+    const FUStreamScheduler::DECISION decision = mStreamScheduler.decide(stream, startTime, isForced, canDefer);
+    if (decision == FUStreamScheduler::PROCESS) {
+        processStream(stream);
+        mStreamScheduler.record(stream, FULatency::getTime() - startTime);
+    }
+    else if (stream == FULatency::DEPTH_STREAM) {
+        processDepth(false);
+    }
+    else if (decision == FUStreamScheduler::SKIP) {
+        mStreamStats[stream].pause();
+        discardFrame(stream);
+    }
+    //A deferred frame stays signaled until a later update
+}
+
+void FUKinectTool::processStream(FULatency::STREAM stream)
+{
+    switch (stream) {
+    case FULatency::SKELETON_STREAM:
         processSkeleton();
-    // Wait for 0ms, just quickly test if it is time to process color
-    if (WaitForSingleObject(mHandleNextColorFrameEvent, 0) == WAIT_OBJECT_0)
-        processColor();
-    // Wait for 0ms, just quickly test if it is time to process color
-    if (WaitForSingleObject(mHandleNextHandEvent, 0) == WAIT_OBJECT_0)
+        break;
+    case FULatency::INTERACTION_STREAM:
         processInteraction();
-    // Wait for 0ms, just quickly test if it is time to process color
-    if (WaitForSingleObject(mHandleNextDepthFrameEvent, 0) == WAIT_OBJECT_0)
-        processDepth();
+        break;
+    case FULatency::DEPTH_STREAM:
+        processDepth(true);
+        break;
+    case FULatency::COLOR_STREAM:
+        processColor();
+        break;
+    default:
+        break;
+    }
+}
+
+void FUKinectTool::discardFrame(FULatency::STREAM stream)
+{
+    if (stream == FULatency::SKELETON_STREAM) {
+        //The interaction stream still needs the skeletons for the hand pointers and the grip and press events
+        NUI_SKELETON_FRAME skeletonFrame;
+        if (SUCCEEDED(mNuiSensor->NuiSkeletonGetNextFrame(0, &skeletonFrame))) {
+            Vector4 accelerometer = {0};
+            mNuiSensor->NuiAccelerometerGetCurrentReading(&accelerometer);
+            mNuiInteractionStream->ProcessSkeleton(NUI_SKELETON_COUNT, skeletonFrame.SkeletonData, &accelerometer, skeletonFrame.liTimeStamp);
+        }
+    }
+    else if (stream == FULatency::INTERACTION_STREAM) {
+        NUI_INTERACTION_FRAME interactionFrame;
+        mNuiInteractionStream->GetNextFrame(0, &interactionFrame);
+    }
+    else {
+        HANDLE streamHandle = stream == FULatency::DEPTH_STREAM ? mHandleDepthStream : mHandleColorStream;
+        NUI_IMAGE_FRAME imageFrame;
+        if (SUCCEEDED(mNuiSensor->NuiImageStreamGetNextFrame(streamHandle, 0, &imageFrame)))
+            mNuiSensor->NuiImageStreamReleaseFrame(streamHandle, &imageFrame);
+    }
+}
+
+HANDLE FUKinectTool::getStreamEvent(FULatency::STREAM stream) const
+{
+    switch (stream) {
+    case FULatency::SKELETON_STREAM:
+        return mHandleNextSkeletonEvent;
+    case FULatency::INTERACTION_STREAM:
+        return mHandleNextHandEvent;
+    case FULatency::DEPTH_STREAM:
+        return mHandleNextDepthFrameEvent;
+    default:
+        return mHandleNextColorFrameEvent;
+    }
+}
+
+void FUKinectTool::publishStreamSnapshots()
+{
+    if (mStreamSnapshotInterval <= 0)
+        return;
+    const int64_t now = FULatency::getTime();
+    if (now - mLastStreamSnapshotTime < static_cast<int64_t>(mStreamSnapshotInterval) * 1000000)
+        return;
+    mLastStreamSnapshotTime = now;
+    for (int i = 0; i < FULatency::STREAM_COUNT; i++) {
+        const StreamSnapshot snapshot = {static_cast<FULatency::STREAM>(i), mStreamStats[i].takeSnapshot()};
+        mStreamSnapshots.push(snapshot);
+    }
 }
 
 void FUKinectTool::processInteraction()
 {
+    FU_TRACE_SCOPE(FUTrace::INTERACTION, "FUKinectTool::processInteraction");
     NUI_INTERACTION_FRAME interactionFrame = { 0 };
     HRESULT results = mNuiInteractionStream->GetNextFrame(0, &interactionFrame );
 
-    if(FAILED(results))
+    if(FAILED(results)) {
+        mStreamStats[FULatency::INTERACTION_STREAM].recordFailedRead();
         return;
+    }
+    mStreamStats[FULatency::INTERACTION_STREAM].recordFrame(interactionFrame.TimeStamp.QuadPart);
+    FULatency::Stamp latencyStamp = mLatency.begin(FULatency::INTERACTION_STREAM, interactionFrame.TimeStamp.QuadPart);
+    GestureEvent event = {0};
+    event.frameNumber = mSkeletonFrame.dwFrameNumber;
+    event.timeStamp = interactionFrame.TimeStamp.QuadPart;
     for(int i = 0; i < NUI_SKELETON_COUNT; i++) {
-        NUI_USER_INFO user = interactionFrame.UserInfos[i];
-        if (user.SkeletonTrackingId != 0) {
-            for(int j = 0; j < NUI_USER_HANDPOINTER_COUNT; j++) {
-                NUI_HANDPOINTER_INFO hand = user.HandPointerInfos[j];
-                NUI_HANDPOINTER_STATE state  = (NUI_HANDPOINTER_STATE)hand.State;
-                if(state & NUI_HANDPOINTER_STATE_PRIMARY_FOR_USER) {
-                    if (mSkeletonDataOne != nullptr && user.SkeletonTrackingId == mSkeletonDataOne->dwTrackingID) {
-                        mVectorSkeletonOneHandPosition.setX(hand.X);
-                        mVectorSkeletonOneHandPosition.setY(hand.Y);
-                    }
-                    else if(mSkeletonDataTwo != nullptr && user.SkeletonTrackingId == mSkeletonDataTwo->dwTrackingID) {
-                        mVectorSkeletonTwoHandPosition.setX(hand.X);
-                        mVectorSkeletonTwoHandPosition.setY(hand.Y);
-                    }
-                }
-                else {
-                    if (mSkeletonDataOne != nullptr && user.SkeletonTrackingId == mSkeletonDataOne->dwTrackingID) {
-                        mVectorSkeletonOneHandPosition.setX(0);
-                        mVectorSkeletonOneHandPosition.setY(0);
-                    }
-                    else if(mSkeletonDataTwo != nullptr && user.SkeletonTrackingId == mSkeletonDataTwo->dwTrackingID) {
-                        mVectorSkeletonTwoHandPosition.setX(0);
-                        mVectorSkeletonTwoHandPosition.setY(0);
-                    }
-                }
-                if(state & NUI_HANDPOINTER_STATE_PRESSED) {
-                    if (mSkeletonDataOne != nullptr && user.SkeletonTrackingId == mSkeletonDataOne->dwTrackingID)
-                        mIsPressedPlayerOne = true;
-                    else if(mSkeletonDataTwo != nullptr && user.SkeletonTrackingId == mSkeletonDataTwo->dwTrackingID)
-                        mIsPressedPlayerTwo = true;
-                }
-                else {
-                    if (mSkeletonDataOne != nullptr && user.SkeletonTrackingId == mSkeletonDataOne->dwTrackingID)
-                        mIsPressedPlayerOne = false;
-                    else if(mSkeletonDataTwo != nullptr && user.SkeletonTrackingId == mSkeletonDataTwo->dwTrackingID)
-                        mIsPressedPlayerTwo = false;
-                }
-
-                if(hand.State != NUI_HANDPOINTER_STATE_NOT_TRACKED) {
-                    switch(hand.HandEventType) {
-                    case NUI_HAND_EVENT_TYPE_NONE:
-                        //                        std::cout << hand.HandType << " NUI_HAND_EVENT_TYPE_NONE" << std::endl; //This never output
-                        break;
-                    case NUI_HAND_EVENT_TYPE_GRIP:
-                        std::cout << hand.HandType << " NUI_HAND_EVENT_TYPE_GRIP" << std::endl; //This never output
-                        break;
-                    case NUI_HAND_EVENT_TYPE_GRIPRELEASE:
-                        //                        std::cout << hand.HandType << " NUI_HAND_EVENT_TYPE_GRIPRELEASE" << std::endl; //TODO: This never outputs
-                        break;
-                    }
+        const NUI_USER_INFO &user = interactionFrame.UserInfos[i];
+        UserHandState &userHands = mUserHands[i];
+        //A different user took this slot, release the hands of the previous one.
+        if (userHands.trackingID != user.SkeletonTrackingId) {
+            //Its subscription may already be released with its skeleton, the latched detectors still end their events
+            if (userHands.trackingID != 0) {
+                event.skeletonTrackingID = userHands.trackingID;
+                for(int j = 0; j < NUI_USER_HANDPOINTER_COUNT; j++) {
+                    HandPointerState releasedHand = HandPointerState();
+                    queueHandEvents(userHands.hands[j], releasedHand, 0, event);
                 }
             }
+            userHands = UserHandState();
+            userHands.trackingID = user.SkeletonTrackingId;
+        }
+        if (user.SkeletonTrackingId == 0)
+            continue;
+
+        const unsigned int detectors = mFrameProcessor.getSubscribedDetectors(user.SkeletonTrackingId);
+        event.skeletonTrackingID = user.SkeletonTrackingId;
+        for(int j = 0; j < NUI_USER_HANDPOINTER_COUNT; j++) {
+            const NUI_HANDPOINTER_INFO &hand = user.HandPointerInfos[j];
+            HandPointerState &handState = userHands.hands[j];
+            const HandPointerState previous = handState;
+            handState.handType = hand.HandType;
+            handState.x = hand.X;
+            handState.y = hand.Y;
+            handState.pressExtent = hand.PressExtent;
+            handState.isTracked = hand.State != NUI_HANDPOINTER_STATE_NOT_TRACKED;
+            handState.isPrimary = (hand.State & NUI_HANDPOINTER_STATE_PRIMARY_FOR_USER) != 0;
+            handState.isPressed = (hand.State & NUI_HANDPOINTER_STATE_PRESSED) != 0;
+            //The grip events are only sent once, so the state is kept until a release or until the hand is lost.
+            if (!handState.isTracked)
+                handState.isGripping = false;
+            else if (hand.HandEventType == NUI_HAND_EVENT_TYPE_GRIP)
+                handState.isGripping = true;
+            else if (hand.HandEventType == NUI_HAND_EVENT_TYPE_GRIPRELEASE)
+                handState.isGripping = false;
+            queueHandEvents(previous, handState, detectors, event);
         }
     }
+    mLatency.mark(latencyStamp, FULatency::INTERACTION_PROCESSING);
+    mLatency.end(latencyStamp, FULatency::INTERACTION_RESULT);
+}
+
+void FUKinectTool::queueHandEvents(const HandPointerState &previous, HandPointerState &current, unsigned int detectors, GestureEvent &event)
+{
+    event.handType = static_cast<HAND_TYPE>(previous.handType != NUI_HAND_TYPE_NONE ? previous.handType : current.handType);
+    const DETECTORS handDetectors[2] = {PUSH, GRIP};
+    const bool wasActive[2] = {previous.isPressed, previous.isGripping};
+    const bool isActive[2] = {current.isPressed, current.isGripping};
+    current.startedDetectors = previous.startedDetectors;
+    for (int i = 0; i < 2; i++) {
+        const DETECTORS detector = handDetectors[i];
+        if (wasActive[i] == isActive[i])
+            continue;
+        //An event ends with the detectors it began with, the subscription may have changed since
+        if (isActive[i] ? (detectors & detector) == 0 : (previous.startedDetectors & detector) == 0)
+            continue;
+        event.detector = detector;
+        event.phase = isActive[i] ? EVENT_BEGAN : EVENT_ENDED;
+        mFrameProcessor.queueEvent(event);
+        if (isActive[i])
+            current.startedDetectors |= detector;
+        else
+            current.startedDetectors &= ~detector;
+    }
 }
 
-void FUKinectTool::processDepth()
+void FUKinectTool::processDepth(bool runStages)
 {
+    FU_TRACE_SCOPE(FUTrace::DEPTH, "FUKinectTool::processDepth");
     HRESULT hr;
     NUI_IMAGE_FRAME imageFrame;
     // Attempt to get the depth frame
     hr = mNuiSensor->NuiImageStreamGetNextFrame(mHandleDepthStream, 0, &imageFrame);
-    if (FAILED(hr))
+    if (FAILED(hr)) {
+        mStreamStats[FULatency::DEPTH_STREAM].recordFailedRead();
         return;
+    }
+    mStreamStats[FULatency::DEPTH_STREAM].recordFrame(imageFrame.dwFrameNumber, imageFrame.liTimeStamp.QuadPart);
+    FULatency::Stamp latencyStamp = mLatency.begin(FULatency::DEPTH_STREAM, imageFrame.liTimeStamp.QuadPart);
 
     BOOL nearMode;
     INuiFrameTexture* pTexture;
     // Get the depth image pixel texture
     hr = mNuiSensor->NuiImageFrameGetDepthImagePixelFrameTexture(mHandleDepthStream, &imageFrame, &nearMode, &pTexture);
     if (FAILED(hr)) {
+        mStreamStats[FULatency::DEPTH_STREAM].recordFailedLock();
         mNuiSensor->NuiImageStreamReleaseFrame(mHandleDepthStream, &imageFrame);
         return;
     }
@@ -269,8 +455,32 @@ void FUKinectTool::processDepth()
     // Lock the frame data so the Kinect knows not to modify it while we're reading it
     pTexture->LockRect(0, &LockedRect, NULL, 0);
     // Make sure we've received valid data
-    if (LockedRect.Pitch != 0) {
+    const FUDepthFrame depthFrame = {reinterpret_cast<const FUDepthPixel*>(LockedRect.pBits), mDepthWidth, mDepthHeight, imageFrame.liTimeStamp.QuadPart};
+    const bool isAnyoneTracked = mSkeletonDataOne != nullptr || mSkeletonDataTwo != nullptr;
+    if (LockedRect.Pitch == 0)
+        mStreamStats[FULatency::DEPTH_STREAM].recordFailedLock();
+    if (LockedRect.Pitch != 0 && (!mGateOnMotion || mMotionGate.update(depthFrame, isAnyoneTracked))) {
         mNuiInteractionStream->ProcessDepth(LockedRect.size,LockedRect.pBits, imageFrame.liTimeStamp);
+        //The interaction stream needs every depth frame, the stages can be left out by the stream scheduler
+        if (runStages) {
+            if (mRecordDepth && mRecordingWriter.isOpen())
+                mRecordingWriter.writeDepthFrame(depthFrame);
+            if (mDepthPublisher.isOpen())
+                mDepthPublisher.publish(LockedRect.pBits, LockedRect.Pitch, imageFrame.dwFrameNumber, imageFrame.liTimeStamp.QuadPart);
+            const FUDepthFrame &frame = mFilterDepth ? mDepthFilter.process(depthFrame) : depthFrame;
+            if (mClassifyHands)
+                classifyHands(frame);
+            if (mSegmentDepth)
+                mDepthSegmentation.process(frame);
+            if (mGeneratePointCloud)
+                mPointCloud.generate(frame, mPointCloudPlayerFilter);
+            if (mRegisterFrames && updateRegistrationTables())
+                mRegistration.mapDepthFrame(frame);
+            if (mEstimateFloor && !isSDKFloorVisible())
+                mFloorEstimator.update(frame);
+            mLatency.mark(latencyStamp, FULatency::DEPTH_PROCESSING);
+            mLatency.end(latencyStamp, FULatency::DEPTH_RESULT);
+        }
     }
 
     // We're done with the texture so unlock it
@@ -280,13 +490,148 @@ void FUKinectTool::processDepth()
     mNuiSensor->NuiImageStreamReleaseFrame(mHandleDepthStream, &imageFrame);
 }
 
+void FUKinectTool::classifyHands(const FUDepthFrame &depthFrame)
+{
+    for (int i = 0; i < NUI_SKELETON_COUNT; i++) {
+        NUI_SKELETON_DATA &skeletonData = mSkeletonFrame.SkeletonData[i];
+        UserHandShapes &shapes = mHandShapes[i];
+        if (!isSkeletonTracked(skeletonData)) {
+            shapes.trackingID = 0;
+            shapes.left = FUHandClassifier::HAND_UNKNOWN;
+            shapes.right = FUHandClassifier::HAND_UNKNOWN;
+            continue;
+        }
+        shapes.trackingID = skeletonData.dwTrackingID;
+        shapes.left = classifyHand(depthFrame, skeletonData, HAND_LEFT);
+        shapes.right = classifyHand(depthFrame, skeletonData, HAND_RIGHT);
+    }
+}
+
+FUHandClassifier::HAND_SHAPE FUKinectTool::classifyHand(const FUDepthFrame &depthFrame, NUI_SKELETON_DATA &skeletonData, SKELETON_JOINTS joint)
+{
+    if (skeletonData.eSkeletonPositionTrackingState[joint] == NUI_SKELETON_POSITION_NOT_TRACKED)
+        return FUHandClassifier::HAND_UNKNOWN;
+    const Vector4 &handPosition = skeletonData.SkeletonPositions[joint];
+    LONG depthX = 0, depthY = 0;
+    USHORT packedDepth = 0;
+    NuiTransformSkeletonToDepthImage(handPosition, &depthX, &depthY, &packedDepth, NUI_IMAGE_RESOLUTION_640x480);
+    const int handDepth = static_cast<int>(handPosition.z * 1000.f);
+    return mHandClassifier.classify(depthFrame, depthX, depthY, handDepth).shape;
+}
+
+bool FUKinectTool::setSegmentationEnabled(bool enabled)
+{
+    if (enabled && !hasPlayerIndex()) {
+        printf("SEGMENTATION NEEDS NUI_INITIALIZE_FLAG_USES_DEPTH_AND_PLAYER_INDEX!\n");
+        mSegmentDepth = false;
+        return false;
+    }
+    mSegmentDepth = enabled;
+    return true;
+}
+
+bool FUKinectTool::setPointCloudEnabled(bool enabled, unsigned int playerFilter)
+{
+    if (enabled && playerFilter != FUPointCloud::ALL_PIXELS && !hasPlayerIndex()) {
+        printf("POINT CLOUD PLAYER FILTER NEEDS NUI_INITIALIZE_FLAG_USES_DEPTH_AND_PLAYER_INDEX!\n");
+        mGeneratePointCloud = false;
+        return false;
+    }
+    mGeneratePointCloud = enabled;
+    mPointCloudPlayerFilter = playerFilter;
+    //Build the ray table now instead of on the first frame
+    if (enabled)
+        mPointCloud.resize(mDepthWidth, mDepthHeight);
+    return true;
+}
+
+void FUKinectTool::setRegistrationEnabled(bool enabled, unsigned int outputs)
+{
+    mRegisterFrames = enabled;
+    mRegistration.setOutputs(outputs);
+}
+
+void FUKinectTool::setColorCroppingEnabled(bool enabled, int size, int downscale, unsigned int regions)
+{
+    mCropColor = enabled;
+    if (enabled)
+        mColorCropper.configure(size, downscale, regions);
+}
+
+bool FUKinectTool::updateRegistrationTables()
+{
+    if (mNuiSensor == nullptr)
+        return false;
+    if (mCoordinateMapper == nullptr) {
+        if (FAILED(mNuiSensor->NuiGetCoordinateMapper(&mCoordinateMapper)))
+            return false;
+        //The calibration of a sensor doesn't change, so it's hashed once per coordinate mapper, which is released with the
+        //sensor. FNV-1a hash of the calibration data.
+        ULONG dataByteCount = 0;
+        void *data = nullptr;
+        mCalibrationKey = 14695981039346656037ULL;
+        if (SUCCEEDED(mCoordinateMapper->GetColorToDepthRelationalParameters(&dataByteCount, &data)) && data) {
+            const BYTE *bytes = static_cast<const BYTE*>(data);
+            for (ULONG i = 0; i < dataByteCount; i++)
+                mCalibrationKey = (mCalibrationKey ^ bytes[i]) * 1099511628211ULL;
+        }
+    }
+    const uint64_t calibrationKey = mCalibrationKey;
+    if (!mRegistration.needsRebuild(mDepthWidth, mDepthHeight, mColorWidth, mColorHeight, calibrationKey))
+        return true;
+
+    //Map two flat frames at known depths, the tables are solved from them
+    const DWORD pixelCount = mDepthWidth * mDepthHeight;
+    std::vector<NUI_DEPTH_IMAGE_PIXEL> flatFrame(pixelCount);
+    std::vector<NUI_COLOR_IMAGE_POINT> nearPoints(pixelCount);
+    std::vector<NUI_COLOR_IMAGE_POINT> farPoints(pixelCount);
+    const int depths[2] = {FURegistration::CALIBRATION_NEAR_DEPTH, FURegistration::CALIBRATION_FAR_DEPTH};
+    NUI_COLOR_IMAGE_POINT *points[2] = {&nearPoints[0], &farPoints[0]};
+    for (int i = 0; i < 2; i++) {
+        for (DWORD j = 0; j < pixelCount; j++) {
+            flatFrame[j].playerIndex = 0;
+            flatFrame[j].depth = static_cast<USHORT>(depths[i]);
+        }
+        HRESULT hr = mCoordinateMapper->MapDepthFrameToColorFrame(NUI_IMAGE_RESOLUTION_640x480, pixelCount, &flatFrame[0],
+                                                                  NUI_IMAGE_TYPE_COLOR, NUI_IMAGE_RESOLUTION_1280x960, pixelCount, points[i]);
+        if (FAILED(hr))
+            return false;
+    }
+    mRegistration.rebuild(mDepthWidth, mDepthHeight, mColorWidth, mColorHeight, calibrationKey,
+                          reinterpret_cast<const FURegistration::ColorPoint*>(&nearPoints[0]),
+                          reinterpret_cast<const FURegistration::ColorPoint*>(&farPoints[0]));
+    return true;
+}
+
+float FUKinectTool::getBodyScale(const NUI_SKELETON_DATA &skeletonData) const
+{
+    return getBodyScale(skeletonData.dwTrackingID);
+}
+
+FUHandClassifier::HAND_SHAPE FUKinectTool::getHandShape(DWORD skeletonTrackingID, NUI_HAND_TYPE handType) const
+{
+    if (skeletonTrackingID == 0)
+        return FUHandClassifier::HAND_UNKNOWN;
+    for (int i = 0; i < NUI_SKELETON_COUNT; i++) {
+        const UserHandShapes &shapes = mHandShapes[i];
+        if (shapes.trackingID == skeletonTrackingID)
+            return handType == NUI_HAND_TYPE_LEFT ? shapes.left : shapes.right;
+    }
+    return FUHandClassifier::HAND_UNKNOWN;
+}
+
 void FUKinectTool::processSkeleton()
 {
+    FU_TRACE_SCOPE(FUTrace::SKELETON, "FUKinectTool::processSkeleton");
     //TODO: Test this!
     std::vector<NUI_SKELETON_DATA*> skeletonVector;
     HRESULT hr = mNuiSensor->NuiSkeletonGetNextFrame(0, &mSkeletonFrame);
-    if (FAILED(hr))
+    if (FAILED(hr)) {
+        mStreamStats[FULatency::SKELETON_STREAM].recordFailedRead();
         return;
+    }
+    mStreamStats[FULatency::SKELETON_STREAM].recordFrame(mSkeletonFrame.dwFrameNumber, mSkeletonFrame.liTimeStamp.QuadPart);
+    FULatency::Stamp latencyStamp = mLatency.begin(FULatency::SKELETON_STREAM, mSkeletonFrame.liTimeStamp.QuadPart);
     // smooth out the skeleton data
     mNuiSensor->NuiTransformSmooth(&mSkeletonFrame, NULL);
     for (int i = 0 ; i < NUI_SKELETON_COUNT; ++i) {
@@ -332,6 +677,22 @@ void FUKinectTool::processSkeleton()
     }
     if (mSkeletonDataOne == nullptr && mSkeletonDataTwo == nullptr)
         mSkeletonLeftScene = SKELETONS::BOTH_SKELETONS;
+    toSkeletonFrame(mSkeletonFrame, mCoreSkeletonFrame);
+    //The detectors use the estimated floor when the SDK can't see it
+    if (!isSDKFloorVisible() && mEstimateFloor && mFloorEstimator.isValid()) {
+        const FUFloorEstimator::Plane &estimatedPlane = mFloorEstimator.getPlane();
+        mCoreSkeletonFrame.floorPlane = FUMath::FUVector4<float>(estimatedPlane.x, estimatedPlane.y, estimatedPlane.z, estimatedPlane.w);
+    }
+    mLatency.mark(latencyStamp, FULatency::SKELETON_PROCESSING);
+    mFrameProcessor.processSkeletonFrame(mCoreSkeletonFrame);
+    mLatency.mark(latencyStamp, FULatency::SKELETON_DETECTORS);
+    mLatency.end(latencyStamp, FULatency::SKELETON_RESULT);
+    if (mRecordingWriter.isOpen())
+        mRecordingWriter.writeSkeletonFrame(mCoreSkeletonFrame);
+    if (mSkeletonPublisher.isOpen() || mSessionExporter.isOpen())
+        publishSkeletonFrame();
+    if (mSkeletonSender.isOpen())
+        mSkeletonSender.send(mCoreSkeletonFrame);
     Vector4 tempVec = {0};
     mNuiSensor->NuiAccelerometerGetCurrentReading(&tempVec);
     mNuiInteractionStream->ProcessSkeleton(NUI_SKELETON_COUNT, mSkeletonFrame.SkeletonData,&tempVec, mSkeletonFrame.liTimeStamp);
@@ -347,8 +708,9 @@ HRESULT FUKinectTool::getScreenshotFileName(wchar_t *screenshotName, UINT screen
         wchar_t timeString[MAX_PATH];
         GetTimeFormatEx(NULL, 0, NULL, L"hh'-'mm'-'ss", timeString, _countof(timeString));
 
-        // File name will be KinectSnapshot-HH-MM-SS.wav
-        StringCchPrintfW(screenshotName, screenshotNameSize, L"%s\\KinectSnapshot-%s.bmp", knownPath, timeString);
+        // File name will be KinectSnapshot-HH-MM-SS.jpg
+        const wchar_t *extension = mSnapshotFormat == SNAPSHOT_JPEG ? L"jpg" : L"bmp";
+        StringCchPrintfW(screenshotName, screenshotNameSize, L"%s\\KinectSnapshot-%s.%s", knownPath, timeString, extension);
         std::cout << screenshotName << std::endl;
     }
     CoTaskMemFree(knownPath);
@@ -357,6 +719,7 @@ HRESULT FUKinectTool::getScreenshotFileName(wchar_t *screenshotName, UINT screen
 
 HRESULT FUKinectTool::saveBitmapToFile(BYTE* pBitmapBits, LONG lWidth, LONG lHeight, WORD wBitsPerPixel, LPCWSTR lpszFilePath)
 {
+    FU_TRACE_SCOPE(FUTrace::IO, "FUKinectTool::saveBitmapToFile");
     DWORD dwByteCount = lWidth * lHeight * (wBitsPerPixel / 8);
 
     BITMAPINFOHEADER bmpInfoHeader = {0};
@@ -412,14 +775,40 @@ HRESULT FUKinectTool::saveBitmapToFile(BYTE* pBitmapBits, LONG lWidth, LONG lHei
     return S_OK;
 }
 
+HRESULT FUKinectTool::saveJpegToFile(const BYTE *pixels, LONG pitch, LPCWSTR filePath)
+{
+    FU_TRACE_SCOPE(FUTrace::IO, "FUKinectTool::saveJpegToFile");
+    if (!mJpegEncoder.encode(pixels, mColorWidth, mColorHeight, pitch, mSnapshotBuffer))
+        return E_INVALIDARG;
+
+    HANDLE file = CreateFileW(filePath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return E_ACCESSDENIED;
+    DWORD bytesWritten = 0;
+    const BOOL written = WriteFile(file, &mSnapshotBuffer[0], static_cast<DWORD>(mSnapshotBuffer.size()), &bytesWritten, NULL);
+    CloseHandle(file);
+    return written && bytesWritten == mSnapshotBuffer.size() ? S_OK : E_FAIL;
+}
+
+void FUKinectTool::setSnapshotFormat(SNAPSHOT_FORMAT format, int quality)
+{
+    mSnapshotFormat = format;
+    mJpegEncoder.setQuality(quality);
+}
+
 void FUKinectTool::processColor()
 {
+    FU_TRACE_SCOPE(FUTrace::COLOR, "FUKinectTool::processColor");
     HRESULT hr;
     NUI_IMAGE_FRAME imageFrame;
     // Attempt to get the color frame
     hr = mNuiSensor->NuiImageStreamGetNextFrame(mHandleColorStream, 0, &imageFrame);
-    if (FAILED(hr))
+    if (FAILED(hr)) {
+        mStreamStats[FULatency::COLOR_STREAM].recordFailedRead();
         return;
+    }
+    mStreamStats[FULatency::COLOR_STREAM].recordFrame(imageFrame.dwFrameNumber, imageFrame.liTimeStamp.QuadPart);
+    FULatency::Stamp latencyStamp = mLatency.begin(FULatency::COLOR_STREAM, imageFrame.liTimeStamp.QuadPart);
 
     INuiFrameTexture *frameTexture = imageFrame.pFrameTexture;
     NUI_LOCKED_RECT lockedRect;
@@ -428,17 +817,35 @@ void FUKinectTool::processColor()
     frameTexture->LockRect(0, &lockedRect, NULL, 0);
 
     // Make sure we've received valid data
-    if (lockedRect.Pitch != 0) {
+    if (lockedRect.Pitch == 0)
+        mStreamStats[FULatency::COLOR_STREAM].recordFailedLock();
+    else {
         // Draw the data with Direct2D
         //        m_pDrawColor->Draw(static_cast<BYTE *>(lockedRect.pBits), lockedRect.size);
 
+        if (mRegisterFrames)
+            mRegistration.registerColorFrame(static_cast<const BYTE*>(lockedRect.pBits), lockedRect.Pitch);
+        if (mColorPublisher.isOpen())
+            mColorPublisher.publish(lockedRect.pBits, lockedRect.Pitch, imageFrame.dwFrameNumber, imageFrame.liTimeStamp.QuadPart);
+        if (mCropColor && updateRegistrationTables()) {
+            const FUColorCropper::Batch *cropBatch = mColorCropper.crop(mCoreSkeletonFrame, mRegistration, static_cast<const uint8_t*>(lockedRect.pBits),
+                                                                        mColorWidth, mColorHeight, lockedRect.Pitch,
+                                                                        imageFrame.dwFrameNumber, imageFrame.liTimeStamp.QuadPart);
+            //A batch that can't be queued is never polled, so it goes back to the pool
+            if (cropBatch && !mColorCropBatches.push(cropBatch))
+                mColorCropper.release(cropBatch);
+        }
+
         // If the user pressed the screenshot button, save a screenshot
         if (mSaveScreenshot) {
             // Retrieve the path to My Photos
             WCHAR screenshotPath[MAX_PATH];
             getScreenshotFileName(screenshotPath, _countof(screenshotPath));
-            // Write out the bitmap to disk
-            hr = saveBitmapToFile(static_cast<BYTE *>(lockedRect.pBits), mColorWidth, mColorHeight, 32, screenshotPath);
+            // Write out the image to disk
+            if (mSnapshotFormat == SNAPSHOT_JPEG)
+                hr = saveJpegToFile(static_cast<const BYTE *>(lockedRect.pBits), lockedRect.Pitch, screenshotPath);
+            else
+                hr = saveBitmapToFile(static_cast<BYTE *>(lockedRect.pBits), mColorWidth, mColorHeight, 32, screenshotPath);
             if (SUCCEEDED(hr))
                 printf("SCREENSHOT SAVED!"); // Success!
             else
@@ -447,6 +854,8 @@ void FUKinectTool::processColor()
             // toggle off so we don't save a screenshot again next frame
             mSaveScreenshot = false;
         }
+        mLatency.mark(latencyStamp, FULatency::COLOR_PROCESSING);
+        mLatency.end(latencyStamp, FULatency::COLOR_RESULT);
     }
 
     // We're done with the texture so unlock it
@@ -483,166 +892,96 @@ bool FUKinectTool::isSkeletonOnRight(NUI_SKELETON_DATA &skeletonDataOne, NUI_SKE
 
 bool FUKinectTool::detectRightHandUpPosture(NUI_SKELETON_DATA &skeletonData)
 {
-    bool isRightHandUp = false;
-    if (skeletonData.eTrackingState == SKELETON_TRACKED)
-    {
-        //Elbow should be under hand
-        if (skeletonData.SkeletonPositions[ELBOW_RIGHT].y > skeletonData.SkeletonPositions[HAND_RIGHT].y)
-            return false;
-        if (skeletonData.SkeletonPositions[HAND_RIGHT].y - skeletonData.SkeletonPositions[HEAD].y > 200)
-            isRightHandUp = true;
-        else
-            isRightHandUp = false;
-    }
-    return isRightHandUp;
+    FUSkeleton::SkeletonData skeleton;
+    toSkeletonData(skeletonData, skeleton);
+    return FUPostureDetector::detectRightHandUpPosture(skeleton, getBodyScale(skeletonData));
 }
 
 bool FUKinectTool::detectLeftHandUpPosture(NUI_SKELETON_DATA &skeletonData)
 {
-    bool isLeftHandUp = false;
-    if (skeletonData.eTrackingState == SKELETON_TRACKED)
-    {
-        //Elbow should be under hand
-        if (skeletonData.SkeletonPositions[ELBOW_LEFT].y > skeletonData.SkeletonPositions[HAND_LEFT].y)
-            return false;
-        if (skeletonData.SkeletonPositions[HAND_LEFT].y - skeletonData.SkeletonPositions[HEAD].y > 200)
-            isLeftHandUp = true;
-        else
-            isLeftHandUp = false;
-    }
-    return isLeftHandUp;
+    FUSkeleton::SkeletonData skeleton;
+    toSkeletonData(skeletonData, skeleton);
+    return FUPostureDetector::detectLeftHandUpPosture(skeleton, getBodyScale(skeletonData));
 }
 
 bool FUKinectTool::detectBothHandsUp(NUI_SKELETON_DATA &skeletonData)
 {
-    return detectRightHandUpPosture(skeletonData) && detectLeftHandUpPosture(skeletonData);
+    FUSkeleton::SkeletonData skeleton;
+    toSkeletonData(skeletonData, skeleton);
+    return FUPostureDetector::detectBothHandsUp(skeleton, getBodyScale(skeletonData));
 }
 
 bool FUKinectTool::detectLeftHandDownPosture(NUI_SKELETON_DATA &skeletonData)
 {
-    bool isLeftHandDown = false;
-    if (skeletonData.eTrackingState == SKELETON_TRACKED)
-    {
-        //Elbow should be under hand
-        if (skeletonData.SkeletonPositions[ELBOW_LEFT].y < skeletonData.SkeletonPositions[HAND_LEFT].y)
-            return false;
-        if (skeletonData.SkeletonPositions[HAND_LEFT].y < skeletonData.SkeletonPositions[HIP_CENTER].y)
-            isLeftHandDown = true;
-        else
-            isLeftHandDown = false;
-    }
-    return isLeftHandDown;
+    FUSkeleton::SkeletonData skeleton;
+    toSkeletonData(skeletonData, skeleton);
+    return FUPostureDetector::detectLeftHandDownPosture(skeleton);
 }
 
 bool FUKinectTool::detectRightHandDownPosture(NUI_SKELETON_DATA &skeletonData)
 {
-    bool isRightHandDown = false;
-    if (skeletonData.eTrackingState == SKELETON_TRACKED)
-    {
-        //Elbow should be under hand
-        if (skeletonData.SkeletonPositions[ELBOW_RIGHT].y < skeletonData.SkeletonPositions[HAND_RIGHT].y)
-            return false;
-        if (skeletonData.SkeletonPositions[HAND_RIGHT].y < skeletonData.SkeletonPositions[HIP_CENTER].y)
-            isRightHandDown = true;
-        else
-            isRightHandDown = false;
-    }
-    return isRightHandDown;
+    FUSkeleton::SkeletonData skeleton;
+    toSkeletonData(skeletonData, skeleton);
+    return FUPostureDetector::detectRightHandDownPosture(skeleton);
 }
 
 bool FUKinectTool::detectOpenRightArm(NUI_SKELETON_DATA &skeletonData)
 {
-    if (!isSkeletonTracked(skeletonData))
-        return false;
-    bool armOpen = true;
-    const Vector4 rightHandPoint = skeletonData.SkeletonPositions[HAND_RIGHT];
-    const Vector4 rightElbowPoint = skeletonData.SkeletonPositions[ELBOW_RIGHT];
-    const Vector4 rightShoulderPoint = skeletonData.SkeletonPositions[SHOULDER_RIGHT];
-    //If elbow is below the shoulder, return false
-    if (rightShoulderPoint.y - rightElbowPoint.y > 150)
-        return false;
-    //If elbow is over shoulder, return false
-    if (rightShoulderPoint.y - rightElbowPoint.y < -150)
-        return false;
-    //If hand is below elbow, return false
-    if (rightHandPoint.y - rightElbowPoint.y > 150)
-        return false;
-    //If the hand is over elbow, return false
-    if (rightHandPoint.y - rightElbowPoint.y < -150)
-        return false;
-    return armOpen;
+    FUSkeleton::SkeletonData skeleton;
+    toSkeletonData(skeletonData, skeleton);
+    return FUPostureDetector::detectOpenRightArm(skeleton, getBodyScale(skeletonData));
 }
 
 bool FUKinectTool::detectOpenLeftArm(NUI_SKELETON_DATA &skeletonData)
 {
-    if (!isSkeletonTracked(skeletonData))
-        return false;
-    bool armOpen = true;
-    const Vector4 leftHandPoint = skeletonData.SkeletonPositions[HAND_RIGHT];
-    const Vector4 leftElbowPoint = skeletonData.SkeletonPositions[ELBOW_RIGHT];
-    const Vector4 leftShoulderPoint = skeletonData.SkeletonPositions[SHOULDER_RIGHT];
-    //If elbow is below the shoulder, return false
-    if (leftShoulderPoint.y - leftElbowPoint.y > 150)
-        return false;
-    //If elbow is over shoulder, return false
-    if (leftShoulderPoint.y - leftElbowPoint.y < -150)
-        return false;
-    //If hand is below elbow, return false
-    if (leftHandPoint.y - leftElbowPoint.y > 150)
-        return false;
-    //If the hand is over elbow, return false
-    if (leftHandPoint.y - leftElbowPoint.y < -150)
-        return false;
-    return armOpen;
+    FUSkeleton::SkeletonData skeleton;
+    toSkeletonData(skeletonData, skeleton);
+    return FUPostureDetector::detectOpenLeftArm(skeleton, getBodyScale(skeletonData));
 }
 
 bool FUKinectTool::detectOpenArms(NUI_SKELETON_DATA &skeletonData)
 {
-    return detectOpenLeftArm(skeletonData) && detectOpenRightArm(skeletonData);
+    FUSkeleton::SkeletonData skeleton;
+    toSkeletonData(skeletonData, skeleton);
+    return FUPostureDetector::detectOpenArms(skeleton, getBodyScale(skeletonData));
 }
 
 bool FUKinectTool::detectPush(DWORD skeletonTrackingID)
 {
-    bool isPressed = false;
-    if (mSkeletonDataOne != nullptr && skeletonTrackingID == mSkeletonDataOne->dwTrackingID)
-        isPressed = mIsPressedPlayerOne;
-    else if (mSkeletonDataTwo != nullptr && skeletonTrackingID == mSkeletonDataTwo->dwTrackingID)
-        isPressed = mIsPressedPlayerTwo;
-    return isPressed;
+    const UserHandState *userHands = findUserHands(skeletonTrackingID);
+    if (userHands == nullptr)
+        return false;
+    for (int i = 0; i < NUI_USER_HANDPOINTER_COUNT; i++) {
+        if (userHands->hands[i].isPressed)
+            return true;
+    }
+    return false;
 }
 
 bool FUKinectTool::detectGrip(DWORD skeletonTrackingID)
 {
-    bool isPressed = false;
-    if (mSkeletonDataOne != nullptr && skeletonTrackingID == mSkeletonDataOne->dwTrackingID)
-        isPressed = mIsGrippingPlayerOne;
-    else if (mSkeletonDataTwo != nullptr && skeletonTrackingID == mSkeletonDataTwo->dwTrackingID)
-        isPressed = mIsGrippingPlayerTwo;
-    return isPressed;
+    const UserHandState *userHands = findUserHands(skeletonTrackingID);
+    if (userHands == nullptr)
+        return false;
+    for (int i = 0; i < NUI_USER_HANDPOINTER_COUNT; i++) {
+        if (userHands->hands[i].isGripping)
+            return true;
+    }
+    return false;
 }
 
 bool FUKinectTool::detectLeanRight(NUI_SKELETON_DATA &skeletonData)
 {
-    if (isSkeletonTracked(skeletonData))
-        return false;
-    bool isLeaningRight = true;
-    const Vector4 headPosition = skeletonData.SkeletonPositions[HEAD];
-    const Vector4 hipCenterPosition = skeletonData.SkeletonPositions[HIP_CENTER];
-    if (headPosition.x <= hipCenterPosition.x || headPosition.x - hipCenterPosition.x < 100)
-        return false;
-    return isLeaningRight;
+    FUSkeleton::SkeletonData skeleton;
+    toSkeletonData(skeletonData, skeleton);
+    return FUPostureDetector::detectLeanRight(skeleton, getBodyScale(skeletonData));
 }
 
 bool FUKinectTool::detectLeanLeft(NUI_SKELETON_DATA &skeletonData)
 {
-    if (isSkeletonTracked(skeletonData))
-        return false;
-    bool isLeaningLeft = true;
-    const Vector4 headPosition = skeletonData.SkeletonPositions[HEAD];
-    const Vector4 hipCenterPosition = skeletonData.SkeletonPositions[HIP_CENTER];
-    if (headPosition.x >= hipCenterPosition.x || hipCenterPosition.x - headPosition.x < 100)
-        return false;
-    return isLeaningLeft;
+    FUSkeleton::SkeletonData skeleton;
+    toSkeletonData(skeletonData, skeleton);
+    return FUPostureDetector::detectLeanLeft(skeleton, getBodyScale(skeletonData));
 }
 
 float FUKinectTool::getRightHandAngle(NUI_SKELETON_DATA &skeletonData)
@@ -711,11 +1050,38 @@ bool FUKinectTool::isFloorVisible()
 {
     // smooth out the skeleton data
     mNuiSensor->NuiTransformSmooth(&mSkeletonFrame, NULL);
-    bool floor = false;
-    if (mSkeletonFrame.vFloorClipPlane.x != 0 && mSkeletonFrame.vFloorClipPlane.y != 0
-            && mSkeletonFrame.vFloorClipPlane.z != 0 && mSkeletonFrame.vFloorClipPlane.w != 0)
-        floor = true;
-    return floor;
+    return isSDKFloorVisible() || (mEstimateFloor && mFloorEstimator.isValid());
+}
+
+bool FUKinectTool::isSDKFloorVisible() const
+{
+    //The SDK zeroes the whole plane when it can't see the floor. A single zero component is a valid plane, e.g. x is 0
+    //when the sensor isn't rolled.
+    return mSkeletonFrame.vFloorClipPlane.x != 0 || mSkeletonFrame.vFloorClipPlane.y != 0
+            || mSkeletonFrame.vFloorClipPlane.z != 0 || mSkeletonFrame.vFloorClipPlane.w != 0;
+}
+
+Vector4 FUKinectTool::getFloorPlane() const
+{
+    if (isSDKFloorVisible())
+        return mSkeletonFrame.vFloorClipPlane;
+    const FUFloorEstimator::Plane &estimatedPlane = mFloorEstimator.getPlane();
+    Vector4 floorPlane = {estimatedPlane.x, estimatedPlane.y, estimatedPlane.z, estimatedPlane.w};
+    return floorPlane;
+}
+
+void FUKinectTool::setFloorEstimationEnabled(bool enabled)
+{
+    mEstimateFloor = enabled;
+    if (!enabled)
+        mFloorEstimator.reset();
+}
+
+void FUKinectTool::setDepthFilterEnabled(bool enabled)
+{
+    mFilterDepth = enabled;
+    if (!enabled)
+        mDepthFilter.reset();
 }
 
 double FUKinectTool::getDistanceFromFloor(Vector4 jointPosition)
@@ -727,11 +1093,12 @@ double FUKinectTool::getDistanceFromFloor(Vector4 jointPosition)
         printf("FLOOR NOT VISIBLE!!!!\n");
         return -1;
     }
+    const Vector4 floorPlane = getFloorPlane();
     double distanceFromFloor = 0;
-    double floorClipPlaneX = mSkeletonFrame.vFloorClipPlane.x;
-    double floorClipPlaneY = mSkeletonFrame.vFloorClipPlane.y;
-    double floorClipPlaneZ = mSkeletonFrame.vFloorClipPlane.z;
-    double floorClipPlaneW = mSkeletonFrame.vFloorClipPlane.w;
+    double floorClipPlaneX = floorPlane.x;
+    double floorClipPlaneY = floorPlane.y;
+    double floorClipPlaneZ = floorPlane.z;
+    double floorClipPlaneW = floorPlane.w;
     distanceFromFloor = floorClipPlaneX * jointPosition.x + floorClipPlaneY * jointPosition.y + floorClipPlaneZ * jointPosition.z + floorClipPlaneW;
     return distanceFromFloor;
 }
@@ -739,50 +1106,157 @@ double FUKinectTool::getDistanceFromFloor(Vector4 jointPosition)
 //TODO: Don't count it as jumping while getting close to Kinect
 bool FUKinectTool::detectJumping(NUI_SKELETON_DATA &skeletonData)
 {
-    bool playerJump = false;
-    if (skeletonData.dwTrackingID == mSkeletonDataOne->dwTrackingID)
-        playerJump = mJumpedPlayerOne;
-    else if (skeletonData.dwTrackingID == mSkeletonDataTwo->dwTrackingID)
-        playerJump = mJumpedPlayerTwo;
-    bool didJump = false;
-    //If floor isn't visible, can't do anything
-    if (!isFloorVisible())
-        return false;
-    if (playerJump == true && getDistanceFromFloor(skeletonData.SkeletonPositions[FOOT_LEFT]) < 0.02
-            && getDistanceFromFloor(skeletonData.SkeletonPositions[FOOT_RIGHT]) < 0.02)
-    {
-        if (skeletonData.dwTrackingID == mSkeletonDataOne->dwTrackingID)
-            mJumpedPlayerOne = false;
-        else if (skeletonData.dwTrackingID == mSkeletonDataTwo->dwTrackingID)
-            mJumpedPlayerTwo = false;
-        return false;
-    }
-    if (playerJump == true)
-        return false;
-    if (playerJump == false && getDistanceFromFloor(skeletonData.SkeletonPositions[FOOT_LEFT]) > 0.06
-            && getDistanceFromFloor(skeletonData.SkeletonPositions[FOOT_RIGHT]) > 0.06)
-    {
-        if (skeletonData.dwTrackingID == mSkeletonDataOne->dwTrackingID)
-            mJumpedPlayerOne = true;
-        else if (skeletonData.dwTrackingID == mSkeletonDataTwo->dwTrackingID)
-            mJumpedPlayerTwo = true;
-        didJump = true;
-    }
-    return didJump;
+    //The jump states are updated with every skeleton frame
+    return mFrameProcessor.hasJumped(skeletonData.dwTrackingID);
 }
 
 FUMath::FUVector2<float> FUKinectTool::getHandPosition(DWORD skeletonTrackingID)
 {
     FUMath::FUVector2<float> position;
-    if (mSkeletonDataOne != nullptr && skeletonTrackingID == mSkeletonDataOne->dwTrackingID)
-        position = mVectorSkeletonOneHandPosition;
-    else if (mSkeletonDataTwo != nullptr && skeletonTrackingID == mSkeletonDataTwo->dwTrackingID)
-        position = mVectorSkeletonTwoHandPosition;
+    const UserHandState *userHands = findUserHands(skeletonTrackingID);
+    if (userHands == nullptr)
+        return position;
+    for (int i = 0; i < NUI_USER_HANDPOINTER_COUNT; i++) {
+        const HandPointerState &hand = userHands->hands[i];
+        if (hand.isPrimary) {
+            position.setX(hand.x);
+            position.setY(hand.y);
+            break;
+        }
+    }
     return position;
 }
 
+void FUKinectTool::transformSkeleton(const NUI_SKELETON_DATA &skeletonData, const FUMath::FUMatrix4<float> &transform, NUI_SKELETON_DATA &output)
+{
+    if (&output != &skeletonData)
+        output = skeletonData;
+    transform.transformPoints(&skeletonData.Position.x, &output.Position.x, 1);
+    transform.transformPoints(&skeletonData.SkeletonPositions[0].x, &output.SkeletonPositions[0].x, NUI_SKELETON_POSITION_COUNT);
+}
+
+void FUKinectTool::transformSkeletonFrame(const NUI_SKELETON_FRAME &frame, const FUMath::FUMatrix4<float> &transform, NUI_SKELETON_FRAME &output)
+{
+    if (&output != &frame)
+        output = frame;
+    for (int i = 0; i < NUI_SKELETON_COUNT; i++) {
+        if (frame.SkeletonData[i].eTrackingState != NUI_SKELETON_NOT_TRACKED)
+            transformSkeleton(frame.SkeletonData[i], transform, output.SkeletonData[i]);
+    }
+    const Vector4 &plane = frame.vFloorClipPlane;
+    if (plane.x != 0 || plane.y != 0 || plane.z != 0 || plane.w != 0) {
+        //Planes are transformed with the inverse transpose
+        const FUMath::FUVector4<float> transformed = transform.inverseRigid().transpose() * FUMath::FUVector4<float>(plane.x, plane.y, plane.z, plane.w);
+        output.vFloorClipPlane.x = transformed.x;
+        output.vFloorClipPlane.y = transformed.y;
+        output.vFloorClipPlane.z = transformed.z;
+        output.vFloorClipPlane.w = transformed.w;
+    }
+}
+
+void FUKinectTool::toSkeletonData(const NUI_SKELETON_DATA &skeletonData, FUSkeleton::SkeletonData &output)
+{
+    output.trackingID = skeletonData.dwTrackingID;
+    output.trackingState = static_cast<FUSkeleton::SKELETON_TRACKING_STATE>(skeletonData.eTrackingState);
+    output.position = FUMath::FUVector3<float>(skeletonData.Position.x, skeletonData.Position.y, skeletonData.Position.z);
+    for (int joint = 0; joint < FUSkeleton::JOINT_COUNT; joint++) {
+        const Vector4 &position = skeletonData.SkeletonPositions[joint];
+        output.joints[joint] = FUMath::FUVector3<float>(position.x, position.y, position.z);
+        output.jointStates[joint] = static_cast<FUSkeleton::JOINT_TRACKING_STATE>(skeletonData.eSkeletonPositionTrackingState[joint]);
+    }
+}
+
+void FUKinectTool::toSkeletonFrame(const NUI_SKELETON_FRAME &frame, FUSkeleton::SkeletonFrame &output)
+{
+    output.timeStamp = frame.liTimeStamp.QuadPart;
+    output.frameNumber = frame.dwFrameNumber;
+    const Vector4 &plane = frame.vFloorClipPlane;
+    output.floorPlane = FUMath::FUVector4<float>(plane.x, plane.y, plane.z, plane.w);
+    for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+        toSkeletonData(frame.SkeletonData[i], output.skeletons[i]);
+}
+
+void FUKinectTool::publishSkeletonFrame()
+{
+    //The frame is filled in place in the shared memory when it's published, and exported from there
+    FUSharedSkeleton::Frame *frame = mSkeletonPublisher.isOpen() ? mSkeletonPublisher.beginFrame() : &mExportFrame;
+    FUSkeletonPublisher::fillFrame(*frame, mCoreSkeletonFrame, mFrameProcessor);
+    for (uint32_t i = 0; i < frame->playerCount; i++) {
+        FUSharedSkeleton::Player &player = frame->players[i];
+        const UserHandState *userHands = findUserHands(player.trackingID);
+        if (userHands == nullptr)
+            continue;
+        for (int j = 0; j < NUI_USER_HANDPOINTER_COUNT; j++) {
+            const HandPointerState &handState = userHands->hands[j];
+            FUSharedSkeleton::Hand &hand = player.hands[j];
+            hand.handType = handState.handType;
+            hand.x = handState.x;
+            hand.y = handState.y;
+            hand.pressExtent = handState.pressExtent;
+            hand.flags = (handState.isTracked ? FUSharedSkeleton::HAND_TRACKED : 0) | (handState.isPrimary ? FUSharedSkeleton::HAND_PRIMARY : 0)
+                    | (handState.isPressed ? FUSharedSkeleton::HAND_PRESSED : 0) | (handState.isGripping ? FUSharedSkeleton::HAND_GRIPPING : 0);
+            if (handState.isPressed)
+                player.postures |= PUSH;
+            if (handState.isGripping)
+                player.postures |= GRIP;
+        }
+    }
+    mSessionExporter.write(*frame);
+    if (mSkeletonPublisher.isOpen())
+        mSkeletonPublisher.endFrame();
+}
+
+bool FUKinectTool::startColorPublishing(const char *name, int slotCount)
+{
+    return mColorPublisher.open(name, FUSharedFrame::COLOR_BGRA, mColorWidth, mColorHeight, slotCount);
+}
+
+bool FUKinectTool::startDepthPublishing(const char *name, int slotCount)
+{
+    return mDepthPublisher.open(name, FUSharedFrame::DEPTH_PIXELS, mDepthWidth, mDepthHeight, slotCount);
+}
+
+void FUKinectTool::stopFramePublishing()
+{
+    mColorPublisher.close();
+    mDepthPublisher.close();
+}
+
+bool FUKinectTool::startRecording(const char *filePath, bool includeDepth)
+{
+    mRecordDepth = includeDepth;
+    return mRecordingWriter.open(filePath);
+}
+
+const FUKinectTool::HandPointerState* FUKinectTool::getHandPointerState(DWORD skeletonTrackingID, NUI_HAND_TYPE handType) const
+{
+    const UserHandState *userHands = findUserHands(skeletonTrackingID);
+    if (userHands == nullptr)
+        return nullptr;
+    for (int i = 0; i < NUI_USER_HANDPOINTER_COUNT; i++) {
+        if (userHands->hands[i].handType == handType)
+            return &userHands->hands[i];
+    }
+    return nullptr;
+}
+
+const FUKinectTool::UserHandState* FUKinectTool::findUserHands(DWORD skeletonTrackingID) const
+{
+    if (skeletonTrackingID == 0)
+        return nullptr;
+    for (int i = 0; i < NUI_SKELETON_COUNT; i++) {
+        if (mUserHands[i].trackingID == skeletonTrackingID)
+            return &mUserHands[i];
+    }
+    return nullptr;
+}
+
 void FUKinectTool::safeReleaseSensor()
 {
+    if (mCoordinateMapper) {
+        mCoordinateMapper->Release();
+        mCoordinateMapper = nullptr;
+    }
     mNuiSensor->NuiShutdown();
     mNuiSensor->Release();
     mNuiSensor = nullptr;
@@ -17,6 +17,29 @@
 #include <iostream>
 //Local Includes
 #include "FUMath.h"
+#include "FUHandClassifier.h"
+#include "FUDepthSegmentation.h"
+#include "FUPointCloud.h"
+#include "FURegistration.h"
+#include "FUColorCropper.h"
+#include "FUThreadPool.h"
+#include "FUFloorEstimator.h"
+#include "FUMotionGate.h"
+#include "FUDepthFilter.h"
+#include "FUSkeleton.h"
+#include "FUGesture.h"
+#include "FUFrameProcessor.h"
+#include "FURecording.h"
+#include "FUSkeletonPublisher.h"
+#include "FUSkeletonStream.h"
+#include "FUSessionExporter.h"
+#include "FUFramePublisher.h"
+#include "FUJpegEncoder.h"
+#include "FULatency.h"
+#include "FUStreamStats.h"
+#include "FUStreamScheduler.h"
+#include "FUEventQueue.h"
+#include "FUTrace.h"
 #define F_UNUSED(T) (void)T
 
 class NuiInteractionClient : public INuiInteractionClient
@@ -46,9 +69,12 @@ public:
 };
 
 /**
- * @brief Create it with NUI_INITIALIZE_FLAG_USES_SKELETON and NUI_INITIALIZE_FLAG_USES_DEPTH to use Interactions
+ * @brief Create it with NUI_INITIALIZE_FLAG_USES_SKELETON and NUI_INITIALIZE_FLAG_USES_DEPTH_AND_PLAYER_INDEX to use
+ * Interactions. The depth stream is opened with the player index then, which the segmentation, the PLAYERS_ONLY and
+ * SCENE_ONLY point clouds and the player exclusion of the floor estimator need. With NUI_INITIALIZE_FLAG_USES_DEPTH every
+ * pixel has player index 0.
  */
-class FUKinectTool
+class FUKinectTool : public FUGesture
 {
 public:
     enum KINECT_STATUS {
@@ -99,6 +125,34 @@ public:
         NONE
     };
 
+    enum SNAPSHOT_FORMAT {
+        SNAPSHOT_JPEG,
+        SNAPSHOT_BMP
+    };
+
+    /**
+     * @brief The counters of a stream, taken periodically by updateSensor().
+     */
+    struct StreamSnapshot {
+        FULatency::STREAM stream;
+        FUStreamStats::Snapshot snapshot;
+    };
+
+    /**
+     * @brief State of one hand pointer from the interaction stream.
+     */
+    struct HandPointerState {
+        NUI_HAND_TYPE handType;
+        float x;
+        float y;
+        float pressExtent;
+        bool isTracked;
+        bool isPrimary;
+        bool isPressed;
+        bool isGripping;
+        unsigned int startedDetectors;//PUSH and GRIP if their EVENT_BEGAN was queued and their EVENT_ENDED is still due
+    };
+
 public:
     FUKinectTool(DWORD flags);
     ~FUKinectTool(void);
@@ -148,7 +202,19 @@ public:
     NUI_SKELETON_DATA* getSkeletonTwo() {return mSkeletonDataTwo;}
     bool isSkeletonTracked(NUI_SKELETON_DATA &skeletonData);
     void takeColorShot() {mSaveScreenshot = true;}
+    /**
+     * @brief Sets the file format of the color shots. They are JPEG by default, which are encoded in strips on the thread pool
+     * and are about 20 times smaller than the bitmaps.
+     * @param format
+     * @param quality --> JPEG quality from 1 to 100, it is ignored for the bitmaps
+     */
+    void setSnapshotFormat(SNAPSHOT_FORMAT format, int quality = 90);
     double getDistanceFromFloor(Vector4 jointPosition);
+    /**
+     * @brief Returns true on the skeleton frame that both feet of the player left the floor.
+     * @param skeletonData
+     * @return
+     */
     bool detectJumping(NUI_SKELETON_DATA &skeletonData);
     /**
      * @brief Returns the position of the active hand in cantimeters
@@ -156,8 +222,281 @@ public:
      * @return
      */
     FUMath::FUVector2<float> getHandPosition(DWORD skeletonTrackingID);
+    /**
+     * @brief Returns the last interaction state of the given hand of a user.
+     * @param skeletonTrackingID
+     * @param handType --> NUI_HAND_TYPE_LEFT or NUI_HAND_TYPE_RIGHT
+     * @return nullptr if the user isn't in the last interaction frame
+     */
+    const HandPointerState* getHandPointerState(DWORD skeletonTrackingID, NUI_HAND_TYPE handType) const;
+    /**
+     * @brief Applies a rigid transform to the position and the joints of a skeleton, e.g. to move it into the space of another
+     * sensor or into a world space. The other fields are copied.
+     * @param skeletonData
+     * @param transform --> Rotation and translation in skeleton space, see FUMath::FUMatrix4::createRigidTransform()
+     * @param output --> Can be the same as skeletonData
+     */
+    static void transformSkeleton(const NUI_SKELETON_DATA &skeletonData, const FUMath::FUMatrix4<float> &transform, NUI_SKELETON_DATA &output);
+    /**
+     * @brief Applies a rigid transform to every skeleton that has a position in the frame, and to the floor plane if there is one.
+     * @param frame
+     * @param transform
+     * @param output --> Can be the same as frame
+     */
+    static void transformSkeletonFrame(const NUI_SKELETON_FRAME &frame, const FUMath::FUMatrix4<float> &transform, NUI_SKELETON_FRAME &output);
+    /**
+     * @brief Converts a skeleton to the plain struct that FUPostureDetector and FUFrameProcessor work with.
+     * @param skeletonData
+     * @param output
+     */
+    static void toSkeletonData(const NUI_SKELETON_DATA &skeletonData, FUSkeleton::SkeletonData &output);
+    /**
+     * @brief Converts a skeleton frame to the plain struct that FUFrameProcessor works with. The floor plane is copied as is.
+     * @param frame
+     * @param output
+     */
+    static void toSkeletonFrame(const NUI_SKELETON_FRAME &frame, FUSkeleton::SkeletonFrame &output);
+    /**
+     * @brief Enables classifying both hands of every tracked player from the depth frames. Unlike the interaction stream this
+     * works for both hands and doesn't need a primary hand. Requires the depth stream and skeleton tracking.
+     * @param enabled
+     */
+    void setHandClassificationEnabled(bool enabled) {mClassifyHands = enabled;}
+    /**
+     * @brief Returns the shape of the hand from the last depth frame. Only available when hand classification is enabled.
+     * @param skeletonTrackingID
+     * @param handType --> NUI_HAND_TYPE_LEFT or NUI_HAND_TYPE_RIGHT
+     * @return FUHandClassifier::HAND_UNKNOWN if the player isn't tracked or the hand couldn't be segmented
+     */
+    FUHandClassifier::HAND_SHAPE getHandShape(DWORD skeletonTrackingID, NUI_HAND_TYPE handType) const;
+    /**
+     * @brief Returns the body scale of a player relative to an adult of about 1.75 m. It is refined with every skeleton frame
+     * and the posture thresholds are multiplied with it.
+     * @param skeletonTrackingID
+     * @return 1 until enough bones of the player are measured, or if the player isn't tracked
+     */
+    float getBodyScale(DWORD skeletonTrackingID) const {return mFrameProcessor.getBodyScale(skeletonTrackingID);}
+    /**
+     * @brief Returns the bone length estimates of a player.
+     * @param skeletonTrackingID
+     * @return nullptr if the player isn't tracked
+     */
+    const FUSkeleton::FUBodyScale* getBodyProportions(DWORD skeletonTrackingID) const {return mFrameProcessor.getBodyProportions(skeletonTrackingID);}
+    /**
+     * @brief Returns true if the depth frames have player indices, see NUI_INITIALIZE_FLAG_USES_DEPTH_AND_PLAYER_INDEX.
+     * @return
+     */
+    bool hasPlayerIndex() const {return (mDWFlags & NUI_INITIALIZE_FLAG_USES_DEPTH_AND_PLAYER_INDEX) != 0;}
+    /**
+     * @brief Enables extracting the player masks and statistics, and the foreground blobs from every depth frame. Requires
+     * NUI_INITIALIZE_FLAG_USES_DEPTH_AND_PLAYER_INDEX.
+     * @param enabled
+     * @return false if the segmentation can't be enabled because the depth frames don't have player indices
+     */
+    bool setSegmentationEnabled(bool enabled);
+    /**
+     * @brief Returns the segmentation of the last depth frame. Use it to configure the foreground blob detection too.
+     * @return
+     */
+    FUDepthSegmentation& getDepthSegmentation() {return mDepthSegmentation;}
+    /**
+     * @brief Enables generating a point cloud from every depth frame.
+     * @param enabled
+     * @param playerFilter --> Which pixels are converted, see FUPointCloud::PLAYER_FILTER. Anything but ALL_PIXELS requires
+     * NUI_INITIALIZE_FLAG_USES_DEPTH_AND_PLAYER_INDEX.
+     * @return false if the filter needs player indices that the depth frames don't have, the point cloud isn't enabled then
+     */
+    bool setPointCloudEnabled(bool enabled, unsigned int playerFilter = FUPointCloud::ALL_PIXELS);
+    /**
+     * @brief Returns the point cloud of the last depth frame. Use FUPointCloudWriter to export it.
+     * @return
+     */
+    const FUPointCloud& getPointCloud() const {return mPointCloud;}
+    /**
+     * @brief Enables registering the depth and color frames. The mapping tables are built from the sensor's calibration on the
+     * first depth frame and rebuilt only when the calibration changes.
+     * @param enabled
+     * @param outputs --> A combination of FURegistration::OUTPUTS
+     */
+    void setRegistrationEnabled(bool enabled, unsigned int outputs = FURegistration::DEPTH_IN_COLOR | FURegistration::COLOR_IN_DEPTH);
+    /**
+     * @brief Returns the registered images. The depth in color image is updated with every depth frame and the color in depth
+     * image with every color frame.
+     * @return
+     */
+    const FURegistration& getRegistration() const {return mRegistration;}
+    /**
+     * @brief Enables cutting crops around the heads and the hands of the tracked players out of every processed color frame,
+     * see FUColorCropper. The joints are mapped with the registration tables, which are built even if registration is disabled.
+     * @param enabled
+     * @param size --> Width and height of the crops in pixels
+     * @param downscale --> Each crop pixel is the average of downscale x downscale color pixels
+     * @param regions --> A combination of FUColorCropper::REGIONS
+     */
+    void setColorCroppingEnabled(bool enabled, int size = 128, int downscale = 1, unsigned int regions = FUColorCropper::ALL_REGIONS);
+    /**
+     * @brief Pops the crop batches of the color frames. Like pollEvents(), a single other thread can call this. Every batch
+     * must be returned with releaseColorCrops() when it's no longer used, the color frames are dropped while all are held.
+     * @param batches --> Output array that has room for at least maxBatches batches
+     * @param maxBatches
+     * @return The number of batches written to batches
+     */
+    size_t pollColorCrops(const FUColorCropper::Batch **batches, size_t maxBatches) {return mColorCropBatches.pop(batches, maxBatches);}
+    void releaseColorCrops(const FUColorCropper::Batch *batch) {mColorCropper.release(batch);}
+    /**
+     * @brief Enables estimating the floor from the depth frames when the SDK doesn't report a floor plane. The estimated plane
+     * is then used by getDistanceFromFloor() and detectJumping(). The players are left out of the fit only if the depth
+     * frames have player indices, see hasPlayerIndex(). Enabled by default.
+     * @param enabled
+     */
+    void setFloorEstimationEnabled(bool enabled);
+    /**
+     * @brief Enables skipping the skeleton, color, interaction and depth processing while the scene is static and nobody is
+     * tracked. The depth stream is still read to watch for motion, and the first frame with motion is processed as usual. The
+     * depth frame is read before the other streams in every updateSensor(), so they follow the gate without a lag.
+     * A pending screenshot is always taken. Disabled by default.
+     * @param enabled
+     */
+    void setMotionGatingEnabled(bool enabled) {mGateOnMotion = enabled;}
+    /**
+     * @brief Returns the motion gate to read its state or tune it.
+     * @return
+     */
+    FUMotionGate& getMotionGate() {return mMotionGate;}
+    /**
+     * @brief Enables filtering the depth frames in time and filling their small holes before the other depth stages use them.
+     * The interaction stream still gets the raw frames. Disabled by default.
+     * @param enabled
+     */
+    void setDepthFilterEnabled(bool enabled);
+    /**
+     * @brief Returns the depth filter to read the last filtered frame or tune it.
+     * @return
+     */
+    FUDepthFilter& getDepthFilter() {return mDepthFilter;}
     SKELETONS getWhichSkeletonLeftScene() {return mSkeletonLeftScene;}
 
+    /**
+     * @brief Subscribes to the given detectors for a player, see FUFrameProcessor::subscribe(). Call this from the thread that
+     * calls updateSensor().
+     * @param skeletonTrackingID --> Tracking ID of the player or ANY_PLAYER
+     * @param detectors --> A combination of DETECTORS
+     * @return false if there's no room for another player subscription
+     */
+    bool subscribe(DWORD skeletonTrackingID, unsigned int detectors) {return mFrameProcessor.subscribe(skeletonTrackingID, detectors);}
+    /**
+     * @brief Removes the given detectors from the player's subscription. Detectors that were active end with an EVENT_ENDED.
+     * @param skeletonTrackingID --> Tracking ID of the player or ANY_PLAYER
+     * @param detectors --> A combination of DETECTORS
+     */
+    void unsubscribe(DWORD skeletonTrackingID, unsigned int detectors) {mFrameProcessor.unsubscribe(skeletonTrackingID, detectors);}
+    /**
+     * @brief Pops the queued detector events. This can be called from a thread other than the one that calls updateSensor(),
+     * as long as there is only one such thread.
+     * @param events --> Output array that has room for at least maxEvents events
+     * @param maxEvents
+     * @return The number of events written to events
+     */
+    size_t pollEvents(GestureEvent *events, size_t maxEvents) {return mFrameProcessor.pollEvents(events, maxEvents);}
+    /**
+     * @brief Returns the number of events that were dropped because pollEvents() wasn't called often enough.
+     * @return
+     */
+    size_t getDroppedEventCount() const {return mFrameProcessor.getDroppedEventCount();}
+    /**
+     * @brief Starts recording the skeleton frames, and optionally the raw depth frames, to a file that FURecordingReader can
+     * play back, e.g. with the benchmarks. A recording that is in progress is closed first.
+     * @param filePath
+     * @param includeDepth
+     * @return false if the file can't be created
+     */
+    bool startRecording(const char *filePath, bool includeDepth = false);
+    void stopRecording() {mRecordingWriter.close();}
+    bool isRecording() const {return mRecordingWriter.isOpen();}
+    /**
+     * @brief Starts publishing every processed skeleton frame, with the postures and the hand pointers of the players, to the
+     * other processes on the machine. They read it with FUSkeletonReader. The hand pointers are the ones of the last interaction
+     * frame, which is usually one skeleton frame behind.
+     * @param name --> Name of the shared memory segment
+     * @return false if the shared memory can't be created
+     */
+    bool startPublishing(const char *name = FUSharedSkeleton::DEFAULT_NAME) {return mSkeletonPublisher.open(name);}
+    void stopPublishing() {mSkeletonPublisher.close();}
+    bool isPublishing() const {return mSkeletonPublisher.isOpen();}
+    /**
+     * @brief Starts publishing the raw color frames to the other processes on the machine through a shared memory frame pool.
+     * They read it with FUFrameReader. Only the frames that are processed are published, see setMotionGatingEnabled().
+     * @param name --> Name of the pool
+     * @param slotCount --> See FUFramePublisher::open()
+     * @return false if the shared memory can't be created
+     */
+    bool startColorPublishing(const char *name = FUSharedFrame::DEFAULT_COLOR_NAME, int slotCount = 4);
+    /**
+     * @brief Same as startColorPublishing() for the raw depth frames, as FUDepthPixels.
+     */
+    bool startDepthPublishing(const char *name = FUSharedFrame::DEFAULT_DEPTH_NAME, int slotCount = 4);
+    void stopFramePublishing();
+    /**
+     * @brief Starts sending every processed skeleton frame to a render node over UDP, see FUSkeletonReceiver.
+     * @param host
+     * @param port
+     * @return false if the host can't be resolved
+     */
+    bool startStreaming(const char *host, uint16_t port) {return mSkeletonSender.open(host, port);}
+    void stopStreaming() {mSkeletonSender.close();}
+    bool isStreaming() const {return mSkeletonSender.isOpen();}
+    const FUSkeletonSender& getSkeletonSender() const {return mSkeletonSender;}
+    /**
+     * @brief Starts exporting every processed skeleton frame, with the detector results, to a columnar session file for
+     * analytics, see FUSessionExporter. The file is written on a background thread and completed by stopExporting().
+     * @param filePath
+     * @return false if the file can't be created
+     */
+    bool startExporting(const char *filePath) {return mSessionExporter.open(filePath);}
+    void stopExporting() {mSessionExporter.close();}
+    bool isExporting() const {return mSessionExporter.isOpen();}
+    const FUSessionExporter& getSessionExporter() const {return mSessionExporter;}
+    /**
+     * @brief Returns the latency histograms of the processing stages of every stream. They can be read from any thread. Nothing
+     * is recorded if the library is built with FU_LATENCY_DISABLED.
+     * @return
+     */
+    FULatency& getLatency() {return mLatency;}
+    /**
+     * @brief Returns the frame counters of a stream: read, dropped, skipped while the motion gate was idle, late and failed
+     * frames, and how many frames were waiting. They can be read from any thread.
+     * @param stream
+     * @return
+     */
+    const FUStreamStats& getStreamStats(FULatency::STREAM stream) const {return mStreamStats[stream];}
+    /**
+     * @brief Sets how often updateSensor() takes a snapshot of the counters of every stream. The default is 1000 ms.
+     * @param milliseconds --> 0 stops the snapshots
+     */
+    void setStreamSnapshotInterval(int milliseconds) {mStreamSnapshotInterval = milliseconds;}
+    /**
+     * @brief Pops the periodic snapshots. Like pollEvents(), a single other thread can call this.
+     * @param snapshots --> Output array that has room for at least maxSnapshots snapshots
+     * @param maxSnapshots
+     * @return The number of snapshots written to snapshots
+     */
+    size_t pollStreamSnapshots(StreamSnapshot *snapshots, size_t maxSnapshots) {return mStreamSnapshots.pop(snapshots, maxSnapshots);}
+    /**
+     * @brief Enables the stream scheduler, which skips and defers the frames of the streams to keep their target rates and the
+     * CPU budget. Its decisions are counted in getStreamScheduler().getCounters(). A depth frame that isn't processed is still
+     * passed to the interaction stream and the motion gate, only the depth stages are left out, so depth frames are skipped
+     * instead of deferred. A skipped skeleton frame is still passed to the interaction stream. The depth stream is always
+     * updated first for the motion gate, the other streams are updated in the order of their priorities. Disabled by default.
+     * @param enabled
+     */
+    void setStreamSchedulingEnabled(bool enabled) {mScheduleStreams = enabled;}
+    /**
+     * @brief Returns the stream scheduler to set the rates, the priorities and the budget. Only the thread that calls
+     * updateSensor() can use it.
+     * @return
+     */
+    FUStreamScheduler& getStreamScheduler() {return mStreamScheduler;}
+
 private:
     /**
      * @brief The skeleton on the right or the only one that is tracked
@@ -180,18 +519,91 @@ private:
     bool mSaveScreenshot;
     const int mColorWidth;
     const int mColorHeight;
+    const int mDepthWidth;
+    const int mDepthHeight;
     INuiInteractionStream *mNuiInteractionStream;
     NuiInteractionClient *mNuiInteractionClient;
-    bool mIsPressedPlayerOne, mIsGrippingPlayerOne, mJumpedPlayerOne, mIsPressedPlayerTwo, mIsGrippingPlayerTwo, mJumpedPlayerTwo;
     DWORD mDWFlags;
 
     KINECT_STATUS mKinectErrorMessage;
     NUI_SKELETON_FRAME mSkeletonFrame;
-    FUMath::FUVector2<float> mVectorSkeletonOneHandPosition;
-    FUMath::FUVector2<float> mVectorSkeletonTwoHandPosition;
 
     SKELETONS mSkeletonLeftScene;
 
+    /**
+     * @brief mSkeletonFrame as plain structs, with the floor plane that the detectors use
+     */
+    FUSkeleton::SkeletonFrame mCoreSkeletonFrame;
+    FUFrameProcessor mFrameProcessor;
+    FURecordingWriter mRecordingWriter;
+    bool mRecordDepth;
+    FUSkeletonPublisher mSkeletonPublisher;
+    FUFramePublisher mColorPublisher;
+    FUFramePublisher mDepthPublisher;
+    FUSkeletonSender mSkeletonSender;
+    FUSessionExporter mSessionExporter;
+    /**
+     * @brief The frame that is exported when the skeleton frames aren't published
+     */
+    FUSharedSkeleton::Frame mExportFrame;
+
+    struct UserHandState {
+        DWORD trackingID;
+        HandPointerState hands[NUI_USER_HANDPOINTER_COUNT];
+    };
+    /**
+     * @brief Hand pointer states of the users in the last interaction frame, in the same order as NUI_INTERACTION_FRAME::UserInfos.
+     */
+    UserHandState mUserHands[NUI_SKELETON_COUNT];
+
+    struct UserHandShapes {
+        DWORD trackingID;
+        FUHandClassifier::HAND_SHAPE left;
+        FUHandClassifier::HAND_SHAPE right;
+    };
+    bool mClassifyHands;
+    FUHandClassifier mHandClassifier;
+    /**
+     * @brief Hand shapes of the players in the same order as mSkeletonFrame.SkeletonData
+     */
+    UserHandShapes mHandShapes[NUI_SKELETON_COUNT];
+
+    bool mSegmentDepth;
+    FUDepthSegmentation mDepthSegmentation;
+    bool mGeneratePointCloud;
+    unsigned int mPointCloudPlayerFilter;
+    FUPointCloud mPointCloud;
+    bool mRegisterFrames;
+    FURegistration mRegistration;
+    INuiCoordinateMapper *mCoordinateMapper;
+    /**
+     * @brief Hash of the calibration data of mCoordinateMapper, taken when the mapper is created
+     */
+    uint64_t mCalibrationKey;
+    bool mCropColor;
+    FUColorCropper mColorCropper;
+    FUEventQueue<const FUColorCropper::Batch*, 4> mColorCropBatches;
+    /**
+     * @brief Shared by the processing stages that run on more than one thread
+     */
+    FUThreadPool mThreadPool;
+    bool mEstimateFloor;
+    FUFloorEstimator mFloorEstimator;
+    bool mGateOnMotion;
+    FUMotionGate mMotionGate;
+    bool mFilterDepth;
+    FUDepthFilter mDepthFilter;
+    SNAPSHOT_FORMAT mSnapshotFormat;
+    FUJpegEncoder mJpegEncoder;
+    std::vector<uint8_t> mSnapshotBuffer;
+    FULatency mLatency;
+    FUStreamStats mStreamStats[FULatency::STREAM_COUNT];
+    int mStreamSnapshotInterval;
+    int64_t mLastStreamSnapshotTime;
+    FUEventQueue<StreamSnapshot, 64> mStreamSnapshots;
+    bool mScheduleStreams;
+    FUStreamScheduler mStreamScheduler;
+
 private:
     /**
      * @brief Finds and creates an instance with the firs found ready kinect. And initializes the Kinect with Skeleton tracking
@@ -216,13 +628,73 @@ private:
      * @return indicates success or failure
      */
     HRESULT saveBitmapToFile(BYTE* pBitmapBits, LONG lWidth, LONG lHeight, WORD wBitsPerPixel, LPCWSTR lpszFilePath);
+    /**
+     * @brief Encodes a color frame as JPEG with mJpegEncoder and saves it to disk
+     * @param pixels --> 32 bit color frame
+     * @param pitch --> Bytes between the rows of pixels
+     * @param filePath
+     * @return indicates success or failure
+     */
+    HRESULT saveJpegToFile(const BYTE *pixels, LONG pitch, LPCWSTR filePath);
+    /**
+     * @brief Processes a signaled frame of a stream, or lets the stream scheduler decide about it when it's enabled.
+     * @param stream
+     * @param shouldProcess --> The decision of the motion gate
+     */
+    void updateStream(FULatency::STREAM stream, bool shouldProcess);
+    void processStream(FULatency::STREAM stream);
+    /**
+     * @brief Reads and releases the next frame of a stream without processing it.
+     * @param stream
+     */
+    void discardFrame(FULatency::STREAM stream);
+    HANDLE getStreamEvent(FULatency::STREAM stream) const;
     void processInteraction();
-    void processDepth();
+    /**
+     * @param runStages --> false only passes the frame to the interaction stream and the motion gate
+     */
+    void processDepth(bool runStages);
     void processColor();
     void processSkeleton();
+    /**
+     * @brief Queues a snapshot of every stream's counters when the snapshot interval has passed.
+     */
+    void publishStreamSnapshots();
+    /**
+     * @brief Publishes mCoreSkeletonFrame with the detector results and the hand pointers, and adds it to the session export.
+     */
+    void publishSkeletonFrame();
+    /**
+     * @brief Returns false when the motion gate is idle and the current frames should be skipped.
+     * @return
+     */
+    bool shouldProcessFrames() const {return !mGateOnMotion || mMotionGate.shouldProcess();}
     bool isSkeletonOnRight(NUI_SKELETON_DATA &skeletonDataOne, NUI_SKELETON_DATA &skeletonDataTwo);
     bool checkForSkeletonVisibility(NUI_SKELETON_DATA &skeletonData, NUI_SKELETON_FRAME &frame);
     int getSkeletonCount(NUI_SKELETON_FRAME &sFrame);
     bool isFloorVisible();
+    /**
+     * @brief Returns true if the SDK reported a floor plane in the last skeleton frame.
+     */
+    bool isSDKFloorVisible() const;
+    /**
+     * @brief Returns the SDK's floor plane, or the estimated one if the SDK didn't report any.
+     */
+    Vector4 getFloorPlane() const;
+    float getBodyScale(const NUI_SKELETON_DATA &skeletonData) const;
+    /**
+     * @brief Queues the PUSH and GRIP transitions of a hand between two interaction frames. An EVENT_BEGAN is only queued for
+     * the subscribed detectors, and it's latched in current so that its EVENT_ENDED is queued even after the player left and
+     * the subscription was released.
+     */
+    void queueHandEvents(const HandPointerState &previous, HandPointerState &current, unsigned int detectors, GestureEvent &event);
+    const UserHandState* findUserHands(DWORD skeletonTrackingID) const;
+    /**
+     * @brief Rebuilds the registration tables if the calibration changed since they were built.
+     * @return false if the tables aren't available
+     */
+    bool updateRegistrationTables();
+    void classifyHands(const FUDepthFrame &depthFrame);
+    FUHandClassifier::HAND_SHAPE classifyHand(const FUDepthFrame &depthFrame, NUI_SKELETON_DATA &skeletonData, SKELETON_JOINTS joint);
 };
 
@@ -0,0 +1,160 @@
+#include "FULatency.h"
+
+/**
+ * @brief The WAIT stage of every stream
+ */
+static const FULatency::STAGE WAIT_STAGES[FULatency::STREAM_COUNT] = {
+    FULatency::SKELETON_WAIT,
+    FULatency::INTERACTION_WAIT,
+    FULatency::DEPTH_WAIT,
+    FULatency::COLOR_WAIT
+};
+
+static const char *STAGE_NAMES[FULatency::STAGE_COUNT] = {
+    "skeleton wait",
+    "skeleton processing",
+    "skeleton detectors",
+    "skeleton result",
+    "interaction wait",
+    "interaction processing",
+    "interaction result",
+    "depth wait",
+    "depth processing",
+    "depth result",
+    "color wait",
+    "color processing",
+    "color result"
+};
+
+/**
+ * @brief Returns the index of the highest set bit, value must not be 0.
+ */
+static int getHighestBit(uint64_t value)
+{
+    int bit = 0;
+    for (int shift = 32; shift > 0; shift >>= 1) {
+        if (value >> shift) {
+            value >>= shift;
+            bit += shift;
+        }
+    }
+    return bit;
+}
+
+FULatencyHistogram::FULatencyHistogram()
+{
+    reset();
+}
+
+int FULatencyHistogram::getBucketIndex(uint64_t value)
+{
+    if (value < SUB_BUCKET_COUNT)
+        return static_cast<int>(value);
+    //The top SUB_BUCKET_BITS + 1 bits of the value pick the bucket
+    const int shift = getHighestBit(value) - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKET_COUNT + static_cast<int>((value >> shift) - SUB_BUCKET_COUNT);
+}
+
+uint64_t FULatencyHistogram::getBucketMaxValue(int index)
+{
+    if (index < SUB_BUCKET_COUNT)
+        return static_cast<uint64_t>(index);
+    const int shift = index / SUB_BUCKET_COUNT - 1;
+    const uint64_t mantissa = SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+uint64_t FULatencyHistogram::getValueAtPercentile(double percentile) const
+{
+    const uint64_t count = getCount();
+    if (count == 0)
+        return 0;
+    const uint64_t rank = percentile >= 100 ? count : static_cast<uint64_t>(percentile / 100.0 * count + 0.5);
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        total += mCounts[i].load(std::memory_order_relaxed);
+        if (total >= rank && total > 0) {
+            const uint64_t max = mMax.load(std::memory_order_relaxed);
+            const uint64_t value = getBucketMaxValue(i);
+            return value < max ? value : max;
+        }
+    }
+    return mMax.load(std::memory_order_relaxed);
+}
+
+FULatencyHistogram::Summary FULatencyHistogram::getSummary() const
+{
+    Summary summary = Summary();
+    //Work on a copy, so the percentiles agree with each other while values are recorded
+    static const double PERCENTILES[4] = {50.0, 90.0, 99.0, 99.9};
+    uint64_t *outputs[4] = {&summary.p50, &summary.p90, &summary.p99, &summary.p999};
+    uint64_t counts[BUCKET_COUNT];
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        counts[i] = mCounts[i].load(std::memory_order_relaxed);
+        summary.count += counts[i];
+    }
+    if (summary.count == 0)
+        return summary;
+    summary.min = mMin.load(std::memory_order_relaxed);
+    summary.max = mMax.load(std::memory_order_relaxed);
+    summary.mean = static_cast<double>(mSum.load(std::memory_order_relaxed)) / mCount.load(std::memory_order_relaxed);
+    int percentile = 0;
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKET_COUNT && percentile < 4; i++) {
+        total += counts[i];
+        while (percentile < 4 && total > 0 && total >= static_cast<uint64_t>(PERCENTILES[percentile] / 100.0 * summary.count + 0.5)) {
+            const uint64_t value = getBucketMaxValue(i);
+            *outputs[percentile++] = value < summary.max ? value : summary.max;
+        }
+    }
+    return summary;
+}
+
+void FULatencyHistogram::reset()
+{
+    for (int i = 0; i < BUCKET_COUNT; i++)
+        mCounts[i].store(0, std::memory_order_relaxed);
+    mCount.store(0, std::memory_order_relaxed);
+    mSum.store(0, std::memory_order_relaxed);
+    mMin.store(MAX_VALUE, std::memory_order_relaxed);
+    mMax.store(0, std::memory_order_relaxed);
+}
+
+FULatency::FULatency()
+    : mClockOffsets()
+    , mHasClockOffset()
+    , mIsEnabled(true)
+    , mIsClockResetRequested(false)
+{
+}
+
+FULatency::Stamp FULatency::beginFrame(STREAM stream, int64_t sensorTimeStamp)
+{
+    if (mIsClockResetRequested.load(std::memory_order_relaxed) && mIsClockResetRequested.exchange(false)) {
+        for (int i = 0; i < STREAM_COUNT; i++)
+            mHasClockOffset[i] = false;
+    }
+    const int64_t now = getTime();
+    const int64_t offset = now - sensorTimeStamp * 1000000;
+    if (!mHasClockOffset[stream] || offset < mClockOffsets[stream]) {
+        mClockOffsets[stream] = offset;
+        mHasClockOffset[stream] = true;
+    }
+    Stamp stamp;
+    stamp.sensorTime = sensorTimeStamp * 1000000 + mClockOffsets[stream];
+    stamp.lastTime = now;
+    record(WAIT_STAGES[stream], now - stamp.sensorTime);
+    return stamp;
+}
+
+void FULatency::reset()
+{
+    for (int i = 0; i < STAGE_COUNT; i++)
+        mHistograms[i].reset();
+    mIsClockResetRequested.store(true);
+}
+
+const char* FULatency::getStageName(STAGE stage)
+{
+    return stage >= 0 && stage < STAGE_COUNT ? STAGE_NAMES[stage] : "";
+}
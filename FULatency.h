@@ -0,0 +1,227 @@
+#pragma once
+//STL Includes
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * FU_LATENCY is defined unless the build defines FU_LATENCY_DISABLED. When it isn't defined the stamps compile to nothing
+ * and the histograms stay empty.
+ */
+#ifndef FU_LATENCY_DISABLED
+#define FU_LATENCY 1
+#endif
+
+/**
+ * @brief A lock-free histogram of durations in nanoseconds with a bounded relative error, in the style of HdrHistogram.
+ * Values below 2^SUB_BUCKET_BITS have a bucket each; above that every power of two range is split into 2^SUB_BUCKET_BITS
+ * buckets, so a value is off by at most 1/64 of itself. Any thread can record and any thread can read.
+ */
+class FULatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 6;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    /**
+     * @brief Larger values are counted as MAX_VALUE, about 18 minutes.
+     */
+    static const uint64_t MAX_VALUE = (1ULL << 40) - 1;
+    static const int BUCKET_COUNT = (40 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    /**
+     * @brief The statistics of the recorded values in nanoseconds. The percentiles are the largest value of their bucket.
+     */
+    struct Summary {
+        uint64_t count;
+        uint64_t min;
+        uint64_t max;
+        double mean;
+        uint64_t p50;
+        uint64_t p90;
+        uint64_t p99;
+        uint64_t p999;
+    };
+
+public:
+    FULatencyHistogram();
+    void record(uint64_t value)
+    {
+        value = value > MAX_VALUE ? MAX_VALUE : value;
+        mCounts[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        mCount.fetch_add(1, std::memory_order_relaxed);
+        mSum.fetch_add(value, std::memory_order_relaxed);
+        uint64_t min = mMin.load(std::memory_order_relaxed);
+        while (value < min && !mMin.compare_exchange_weak(min, value, std::memory_order_relaxed)) {}
+        uint64_t max = mMax.load(std::memory_order_relaxed);
+        while (value > max && !mMax.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+    }
+
+    /**
+     * @brief Returns the value at the given percentile.
+     * @param percentile --> 0 to 100
+     * @return 0 if nothing is recorded
+     */
+    uint64_t getValueAtPercentile(double percentile) const;
+    /**
+     * @brief Returns all the statistics with a single pass over the buckets.
+     * @return
+     */
+    Summary getSummary() const;
+    uint64_t getCount() const {return mCount.load(std::memory_order_relaxed);}
+    /**
+     * @brief Clears the histogram. Values recorded while it runs can be lost.
+     */
+    void reset();
+
+    static int getBucketIndex(uint64_t value);
+    /**
+     * @brief Returns the largest value that is counted in a bucket.
+     */
+    static uint64_t getBucketMaxValue(int index);
+
+private:
+    std::atomic<uint64_t> mCounts[BUCKET_COUNT];
+    std::atomic<uint64_t> mCount;
+    std::atomic<uint64_t> mSum;
+    std::atomic<uint64_t> mMin;
+    std::atomic<uint64_t> mMax;
+
+private:
+    FULatencyHistogram(const FULatencyHistogram&);
+    FULatencyHistogram& operator=(const FULatencyHistogram&);
+};
+
+/**
+ * @brief Per stage latency histograms of the sensor streams. Each frame is stamped when it's acquired, at every stage boundary
+ * and when its result is ready. The WAIT and RESULT stages are measured from the sensor time stamp of the frame. The sensor
+ * clock is mapped to the host clock with the smallest difference seen between the two, so these stages leave out the constant
+ * part of the transport delay and measure how much older a frame is than the freshest frame was.
+ */
+class FULatency
+{
+public:
+    enum STREAM {
+        SKELETON_STREAM,
+        INTERACTION_STREAM,
+        DEPTH_STREAM,
+        COLOR_STREAM,
+        STREAM_COUNT
+    };
+
+    enum STAGE {
+        SKELETON_WAIT,//From the sensor time stamp until the frame is read
+        SKELETON_PROCESSING,//Smoothing and sorting the skeletons
+        SKELETON_DETECTORS,//Running the detectors and queueing the events
+        SKELETON_RESULT,//From the sensor time stamp until the events are queued
+        INTERACTION_WAIT,
+        INTERACTION_PROCESSING,
+        INTERACTION_RESULT,
+        DEPTH_WAIT,
+        DEPTH_PROCESSING,
+        DEPTH_RESULT,
+        COLOR_WAIT,
+        COLOR_PROCESSING,
+        COLOR_RESULT,
+        STAGE_COUNT
+    };
+
+    /**
+     * @brief The stamps of a frame as it goes through the stages. Times are on the host clock in nanoseconds.
+     */
+    struct Stamp {
+        int64_t sensorTime;//The sensor time stamp mapped to the host clock
+        int64_t lastTime;//When the previous stage ended
+    };
+
+public:
+    FULatency();
+    /**
+     * @brief Stamps a frame that was just read and records how long it waited.
+     * @param stream
+     * @param sensorTimeStamp --> The time stamp of the frame in milliseconds, like liTimeStamp
+     * @return
+     */
+    Stamp begin(STREAM stream, int64_t sensorTimeStamp)
+    {
+        Stamp stamp = {0, 0};
+#ifdef FU_LATENCY
+        if (mIsEnabled.load(std::memory_order_relaxed))
+            stamp = beginFrame(stream, sensorTimeStamp);
+#else
+        (void)stream;
+        (void)sensorTimeStamp;
+#endif
+        return stamp;
+    }
+
+    /**
+     * @brief Records the time since the previous stamp of the frame as the given stage.
+     * @param stamp
+     * @param stage
+     */
+    void mark(Stamp &stamp, STAGE stage)
+    {
+#ifdef FU_LATENCY
+        if (stamp.lastTime != 0) {
+            const int64_t now = getTime();
+            record(stage, now - stamp.lastTime);
+            stamp.lastTime = now;
+        }
+#else
+        (void)stamp;
+        (void)stage;
+#endif
+    }
+
+    /**
+     * @brief Records the time since the sensor time stamp of the frame as the given stage.
+     * @param stamp
+     * @param stage
+     */
+    void end(const Stamp &stamp, STAGE stage)
+    {
+#ifdef FU_LATENCY
+        if (stamp.lastTime != 0)
+            record(stage, getTime() - stamp.sensorTime);
+#else
+        (void)stamp;
+        (void)stage;
+#endif
+    }
+
+    /**
+     * @brief Enables stamping the frames. Enabled by default when FU_LATENCY is defined.
+     * @param enabled
+     */
+    void setEnabled(bool enabled) {mIsEnabled.store(enabled, std::memory_order_relaxed);}
+    bool isEnabled() const {return mIsEnabled.load(std::memory_order_relaxed);}
+    const FULatencyHistogram& getHistogram(STAGE stage) const {return mHistograms[stage];}
+    FULatencyHistogram::Summary getSummary(STAGE stage) const {return mHistograms[stage].getSummary();}
+    /**
+     * @brief Clears the histograms and the clock mapping, e.g. after the sensor is reconnected. It can be called from any
+     * thread, the clock mapping is cleared with the next frame.
+     */
+    void reset();
+    static const char* getStageName(STAGE stage);
+    /**
+     * @brief Returns the monotonic host clock in nanoseconds.
+     */
+    static int64_t getTime()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    FULatencyHistogram mHistograms[STAGE_COUNT];
+    /**
+     * @brief Host time minus sensor time, the smallest seen for each stream. Only the thread that stamps the frames uses it.
+     */
+    int64_t mClockOffsets[STREAM_COUNT];
+    bool mHasClockOffset[STREAM_COUNT];
+    std::atomic<bool> mIsEnabled;
+    std::atomic<bool> mIsClockResetRequested;
+
+private:
+    Stamp beginFrame(STREAM stream, int64_t sensorTimeStamp);
+    void record(STAGE stage, int64_t duration) {mHistograms[stage].record(duration > 0 ? static_cast<uint64_t>(duration) : 0);}
+};
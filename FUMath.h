@@ -4,8 +4,21 @@
  * All rights reserved.
  * vmath is the base class for FUMath. FUMath basically adds a few more functions and changes the function and class names.
  */
+#pragma once
+//STL Includes
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <ostream>
+#include <sstream>
+#include <string>
+//Local Includes
+#include "FUSimd.h"
 
 namespace FUMath {
+//Threshold of the equality operators
+const float EPSILON = 4.37114e-05f;
+
 template<class T>
 class FUVector2
 {
@@ -88,10 +101,7 @@ public:
      */
     T& operator[](int n) {
         assert(n >= 0 && n <= 1);
-        if (0 == n)
-            return x;
-        else
-            return y;
+        return (&x)[n];
     }
 
     /**
@@ -102,10 +112,7 @@ public:
      */
     const T& operator[](int n) const {
         assert(n >= 0 && n <= 1);
-        if (0 == n)
-            return x;
-        else
-            return y;
+        return (&x)[n];
     }
 
     //---------------[ Vector Aritmetic Operator ]---------------//
@@ -394,4 +401,947 @@ public:
         return oss.str();
     }
 };
+
+/**
+ * The SIMD kernels of the 4 component types. The templates are the scalar versions and the float overloads use SSE when
+ * it is available. Pointers to 4 component values must be 16 byte aligned unless the name says otherwise.
+ */
+namespace Simd {
+template<class T>
+inline void add4(const T *a, const T *b, T *result) {
+    for (int i = 0; i < 4; i++)
+        result[i] = a[i] + b[i];
+}
+
+template<class T>
+inline void subtract4(const T *a, const T *b, T *result) {
+    for (int i = 0; i < 4; i++)
+        result[i] = a[i] - b[i];
+}
+
+template<class T>
+inline void multiply4(const T *a, const T *b, T *result) {
+    for (int i = 0; i < 4; i++)
+        result[i] = a[i] * b[i];
+}
+
+template<class T>
+inline void scale4(const T *a, T scale, T *result) {
+    for (int i = 0; i < 4; i++)
+        result[i] = a[i] * scale;
+}
+
+template<class T>
+inline T dot4(const T *a, const T *b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+}
+
+/**
+ * @brief result = matrix * vector, with a column major matrix.
+ */
+template<class T>
+inline void transform4(const T *matrix, const T *vector, T *result) {
+    for (int row = 0; row < 4; row++)
+        result[row] = matrix[row] * vector[0] + matrix[4 + row] * vector[1] + matrix[8 + row] * vector[2] + matrix[12 + row] * vector[3];
+}
+
+/**
+ * @brief Hamilton product of two quaternions stored as (x, y, z, w).
+ */
+template<class T>
+inline void quaternionMultiply(const T *a, const T *b, T *result) {
+    result[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+    result[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+    result[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+    result[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+}
+
+/**
+ * @brief Transforms count points stored as (x, y, z, w) with a column major matrix. The points are transformed with a w of 1
+ * and their w is copied to the output. The points don't need to be aligned and can be transformed in place.
+ */
+template<class T>
+inline void transformPoints(const T *matrix, const T *points, T *output, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const T x = points[i * 4];
+        const T y = points[i * 4 + 1];
+        const T z = points[i * 4 + 2];
+        const T w = points[i * 4 + 3];
+        for (int row = 0; row < 3; row++)
+            output[i * 4 + row] = matrix[row] * x + matrix[4 + row] * y + matrix[8 + row] * z + matrix[12 + row];
+        output[i * 4 + 3] = w;
+    }
+}
+
+#ifdef FU_SSE2
+inline void add4(const float *a, const float *b, float *result) {
+    _mm_store_ps(result, _mm_add_ps(_mm_load_ps(a), _mm_load_ps(b)));
+}
+
+inline void subtract4(const float *a, const float *b, float *result) {
+    _mm_store_ps(result, _mm_sub_ps(_mm_load_ps(a), _mm_load_ps(b)));
+}
+
+inline void multiply4(const float *a, const float *b, float *result) {
+    _mm_store_ps(result, _mm_mul_ps(_mm_load_ps(a), _mm_load_ps(b)));
+}
+
+inline void scale4(const float *a, float scale, float *result) {
+    _mm_store_ps(result, _mm_mul_ps(_mm_load_ps(a), _mm_set1_ps(scale)));
+}
+
+inline float dot4(const float *a, const float *b) {
+    __m128 product = _mm_mul_ps(_mm_load_ps(a), _mm_load_ps(b));
+    product = _mm_add_ps(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1)));
+    product = _mm_add_ps(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(product);
+}
+
+inline __m128 transform4(const __m128 *columns, __m128 vector) {
+    const __m128 x = _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(0, 0, 0, 0));
+    const __m128 y = _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(1, 1, 1, 1));
+    const __m128 z = _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(2, 2, 2, 2));
+    const __m128 w = _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(columns[0], x), _mm_mul_ps(columns[1], y)),
+                      _mm_add_ps(_mm_mul_ps(columns[2], z), _mm_mul_ps(columns[3], w)));
+}
+
+inline void transform4(const float *matrix, const float *vector, float *result) {
+    const __m128 columns[4] = {_mm_load_ps(matrix), _mm_load_ps(matrix + 4), _mm_load_ps(matrix + 8), _mm_load_ps(matrix + 12)};
+    _mm_store_ps(result, transform4(columns, _mm_load_ps(vector)));
+}
+
+inline void quaternionMultiply(const float *a, const float *b, float *result) {
+    const __m128 left = _mm_load_ps(a);
+    const __m128 right = _mm_load_ps(b);
+    //Signs of the x, y and z terms, in the order of the lanes
+    const __m128 xSigns = _mm_set_ps(-0.f, 0.f, -0.f, 0.f);
+    const __m128 ySigns = _mm_set_ps(-0.f, -0.f, 0.f, 0.f);
+    const __m128 zSigns = _mm_set_ps(-0.f, 0.f, 0.f, -0.f);
+    const __m128 w = _mm_mul_ps(_mm_shuffle_ps(left, left, _MM_SHUFFLE(3, 3, 3, 3)), right);
+    const __m128 x = _mm_mul_ps(_mm_shuffle_ps(left, left, _MM_SHUFFLE(0, 0, 0, 0)),
+                                _mm_xor_ps(_mm_shuffle_ps(right, right, _MM_SHUFFLE(0, 1, 2, 3)), xSigns));
+    const __m128 y = _mm_mul_ps(_mm_shuffle_ps(left, left, _MM_SHUFFLE(1, 1, 1, 1)),
+                                _mm_xor_ps(_mm_shuffle_ps(right, right, _MM_SHUFFLE(1, 0, 3, 2)), ySigns));
+    const __m128 z = _mm_mul_ps(_mm_shuffle_ps(left, left, _MM_SHUFFLE(2, 2, 2, 2)),
+                                _mm_xor_ps(_mm_shuffle_ps(right, right, _MM_SHUFFLE(2, 3, 0, 1)), zSigns));
+    _mm_store_ps(result, _mm_add_ps(_mm_add_ps(w, x), _mm_add_ps(y, z)));
+}
+
+inline void transformPoints(const float *matrix, const float *points, float *output, size_t count) {
+    const __m128 columns[4] = {_mm_load_ps(matrix), _mm_load_ps(matrix + 4), _mm_load_ps(matrix + 8), _mm_load_ps(matrix + 12)};
+    const __m128 one = _mm_set_ps(1.f, 0.f, 0.f, 0.f);
+    const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    for (size_t i = 0; i < count; i++) {
+        const __m128 point = _mm_loadu_ps(points + i * 4);
+        const __m128 transformed = transform4(columns, _mm_or_ps(_mm_and_ps(point, xyzMask), one));
+        _mm_storeu_ps(output + i * 4, _mm_or_ps(_mm_and_ps(xyzMask, transformed), _mm_andnot_ps(xyzMask, point)));
+    }
+}
+#endif
+}
+
+template<class T>
+class alignas(16) FUVector3
+{
+public:
+    union {
+        //First element of vector, alias for X-coordinate.
+        T x;
+
+        //First element of vector, alias for R-coordinate. For color notation.
+        T r;
+    };
+
+    union {
+        //Second element of vector, alias for Y-coordinate.
+        T y;
+
+        //Second element of vector, alias for G-coordinate. For color notation.
+        T g;
+    };
+
+    union {
+        //Third element of vector, alias for Z-coordinate.
+        T z;
+
+        //Third element of vector, alias for B-coordinate. For color notation.
+        T b;
+    };
+
+    //----------------[ Constructors ]----------------//
+
+    //Creates and sets to (0,0,0)
+    constexpr FUVector3()
+        : x(0), y(0), z(0)
+    {
+    }
+    constexpr FUVector3(T nx, T ny, T nz)
+        : x(nx), y(ny), z(nz)
+    {
+    }
+    /**
+     * @brief Copy casting constructor.
+     * @param src Source of data for new created instance.
+     */
+    template<class FromT>
+    constexpr FUVector3(const FUVector3<FromT>& src)
+        : x(static_cast<T>(src.x)), y(static_cast<T>(src.y)), z(static_cast<T>(src.z))
+    {
+    }
+
+    //----------------[ Access Operators ]----------------//
+    T& operator[](int n) {
+        assert(n >= 0 && n <= 2);
+        return (&x)[n];
+    }
+
+    const T& operator[](int n) const {
+        assert(n >= 0 && n <= 2);
+        return (&x)[n];
+    }
+
+    //---------------[ Vector Aritmetic Operator ]---------------//
+    constexpr FUVector3<T> operator+(const FUVector3<T>& rhs) const {
+        return FUVector3<T>(x + rhs.x, y + rhs.y, z + rhs.z);
+    }
+
+    constexpr FUVector3<T> operator-(const FUVector3<T>& rhs) const {
+        return FUVector3<T>(x - rhs.x, y - rhs.y, z - rhs.z);
+    }
+
+    constexpr FUVector3<T> operator*(const FUVector3<T>& rhs) const {
+        return FUVector3<T>(x * rhs.x, y * rhs.y, z * rhs.z);
+    }
+
+    constexpr FUVector3<T> operator/(const FUVector3<T>& rhs) const {
+        return FUVector3<T>(x / rhs.x, y / rhs.y, z / rhs.z);
+    }
+
+    FUVector3<T>& operator+=(const FUVector3<T>& rhs) {
+        x += rhs.x;
+        y += rhs.y;
+        z += rhs.z;
+        return *this;
+    }
+
+    FUVector3<T>& operator-=(const FUVector3<T>& rhs) {
+        x -= rhs.x;
+        y -= rhs.y;
+        z -= rhs.z;
+        return *this;
+    }
+
+    FUVector3<T>& operator*=(const FUVector3<T>& rhs) {
+        x *= rhs.x;
+        y *= rhs.y;
+        z *= rhs.z;
+        return *this;
+    }
+
+    FUVector3<T>& operator/=(const FUVector3<T>& rhs) {
+        x /= rhs.x;
+        y /= rhs.y;
+        z /= rhs.z;
+        return *this;
+    }
+
+    //--------------[ Scalar Vector Operator ]--------------//
+    constexpr FUVector3<T> operator+(T rhs) const {
+        return FUVector3<T>(x + rhs, y + rhs, z + rhs);
+    }
+
+    constexpr FUVector3<T> operator-(T rhs) const {
+        return FUVector3<T>(x - rhs, y - rhs, z - rhs);
+    }
+
+    constexpr FUVector3<T> operator*(T rhs) const {
+        return FUVector3<T>(x * rhs, y * rhs, z * rhs);
+    }
+
+    constexpr FUVector3<T> operator/(T rhs) const {
+        return FUVector3<T>(x / rhs, y / rhs, z / rhs);
+    }
+
+    FUVector3<T>& operator+=(T rhs) {
+        x += rhs;
+        y += rhs;
+        z += rhs;
+        return *this;
+    }
+
+    FUVector3<T>& operator-=(T rhs) {
+        x -= rhs;
+        y -= rhs;
+        z -= rhs;
+        return *this;
+    }
+
+    FUVector3<T>& operator*=(T rhs) {
+        x *= rhs;
+        y *= rhs;
+        z *= rhs;
+        return *this;
+    }
+
+    FUVector3<T>& operator/=(T rhs) {
+        x /= rhs;
+        y /= rhs;
+        z /= rhs;
+        return *this;
+    }
+
+    //--------------[ Equality Operator ]--------------//
+    /**
+     * @brief Equality test operator
+     * @note Test of equality is based of threshold EPSILON value, per component.
+     */
+    bool operator==(const FUVector3<T>& rhs) const {
+        return std::abs(x - rhs.x) < EPSILON && std::abs(y - rhs.y) < EPSILON && std::abs(z - rhs.z) < EPSILON;
+    }
+
+    bool operator!=(const FUVector3<T>& rhs) const {
+        return !(*this == rhs);
+    }
+
+    //-------------[ Unary Operations ]-------------//
+    constexpr FUVector3<T> operator-() const {
+        return FUVector3<T>(-x, -y, -z);
+    }
+
+    //-------------[ Vector Operations ]-------------//
+    constexpr T dot(const FUVector3<T>& rhs) const {
+        return x * rhs.x + y * rhs.y + z * rhs.z;
+    }
+
+    constexpr FUVector3<T> cross(const FUVector3<T>& rhs) const {
+        return FUVector3<T>(y * rhs.z - z * rhs.y, z * rhs.x - x * rhs.z, x * rhs.y - y * rhs.x);
+    }
+
+    //-------------[ Size Operations ]-------------//
+    T length() const {
+        return (T) std::sqrt(x * x + y * y + z * z);
+    }
+
+    /**
+     * @brief Return square of length.
+     * @return length ^ 2
+     * @note This method is faster then length(). For comparison of length of two vector can be used just this value, instead
+     * of more expensive length() method.
+     */
+    constexpr T lengthSquare() const {
+        return x * x + y * y + z * z;
+    }
+
+    void normalize() {
+        T s = length();
+        x /= s;
+        y /= s;
+        z /= s;
+    }
+
+    FUVector3<T> normalized() const {
+        return *this / length();
+    }
+
+    //--------------[ Misc. Operations ]--------------//
+    /**
+     * @brief Linear interpolation of two vectors
+     * @param fact --> Factor of interpolation. For translation from position of this vector to vector r, values of factor goes
+     * from 0.0 to 1.0.
+     * @param r --> Second Vector for interpolation
+     */
+    constexpr FUVector3<T> linearInterpolation(T fact, const FUVector3<T>& r) const {
+        return (*this) + (r - (*this)) * fact;
+    }
+
+    //-------------[ Conversion ]-------------//
+    operator T*() {
+        return (T*) this;
+    }
+
+    operator const T*() const {
+        return (const T*) this;
+    }
+
+    //-------------[ Output Operator ]-------------//
+    friend std::ostream& operator<<(std::ostream& lhs, const FUVector3<T>& rhs) {
+        lhs << "[" << rhs.x << "," << rhs.y << "," << rhs.z << "]";
+        return lhs;
+    }
+
+    std::string toString() const {
+        std::ostringstream oss;
+        oss << *this;
+        return oss.str();
+    }
+};
+
+/**
+ * @brief A 4 component vector. The arithmetic operators of FUVector4<float> use SSE.
+ */
+template<class T>
+class alignas(16) FUVector4
+{
+public:
+    union {
+        //First element of vector, alias for X-coordinate.
+        T x;
+
+        //First element of vector, alias for R-coordinate. For color notation.
+        T r;
+    };
+
+    union {
+        //Second element of vector, alias for Y-coordinate.
+        T y;
+
+        //Second element of vector, alias for G-coordinate. For color notation.
+        T g;
+    };
+
+    union {
+        //Third element of vector, alias for Z-coordinate.
+        T z;
+
+        //Third element of vector, alias for B-coordinate. For color notation.
+        T b;
+    };
+
+    union {
+        //Fourth element of vector, alias for W-coordinate.
+        T w;
+
+        //Fourth element of vector, alias for A-coordinate. For color notation.
+        T a;
+    };
+
+    //----------------[ Constructors ]----------------//
+
+    //Creates and sets to (0,0,0,0)
+    constexpr FUVector4()
+        : x(0), y(0), z(0), w(0)
+    {
+    }
+    constexpr FUVector4(T nx, T ny, T nz, T nw)
+        : x(nx), y(ny), z(nz), w(nw)
+    {
+    }
+    constexpr FUVector4(const FUVector3<T>& v, T nw)
+        : x(v.x), y(v.y), z(v.z), w(nw)
+    {
+    }
+    template<class FromT>
+    constexpr FUVector4(const FUVector4<FromT>& src)
+        : x(static_cast<T>(src.x)), y(static_cast<T>(src.y)), z(static_cast<T>(src.z)), w(static_cast<T>(src.w))
+    {
+    }
+
+    //----------------[ Access Operators ]----------------//
+    T& operator[](int n) {
+        assert(n >= 0 && n <= 3);
+        return (&x)[n];
+    }
+
+    const T& operator[](int n) const {
+        assert(n >= 0 && n <= 3);
+        return (&x)[n];
+    }
+
+    /**
+     * @brief Returns the first three components.
+     * @return
+     */
+    constexpr FUVector3<T> xyz() const {
+        return FUVector3<T>(x, y, z);
+    }
+
+    //---------------[ Vector Aritmetic Operator ]---------------//
+    FUVector4<T> operator+(const FUVector4<T>& rhs) const {
+        FUVector4<T> result;
+        Simd::add4(&x, &rhs.x, &result.x);
+        return result;
+    }
+
+    FUVector4<T> operator-(const FUVector4<T>& rhs) const {
+        FUVector4<T> result;
+        Simd::subtract4(&x, &rhs.x, &result.x);
+        return result;
+    }
+
+    FUVector4<T> operator*(const FUVector4<T>& rhs) const {
+        FUVector4<T> result;
+        Simd::multiply4(&x, &rhs.x, &result.x);
+        return result;
+    }
+
+    FUVector4<T> operator/(const FUVector4<T>& rhs) const {
+        return FUVector4<T>(x / rhs.x, y / rhs.y, z / rhs.z, w / rhs.w);
+    }
+
+    FUVector4<T>& operator+=(const FUVector4<T>& rhs) {
+        Simd::add4(&x, &rhs.x, &x);
+        return *this;
+    }
+
+    FUVector4<T>& operator-=(const FUVector4<T>& rhs) {
+        Simd::subtract4(&x, &rhs.x, &x);
+        return *this;
+    }
+
+    FUVector4<T>& operator*=(const FUVector4<T>& rhs) {
+        Simd::multiply4(&x, &rhs.x, &x);
+        return *this;
+    }
+
+    //--------------[ Scalar Vector Operator ]--------------//
+    FUVector4<T> operator*(T rhs) const {
+        FUVector4<T> result;
+        Simd::scale4(&x, rhs, &result.x);
+        return result;
+    }
+
+    FUVector4<T> operator/(T rhs) const {
+        return *this * (static_cast<T>(1) / rhs);
+    }
+
+    FUVector4<T>& operator*=(T rhs) {
+        Simd::scale4(&x, rhs, &x);
+        return *this;
+    }
+
+    FUVector4<T>& operator/=(T rhs) {
+        Simd::scale4(&x, static_cast<T>(1) / rhs, &x);
+        return *this;
+    }
+
+    //--------------[ Equality Operator ]--------------//
+    bool operator==(const FUVector4<T>& rhs) const {
+        return std::abs(x - rhs.x) < EPSILON && std::abs(y - rhs.y) < EPSILON && std::abs(z - rhs.z) < EPSILON
+                && std::abs(w - rhs.w) < EPSILON;
+    }
+
+    bool operator!=(const FUVector4<T>& rhs) const {
+        return !(*this == rhs);
+    }
+
+    //-------------[ Unary Operations ]-------------//
+    constexpr FUVector4<T> operator-() const {
+        return FUVector4<T>(-x, -y, -z, -w);
+    }
+
+    //-------------[ Vector Operations ]-------------//
+    T dot(const FUVector4<T>& rhs) const {
+        return Simd::dot4(&x, &rhs.x);
+    }
+
+    //-------------[ Size Operations ]-------------//
+    T length() const {
+        return (T) std::sqrt(lengthSquare());
+    }
+
+    T lengthSquare() const {
+        return Simd::dot4(&x, &x);
+    }
+
+    void normalize() {
+        *this /= length();
+    }
+
+    //--------------[ Misc. Operations ]--------------//
+    FUVector4<T> linearInterpolation(T fact, const FUVector4<T>& r) const {
+        return (*this) + (r - (*this)) * fact;
+    }
+
+    //-------------[ Conversion ]-------------//
+    operator T*() {
+        return (T*) this;
+    }
+
+    operator const T*() const {
+        return (const T*) this;
+    }
+
+    //-------------[ Output Operator ]-------------//
+    friend std::ostream& operator<<(std::ostream& lhs, const FUVector4<T>& rhs) {
+        lhs << "[" << rhs.x << "," << rhs.y << "," << rhs.z << "," << rhs.w << "]";
+        return lhs;
+    }
+
+    std::string toString() const {
+        std::ostringstream oss;
+        oss << *this;
+        return oss.str();
+    }
+};
+
+template<class T>
+class FUMatrix4;
+
+/**
+ * @brief A rotation quaternion stored as (x, y, z, w), w being the scalar part. Multiplication of FUQuaternion<float> uses SSE.
+ */
+template<class T>
+class alignas(16) FUQuaternion
+{
+public:
+    T x;
+    T y;
+    T z;
+    T w;
+
+    //----------------[ Constructors ]----------------//
+
+    //Creates the identity rotation
+    constexpr FUQuaternion()
+        : x(0), y(0), z(0), w(1)
+    {
+    }
+    constexpr FUQuaternion(T nx, T ny, T nz, T nw)
+        : x(nx), y(ny), z(nz), w(nw)
+    {
+    }
+    template<class FromT>
+    constexpr FUQuaternion(const FUQuaternion<FromT>& src)
+        : x(static_cast<T>(src.x)), y(static_cast<T>(src.y)), z(static_cast<T>(src.z)), w(static_cast<T>(src.w))
+    {
+    }
+    /**
+     * @brief Creates a rotation around an axis.
+     * @param axis --> Unit vector
+     * @param angle --> In radians
+     * @return
+     */
+    static FUQuaternion<T> fromAxisAngle(const FUVector3<T>& axis, T angle) {
+        const T s = (T) std::sin(angle / 2);
+        return FUQuaternion<T>(axis.x * s, axis.y * s, axis.z * s, (T) std::cos(angle / 2));
+    }
+
+    //---------------[ Quaternion Operations ]---------------//
+    /**
+     * @brief Combines two rotations, the result rotates by rhs first and then by this.
+     * @param rhs
+     * @return
+     */
+    FUQuaternion<T> operator*(const FUQuaternion<T>& rhs) const {
+        FUQuaternion<T> result;
+        Simd::quaternionMultiply(&x, &rhs.x, &result.x);
+        return result;
+    }
+
+    FUQuaternion<T>& operator*=(const FUQuaternion<T>& rhs) {
+        *this = *this * rhs;
+        return *this;
+    }
+
+    bool operator==(const FUQuaternion<T>& rhs) const {
+        return std::abs(x - rhs.x) < EPSILON && std::abs(y - rhs.y) < EPSILON && std::abs(z - rhs.z) < EPSILON
+                && std::abs(w - rhs.w) < EPSILON;
+    }
+
+    bool operator!=(const FUQuaternion<T>& rhs) const {
+        return !(*this == rhs);
+    }
+
+    /**
+     * @brief Returns the inverse rotation of a unit quaternion.
+     * @return
+     */
+    constexpr FUQuaternion<T> conjugate() const {
+        return FUQuaternion<T>(-x, -y, -z, w);
+    }
+
+    constexpr T dot(const FUQuaternion<T>& rhs) const {
+        return x * rhs.x + y * rhs.y + z * rhs.z + w * rhs.w;
+    }
+
+    constexpr T lengthSquare() const {
+        return dot(*this);
+    }
+
+    T length() const {
+        return (T) std::sqrt(lengthSquare());
+    }
+
+    void normalize() {
+        const T s = length();
+        x /= s;
+        y /= s;
+        z /= s;
+        w /= s;
+    }
+
+    /**
+     * @brief Rotates a vector with a unit quaternion.
+     * @param v
+     * @return
+     */
+    FUVector3<T> rotate(const FUVector3<T>& v) const {
+        const FUVector3<T> u(x, y, z);
+        const FUVector3<T> t = u.cross(v) * static_cast<T>(2);
+        return v + t * w + u.cross(t);
+    }
+
+    /**
+     * @brief Spherical linear interpolation of two unit quaternions along the shorter arc.
+     * @param fact --> 0.0 gives this, 1.0 gives r
+     * @param r
+     * @return
+     */
+    FUQuaternion<T> slerp(T fact, const FUQuaternion<T>& r) const {
+        T cosTheta = dot(r);
+        FUQuaternion<T> target = r;
+        if (cosTheta < 0) {
+            cosTheta = -cosTheta;
+            target = FUQuaternion<T>(-r.x, -r.y, -r.z, -r.w);
+        }
+        T thisFactor = 1 - fact;
+        T targetFactor = fact;
+        //Close rotations are interpolated linearly to avoid the division by a small sine
+        if (cosTheta < static_cast<T>(1) - static_cast<T>(EPSILON)) {
+            const T theta = (T) std::acos(cosTheta);
+            const T sinTheta = (T) std::sin(theta);
+            thisFactor = (T) std::sin((1 - fact) * theta) / sinTheta;
+            targetFactor = (T) std::sin(fact * theta) / sinTheta;
+        }
+        FUQuaternion<T> result(x * thisFactor + target.x * targetFactor, y * thisFactor + target.y * targetFactor,
+                               z * thisFactor + target.z * targetFactor, w * thisFactor + target.w * targetFactor);
+        result.normalize();
+        return result;
+    }
+
+    FUMatrix4<T> toMatrix() const;
+
+    //-------------[ Output Operator ]-------------//
+    friend std::ostream& operator<<(std::ostream& lhs, const FUQuaternion<T>& rhs) {
+        lhs << "[" << rhs.x << "," << rhs.y << "," << rhs.z << "," << rhs.w << "]";
+        return lhs;
+    }
+
+    std::string toString() const {
+        std::ostringstream oss;
+        oss << *this;
+        return oss.str();
+    }
+};
+
+/**
+ * @brief A 4x4 matrix stored in column major order, as in vmath. The products of FUMatrix4<float> use SSE.
+ */
+template<class T>
+class alignas(16) FUMatrix4
+{
+public:
+    T data[16];
+
+    //----------------[ Constructors ]----------------//
+
+    //Creates an identity matrix
+    constexpr FUMatrix4()
+        : data{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}
+    {
+    }
+    /**
+     * @brief Creates a matrix from its columns.
+     */
+    constexpr FUMatrix4(const FUVector4<T>& c0, const FUVector4<T>& c1, const FUVector4<T>& c2, const FUVector4<T>& c3)
+        : data{c0.x, c0.y, c0.z, c0.w, c1.x, c1.y, c1.z, c1.w, c2.x, c2.y, c2.z, c2.w, c3.x, c3.y, c3.z, c3.w}
+    {
+    }
+
+    static constexpr FUMatrix4<T> createTranslation(const FUVector3<T>& translation) {
+        return FUMatrix4<T>(FUVector4<T>(1, 0, 0, 0), FUVector4<T>(0, 1, 0, 0), FUVector4<T>(0, 0, 1, 0), FUVector4<T>(translation, 1));
+    }
+
+    static constexpr FUMatrix4<T> createScale(T sx, T sy, T sz) {
+        return FUMatrix4<T>(FUVector4<T>(sx, 0, 0, 0), FUVector4<T>(0, sy, 0, 0), FUVector4<T>(0, 0, sz, 0), FUVector4<T>(0, 0, 0, 1));
+    }
+
+    /**
+     * @brief Creates a transform that rotates and then translates.
+     * @param rotation --> Unit quaternion
+     * @param translation
+     * @return
+     */
+    static FUMatrix4<T> createRigidTransform(const FUQuaternion<T>& rotation, const FUVector3<T>& translation) {
+        FUMatrix4<T> result = rotation.toMatrix();
+        result.data[12] = translation.x;
+        result.data[13] = translation.y;
+        result.data[14] = translation.z;
+        return result;
+    }
+
+    //----------------[ Access Operators ]----------------//
+    /**
+     * @brief Returns the element at the given column and row.
+     */
+    T& at(int column, int row) {
+        assert(column >= 0 && column < 4 && row >= 0 && row < 4);
+        return data[column * 4 + row];
+    }
+
+    const T& at(int column, int row) const {
+        assert(column >= 0 && column < 4 && row >= 0 && row < 4);
+        return data[column * 4 + row];
+    }
+
+    FUVector4<T> getColumn(int column) const {
+        return FUVector4<T>(data[column * 4], data[column * 4 + 1], data[column * 4 + 2], data[column * 4 + 3]);
+    }
+
+    FUVector3<T> getTranslation() const {
+        return FUVector3<T>(data[12], data[13], data[14]);
+    }
+
+    //---------------[ Matrix Operations ]---------------//
+    FUMatrix4<T> operator*(const FUMatrix4<T>& rhs) const {
+        FUMatrix4<T> result;
+        for (int column = 0; column < 4; column++)
+            Simd::transform4(data, rhs.data + column * 4, result.data + column * 4);
+        return result;
+    }
+
+    FUMatrix4<T>& operator*=(const FUMatrix4<T>& rhs) {
+        *this = *this * rhs;
+        return *this;
+    }
+
+    FUVector4<T> operator*(const FUVector4<T>& rhs) const {
+        FUVector4<T> result;
+        Simd::transform4(data, &rhs.x, &result.x);
+        return result;
+    }
+
+    bool operator==(const FUMatrix4<T>& rhs) const {
+        for (int i = 0; i < 16; i++) {
+            if (std::abs(data[i] - rhs.data[i]) >= EPSILON)
+                return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const FUMatrix4<T>& rhs) const {
+        return !(*this == rhs);
+    }
+
+    /**
+     * @brief Transforms a point, with a w of 1.
+     */
+    FUVector3<T> transformPoint(const FUVector3<T>& point) const {
+        return (*this * FUVector4<T>(point, 1)).xyz();
+    }
+
+    /**
+     * @brief Transforms a direction, with a w of 0.
+     */
+    FUVector3<T> transformDirection(const FUVector3<T>& direction) const {
+        return (*this * FUVector4<T>(direction, 0)).xyz();
+    }
+
+    /**
+     * @brief Transforms an array of points stored as (x, y, z, w) with a w of 1, keeping their w. The points don't need to
+     * be aligned and output can be the same as points. This is how whole skeletons are transformed.
+     * @param points
+     * @param output
+     * @param count --> Number of points
+     */
+    void transformPoints(const T *points, T *output, size_t count) const {
+        Simd::transformPoints(data, points, output, count);
+    }
+
+    FUMatrix4<T> transpose() const {
+        FUMatrix4<T> result;
+        for (int column = 0; column < 4; column++) {
+            for (int row = 0; row < 4; row++)
+                result.data[row * 4 + column] = data[column * 4 + row];
+        }
+        return result;
+    }
+
+    /**
+     * @brief Inverse of a rotation and translation, much cheaper than inverse().
+     * @return
+     */
+    FUMatrix4<T> inverseRigid() const {
+        FUMatrix4<T> result;
+        for (int column = 0; column < 3; column++) {
+            for (int row = 0; row < 3; row++)
+                result.data[column * 4 + row] = data[row * 4 + column];
+        }
+        const FUVector3<T> translation = result.transformDirection(getTranslation());
+        result.data[12] = -translation.x;
+        result.data[13] = -translation.y;
+        result.data[14] = -translation.z;
+        return result;
+    }
+
+    /**
+     * @brief General inverse with cofactors.
+     * @return The identity if the matrix isn't invertible
+     */
+    FUMatrix4<T> inverse() const {
+        const T *m = data;
+        T inv[16];
+        inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+        inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+        inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+        inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+        inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+        inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+        inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+        inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+        inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+        inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+        inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+        inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+        inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+        inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+        inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+        inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+        const T determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+        FUMatrix4<T> result;
+        if (std::abs(determinant) < EPSILON)
+            return result;
+        for (int i = 0; i < 16; i++)
+            result.data[i] = inv[i] / determinant;
+        return result;
+    }
+
+    //-------------[ Conversion ]-------------//
+    operator T*() {
+        return (T*) data;
+    }
+
+    operator const T*() const {
+        return (const T*) data;
+    }
+
+    //-------------[ Output Operator ]-------------//
+    friend std::ostream& operator<<(std::ostream& lhs, const FUMatrix4<T>& rhs) {
+        for (int row = 0; row < 4; row++) {
+            lhs << "|";
+            for (int column = 0; column < 4; column++)
+                lhs << (column > 0 ? "," : "") << rhs.data[column * 4 + row];
+            lhs << "|" << std::endl;
+        }
+        return lhs;
+    }
+
+    std::string toString() const {
+        std::ostringstream oss;
+        oss << *this;
+        return oss.str();
+    }
+};
+
+template<class T>
+FUMatrix4<T> FUQuaternion<T>::toMatrix() const {
+    const T xx = x * x, yy = y * y, zz = z * z;
+    const T xy = x * y, xz = x * z, yz = y * z;
+    const T wx = w * x, wy = w * y, wz = w * z;
+    return FUMatrix4<T>(FUVector4<T>(1 - 2 * (yy + zz), 2 * (xy + wz), 2 * (xz - wy), 0),
+                        FUVector4<T>(2 * (xy - wz), 1 - 2 * (xx + zz), 2 * (yz + wx), 0),
+                        FUVector4<T>(2 * (xz + wy), 2 * (yz - wx), 1 - 2 * (xx + yy), 0),
+                        FUVector4<T>(0, 0, 0, 1));
+}
 }
@@ -0,0 +1,454 @@
+#include "FUMathBatch.h"
+//STL Includes
+#include <cmath>
+//Local Includes
+#include "FUSimd.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace FUMath {
+namespace Batch {
+namespace {
+struct Kernels {
+    void (*transform)(const float *matrix, const FUConstVector3Span &points, const FUVector3Span &output);
+    void (*distance)(const FUConstVector3Span &a, const FUConstVector3Span &b, float *output);
+    void (*dot)(const FUConstVector3Span &a, const FUConstVector3Span &b, float *output);
+    void (*length)(const FUConstVector3Span &points, float *output);
+    void (*normalize)(const FUConstVector3Span &points, const FUVector3Span &output);
+    void (*lerp)(const FUConstVector3Span &a, const FUConstVector3Span &b, float fact, const FUVector3Span &output);
+    void (*planeDistance)(const float *plane, const FUConstVector3Span &points, float *output);
+};
+
+//----------------[ Scalar ]----------------//
+//The scalar kernels also finish the elements that are left over by the vectorized ones, starting from begin.
+
+void transformScalar(const float *m, const FUConstVector3Span &points, const FUVector3Span &output, size_t begin)
+{
+    for (size_t i = begin; i < points.count; i++) {
+        const float x = points.x[i];
+        const float y = points.y[i];
+        const float z = points.z[i];
+        //Summed in the same order as the vectorized kernels, so that all of them give the same results
+        output.x[i] = (m[0] * x + m[4] * y) + (m[8] * z + m[12]);
+        output.y[i] = (m[1] * x + m[5] * y) + (m[9] * z + m[13]);
+        output.z[i] = (m[2] * x + m[6] * y) + (m[10] * z + m[14]);
+    }
+}
+
+void distanceScalar(const FUConstVector3Span &a, const FUConstVector3Span &b, float *output, size_t begin)
+{
+    for (size_t i = begin; i < a.count; i++) {
+        const float dx = a.x[i] - b.x[i];
+        const float dy = a.y[i] - b.y[i];
+        const float dz = a.z[i] - b.z[i];
+        output[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+}
+
+void dotScalar(const FUConstVector3Span &a, const FUConstVector3Span &b, float *output, size_t begin)
+{
+    for (size_t i = begin; i < a.count; i++)
+        output[i] = a.x[i] * b.x[i] + a.y[i] * b.y[i] + a.z[i] * b.z[i];
+}
+
+void lengthScalar(const FUConstVector3Span &points, float *output, size_t begin)
+{
+    for (size_t i = begin; i < points.count; i++)
+        output[i] = std::sqrt(points.x[i] * points.x[i] + points.y[i] * points.y[i] + points.z[i] * points.z[i]);
+}
+
+void normalizeScalar(const FUConstVector3Span &points, const FUVector3Span &output, size_t begin)
+{
+    for (size_t i = begin; i < points.count; i++) {
+        const float x = points.x[i];
+        const float y = points.y[i];
+        const float z = points.z[i];
+        const float length = std::sqrt(x * x + y * y + z * z);
+        const float scale = length > 0.f ? 1.f / length : 0.f;
+        output.x[i] = x * scale;
+        output.y[i] = y * scale;
+        output.z[i] = z * scale;
+    }
+}
+
+void lerpScalar(const FUConstVector3Span &a, const FUConstVector3Span &b, float fact, const FUVector3Span &output, size_t begin)
+{
+    for (size_t i = begin; i < a.count; i++) {
+        output.x[i] = a.x[i] + (b.x[i] - a.x[i]) * fact;
+        output.y[i] = a.y[i] + (b.y[i] - a.y[i]) * fact;
+        output.z[i] = a.z[i] + (b.z[i] - a.z[i]) * fact;
+    }
+}
+
+void planeDistanceScalar(const float *plane, const FUConstVector3Span &points, float *output, size_t begin)
+{
+    for (size_t i = begin; i < points.count; i++)
+        output[i] = plane[0] * points.x[i] + plane[1] * points.y[i] + plane[2] * points.z[i] + plane[3];
+}
+
+const Kernels SCALAR_KERNELS = {
+    [](const float *m, const FUConstVector3Span &points, const FUVector3Span &output) {transformScalar(m, points, output, 0);},
+    [](const FUConstVector3Span &a, const FUConstVector3Span &b, float *output) {distanceScalar(a, b, output, 0);},
+    [](const FUConstVector3Span &a, const FUConstVector3Span &b, float *output) {dotScalar(a, b, output, 0);},
+    [](const FUConstVector3Span &points, float *output) {lengthScalar(points, output, 0);},
+    [](const FUConstVector3Span &points, const FUVector3Span &output) {normalizeScalar(points, output, 0);},
+    [](const FUConstVector3Span &a, const FUConstVector3Span &b, float fact, const FUVector3Span &output) {lerpScalar(a, b, fact, output, 0);},
+    [](const float *plane, const FUConstVector3Span &points, float *output) {planeDistanceScalar(plane, points, output, 0);}
+};
+
+#ifdef FU_SSE2
+//----------------[ SSE2 ]----------------//
+
+void transformSSE2(const float *m, const FUConstVector3Span &points, const FUVector3Span &output)
+{
+    __m128 matrix[12];
+    for (int i = 0; i < 12; i++)
+        matrix[i] = _mm_set1_ps(m[i < 3 ? i : i < 6 ? i + 1 : i < 9 ? i + 2 : i + 3]);
+    size_t i = 0;
+    for (; i + 4 <= points.count; i += 4) {
+        const __m128 x = _mm_loadu_ps(points.x + i);
+        const __m128 y = _mm_loadu_ps(points.y + i);
+        const __m128 z = _mm_loadu_ps(points.z + i);
+        //matrix[] holds the first three rows of the columns, matrix[9 + row] is the translation
+        const __m128 nx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(matrix[0], x), _mm_mul_ps(matrix[3], y)), _mm_add_ps(_mm_mul_ps(matrix[6], z), matrix[9]));
+        const __m128 ny = _mm_add_ps(_mm_add_ps(_mm_mul_ps(matrix[1], x), _mm_mul_ps(matrix[4], y)), _mm_add_ps(_mm_mul_ps(matrix[7], z), matrix[10]));
+        const __m128 nz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(matrix[2], x), _mm_mul_ps(matrix[5], y)), _mm_add_ps(_mm_mul_ps(matrix[8], z), matrix[11]));
+        _mm_storeu_ps(output.x + i, nx);
+        _mm_storeu_ps(output.y + i, ny);
+        _mm_storeu_ps(output.z + i, nz);
+    }
+    transformScalar(m, points, output, i);
+}
+
+void distanceSSE2(const FUConstVector3Span &a, const FUConstVector3Span &b, float *output)
+{
+    size_t i = 0;
+    for (; i + 4 <= a.count; i += 4) {
+        const __m128 dx = _mm_sub_ps(_mm_loadu_ps(a.x + i), _mm_loadu_ps(b.x + i));
+        const __m128 dy = _mm_sub_ps(_mm_loadu_ps(a.y + i), _mm_loadu_ps(b.y + i));
+        const __m128 dz = _mm_sub_ps(_mm_loadu_ps(a.z + i), _mm_loadu_ps(b.z + i));
+        const __m128 square = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        _mm_storeu_ps(output + i, _mm_sqrt_ps(square));
+    }
+    distanceScalar(a, b, output, i);
+}
+
+void dotSSE2(const FUConstVector3Span &a, const FUConstVector3Span &b, float *output)
+{
+    size_t i = 0;
+    for (; i + 4 <= a.count; i += 4) {
+        const __m128 x = _mm_mul_ps(_mm_loadu_ps(a.x + i), _mm_loadu_ps(b.x + i));
+        const __m128 y = _mm_mul_ps(_mm_loadu_ps(a.y + i), _mm_loadu_ps(b.y + i));
+        const __m128 z = _mm_mul_ps(_mm_loadu_ps(a.z + i), _mm_loadu_ps(b.z + i));
+        _mm_storeu_ps(output + i, _mm_add_ps(_mm_add_ps(x, y), z));
+    }
+    dotScalar(a, b, output, i);
+}
+
+void lengthSSE2(const FUConstVector3Span &points, float *output)
+{
+    size_t i = 0;
+    for (; i + 4 <= points.count; i += 4) {
+        const __m128 x = _mm_loadu_ps(points.x + i);
+        const __m128 y = _mm_loadu_ps(points.y + i);
+        const __m128 z = _mm_loadu_ps(points.z + i);
+        const __m128 square = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        _mm_storeu_ps(output + i, _mm_sqrt_ps(square));
+    }
+    lengthScalar(points, output, i);
+}
+
+void normalizeSSE2(const FUConstVector3Span &points, const FUVector3Span &output)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    size_t i = 0;
+    for (; i + 4 <= points.count; i += 4) {
+        const __m128 x = _mm_loadu_ps(points.x + i);
+        const __m128 y = _mm_loadu_ps(points.y + i);
+        const __m128 z = _mm_loadu_ps(points.z + i);
+        const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+        //The division by a zero length is masked out
+        const __m128 scale = _mm_and_ps(_mm_cmpgt_ps(length, zero), _mm_div_ps(one, length));
+        _mm_storeu_ps(output.x + i, _mm_mul_ps(x, scale));
+        _mm_storeu_ps(output.y + i, _mm_mul_ps(y, scale));
+        _mm_storeu_ps(output.z + i, _mm_mul_ps(z, scale));
+    }
+    normalizeScalar(points, output, i);
+}
+
+void lerpSSE2(const FUConstVector3Span &a, const FUConstVector3Span &b, float fact, const FUVector3Span &output)
+{
+    const __m128 factor = _mm_set1_ps(fact);
+    size_t i = 0;
+    for (; i + 4 <= a.count; i += 4) {
+        const __m128 ax = _mm_loadu_ps(a.x + i);
+        const __m128 ay = _mm_loadu_ps(a.y + i);
+        const __m128 az = _mm_loadu_ps(a.z + i);
+        _mm_storeu_ps(output.x + i, _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b.x + i), ax), factor)));
+        _mm_storeu_ps(output.y + i, _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b.y + i), ay), factor)));
+        _mm_storeu_ps(output.z + i, _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b.z + i), az), factor)));
+    }
+    lerpScalar(a, b, fact, output, i);
+}
+
+void planeDistanceSSE2(const float *plane, const FUConstVector3Span &points, float *output)
+{
+    const __m128 a = _mm_set1_ps(plane[0]);
+    const __m128 b = _mm_set1_ps(plane[1]);
+    const __m128 c = _mm_set1_ps(plane[2]);
+    const __m128 w = _mm_set1_ps(plane[3]);
+    size_t i = 0;
+    for (; i + 4 <= points.count; i += 4) {
+        const __m128 xy = _mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(points.x + i)), _mm_mul_ps(b, _mm_loadu_ps(points.y + i)));
+        _mm_storeu_ps(output + i, _mm_add_ps(_mm_add_ps(xy, _mm_mul_ps(c, _mm_loadu_ps(points.z + i))), w));
+    }
+    planeDistanceScalar(plane, points, output, i);
+}
+
+const Kernels SSE2_KERNELS = {
+    transformSSE2,
+    distanceSSE2,
+    dotSSE2,
+    lengthSSE2,
+    normalizeSSE2,
+    lerpSSE2,
+    planeDistanceSSE2
+};
+#endif
+
+#ifdef FU_AVX2
+//----------------[ AVX2 ]----------------//
+//The AVX2 kernels don't use FMA, so they give the same results as the others.
+
+FU_TARGET_AVX2 void transformAVX2(const float *m, const FUConstVector3Span &points, const FUVector3Span &output)
+{
+    __m256 matrix[12];
+    for (int i = 0; i < 12; i++)
+        matrix[i] = _mm256_set1_ps(m[i < 3 ? i : i < 6 ? i + 1 : i < 9 ? i + 2 : i + 3]);
+    size_t i = 0;
+    for (; i + 8 <= points.count; i += 8) {
+        const __m256 x = _mm256_loadu_ps(points.x + i);
+        const __m256 y = _mm256_loadu_ps(points.y + i);
+        const __m256 z = _mm256_loadu_ps(points.z + i);
+        const __m256 nx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(matrix[0], x), _mm256_mul_ps(matrix[3], y)), _mm256_add_ps(_mm256_mul_ps(matrix[6], z), matrix[9]));
+        const __m256 ny = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(matrix[1], x), _mm256_mul_ps(matrix[4], y)), _mm256_add_ps(_mm256_mul_ps(matrix[7], z), matrix[10]));
+        const __m256 nz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(matrix[2], x), _mm256_mul_ps(matrix[5], y)), _mm256_add_ps(_mm256_mul_ps(matrix[8], z), matrix[11]));
+        _mm256_storeu_ps(output.x + i, nx);
+        _mm256_storeu_ps(output.y + i, ny);
+        _mm256_storeu_ps(output.z + i, nz);
+    }
+    transformScalar(m, points, output, i);
+}
+
+FU_TARGET_AVX2 void distanceAVX2(const FUConstVector3Span &a, const FUConstVector3Span &b, float *output)
+{
+    size_t i = 0;
+    for (; i + 8 <= a.count; i += 8) {
+        const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(a.x + i), _mm256_loadu_ps(b.x + i));
+        const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(a.y + i), _mm256_loadu_ps(b.y + i));
+        const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(a.z + i), _mm256_loadu_ps(b.z + i));
+        const __m256 square = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        _mm256_storeu_ps(output + i, _mm256_sqrt_ps(square));
+    }
+    distanceScalar(a, b, output, i);
+}
+
+FU_TARGET_AVX2 void dotAVX2(const FUConstVector3Span &a, const FUConstVector3Span &b, float *output)
+{
+    size_t i = 0;
+    for (; i + 8 <= a.count; i += 8) {
+        const __m256 x = _mm256_mul_ps(_mm256_loadu_ps(a.x + i), _mm256_loadu_ps(b.x + i));
+        const __m256 y = _mm256_mul_ps(_mm256_loadu_ps(a.y + i), _mm256_loadu_ps(b.y + i));
+        const __m256 z = _mm256_mul_ps(_mm256_loadu_ps(a.z + i), _mm256_loadu_ps(b.z + i));
+        _mm256_storeu_ps(output + i, _mm256_add_ps(_mm256_add_ps(x, y), z));
+    }
+    dotScalar(a, b, output, i);
+}
+
+FU_TARGET_AVX2 void lengthAVX2(const FUConstVector3Span &points, float *output)
+{
+    size_t i = 0;
+    for (; i + 8 <= points.count; i += 8) {
+        const __m256 x = _mm256_loadu_ps(points.x + i);
+        const __m256 y = _mm256_loadu_ps(points.y + i);
+        const __m256 z = _mm256_loadu_ps(points.z + i);
+        const __m256 square = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+        _mm256_storeu_ps(output + i, _mm256_sqrt_ps(square));
+    }
+    lengthScalar(points, output, i);
+}
+
+FU_TARGET_AVX2 void normalizeAVX2(const FUConstVector3Span &points, const FUVector3Span &output)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.f);
+    size_t i = 0;
+    for (; i + 8 <= points.count; i += 8) {
+        const __m256 x = _mm256_loadu_ps(points.x + i);
+        const __m256 y = _mm256_loadu_ps(points.y + i);
+        const __m256 z = _mm256_loadu_ps(points.z + i);
+        const __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)));
+        const __m256 scale = _mm256_and_ps(_mm256_cmp_ps(length, zero, _CMP_GT_OQ), _mm256_div_ps(one, length));
+        _mm256_storeu_ps(output.x + i, _mm256_mul_ps(x, scale));
+        _mm256_storeu_ps(output.y + i, _mm256_mul_ps(y, scale));
+        _mm256_storeu_ps(output.z + i, _mm256_mul_ps(z, scale));
+    }
+    normalizeScalar(points, output, i);
+}
+
+FU_TARGET_AVX2 void lerpAVX2(const FUConstVector3Span &a, const FUConstVector3Span &b, float fact, const FUVector3Span &output)
+{
+    const __m256 factor = _mm256_set1_ps(fact);
+    size_t i = 0;
+    for (; i + 8 <= a.count; i += 8) {
+        const __m256 ax = _mm256_loadu_ps(a.x + i);
+        const __m256 ay = _mm256_loadu_ps(a.y + i);
+        const __m256 az = _mm256_loadu_ps(a.z + i);
+        _mm256_storeu_ps(output.x + i, _mm256_add_ps(ax, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(b.x + i), ax), factor)));
+        _mm256_storeu_ps(output.y + i, _mm256_add_ps(ay, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(b.y + i), ay), factor)));
+        _mm256_storeu_ps(output.z + i, _mm256_add_ps(az, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(b.z + i), az), factor)));
+    }
+    lerpScalar(a, b, fact, output, i);
+}
+
+FU_TARGET_AVX2 void planeDistanceAVX2(const float *plane, const FUConstVector3Span &points, float *output)
+{
+    const __m256 a = _mm256_set1_ps(plane[0]);
+    const __m256 b = _mm256_set1_ps(plane[1]);
+    const __m256 c = _mm256_set1_ps(plane[2]);
+    const __m256 w = _mm256_set1_ps(plane[3]);
+    size_t i = 0;
+    for (; i + 8 <= points.count; i += 8) {
+        const __m256 xy = _mm256_add_ps(_mm256_mul_ps(a, _mm256_loadu_ps(points.x + i)), _mm256_mul_ps(b, _mm256_loadu_ps(points.y + i)));
+        _mm256_storeu_ps(output + i, _mm256_add_ps(_mm256_add_ps(xy, _mm256_mul_ps(c, _mm256_loadu_ps(points.z + i))), w));
+    }
+    planeDistanceScalar(plane, points, output, i);
+}
+
+const Kernels AVX2_KERNELS = {
+    transformAVX2,
+    distanceAVX2,
+    dotAVX2,
+    lengthAVX2,
+    normalizeAVX2,
+    lerpAVX2,
+    planeDistanceAVX2
+};
+
+bool isAVX2Supported()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    //OSXSAVE and AVX, and the OS saves the YMM registers
+    const bool hasAVX = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return hasAVX && (info[1] & (1 << 5));
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+INSTRUCTION_SET detectInstructionSet()
+{
+#ifdef FU_AVX2
+    if (isAVX2Supported())
+        return AVX2;
+#endif
+#ifdef FU_SSE2
+    return SSE2;
+#else
+    return SCALAR;
+#endif
+}
+
+const Kernels& getKernels(INSTRUCTION_SET instructionSet)
+{
+#ifdef FU_AVX2
+    if (instructionSet == AVX2)
+        return AVX2_KERNELS;
+#endif
+#ifdef FU_SSE2
+    if (instructionSet == SSE2)
+        return SSE2_KERNELS;
+#endif
+    return SCALAR_KERNELS;
+}
+
+const INSTRUCTION_SET SUPPORTED_INSTRUCTION_SET = detectInstructionSet();
+INSTRUCTION_SET gInstructionSet = SUPPORTED_INSTRUCTION_SET;
+const Kernels *gKernels = &getKernels(SUPPORTED_INSTRUCTION_SET);
+}
+
+INSTRUCTION_SET getInstructionSet()
+{
+    return gInstructionSet;
+}
+
+INSTRUCTION_SET getSupportedInstructionSet()
+{
+    return SUPPORTED_INSTRUCTION_SET;
+}
+
+INSTRUCTION_SET setInstructionSet(INSTRUCTION_SET instructionSet)
+{
+    gInstructionSet = instructionSet > SUPPORTED_INSTRUCTION_SET ? SUPPORTED_INSTRUCTION_SET : instructionSet;
+    gKernels = &getKernels(gInstructionSet);
+    return gInstructionSet;
+}
+
+const char* getInstructionSetName(INSTRUCTION_SET instructionSet)
+{
+    switch (instructionSet) {
+    case AVX2:
+        return "AVX2";
+    case SSE2:
+        return "SSE2";
+    default:
+        return "Scalar";
+    }
+}
+
+void transform(const FUMatrix4<float> &matrix, const FUConstVector3Span &points, const FUVector3Span &output)
+{
+    gKernels->transform(matrix.data, points, output);
+}
+
+void distance(const FUConstVector3Span &a, const FUConstVector3Span &b, float *output)
+{
+    gKernels->distance(a, b, output);
+}
+
+void dot(const FUConstVector3Span &a, const FUConstVector3Span &b, float *output)
+{
+    gKernels->dot(a, b, output);
+}
+
+void length(const FUConstVector3Span &points, float *output)
+{
+    gKernels->length(points, output);
+}
+
+void normalize(const FUConstVector3Span &points, const FUVector3Span &output)
+{
+    gKernels->normalize(points, output);
+}
+
+void lerp(const FUConstVector3Span &a, const FUConstVector3Span &b, float fact, const FUVector3Span &output)
+{
+    gKernels->lerp(a, b, fact, output);
+}
+
+void planeDistance(const FUVector4<float> &plane, const FUConstVector3Span &points, float *output)
+{
+    gKernels->planeDistance(&plane.x, points, output);
+}
+}
+}
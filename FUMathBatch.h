@@ -0,0 +1,104 @@
+#pragma once
+//STL Includes
+#include <cstddef>
+//Local Includes
+#include "FUMath.h"
+
+/**
+ * Batch versions of the FUMath operations over structure of arrays buffers, for when many joints or points are processed
+ * together. Every function runs on the best instruction set the CPU supports, AVX2, SSE2 or plain C++, which is picked once
+ * at startup. The outputs can be the same buffers as the inputs. The buffers don't need to be aligned.
+ */
+namespace FUMath {
+namespace Batch {
+/**
+ * @brief count points stored as separate x, y and z arrays.
+ */
+struct FUVector3Span {
+    float *x;
+    float *y;
+    float *z;
+    size_t count;
+};
+
+struct FUConstVector3Span {
+    const float *x;
+    const float *y;
+    const float *z;
+    size_t count;
+
+    FUConstVector3Span()
+        : x(nullptr), y(nullptr), z(nullptr), count(0)
+    {
+    }
+    FUConstVector3Span(const float *nx, const float *ny, const float *nz, size_t ncount)
+        : x(nx), y(ny), z(nz), count(ncount)
+    {
+    }
+    FUConstVector3Span(const FUVector3Span &span)
+        : x(span.x), y(span.y), z(span.z), count(span.count)
+    {
+    }
+};
+
+enum INSTRUCTION_SET {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+/**
+ * @brief Returns the instruction set the batch functions use.
+ * @return
+ */
+INSTRUCTION_SET getInstructionSet();
+/**
+ * @brief Returns the best instruction set that is both compiled in and supported by the CPU.
+ * @return
+ */
+INSTRUCTION_SET getSupportedInstructionSet();
+/**
+ * @brief Forces an instruction set, e.g. to compare them in a benchmark. Sets that aren't supported fall back to the best
+ * supported one. Don't call this while a batch function is running on another thread.
+ * @param instructionSet
+ * @return The instruction set that is used from now on
+ */
+INSTRUCTION_SET setInstructionSet(INSTRUCTION_SET instructionSet);
+const char* getInstructionSetName(INSTRUCTION_SET instructionSet);
+
+/**
+ * @brief output[i] = matrix * (points[i], 1)
+ * @param matrix
+ * @param points
+ * @param output --> Has room for points.count points
+ */
+void transform(const FUMatrix4<float> &matrix, const FUConstVector3Span &points, const FUVector3Span &output);
+/**
+ * @brief output[i] = |a[i] - b[i]|
+ */
+void distance(const FUConstVector3Span &a, const FUConstVector3Span &b, float *output);
+/**
+ * @brief output[i] = a[i] . b[i]
+ */
+void dot(const FUConstVector3Span &a, const FUConstVector3Span &b, float *output);
+/**
+ * @brief output[i] = |points[i]|
+ */
+void length(const FUConstVector3Span &points, float *output);
+/**
+ * @brief output[i] = points[i] / |points[i]|, or zero for zero length vectors.
+ */
+void normalize(const FUConstVector3Span &points, const FUVector3Span &output);
+/**
+ * @brief output[i] = a[i] + (b[i] - a[i]) * fact
+ */
+void lerp(const FUConstVector3Span &a, const FUConstVector3Span &b, float fact, const FUVector3Span &output);
+/**
+ * @brief Signed distance of every point to a plane ax + by + cz + w = 0 with a unit normal, e.g. the floor clip plane.
+ * @param plane
+ * @param points
+ * @param output
+ */
+void planeDistance(const FUVector4<float> &plane, const FUConstVector3Span &points, float *output);
+}
+}
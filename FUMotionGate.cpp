@@ -0,0 +1,135 @@
+#include "FUMotionGate.h"
+//STL Includes
+#include <cstdlib>
+//Local Includes
+#include "FUSimd.h"
+#include "FUTrace.h"
+
+//The background moves 1 / 2^BACKGROUND_SHIFT of the way to every new frame
+static const int BACKGROUND_SHIFT = 3;
+
+FUMotionGate::FUMotionGate()
+    : mWidth(0)
+    , mHeight(0)
+    , mState(ACTIVE)
+    , mShouldProcess(true)
+    , mHasBackground(false)
+    , mIdleDelay(90)
+    , mIdleInterval(15)
+    , mDepthDifference(60)
+    , mMinChangedSampleCount(24)
+    , mChangedSampleCount(0)
+    , mStaticFrameCount(0)
+    , mIdleFrameCount(0)
+{
+}
+
+void FUMotionGate::setMotionThreshold(int depthDifference, int sampleCount)
+{
+    mDepthDifference = depthDifference;
+    mMinChangedSampleCount = sampleCount;
+}
+
+bool FUMotionGate::update(const FUDepthFrame &frame, bool isAnyoneTracked)
+{
+    FU_TRACE_SCOPE(FUTrace::DEPTH, "FUMotionGate::update");
+    const int width = frame.width / DECIMATION;
+    const int height = frame.height / DECIMATION;
+    if (width != mWidth || height != mHeight) {
+        mWidth = width;
+        mHeight = height;
+        //Padded to a multiple of 8 samples for the vectorized loop
+        const size_t sampleCount = (width * height + 7) & ~static_cast<size_t>(7);
+        mSamples.assign(sampleCount, 0);
+        mBackground.assign(sampleCount, 0);
+        mHasBackground = false;
+    }
+    decimate(frame);
+    if (!mHasBackground) {
+        mBackground = mSamples;
+        mHasBackground = true;
+        mChangedSampleCount = 0;
+    }
+    else {
+        mChangedSampleCount = compareWithBackground();
+    }
+
+    const bool hasMotion = mChangedSampleCount >= mMinChangedSampleCount;
+    if (hasMotion || isAnyoneTracked) {
+        mState = ACTIVE;
+        mStaticFrameCount = 0;
+    }
+    else if (mState == ACTIVE && ++mStaticFrameCount >= mIdleDelay) {
+        mState = IDLE;
+        mIdleFrameCount = 0;
+    }
+
+    if (mState == ACTIVE)
+        mShouldProcess = true;
+    else
+        mShouldProcess = mIdleInterval > 0 && ++mIdleFrameCount % mIdleInterval == 0;
+    return mShouldProcess;
+}
+
+void FUMotionGate::decimate(const FUDepthFrame &frame)
+{
+    uint16_t *samples = &mSamples[0];
+    for (int y = 0; y < mHeight; y++) {
+        const FUDepthPixel *row = frame.pixels + y * DECIMATION * frame.width;
+        uint16_t *sampleRow = samples + y * mWidth;
+        for (int x = 0; x < mWidth; x++)
+            sampleRow[x] = row[x * DECIMATION].depth;
+    }
+}
+
+int FUMotionGate::compareWithBackground()
+{
+    uint16_t *samples = &mSamples[0];
+    uint16_t *background = &mBackground[0];
+    const int sampleCount = static_cast<int>(mSamples.size());
+    int changedCount = 0;
+    int i = 0;
+#ifdef FU_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i threshold = _mm_set1_epi16(static_cast<short>(mDepthDifference));
+    //Differences are capped so that they stay positive as signed 16 bit values
+    const __m128i cap = _mm_set1_epi16(0x7FFF);
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i changedCounts = zero;
+    for (; i + 8 <= sampleCount; i += 8) {
+        const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        const __m128i reference = _mm_loadu_si128(reinterpret_cast<const __m128i*>(background + i));
+        //|a - b| with saturating unsigned subtractions
+        __m128i difference = _mm_or_si128(_mm_subs_epu16(current, reference), _mm_subs_epu16(reference, current));
+        difference = _mm_subs_epu16(difference, _mm_subs_epu16(difference, cap));
+        //Unknown depth on either side isn't motion
+        const __m128i unknown = _mm_or_si128(_mm_cmpeq_epi16(current, zero), _mm_cmpeq_epi16(reference, zero));
+        const __m128i changed = _mm_andnot_si128(unknown, _mm_cmpgt_epi16(difference, threshold));
+        changedCounts = _mm_add_epi32(changedCounts, _mm_madd_epi16(_mm_and_si128(changed, ones), ones));
+        //background += (current - background) >> shift, or current where the background is unknown
+        const __m128i step = _mm_srai_epi16(_mm_sub_epi16(current, reference), BACKGROUND_SHIFT);
+        __m128i updated = _mm_add_epi16(reference, step);
+        const __m128i referenceUnknown = _mm_cmpeq_epi16(reference, zero);
+        updated = _mm_or_si128(_mm_and_si128(referenceUnknown, current), _mm_andnot_si128(referenceUnknown, updated));
+        const __m128i currentUnknown = _mm_cmpeq_epi16(current, zero);
+        updated = _mm_or_si128(_mm_and_si128(currentUnknown, reference), _mm_andnot_si128(currentUnknown, updated));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(background + i), updated);
+    }
+    int32_t counts[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(counts), changedCounts);
+    changedCount = counts[0] + counts[1] + counts[2] + counts[3];
+#endif
+    for (; i < sampleCount; i++) {
+        const int current = samples[i];
+        const int reference = background[i];
+        if (current == 0)
+            continue;
+        if (reference == 0) {
+            background[i] = static_cast<uint16_t>(current);
+            continue;
+        }
+        changedCount += std::abs(current - reference) > mDepthDifference;
+        background[i] = static_cast<uint16_t>(reference + ((current - reference) >> BACKGROUND_SHIFT));
+    }
+    return changedCount;
+}
@@ -0,0 +1,87 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+#include <vector>
+//Local Includes
+#include "FUDepthFrame.h"
+
+/**
+ * @brief A cheap presence detector that decides when the expensive processing stages can be skipped. It compares a
+ * decimated depth frame with a running background. When the scene stays static and nobody is tracked for a while the gate
+ * goes idle and lets only every Nth frame through. Any motion opens it again on the same frame.
+ */
+class FUMotionGate
+{
+public:
+    enum STATE {
+        ACTIVE,
+        IDLE
+    };
+
+    /**
+     * @brief Only every DECIMATION th pixel in both directions is compared.
+     */
+    static const int DECIMATION = 4;
+
+public:
+    FUMotionGate();
+    /**
+     * @brief Measures the motion in a new depth frame and updates the state.
+     * @param frame
+     * @param isAnyoneTracked --> The gate doesn't go idle while someone is tracked, even if they stand still
+     * @return true if the expensive stages should run for this frame
+     */
+    bool update(const FUDepthFrame &frame, bool isAnyoneTracked);
+    STATE getState() const {return mState;}
+    /**
+     * @brief Returns the result of the last update().
+     * @return
+     */
+    bool shouldProcess() const {return mShouldProcess;}
+    /**
+     * @brief Number of static frames without anyone tracked before the gate goes idle. The default is 90, 3 seconds.
+     * @param frameCount
+     */
+    void setIdleDelay(int frameCount) {mIdleDelay = frameCount;}
+    /**
+     * @brief While idle, every frameCount th frame is let through. 0 doesn't let any frame through. The default is 15.
+     * @param frameCount
+     */
+    void setIdleInterval(int frameCount) {mIdleInterval = frameCount;}
+    /**
+     * @brief A sample has changed when it differs from the background by more than depthDifference millimeters. There is
+     * motion when at least sampleCount samples changed. The defaults are 60 mm and 24 samples.
+     * @param depthDifference
+     * @param sampleCount
+     */
+    void setMotionThreshold(int depthDifference, int sampleCount);
+    /**
+     * @brief Returns the number of changed samples in the last frame.
+     * @return
+     */
+    int getChangedSampleCount() const {return mChangedSampleCount;}
+
+private:
+    int mWidth;
+    int mHeight;
+    std::vector<uint16_t> mSamples;
+    std::vector<uint16_t> mBackground;
+    STATE mState;
+    bool mShouldProcess;
+    bool mHasBackground;
+    int mIdleDelay;
+    int mIdleInterval;
+    int mDepthDifference;
+    int mMinChangedSampleCount;
+    int mChangedSampleCount;
+    int mStaticFrameCount;
+    int mIdleFrameCount;
+
+private:
+    void decimate(const FUDepthFrame &frame);
+    /**
+     * @brief Counts the samples that differ from the background and moves the background towards the samples.
+     * @return Number of changed samples
+     */
+    int compareWithBackground();
+};
@@ -0,0 +1,139 @@
+#include "FUPointCloud.h"
+//Local Includes
+#include "FUSimd.h"
+#include "FUTrace.h"
+
+//The streams are written in big chunks, one point cloud is a few MB
+static const size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+FUPointCloud::FUPointCloud()
+    : mWidth(0)
+    , mHeight(0)
+    , mPointCount(0)
+    , mTimeStamp(0)
+{
+}
+
+void FUPointCloud::resize(int width, int height)
+{
+    mWidth = width;
+    mHeight = height;
+    mRayX.resize(width * height);
+    mRayY.resize(width * height);
+    mPoints.resize(width * height * 3);
+    mPointCount = 0;
+    const float inverseFocalLength = 1.f / getDepthFocalLength(width);
+    for (int v = 0; v < height; v++) {
+        for (int u = 0; u < width; u++) {
+            mRayX[v * width + u] = (u - width / 2.f) * inverseFocalLength;
+            mRayY[v * width + u] = -(v - height / 2.f) * inverseFocalLength;
+        }
+    }
+}
+
+int FUPointCloud::generate(const FUDepthFrame &frame, unsigned int playerFilter)
+{
+    FU_TRACE_SCOPE(FUTrace::DEPTH, "FUPointCloud::generate");
+    if (frame.width != mWidth || frame.height != mHeight)
+        resize(frame.width, frame.height);
+    mTimeStamp = frame.timeStamp;
+    const int pixelCount = mWidth * mHeight;
+    const float *rayX = &mRayX[0];
+    const float *rayY = &mRayY[0];
+    float *points = &mPoints[0];
+    int pointCount = 0;
+    int i = 0;
+#ifdef FU_SSE2
+    const __m128 millimetersToMeters = _mm_set1_ps(0.001f);
+    const __m128 zero = _mm_setzero_ps();
+    float x[4], y[4], z[4];
+    for (; i + 4 <= pixelCount; i += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame.pixels + i));
+        const __m128 depth = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(pixels, 16)), millimetersToMeters);
+        const int hasDepth = _mm_movemask_ps(_mm_cmpgt_ps(depth, zero));
+        if (hasDepth == 0)
+            continue;
+        _mm_storeu_ps(x, _mm_mul_ps(_mm_loadu_ps(rayX + i), depth));
+        _mm_storeu_ps(y, _mm_mul_ps(_mm_loadu_ps(rayY + i), depth));
+        _mm_storeu_ps(z, depth);
+        for (int j = 0; j < 4; j++) {
+            if ((hasDepth & (1 << j)) == 0 || ((playerFilter >> frame.pixels[i + j].playerIndex) & 1) == 0)
+                continue;
+            float *point = points + pointCount * 3;
+            point[0] = x[j];
+            point[1] = y[j];
+            point[2] = z[j];
+            pointCount++;
+        }
+    }
+#endif
+    for (; i < pixelCount; i++) {
+        const FUDepthPixel &pixel = frame.pixels[i];
+        if (pixel.depth == 0 || ((playerFilter >> pixel.playerIndex) & 1) == 0)
+            continue;
+        const float depth = pixel.depth * 0.001f;
+        float *point = points + pointCount * 3;
+        point[0] = rayX[i] * depth;
+        point[1] = rayY[i] * depth;
+        point[2] = depth;
+        pointCount++;
+    }
+    mPointCount = pointCount;
+    return pointCount;
+}
+
+FUPointCloudWriter::FUPointCloudWriter()
+    : mFile(nullptr)
+{
+}
+
+FUPointCloudWriter::~FUPointCloudWriter()
+{
+    close();
+}
+
+bool FUPointCloudWriter::open(const char *filePath)
+{
+    close();
+    mFile = std::fopen(filePath, "wb");
+    if (mFile == nullptr)
+        return false;
+    std::setvbuf(mFile, nullptr, _IOFBF, WRITE_BUFFER_SIZE);
+    return true;
+}
+
+bool FUPointCloudWriter::writeFrame(const FUPointCloud &pointCloud)
+{
+    FU_TRACE_SCOPE(FUTrace::IO, "FUPointCloudWriter::writeFrame");
+    if (mFile == nullptr)
+        return false;
+    const int64_t timeStamp = pointCloud.getTimeStamp();
+    const uint32_t pointCount = static_cast<uint32_t>(pointCloud.getPointCount());
+    if (std::fwrite(&timeStamp, sizeof(timeStamp), 1, mFile) != 1 || std::fwrite(&pointCount, sizeof(pointCount), 1, mFile) != 1)
+        return false;
+    if (pointCount == 0)
+        return true;
+    return std::fwrite(pointCloud.getPoints(), sizeof(float) * 3, pointCount, mFile) == pointCount;
+}
+
+void FUPointCloudWriter::close()
+{
+    if (mFile) {
+        std::fclose(mFile);
+        mFile = nullptr;
+    }
+}
+
+bool FUPointCloudWriter::writePly(const char *filePath, const FUPointCloud &pointCloud)
+{
+    std::FILE *file = std::fopen(filePath, "wb");
+    if (file == nullptr)
+        return false;
+    std::setvbuf(file, nullptr, _IOFBF, WRITE_BUFFER_SIZE);
+    const size_t pointCount = static_cast<size_t>(pointCloud.getPointCount());
+    std::fprintf(file, "ply\nformat binary_little_endian 1.0\nelement vertex %u\n"
+                 "property float x\nproperty float y\nproperty float z\nend_header\n", static_cast<unsigned int>(pointCount));
+    bool succeeded = pointCount == 0 || std::fwrite(pointCloud.getPoints(), sizeof(float) * 3, pointCount, file) == pointCount;
+    succeeded = std::fclose(file) == 0 && succeeded;
+    return succeeded;
+}
@@ -0,0 +1,98 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+//Local Includes
+#include "FUDepthFrame.h"
+
+/**
+ * @brief Converts depth frames to points in skeleton space (meters, y up) using a per pixel ray table that is built once
+ * for the frame size. Every point is the pixel's ray scaled by its depth, so a frame costs a multiply per coordinate.
+ * The output buffer is allocated with the table and reused for every frame.
+ */
+class FUPointCloud
+{
+public:
+    /**
+     * @brief Bit i of a player filter selects the pixels with player index i. Bit 0 is the scene without the players.
+     */
+    enum PLAYER_FILTER {
+        SCENE_ONLY = 1,
+        PLAYERS_ONLY = 0x7E,
+        ALL_PIXELS = 0x7F
+    };
+
+public:
+    FUPointCloud();
+    /**
+     * @brief Builds the ray table with the nominal depth camera intrinsics, the same ones NuiTransformDepthImageToSkeleton uses.
+     * @param width
+     * @param height
+     */
+    void resize(int width, int height);
+    /**
+     * @brief Converts a depth frame. Pixels with unknown depth are skipped, so the point count changes from frame to frame.
+     * @param frame --> Its size must match the size the table was built for. If it doesn't, the table is rebuilt.
+     * @param playerFilter --> A combination of the player bits, see PLAYER_FILTER
+     * @return Number of points
+     */
+    int generate(const FUDepthFrame &frame, unsigned int playerFilter = ALL_PIXELS);
+
+    /**
+     * @brief Returns the points of the last frame as x, y, z triplets.
+     * @return
+     */
+    const float* getPoints() const {return mPoints.empty() ? nullptr : &mPoints[0];}
+    int getPointCount() const {return mPointCount;}
+    int64_t getTimeStamp() const {return mTimeStamp;}
+    /**
+     * @brief The ray of a pixel is (rayX, rayY, 1). Multiplying it by the depth in meters gives the point.
+     */
+    const float* getRayX() const {return mRayX.empty() ? nullptr : &mRayX[0];}
+    const float* getRayY() const {return mRayY.empty() ? nullptr : &mRayY[0];}
+
+private:
+    int mWidth;
+    int mHeight;
+    std::vector<float> mRayX;
+    std::vector<float> mRayY;
+    std::vector<float> mPoints;
+    int mPointCount;
+    int64_t mTimeStamp;
+};
+
+/**
+ * @brief Writes point clouds to disk with a single write per frame, without formatting the points.
+ */
+class FUPointCloudWriter
+{
+public:
+    FUPointCloudWriter();
+    ~FUPointCloudWriter();
+    /**
+     * @brief Opens a binary stream file. Every frame is written as its time stamp (int64), point count (uint32) and
+     * the points as little endian float triplets.
+     * @param filePath
+     * @return false if the file can't be created
+     */
+    bool open(const char *filePath);
+    bool writeFrame(const FUPointCloud &pointCloud);
+    void close();
+    bool isOpen() const {return mFile != nullptr;}
+
+    /**
+     * @brief Writes a single point cloud as a binary little endian PLY file.
+     * @param filePath
+     * @param pointCloud
+     * @return false if the file can't be written
+     */
+    static bool writePly(const char *filePath, const FUPointCloud &pointCloud);
+
+private:
+    std::FILE *mFile;
+
+private:
+    FUPointCloudWriter(const FUPointCloudWriter&);
+    FUPointCloudWriter& operator=(const FUPointCloudWriter&);
+};
@@ -0,0 +1,137 @@
+#include "FUPostureDetector.h"
+
+using namespace FUSkeleton;
+
+//Posture thresholds in meters for an adult. They are multiplied with the player's body scale.
+static const float HAND_ABOVE_HEAD = 0.2f;
+static const float ARM_LEVEL_TOLERANCE = 0.15f;
+static const float LEAN_OFFSET = 0.1f;
+
+const float FUPostureDetector::JUMP_HEIGHT = 0.06f;
+const float FUPostureDetector::LANDING_HEIGHT = 0.02f;
+
+static bool isTracked(const SkeletonData &skeleton)
+{
+    return skeleton.trackingState == SKELETON_TRACKED;
+}
+
+/**
+ * @brief The hand must be above the elbow and higher than the head by the threshold.
+ */
+static bool isHandUp(const SkeletonData &skeleton, JOINT hand, JOINT elbow, float bodyScale)
+{
+    if (!isTracked(skeleton))
+        return false;
+    //Elbow should be under hand
+    if (skeleton.joints[elbow].y > skeleton.joints[hand].y)
+        return false;
+    return skeleton.joints[hand].y - skeleton.joints[HEAD].y > HAND_ABOVE_HEAD * bodyScale;
+}
+
+/**
+ * @brief The hand must be below the elbow and the hip center.
+ */
+static bool isHandDown(const SkeletonData &skeleton, JOINT hand, JOINT elbow)
+{
+    if (!isTracked(skeleton))
+        return false;
+    //Elbow should be over hand
+    if (skeleton.joints[elbow].y < skeleton.joints[hand].y)
+        return false;
+    return skeleton.joints[hand].y < skeleton.joints[HIP_CENTER].y;
+}
+
+/**
+ * @brief The shoulder, the elbow and the hand must be at about the same height.
+ */
+static bool isArmOpen(const SkeletonData &skeleton, JOINT hand, JOINT elbow, JOINT shoulder, float bodyScale)
+{
+    if (!isTracked(skeleton))
+        return false;
+    const float tolerance = ARM_LEVEL_TOLERANCE * bodyScale;
+    const float elbowHeight = skeleton.joints[elbow].y;
+    return std::abs(skeleton.joints[shoulder].y - elbowHeight) <= tolerance && std::abs(skeleton.joints[hand].y - elbowHeight) <= tolerance;
+}
+
+bool FUPostureDetector::detectRightHandUpPosture(const SkeletonData &skeleton, float bodyScale)
+{
+    return isHandUp(skeleton, HAND_RIGHT, ELBOW_RIGHT, bodyScale);
+}
+
+bool FUPostureDetector::detectLeftHandUpPosture(const SkeletonData &skeleton, float bodyScale)
+{
+    return isHandUp(skeleton, HAND_LEFT, ELBOW_LEFT, bodyScale);
+}
+
+bool FUPostureDetector::detectBothHandsUp(const SkeletonData &skeleton, float bodyScale)
+{
+    return detectRightHandUpPosture(skeleton, bodyScale) && detectLeftHandUpPosture(skeleton, bodyScale);
+}
+
+bool FUPostureDetector::detectLeftHandDownPosture(const SkeletonData &skeleton)
+{
+    return isHandDown(skeleton, HAND_LEFT, ELBOW_LEFT);
+}
+
+bool FUPostureDetector::detectRightHandDownPosture(const SkeletonData &skeleton)
+{
+    return isHandDown(skeleton, HAND_RIGHT, ELBOW_RIGHT);
+}
+
+bool FUPostureDetector::detectOpenRightArm(const SkeletonData &skeleton, float bodyScale)
+{
+    return isArmOpen(skeleton, HAND_RIGHT, ELBOW_RIGHT, SHOULDER_RIGHT, bodyScale);
+}
+
+bool FUPostureDetector::detectOpenLeftArm(const SkeletonData &skeleton, float bodyScale)
+{
+    return isArmOpen(skeleton, HAND_LEFT, ELBOW_LEFT, SHOULDER_LEFT, bodyScale);
+}
+
+bool FUPostureDetector::detectOpenArms(const SkeletonData &skeleton, float bodyScale)
+{
+    return detectOpenLeftArm(skeleton, bodyScale) && detectOpenRightArm(skeleton, bodyScale);
+}
+
+bool FUPostureDetector::detectLeanRight(const SkeletonData &skeleton, float bodyScale)
+{
+    if (!isTracked(skeleton))
+        return false;
+    return skeleton.joints[HEAD].x - skeleton.joints[HIP_CENTER].x >= LEAN_OFFSET * bodyScale;
+}
+
+bool FUPostureDetector::detectLeanLeft(const SkeletonData &skeleton, float bodyScale)
+{
+    if (!isTracked(skeleton))
+        return false;
+    return skeleton.joints[HIP_CENTER].x - skeleton.joints[HEAD].x >= LEAN_OFFSET * bodyScale;
+}
+
+bool FUPostureDetector::isFloorVisible(const FUMath::FUVector4<float> &floorPlane)
+{
+    //A single zero component is a valid plane, e.g. x is 0 when the sensor isn't rolled
+    return floorPlane.x != 0 || floorPlane.y != 0 || floorPlane.z != 0 || floorPlane.w != 0;
+}
+
+float FUPostureDetector::getDistanceFromFloor(const FUMath::FUVector4<float> &floorPlane, const FUMath::FUVector3<float> &position)
+{
+    return floorPlane.x * position.x + floorPlane.y * position.y + floorPlane.z * position.z + floorPlane.w;
+}
+
+bool FUPostureDetector::updateJump(JumpState &state, const SkeletonData &skeleton, const FUMath::FUVector4<float> &floorPlane)
+{
+    //If floor isn't visible, can't do anything
+    if (!isTracked(skeleton) || !isFloorVisible(floorPlane)) {
+        state.isAirborne = false;
+        return false;
+    }
+    const float leftFootHeight = getDistanceFromFloor(floorPlane, skeleton.joints[FOOT_LEFT]);
+    const float rightFootHeight = getDistanceFromFloor(floorPlane, skeleton.joints[FOOT_RIGHT]);
+    if (state.isAirborne) {
+        if (leftFootHeight < LANDING_HEIGHT && rightFootHeight < LANDING_HEIGHT)
+            state.isAirborne = false;
+        return false;
+    }
+    state.isAirborne = leftFootHeight > JUMP_HEIGHT && rightFootHeight > JUMP_HEIGHT;
+    return state.isAirborne;
+}
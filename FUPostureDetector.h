@@ -0,0 +1,56 @@
+#pragma once
+//Local Includes
+#include "FUSkeleton.h"
+
+/**
+ * @brief The posture detectors over plain skeletons. The distance thresholds are in meters for an adult and are multiplied
+ * with the body scale of the player, see FUSkeleton::FUBodyScale.
+ */
+class FUPostureDetector
+{
+public:
+    /**
+     * @brief The feet must be this high above the floor for a jump to start, in meters.
+     */
+    static const float JUMP_HEIGHT;
+    /**
+     * @brief The jump ends when both feet are lower than this, in meters.
+     */
+    static const float LANDING_HEIGHT;
+
+    /**
+     * @brief State of the jump detector of one player.
+     */
+    struct JumpState {
+        bool isAirborne;
+    };
+
+public:
+    static bool detectRightHandUpPosture(const FUSkeleton::SkeletonData &skeleton, float bodyScale = 1.f);
+    static bool detectLeftHandUpPosture(const FUSkeleton::SkeletonData &skeleton, float bodyScale = 1.f);
+    static bool detectBothHandsUp(const FUSkeleton::SkeletonData &skeleton, float bodyScale = 1.f);
+    static bool detectLeftHandDownPosture(const FUSkeleton::SkeletonData &skeleton);
+    static bool detectRightHandDownPosture(const FUSkeleton::SkeletonData &skeleton);
+    static bool detectOpenRightArm(const FUSkeleton::SkeletonData &skeleton, float bodyScale = 1.f);
+    static bool detectOpenLeftArm(const FUSkeleton::SkeletonData &skeleton, float bodyScale = 1.f);
+    static bool detectOpenArms(const FUSkeleton::SkeletonData &skeleton, float bodyScale = 1.f);
+    static bool detectLeanRight(const FUSkeleton::SkeletonData &skeleton, float bodyScale = 1.f);
+    static bool detectLeanLeft(const FUSkeleton::SkeletonData &skeleton, float bodyScale = 1.f);
+
+    /**
+     * @brief Returns true if the plane isn't all zeros.
+     */
+    static bool isFloorVisible(const FUMath::FUVector4<float> &floorPlane);
+    /**
+     * @brief Returns the height of a point above the floor in meters.
+     */
+    static float getDistanceFromFloor(const FUMath::FUVector4<float> &floorPlane, const FUMath::FUVector3<float> &position);
+    /**
+     * @brief Updates the jump state of a player with a new skeleton.
+     * @param state
+     * @param skeleton
+     * @param floorPlane
+     * @return true on the frame that both feet leave the floor
+     */
+    static bool updateJump(JumpState &state, const FUSkeleton::SkeletonData &skeleton, const FUMath::FUVector4<float> &floorPlane);
+};
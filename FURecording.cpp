@@ -0,0 +1,244 @@
+#include "FURecording.h"
+//STL Includes
+#include <cstring>
+//Local Includes
+#include "FUTrace.h"
+
+using namespace FUSkeleton;
+
+static const char MAGIC[4] = {'F', 'U', 'R', 'C'};
+static const size_t WRITE_BUFFER_SIZE = 1 << 20;
+static const size_t SKELETON_HEADER_SIZE = sizeof(int64_t) + sizeof(uint32_t) + sizeof(float) * 4 + sizeof(uint32_t);
+static const size_t SKELETON_RECORD_SIZE = sizeof(uint32_t) * 2 + sizeof(float) * 3 * (JOINT_COUNT + 1) + JOINT_COUNT;
+static const size_t DEPTH_HEADER_SIZE = sizeof(int64_t) + sizeof(int32_t) * 2;
+/**
+ * @brief Larger records are treated as broken files instead of being allocated
+ */
+static const uint32_t MAX_RECORD_SIZE = 64 << 20;
+
+template<typename T>
+static void append(std::vector<uint8_t> &buffer, const T &value)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+static T extract(const uint8_t *&data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return value;
+}
+
+FURecordingWriter::FURecordingWriter()
+    : mFile(nullptr)
+{
+}
+
+FURecordingWriter::~FURecordingWriter()
+{
+    close();
+}
+
+bool FURecordingWriter::open(const char *filePath)
+{
+    close();
+    mFile = std::fopen(filePath, "wb");
+    if (mFile == nullptr)
+        return false;
+    std::setvbuf(mFile, nullptr, _IOFBF, WRITE_BUFFER_SIZE);
+    const uint32_t version = FURecording::VERSION;
+    if (std::fwrite(MAGIC, sizeof(MAGIC), 1, mFile) != 1 || std::fwrite(&version, sizeof(version), 1, mFile) != 1) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool FURecordingWriter::writeSkeletonFrame(const SkeletonFrame &frame)
+{
+    FU_TRACE_SCOPE(FUTrace::IO, "FURecordingWriter::writeSkeletonFrame");
+    if (mFile == nullptr)
+        return false;
+    uint32_t skeletonCount = 0;
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        if (frame.skeletons[i].trackingState != SKELETON_NOT_TRACKED)
+            skeletonCount++;
+    }
+    mBuffer.clear();
+    append(mBuffer, frame.timeStamp);
+    append(mBuffer, frame.frameNumber);
+    append(mBuffer, frame.floorPlane.x);
+    append(mBuffer, frame.floorPlane.y);
+    append(mBuffer, frame.floorPlane.z);
+    append(mBuffer, frame.floorPlane.w);
+    append(mBuffer, skeletonCount);
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        const SkeletonData &skeleton = frame.skeletons[i];
+        if (skeleton.trackingState == SKELETON_NOT_TRACKED)
+            continue;
+        append(mBuffer, skeleton.trackingID);
+        append(mBuffer, static_cast<uint32_t>(skeleton.trackingState));
+        append(mBuffer, skeleton.position.x);
+        append(mBuffer, skeleton.position.y);
+        append(mBuffer, skeleton.position.z);
+        for (int joint = 0; joint < JOINT_COUNT; joint++) {
+            append(mBuffer, skeleton.joints[joint].x);
+            append(mBuffer, skeleton.joints[joint].y);
+            append(mBuffer, skeleton.joints[joint].z);
+        }
+        for (int joint = 0; joint < JOINT_COUNT; joint++)
+            append(mBuffer, static_cast<uint8_t>(skeleton.jointStates[joint]));
+    }
+    return writeRecord(FURecording::SKELETON_RECORD);
+}
+
+bool FURecordingWriter::writeDepthFrame(const FUDepthFrame &frame)
+{
+    FU_TRACE_SCOPE(FUTrace::IO, "FURecordingWriter::writeDepthFrame");
+    if (mFile == nullptr)
+        return false;
+    const uint8_t *pixels = reinterpret_cast<const uint8_t*>(frame.pixels);
+    mBuffer.clear();
+    append(mBuffer, frame.timeStamp);
+    append(mBuffer, static_cast<int32_t>(frame.width));
+    append(mBuffer, static_cast<int32_t>(frame.height));
+    mBuffer.insert(mBuffer.end(), pixels, pixels + sizeof(FUDepthPixel) * frame.width * frame.height);
+    return writeRecord(FURecording::DEPTH_RECORD);
+}
+
+bool FURecordingWriter::writeRecord(FURecording::RECORD_TYPE type)
+{
+    const uint32_t header[2] = {static_cast<uint32_t>(type), static_cast<uint32_t>(mBuffer.size())};
+    if (std::fwrite(header, sizeof(header), 1, mFile) != 1)
+        return false;
+    return std::fwrite(&mBuffer[0], mBuffer.size(), 1, mFile) == 1;
+}
+
+void FURecordingWriter::close()
+{
+    if (mFile) {
+        std::fclose(mFile);
+        mFile = nullptr;
+    }
+}
+
+FURecordingReader::FURecordingReader()
+    : mFile(nullptr)
+    , mFirstRecordOffset(0)
+    , mSkeletonFrame()
+    , mDepthFrame()
+{
+}
+
+FURecordingReader::~FURecordingReader()
+{
+    close();
+}
+
+bool FURecordingReader::open(const char *filePath)
+{
+    close();
+    mFile = std::fopen(filePath, "rb");
+    if (mFile == nullptr)
+        return false;
+    char magic[sizeof(MAGIC)];
+    uint32_t version = 0;
+    if (std::fread(magic, sizeof(magic), 1, mFile) != 1 || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+            || std::fread(&version, sizeof(version), 1, mFile) != 1 || version != FURecording::VERSION) {
+        close();
+        return false;
+    }
+    mFirstRecordOffset = std::ftell(mFile);
+    return true;
+}
+
+void FURecordingReader::close()
+{
+    if (mFile) {
+        std::fclose(mFile);
+        mFile = nullptr;
+    }
+}
+
+void FURecordingReader::rewind()
+{
+    if (mFile)
+        std::fseek(mFile, mFirstRecordOffset, SEEK_SET);
+}
+
+FURecording::RECORD_TYPE FURecordingReader::readNext()
+{
+    if (mFile == nullptr)
+        return FURecording::NO_RECORD;
+    while (true) {
+        uint32_t header[2];
+        if (std::fread(header, sizeof(header), 1, mFile) != 1 || header[1] > MAX_RECORD_SIZE)
+            return FURecording::NO_RECORD;
+        mBuffer.resize(header[1]);
+        if (header[1] != 0 && std::fread(&mBuffer[0], header[1], 1, mFile) != 1)
+            return FURecording::NO_RECORD;
+        if (header[0] == FURecording::SKELETON_RECORD)
+            return parseSkeletonFrame() ? FURecording::SKELETON_RECORD : FURecording::NO_RECORD;
+        if (header[0] == FURecording::DEPTH_RECORD)
+            return parseDepthFrame() ? FURecording::DEPTH_RECORD : FURecording::NO_RECORD;
+    }
+}
+
+bool FURecordingReader::parseSkeletonFrame()
+{
+    if (mBuffer.size() < SKELETON_HEADER_SIZE)
+        return false;
+    const uint8_t *data = &mBuffer[0];
+    SkeletonFrame &frame = mSkeletonFrame;
+    frame.timeStamp = extract<int64_t>(data);
+    frame.frameNumber = extract<uint32_t>(data);
+    frame.floorPlane.x = extract<float>(data);
+    frame.floorPlane.y = extract<float>(data);
+    frame.floorPlane.z = extract<float>(data);
+    frame.floorPlane.w = extract<float>(data);
+    const uint32_t skeletonCount = extract<uint32_t>(data);
+    if (skeletonCount > MAX_SKELETONS || mBuffer.size() != SKELETON_HEADER_SIZE + skeletonCount * SKELETON_RECORD_SIZE)
+        return false;
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        SkeletonData &skeleton = frame.skeletons[i];
+        if (i >= static_cast<int>(skeletonCount)) {
+            skeleton = SkeletonData();
+            continue;
+        }
+        skeleton.trackingID = extract<uint32_t>(data);
+        skeleton.trackingState = static_cast<SKELETON_TRACKING_STATE>(extract<uint32_t>(data));
+        skeleton.position.x = extract<float>(data);
+        skeleton.position.y = extract<float>(data);
+        skeleton.position.z = extract<float>(data);
+        for (int joint = 0; joint < JOINT_COUNT; joint++) {
+            skeleton.joints[joint].x = extract<float>(data);
+            skeleton.joints[joint].y = extract<float>(data);
+            skeleton.joints[joint].z = extract<float>(data);
+        }
+        for (int joint = 0; joint < JOINT_COUNT; joint++)
+            skeleton.jointStates[joint] = static_cast<JOINT_TRACKING_STATE>(extract<uint8_t>(data));
+    }
+    return true;
+}
+
+bool FURecordingReader::parseDepthFrame()
+{
+    if (mBuffer.size() < DEPTH_HEADER_SIZE)
+        return false;
+    const uint8_t *data = &mBuffer[0];
+    const int64_t timeStamp = extract<int64_t>(data);
+    const int32_t width = extract<int32_t>(data);
+    const int32_t height = extract<int32_t>(data);
+    if (width <= 0 || height <= 0 || mBuffer.size() != DEPTH_HEADER_SIZE + sizeof(FUDepthPixel) * width * height)
+        return false;
+    mDepthPixels.resize(static_cast<size_t>(width) * height);
+    std::memcpy(&mDepthPixels[0], data, sizeof(FUDepthPixel) * mDepthPixels.size());
+    mDepthFrame.pixels = &mDepthPixels[0];
+    mDepthFrame.width = width;
+    mDepthFrame.height = height;
+    mDepthFrame.timeStamp = timeStamp;
+    return true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+//Local Includes
+#include "FUDepthFrame.h"
+#include "FUSkeleton.h"
+
+/**
+ * @brief The recording file format. A recording starts with the magic "FURC" and the version (uint32), followed by records.
+ * Every record is its type (uint32), its payload size in bytes (uint32) and the payload. Everything is little endian.
+ * - SKELETON_RECORD: time stamp (int64), frame number (uint32), floor plane (4 floats), skeleton count (uint32), then for every
+ * skeleton that isn't SKELETON_NOT_TRACKED: tracking ID (uint32), tracking state (uint32), position (3 floats), the joints
+ * (JOINT_COUNT float triplets) and the joint tracking states (JOINT_COUNT bytes).
+ * - DEPTH_RECORD: time stamp (int64), width (int32), height (int32) and the pixels in the layout of FUDepthPixel.
+ */
+namespace FURecording
+{
+enum RECORD_TYPE {
+    NO_RECORD = 0,
+    SKELETON_RECORD = 1,
+    DEPTH_RECORD = 2
+};
+
+const uint32_t VERSION = 1;
+}
+
+class FURecordingWriter
+{
+public:
+    FURecordingWriter();
+    ~FURecordingWriter();
+    /**
+     * @brief Creates the file and writes the header.
+     * @param filePath
+     * @return false if the file can't be created
+     */
+    bool open(const char *filePath);
+    bool writeSkeletonFrame(const FUSkeleton::SkeletonFrame &frame);
+    bool writeDepthFrame(const FUDepthFrame &frame);
+    void close();
+    bool isOpen() const {return mFile != nullptr;}
+
+private:
+    std::FILE *mFile;
+    std::vector<uint8_t> mBuffer;
+
+private:
+    bool writeRecord(FURecording::RECORD_TYPE type);
+    FURecordingWriter(const FURecordingWriter&);
+    FURecordingWriter& operator=(const FURecordingWriter&);
+};
+
+/**
+ * @brief Reads the records of a recording one by one. The last read frame of each type stays available until the next one
+ * of the same type is read. The skeletons of a frame are packed into its first slots.
+ */
+class FURecordingReader
+{
+public:
+    FURecordingReader();
+    ~FURecordingReader();
+    /**
+     * @brief Opens a recording and checks its header.
+     * @param filePath
+     * @return false if the file can't be opened or isn't a recording
+     */
+    bool open(const char *filePath);
+    void close();
+    bool isOpen() const {return mFile != nullptr;}
+    /**
+     * @brief Reads the next record. Records of unknown types are skipped.
+     * @return The type of the record that was read, NO_RECORD at the end of the file or when a record is broken
+     */
+    FURecording::RECORD_TYPE readNext();
+    /**
+     * @brief Goes back to the first record.
+     */
+    void rewind();
+    const FUSkeleton::SkeletonFrame& getSkeletonFrame() const {return mSkeletonFrame;}
+    /**
+     * @brief Returns the last depth frame. Its pixels are owned by the reader.
+     * @return
+     */
+    const FUDepthFrame& getDepthFrame() const {return mDepthFrame;}
+
+private:
+    std::FILE *mFile;
+    long mFirstRecordOffset;
+    std::vector<uint8_t> mBuffer;
+    FUSkeleton::SkeletonFrame mSkeletonFrame;
+    std::vector<FUDepthPixel> mDepthPixels;
+    FUDepthFrame mDepthFrame;
+
+private:
+    bool parseSkeletonFrame();
+    bool parseDepthFrame();
+    FURecordingReader(const FURecordingReader&);
+    FURecordingReader& operator=(const FURecordingReader&);
+};
@@ -0,0 +1,182 @@
+#include "FURegistration.h"
+//STL Includes
+#include <cstddef>
+#include <cstring>
+//Local Includes
+#include "FUSimd.h"
+#include "FUTrace.h"
+
+FURegistration::FURegistration()
+    : mDepthWidth(0)
+    , mDepthHeight(0)
+    , mColorWidth(0)
+    , mColorHeight(0)
+    , mCalibrationKey(0)
+    , mOutputs(DEPTH_IN_COLOR | COLOR_IN_DEPTH)
+{
+}
+
+bool FURegistration::needsRebuild(int depthWidth, int depthHeight, int colorWidth, int colorHeight, uint64_t calibrationKey) const
+{
+    return depthWidth != mDepthWidth || depthHeight != mDepthHeight || colorWidth != mColorWidth || colorHeight != mColorHeight
+            || calibrationKey != mCalibrationKey;
+}
+
+void FURegistration::rebuild(int depthWidth, int depthHeight, int colorWidth, int colorHeight, uint64_t calibrationKey,
+                             const ColorPoint *nearPoints, const ColorPoint *farPoints)
+{
+    mDepthWidth = depthWidth;
+    mDepthHeight = depthHeight;
+    mColorWidth = colorWidth;
+    mColorHeight = colorHeight;
+    mCalibrationKey = calibrationKey;
+    const int pixelCount = depthWidth * depthHeight;
+    mBaseX.resize(pixelCount);
+    mBaseY.resize(pixelCount);
+    mParallaxX.resize(pixelCount);
+    mParallaxY.resize(pixelCount);
+    mColorIndices.assign(pixelCount, -1);
+    mDepthInColor.assign(colorWidth * colorHeight, 0);
+    mColorInDepth.assign(pixelCount, 0);
+
+    //c(z) = base + parallax / z, solved from the two samples
+    const float inverseNear = 1.f / CALIBRATION_NEAR_DEPTH;
+    const float inverseFar = 1.f / CALIBRATION_FAR_DEPTH;
+    const float scale = 1.f / (inverseNear - inverseFar);
+    for (int i = 0; i < pixelCount; i++) {
+        mParallaxX[i] = (nearPoints[i].x - farPoints[i].x) * scale;
+        mParallaxY[i] = (nearPoints[i].y - farPoints[i].y) * scale;
+        mBaseX[i] = nearPoints[i].x - mParallaxX[i] * inverseNear;
+        mBaseY[i] = nearPoints[i].y - mParallaxY[i] * inverseNear;
+    }
+}
+
+void FURegistration::mapDepthFrame(const FUDepthFrame &frame)
+{
+    FU_TRACE_SCOPE(FUTrace::DEPTH, "FURegistration::mapDepthFrame");
+    if (!isValid() || frame.width != mDepthWidth || frame.height != mDepthHeight)
+        return;
+    computeColorIndices(frame);
+    if (mOutputs & DEPTH_IN_COLOR)
+        splatDepth(frame);
+}
+
+bool FURegistration::mapSkeletonPoint(const FUMath::FUVector3<float> &point, float &colorX, float &colorY) const
+{
+    if (!isValid() || point.z <= 0.f)
+        return false;
+    const float focalLength = getDepthFocalLength(mDepthWidth);
+    const float depthX = mDepthWidth * 0.5f + point.x * focalLength / point.z;
+    const float depthY = mDepthHeight * 0.5f - point.y * focalLength / point.z;
+    if (depthX < 0.f || depthY < 0.f || depthX >= mDepthWidth || depthY >= mDepthHeight)
+        return false;
+    const int index = static_cast<int>(depthY) * mDepthWidth + static_cast<int>(depthX);
+    const float inverseDepth = 1.f / (point.z * 1000.f);
+    colorX = mBaseX[index] + mParallaxX[index] * inverseDepth;
+    colorY = mBaseY[index] + mParallaxY[index] * inverseDepth;
+    return colorX >= 0.f && colorY >= 0.f && colorX < mColorWidth && colorY < mColorHeight;
+}
+
+void FURegistration::computeColorIndices(const FUDepthFrame &frame)
+{
+    const int pixelCount = mDepthWidth * mDepthHeight;
+    const float *baseX = &mBaseX[0];
+    const float *baseY = &mBaseY[0];
+    const float *parallaxX = &mParallaxX[0];
+    const float *parallaxY = &mParallaxY[0];
+    int32_t *colorIndices = &mColorIndices[0];
+    int i = 0;
+#ifdef FU_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 colorWidth = _mm_set1_ps(static_cast<float>(mColorWidth));
+    const __m128 colorHeight = _mm_set1_ps(static_cast<float>(mColorHeight));
+    for (; i + 4 <= pixelCount; i += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame.pixels + i));
+        const __m128 depth = _mm_cvtepi32_ps(_mm_srli_epi32(pixels, 16));
+        const __m128 hasDepth = _mm_cmpgt_ps(depth, zero);
+        //Unknown depth gives inf here, it's masked out below
+        const __m128 inverseDepth = _mm_div_ps(one, depth);
+        const __m128 x = _mm_add_ps(_mm_loadu_ps(baseX + i), _mm_mul_ps(_mm_loadu_ps(parallaxX + i), inverseDepth));
+        const __m128 y = _mm_add_ps(_mm_loadu_ps(baseY + i), _mm_mul_ps(_mm_loadu_ps(parallaxY + i), inverseDepth));
+        const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(x, zero), _mm_cmplt_ps(x, colorWidth)),
+                                         _mm_and_ps(_mm_cmpge_ps(y, zero), _mm_cmplt_ps(y, colorHeight)));
+        const __m128i valid = _mm_castps_si128(_mm_and_ps(hasDepth, inside));
+        //The color frame has less than 2^24 pixels, so the index is exact in float
+        const __m128 row = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_and_ps(y, _mm_castsi128_ps(valid))));
+        const __m128 column = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_and_ps(x, _mm_castsi128_ps(valid))));
+        const __m128i index = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(row, colorWidth), column));
+        //Invalid lanes become -1
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(colorIndices + i), _mm_or_si128(_mm_and_si128(index, valid), _mm_andnot_si128(valid, _mm_set1_epi32(-1))));
+    }
+#endif
+    for (; i < pixelCount; i++) {
+        const int depth = frame.pixels[i].depth;
+        colorIndices[i] = -1;
+        if (depth == 0)
+            continue;
+        const float inverseDepth = 1.f / depth;
+        const float x = baseX[i] + parallaxX[i] * inverseDepth;
+        const float y = baseY[i] + parallaxY[i] * inverseDepth;
+        if (x < 0.f || y < 0.f || x >= mColorWidth || y >= mColorHeight)
+            continue;
+        colorIndices[i] = static_cast<int32_t>(y) * mColorWidth + static_cast<int32_t>(x);
+    }
+}
+
+void FURegistration::splatDepth(const FUDepthFrame &frame)
+{
+    //Every depth pixel covers a block of color pixels, the closest depth wins
+    const int blockWidth = mColorWidth > mDepthWidth ? mColorWidth / mDepthWidth : 1;
+    const int blockHeight = mColorHeight > mDepthHeight ? mColorHeight / mDepthHeight : 1;
+    uint16_t *depthInColor = &mDepthInColor[0];
+    std::memset(depthInColor, 0, mDepthInColor.size() * sizeof(uint16_t));
+    const int pixelCount = mDepthWidth * mDepthHeight;
+    for (int i = 0; i < pixelCount; i++) {
+        const int32_t colorIndex = mColorIndices[i];
+        if (colorIndex < 0)
+            continue;
+        const uint16_t depth = frame.pixels[i].depth;
+        const int colorX = colorIndex % mColorWidth;
+        const int colorY = colorIndex / mColorWidth;
+        const int right = colorX + blockWidth > mColorWidth ? mColorWidth : colorX + blockWidth;
+        const int bottom = colorY + blockHeight > mColorHeight ? mColorHeight : colorY + blockHeight;
+        for (int y = colorY; y < bottom; y++) {
+            uint16_t *row = depthInColor + y * mColorWidth;
+            for (int x = colorX; x < right; x++) {
+                if (row[x] == 0 || depth < row[x])
+                    row[x] = depth;
+            }
+        }
+    }
+}
+
+void FURegistration::registerColorFrame(const uint8_t *colorPixels, int pitch)
+{
+    FU_TRACE_SCOPE(FUTrace::COLOR, "FURegistration::registerColorFrame");
+    if (!isValid() || (mOutputs & COLOR_IN_DEPTH) == 0)
+        return;
+    const int32_t *colorIndices = &mColorIndices[0];
+    uint32_t *colorInDepth = &mColorInDepth[0];
+    const int pixelCount = mDepthWidth * mDepthHeight;
+    if (pitch == mColorWidth * 4) {
+        const uint32_t *color = reinterpret_cast<const uint32_t*>(colorPixels);
+        //Gather. The indices are already validated, so this loop is only loads and stores.
+        for (int i = 0; i < pixelCount; i++) {
+            const int32_t colorIndex = colorIndices[i];
+            colorInDepth[i] = colorIndex >= 0 ? color[colorIndex] : 0;
+        }
+        return;
+    }
+    //The rows are padded, so the indices are split into rows and columns
+    for (int i = 0; i < pixelCount; i++) {
+        const int32_t colorIndex = colorIndices[i];
+        if (colorIndex < 0) {
+            colorInDepth[i] = 0;
+            continue;
+        }
+        const int colorY = colorIndex / mColorWidth;
+        const int colorX = colorIndex - colorY * mColorWidth;
+        colorInDepth[i] = *reinterpret_cast<const uint32_t*>(colorPixels + static_cast<ptrdiff_t>(pitch) * colorY + colorX * 4);
+    }
+}
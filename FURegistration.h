@@ -0,0 +1,110 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+#include <vector>
+//Local Includes
+#include "FUDepthFrame.h"
+#include "FUMath.h"
+
+/**
+ * @brief Registers the depth and color frames using cached mapping tables. The color coordinate of a depth pixel is
+ * modelled as base + parallax / depth per pixel, which is solved once from two mappings of the whole frame at known depths.
+ * After that a frame is mapped with a multiply-add per coordinate instead of a coordinate mapper call per pixel. The tables
+ * are only rebuilt when the resolutions or the calibration change.
+ */
+class FURegistration
+{
+public:
+    /**
+     * @brief Same layout as NUI_COLOR_IMAGE_POINT
+     */
+    struct ColorPoint {
+        int32_t x;
+        int32_t y;
+    };
+
+    enum OUTPUTS {
+        DEPTH_IN_COLOR = 1,//Depth image at the color resolution
+        COLOR_IN_DEPTH = 2//Color image at the depth resolution
+    };
+
+    /**
+     * @brief The depths in millimeters the calibration mappings should be taken at.
+     */
+    static const int CALIBRATION_NEAR_DEPTH = 800;
+    static const int CALIBRATION_FAR_DEPTH = 4000;
+
+public:
+    FURegistration();
+    /**
+     * @brief Returns true if the tables weren't built for these resolutions and calibration.
+     * @param calibrationKey --> Any value that changes when the calibration changes, like a hash of the calibration data
+     */
+    bool needsRebuild(int depthWidth, int depthHeight, int colorWidth, int colorHeight, uint64_t calibrationKey) const;
+    /**
+     * @brief Builds the tables from the color coordinates of every depth pixel at the two calibration depths.
+     * @param nearPoints --> depthWidth * depthHeight color points, mapped at CALIBRATION_NEAR_DEPTH
+     * @param farPoints --> depthWidth * depthHeight color points, mapped at CALIBRATION_FAR_DEPTH
+     */
+    void rebuild(int depthWidth, int depthHeight, int colorWidth, int colorHeight, uint64_t calibrationKey,
+                 const ColorPoint *nearPoints, const ColorPoint *farPoints);
+    bool isValid() const {return mDepthWidth > 0;}
+    /**
+     * @brief Selects the outputs that are produced. Both are produced by default.
+     * @param outputs --> A combination of OUTPUTS
+     */
+    void setOutputs(unsigned int outputs) {mOutputs = outputs;}
+
+    /**
+     * @brief Maps every pixel of the depth frame to the color frame, and produces the depth in color image if it is enabled.
+     * @param frame
+     */
+    void mapDepthFrame(const FUDepthFrame &frame);
+    /**
+     * @brief Produces the color in depth image from a color frame, using the mapping of the last depth frame.
+     * @param colorPixels --> 32 bit BGRX pixels of the color frame
+     * @param pitch --> Bytes between the rows of pixels
+     */
+    void registerColorFrame(const uint8_t *colorPixels, int pitch);
+    /**
+     * @brief Maps a skeleton space point to the color frame. The point is projected to the depth frame with the nominal focal
+     * length like NuiTransformSkeletonToDepthImage() and the tables of that depth pixel are used at the point's depth.
+     * @param point --> In meters
+     * @param colorX
+     * @param colorY
+     * @return false if the tables aren't built or the point falls outside of the depth or the color frame
+     */
+    bool mapSkeletonPoint(const FUMath::FUVector3<float> &point, float &colorX, float &colorY) const;
+
+    /**
+     * @brief Depth in millimeters for every color pixel, 0 where there is no depth.
+     */
+    const uint16_t* getDepthInColor() const {return mDepthInColor.empty() ? nullptr : &mDepthInColor[0];}
+    /**
+     * @brief 32 bit BGRX color for every depth pixel, 0 where the pixel has no depth or falls outside of the color frame.
+     * Together with the depth frame it makes an aligned RGB-D image.
+     */
+    const uint32_t* getColorInDepth() const {return mColorInDepth.empty() ? nullptr : &mColorInDepth[0];}
+
+private:
+    int mDepthWidth;
+    int mDepthHeight;
+    int mColorWidth;
+    int mColorHeight;
+    uint64_t mCalibrationKey;
+    unsigned int mOutputs;
+    std::vector<float> mBaseX;
+    std::vector<float> mBaseY;
+    std::vector<float> mParallaxX;
+    std::vector<float> mParallaxY;
+    /**
+     * @brief Index of the color pixel of every depth pixel in the last mapped frame, -1 if there is none
+     */
+    std::vector<int32_t> mColorIndices;
+    std::vector<uint16_t> mDepthInColor;
+    std::vector<uint32_t> mColorInDepth;
+
+private:
+    void computeColorIndices(const FUDepthFrame &frame);
+    void splatDepth(const FUDepthFrame &frame);
+};
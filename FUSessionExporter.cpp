@@ -0,0 +1,437 @@
+#include "FUSessionExporter.h"
+//STL Includes
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+//Local Includes
+#include "FUTrace.h"
+
+using namespace FUSessionFile;
+
+/**
+ * @brief Row groups that can wait for the writer thread before the rows are dropped, including the one that is filled
+ */
+static const int BATCH_COUNT = 4;
+static const size_t HEADER_SIZE = ALIGNMENT;
+static const size_t TRAILER_SIZE = sizeof(uint32_t) + sizeof(MAGIC);
+/**
+ * @brief Larger footers are treated as broken files instead of being allocated
+ */
+static const uint32_t MAX_FOOTER_SIZE = 64 << 20;
+
+static const char *JOINT_NAMES[FUSkeleton::JOINT_COUNT] = {
+    "hipCenter", "spine", "shoulderCenter", "head",
+    "shoulderLeft", "elbowLeft", "wristLeft", "handLeft",
+    "shoulderRight", "elbowRight", "wristRight", "handRight",
+    "hipLeft", "kneeLeft", "ankleLeft", "footLeft",
+    "hipRight", "kneeRight", "ankleRight", "footRight"
+};
+
+/**
+ * @brief std::fseek() with a 64 bit offset, long is 32 bits on Windows and session files can be larger than 2 GB
+ * @return false if the offset doesn't fit or the seek failed
+ */
+static bool seekFile(std::FILE *file, int64_t offset, int origin)
+{
+#ifdef _WIN32
+    return _fseeki64(file, offset, origin) == 0;
+#else
+    if (static_cast<int64_t>(static_cast<off_t>(offset)) != offset)
+        return false;
+    return fseeko(file, static_cast<off_t>(offset), origin) == 0;
+#endif
+}
+
+static size_t alignSize(size_t size)
+{
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+template<typename T>
+static void append(std::vector<uint8_t> &buffer, const T &value)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+static bool extract(const uint8_t *&data, const uint8_t *end, T &value)
+{
+    if (static_cast<size_t>(end - data) < sizeof(T))
+        return false;
+    std::memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+
+/**
+ * @brief Sets the value of a row in a column that starts at columnData.
+ */
+template<typename T>
+static void setValue(uint8_t *columnData, uint32_t row, T value)
+{
+    std::memcpy(columnData + sizeof(T) * row, &value, sizeof(T));
+}
+
+const std::vector<Column>& FUSessionFile::getColumns()
+{
+    static const std::vector<Column> columns = []() {
+        std::vector<Column> list;
+        const Column firstColumns[] = {
+            {"timeStamp", INT64_COLUMN},
+            {"frameNumber", UINT32_COLUMN},
+            {"trackingID", UINT32_COLUMN},
+            {"trackingState", UINT8_COLUMN},
+            {"bodyScale", FLOAT_COLUMN},
+            {"positionX", FLOAT_COLUMN},
+            {"positionY", FLOAT_COLUMN},
+            {"positionZ", FLOAT_COLUMN}
+        };
+        list.assign(firstColumns, firstColumns + sizeof(firstColumns) / sizeof(firstColumns[0]));
+        const char *axes[3] = {"X", "Y", "Z"};
+        for (int joint = 0; joint < FUSkeleton::JOINT_COUNT; joint++) {
+            for (int axis = 0; axis < 3; axis++) {
+                const Column column = {std::string(JOINT_NAMES[joint]) + axes[axis], FLOAT_COLUMN};
+                list.push_back(column);
+            }
+        }
+        for (int joint = 0; joint < FUSkeleton::JOINT_COUNT; joint++) {
+            const Column column = {std::string(JOINT_NAMES[joint]) + "State", UINT8_COLUMN};
+            list.push_back(column);
+        }
+        for (int detector = 0; detector < FUGesture::DETECTOR_COUNT; detector++) {
+            const Column column = {FUGesture::getDetectorName(static_cast<FUGesture::DETECTORS>(1 << detector)), UINT8_COLUMN};
+            list.push_back(column);
+        }
+        return list;
+    }();
+    return columns;
+}
+
+size_t FUSessionFile::getValueSize(COLUMN_TYPE type)
+{
+    switch (type) {
+    case INT64_COLUMN: return sizeof(int64_t);
+    case UINT32_COLUMN: return sizeof(uint32_t);
+    case FLOAT_COLUMN: return sizeof(float);
+    case UINT8_COLUMN: return sizeof(uint8_t);
+    }
+    return 0;
+}
+
+FUSessionExporter::FUSessionExporter()
+    : mFile(nullptr)
+    , mRowGroupSize(0)
+    , mCurrentBatch(nullptr)
+    , mRowCount(0)
+    , mDroppedRowCount(0)
+    , mIsStopping(false)
+    , mHasWriteFailed(false)
+    , mFileOffset(0)
+{
+}
+
+FUSessionExporter::~FUSessionExporter()
+{
+    close();
+}
+
+bool FUSessionExporter::open(const char *filePath, int rowGroupSize)
+{
+    close();
+    if (rowGroupSize <= 0)
+        return false;
+    mFile = std::fopen(filePath, "wb");
+    if (mFile == nullptr)
+        return false;
+    uint8_t header[HEADER_SIZE] = {};
+    std::memcpy(header, MAGIC, sizeof(MAGIC));
+    std::memcpy(header + sizeof(MAGIC), &VERSION, sizeof(VERSION));
+    if (std::fwrite(header, sizeof(header), 1, mFile) != 1) {
+        std::fclose(mFile);
+        mFile = nullptr;
+        return false;
+    }
+
+    mRowGroupSize = static_cast<uint32_t>(rowGroupSize);
+    const std::vector<Column> &columns = getColumns();
+    mColumnOffsets.resize(columns.size());
+    size_t batchSize = 0;
+    for (size_t i = 0; i < columns.size(); i++) {
+        mColumnOffsets[i] = batchSize;
+        batchSize += alignSize(getValueSize(columns[i].type) * mRowGroupSize);
+    }
+    mBatches.resize(BATCH_COUNT);
+    mFreeBatches.clear();
+    for (int i = 0; i < BATCH_COUNT; i++) {
+        mBatches[i].data.resize(batchSize);
+        mBatches[i].rowCount = 0;
+        mFreeBatches.push_back(&mBatches[i]);
+    }
+    mFullBatches.clear();
+    mCurrentBatch = nullptr;
+    mRowCount = 0;
+    mDroppedRowCount = 0;
+    mIsStopping = false;
+    mHasWriteFailed = false;
+    mFileOffset = HEADER_SIZE;
+    mRowGroups.clear();
+    mWriter = std::thread(&FUSessionExporter::writerLoop, this);
+    return true;
+}
+
+void FUSessionExporter::close()
+{
+    if (mFile == nullptr)
+        return;
+    if (mCurrentBatch && mCurrentBatch->rowCount > 0)
+        queueCurrentBatch();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = true;
+    }
+    mCondition.notify_one();
+    mWriter.join();
+    if (!mHasWriteFailed && !writeFooter())
+        mHasWriteFailed = true;
+    if (std::fclose(mFile) != 0)
+        mHasWriteFailed = true;
+    mFile = nullptr;
+    mCurrentBatch = nullptr;
+    mFreeBatches.clear();
+    mFullBatches.clear();
+    mBatches.clear();
+}
+
+void FUSessionExporter::write(const FUSharedSkeleton::Frame &frame)
+{
+    if (mFile == nullptr)
+        return;
+    for (uint32_t i = 0; i < frame.playerCount; i++) {
+        if (mCurrentBatch == nullptr) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mFreeBatches.empty()) {
+                mCurrentBatch = mFreeBatches.back();
+                mFreeBatches.pop_back();
+            }
+        }
+        if (mCurrentBatch == nullptr) {
+            mDroppedRowCount += frame.playerCount - i;
+            return;
+        }
+
+        const FUSharedSkeleton::Player &player = frame.players[i];
+        uint8_t *data = &mCurrentBatch->data[0];
+        const size_t *offsets = &mColumnOffsets[0];
+        const uint32_t row = mCurrentBatch->rowCount;
+        int column = 0;
+        setValue(data + offsets[column++], row, frame.timeStamp);
+        setValue(data + offsets[column++], row, frame.frameNumber);
+        setValue(data + offsets[column++], row, player.trackingID);
+        setValue(data + offsets[column++], row, static_cast<uint8_t>(player.trackingState));
+        setValue(data + offsets[column++], row, player.bodyScale);
+        for (int axis = 0; axis < 3; axis++)
+            setValue(data + offsets[column++], row, player.position[axis]);
+        for (int joint = 0; joint < FUSkeleton::JOINT_COUNT; joint++) {
+            for (int axis = 0; axis < 3; axis++)
+                setValue(data + offsets[column++], row, player.joints[joint][axis]);
+        }
+        for (int joint = 0; joint < FUSkeleton::JOINT_COUNT; joint++)
+            setValue(data + offsets[column++], row, player.jointStates[joint]);
+        for (int detector = 0; detector < FUGesture::DETECTOR_COUNT; detector++)
+            setValue(data + offsets[column++], row, static_cast<uint8_t>((player.postures >> detector) & 1));
+
+        mRowCount++;
+        if (++mCurrentBatch->rowCount == mRowGroupSize)
+            queueCurrentBatch();
+    }
+}
+
+void FUSessionExporter::queueCurrentBatch()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFullBatches.push_back(mCurrentBatch);
+    }
+    mCurrentBatch = nullptr;
+    mCondition.notify_one();
+}
+
+void FUSessionExporter::writerLoop()
+{
+    FUTrace::setThreadName("FUSessionExporter writer");
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mCondition.wait(lock, [this]() {return mIsStopping || !mFullBatches.empty();});
+        if (mFullBatches.empty())
+            return;
+        Batch *batch = mFullBatches.front();
+        mFullBatches.pop_front();
+        lock.unlock();
+        if (!mHasWriteFailed && !writeRowGroup(*batch))
+            mHasWriteFailed = true;
+        batch->rowCount = 0;
+        lock.lock();
+        mFreeBatches.push_back(batch);
+    }
+}
+
+bool FUSessionExporter::writeRowGroup(const Batch &batch)
+{
+    FU_TRACE_SCOPE(FUTrace::IO, "FUSessionExporter::writeRowGroup");
+    static const uint8_t padding[ALIGNMENT] = {};
+    const std::vector<Column> &columns = getColumns();
+    RowGroup rowGroup;
+    rowGroup.rowCount = batch.rowCount;
+    rowGroup.columnOffsets.resize(columns.size());
+    for (size_t i = 0; i < columns.size(); i++) {
+        const size_t size = getValueSize(columns[i].type) * batch.rowCount;
+        rowGroup.columnOffsets[i] = mFileOffset;
+        if (!writeBytes(&batch.data[mColumnOffsets[i]], size) || !writeBytes(padding, alignSize(size) - size))
+            return false;
+    }
+    mRowGroups.push_back(rowGroup);
+    return true;
+}
+
+bool FUSessionExporter::writeFooter()
+{
+    const std::vector<Column> &columns = getColumns();
+    std::vector<uint8_t> footer;
+    append(footer, static_cast<uint32_t>(columns.size()));
+    for (size_t i = 0; i < columns.size(); i++) {
+        append(footer, static_cast<uint8_t>(columns[i].type));
+        append(footer, static_cast<uint8_t>(columns[i].name.size()));
+        footer.insert(footer.end(), columns[i].name.begin(), columns[i].name.end());
+    }
+    append(footer, static_cast<uint32_t>(mRowGroups.size()));
+    for (size_t i = 0; i < mRowGroups.size(); i++) {
+        append(footer, mRowGroups[i].rowCount);
+        for (size_t j = 0; j < columns.size(); j++)
+            append(footer, mRowGroups[i].columnOffsets[j]);
+    }
+    append(footer, static_cast<uint32_t>(footer.size()));
+    footer.insert(footer.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    return writeBytes(&footer[0], footer.size());
+}
+
+bool FUSessionExporter::writeBytes(const void *data, size_t size)
+{
+    if (size == 0)
+        return true;
+    if (std::fwrite(data, size, 1, mFile) != 1)
+        return false;
+    mFileOffset += size;
+    return true;
+}
+
+FUSessionReader::FUSessionReader()
+    : mFile(nullptr)
+{
+}
+
+FUSessionReader::~FUSessionReader()
+{
+    close();
+}
+
+bool FUSessionReader::open(const char *filePath)
+{
+    close();
+    mFile = std::fopen(filePath, "rb");
+    if (mFile == nullptr)
+        return false;
+    if (!readFooter()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void FUSessionReader::close()
+{
+    if (mFile) {
+        std::fclose(mFile);
+        mFile = nullptr;
+    }
+    mColumns.clear();
+    mRowGroups.clear();
+}
+
+bool FUSessionReader::readFooter()
+{
+    char magic[sizeof(MAGIC)];
+    uint32_t version = 0;
+    if (std::fread(magic, sizeof(magic), 1, mFile) != 1 || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+            || std::fread(&version, sizeof(version), 1, mFile) != 1 || version != VERSION)
+        return false;
+
+    uint32_t footerSize = 0;
+    if (!seekFile(mFile, -static_cast<int64_t>(TRAILER_SIZE), SEEK_END) || std::fread(&footerSize, sizeof(footerSize), 1, mFile) != 1
+            || std::fread(magic, sizeof(magic), 1, mFile) != 1 || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+            || footerSize == 0 || footerSize > MAX_FOOTER_SIZE)
+        return false;
+    std::vector<uint8_t> footer(footerSize);
+    if (!seekFile(mFile, -static_cast<int64_t>(TRAILER_SIZE + footerSize), SEEK_END) || std::fread(&footer[0], footerSize, 1, mFile) != 1)
+        return false;
+
+    const uint8_t *data = &footer[0];
+    const uint8_t *end = data + footer.size();
+    uint32_t columnCount = 0;
+    if (!extract(data, end, columnCount) || columnCount > footerSize)
+        return false;
+    mColumns.resize(columnCount);
+    for (uint32_t i = 0; i < columnCount; i++) {
+        uint8_t type = 0;
+        uint8_t nameLength = 0;
+        if (!extract(data, end, type) || !extract(data, end, nameLength) || static_cast<size_t>(end - data) < nameLength)
+            return false;
+        if (getValueSize(static_cast<COLUMN_TYPE>(type)) == 0)
+            return false;
+        mColumns[i].type = static_cast<COLUMN_TYPE>(type);
+        mColumns[i].name.assign(reinterpret_cast<const char*>(data), nameLength);
+        data += nameLength;
+    }
+    uint32_t rowGroupCount = 0;
+    if (!extract(data, end, rowGroupCount) || rowGroupCount > footerSize)
+        return false;
+    mRowGroups.resize(rowGroupCount);
+    for (uint32_t i = 0; i < rowGroupCount; i++) {
+        RowGroup &rowGroup = mRowGroups[i];
+        if (!extract(data, end, rowGroup.rowCount))
+            return false;
+        rowGroup.columnOffsets.resize(columnCount);
+        for (uint32_t j = 0; j < columnCount; j++) {
+            if (!extract(data, end, rowGroup.columnOffsets[j]))
+                return false;
+        }
+    }
+    return data == end;
+}
+
+int FUSessionReader::findColumn(const char *name) const
+{
+    for (size_t i = 0; i < mColumns.size(); i++) {
+        if (mColumns[i].name == name)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+const void* FUSessionReader::readColumn(int rowGroup, int column)
+{
+    FU_TRACE_SCOPE(FUTrace::IO, "FUSessionReader::readColumn");
+    if (mFile == nullptr || rowGroup < 0 || rowGroup >= getRowGroupCount() || column < 0 || column >= getColumnCount())
+        return nullptr;
+    const RowGroup &group = mRowGroups[rowGroup];
+    const size_t size = getValueSize(mColumns[column].type) * group.rowCount;
+    mColumnBuffer.resize(size / sizeof(uint64_t) + 1);
+    const uint64_t offset = group.columnOffsets[column];
+    if (offset > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) || !seekFile(mFile, static_cast<int64_t>(offset), SEEK_SET)
+            || (size != 0 && std::fread(&mColumnBuffer[0], size, 1, mFile) != 1))
+        return nullptr;
+    return &mColumnBuffer[0];
+}
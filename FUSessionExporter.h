@@ -0,0 +1,196 @@
+#pragma once
+//STL Includes
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+//Local Includes
+#include "FUSkeletonPublisher.h"
+
+/**
+ * @brief The layout of a session file. It has one row for every tracked player of every skeleton frame, and the rows are
+ * stored in row groups of columns, so a query reads only the columns it needs and scans them as arrays.
+ *
+ * All the values are little endian. The file starts with MAGIC and VERSION, then come the row groups. Every row group has the
+ * values of each column one after another, and every column chunk starts at a multiple of ALIGNMENT like the Arrow buffers.
+ * The file ends with the footer, the size of the footer as uint32 and MAGIC again. The footer is:
+ * - uint32 column count, then for every column its COLUMN_TYPE as uint8, its name length as uint8 and the name
+ * - uint32 row group count, then for every row group its row count as uint32 and the file offsets of its columns as uint64
+ */
+namespace FUSessionFile
+{
+enum COLUMN_TYPE {
+    INT64_COLUMN = 1,
+    UINT32_COLUMN = 2,
+    FLOAT_COLUMN = 3,
+    UINT8_COLUMN = 4
+};
+
+const char MAGIC[4] = {'F', 'U', 'S', 'C'};
+const uint32_t VERSION = 1;
+const int ALIGNMENT = 64;
+
+struct Column {
+    std::string name;
+    COLUMN_TYPE type;
+};
+
+struct RowGroup {
+    uint32_t rowCount;
+    std::vector<uint64_t> columnOffsets;
+};
+
+/**
+ * @brief Returns the columns of the session files. They are, in order: timeStamp, frameNumber, trackingID, trackingState,
+ * bodyScale, positionX/Y/Z, then x, y and z of every joint (e.g. handRightX), the tracking state of every joint
+ * (e.g. handRightState) and a 0/1 column for every detector (e.g. rightHandUp), see FUSharedSkeleton::Player::postures.
+ * @return
+ */
+const std::vector<Column>& getColumns();
+/**
+ * @brief Returns the size of a value of the type in bytes.
+ * @param type
+ * @return
+ */
+size_t getValueSize(COLUMN_TYPE type);
+}
+
+/**
+ * @brief Writes the processed skeleton frames to a session file for analytics. The rows are collected in a row group on the
+ * calling thread and the full row groups are written by a background thread, so write() never waits for the disk.
+ */
+class FUSessionExporter
+{
+public:
+    FUSessionExporter();
+    ~FUSessionExporter();
+    /**
+     * @brief Creates the file and starts the writer thread.
+     * @param filePath
+     * @param rowGroupSize --> Number of rows in a row group. Larger groups make faster scans but are written less often.
+     * @return false if the file can't be created
+     */
+    bool open(const char *filePath, int rowGroupSize = 4096);
+    /**
+     * @brief Writes the rows that are left and the footer, and closes the file.
+     */
+    void close();
+    bool isOpen() const {return mFile != nullptr;}
+    /**
+     * @brief Adds a row for every player of the frame. If the writer thread is behind by a few row groups, the rows are
+     * dropped and counted instead.
+     * @param frame --> Filled by FUSkeletonPublisher::fillFrame()
+     */
+    void write(const FUSharedSkeleton::Frame &frame);
+    /**
+     * @brief Returns the number of rows that were written or are waiting for the writer thread.
+     * @return
+     */
+    uint64_t getRowCount() const {return mRowCount;}
+    uint64_t getDroppedRowCount() const {return mDroppedRowCount;}
+    /**
+     * @brief Returns true if writing to the file failed. The rows after the failure are lost.
+     * @return
+     */
+    bool hasWriteFailed() const {return mHasWriteFailed.load();}
+
+private:
+    /**
+     * @brief The columns of a row group, every column at its offset from mColumnOffsets.
+     */
+    struct Batch {
+        std::vector<uint8_t> data;
+        uint32_t rowCount;
+    };
+
+    FILE *mFile;
+    uint32_t mRowGroupSize;
+    std::vector<size_t> mColumnOffsets;
+    std::vector<Batch> mBatches;
+    /**
+     * @brief The batch that write() fills. It belongs to the calling thread until it's queued for the writer.
+     */
+    Batch *mCurrentBatch;
+    uint64_t mRowCount;
+    uint64_t mDroppedRowCount;
+
+    std::thread mWriter;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Batch*> mFullBatches;
+    std::vector<Batch*> mFreeBatches;
+    bool mIsStopping;
+    std::atomic<bool> mHasWriteFailed;
+    /**
+     * @brief Only the writer thread uses these until it's joined.
+     */
+    uint64_t mFileOffset;
+    std::vector<FUSessionFile::RowGroup> mRowGroups;
+
+private:
+    void writerLoop();
+    bool writeRowGroup(const Batch &batch);
+    bool writeFooter();
+    bool writeBytes(const void *data, size_t size);
+    /**
+     * @brief Hands the current batch to the writer thread.
+     */
+    void queueCurrentBatch();
+    FUSessionExporter(const FUSessionExporter&);
+    FUSessionExporter& operator=(const FUSessionExporter&);
+};
+
+/**
+ * @brief Reads the columns of a session file one row group at a time.
+ */
+class FUSessionReader
+{
+public:
+    FUSessionReader();
+    ~FUSessionReader();
+    /**
+     * @brief Opens a session file and reads its footer.
+     * @param filePath
+     * @return false if the file can't be opened or it isn't a complete session file
+     */
+    bool open(const char *filePath);
+    void close();
+    bool isOpen() const {return mFile != nullptr;}
+
+    int getColumnCount() const {return static_cast<int>(mColumns.size());}
+    const FUSessionFile::Column& getColumn(int column) const {return mColumns[column];}
+    /**
+     * @brief Returns the index of the column with the name, or -1 if there isn't one.
+     * @param name
+     * @return
+     */
+    int findColumn(const char *name) const;
+    int getRowGroupCount() const {return static_cast<int>(mRowGroups.size());}
+    uint32_t getRowCount(int rowGroup) const {return mRowGroups[rowGroup].rowCount;}
+    /**
+     * @brief Reads the values of a column in a row group. They are valid until the next call.
+     * @param rowGroup
+     * @param column
+     * @return An array of getRowCount(rowGroup) values of the column's type, nullptr if the read fails
+     */
+    const void* readColumn(int rowGroup, int column);
+
+private:
+    FILE *mFile;
+    std::vector<FUSessionFile::Column> mColumns;
+    std::vector<FUSessionFile::RowGroup> mRowGroups;
+    /**
+     * @brief uint64_t so that the values of every type are aligned
+     */
+    std::vector<uint64_t> mColumnBuffer;
+
+private:
+    bool readFooter();
+    FUSessionReader(const FUSessionReader&);
+    FUSessionReader& operator=(const FUSessionReader&);
+};
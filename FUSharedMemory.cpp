@@ -0,0 +1,169 @@
+#include "FUSharedMemory.h"
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FUSharedMemory::FUSharedMemory()
+    : mData(nullptr)
+    , mSize(0)
+    , mName()
+    , mIsOwner(false)
+#ifdef _WIN32
+    , mHandle(nullptr)
+#endif
+{
+}
+
+FUSharedMemory::~FUSharedMemory()
+{
+    close();
+}
+
+#ifdef _WIN32
+bool FUSharedMemory::create(const char *name, size_t size)
+{
+    close();
+    //Local\ keeps the segment in the session, Global\ would need SeCreateGlobalPrivilege
+    mName = std::string("Local\\") + name;
+    const unsigned long long mappingSize = size;
+    mHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, static_cast<DWORD>(mappingSize >> 32),
+                                 static_cast<DWORD>(mappingSize & 0xFFFFFFFF), mName.c_str());
+    if (mHandle == nullptr)
+        return false;
+    mData = MapViewOfFile(mHandle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (mData == nullptr) {
+        close();
+        return false;
+    }
+    mSize = size;
+    mIsOwner = true;
+    return true;
+}
+
+bool FUSharedMemory::open(const char *name, bool isReadOnly)
+{
+    close();
+    mName = std::string("Local\\") + name;
+    mHandle = OpenFileMappingA(isReadOnly ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, FALSE, mName.c_str());
+    if (mHandle == nullptr)
+        return false;
+    mData = MapViewOfFile(mHandle, isReadOnly ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (mData == nullptr) {
+        close();
+        return false;
+    }
+    MEMORY_BASIC_INFORMATION info;
+    mSize = VirtualQuery(mData, &info, sizeof(info)) != 0 ? info.RegionSize : 0;
+    return true;
+}
+
+void FUSharedMemory::close()
+{
+    //The mapping is destroyed when the last process closes its handle
+    if (mData != nullptr)
+        UnmapViewOfFile(mData);
+    if (mHandle != nullptr)
+        CloseHandle(mHandle);
+    mData = nullptr;
+    mHandle = nullptr;
+    mSize = 0;
+    mIsOwner = false;
+}
+
+uint32_t FUSharedMemory::getProcessID()
+{
+    return GetCurrentProcessId();
+}
+
+bool FUSharedMemory::isProcessAlive(uint32_t processID)
+{
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processID);
+    if (process == nullptr)
+        return GetLastError() != ERROR_INVALID_PARAMETER;
+    DWORD exitCode = 0;
+    const bool isAlive = GetExitCodeProcess(process, &exitCode) == 0 || exitCode == STILL_ACTIVE;
+    CloseHandle(process);
+    return isAlive;
+}
+#else
+bool FUSharedMemory::create(const char *name, size_t size)
+{
+    close();
+    mName = std::string("/") + name;
+    const int fd = shm_open(mName.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        shm_unlink(mName.c_str());
+        return false;
+    }
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        shm_unlink(mName.c_str());
+        return false;
+    }
+    mData = data;
+    mSize = size;
+    mIsOwner = true;
+    return true;
+}
+
+bool FUSharedMemory::open(const char *name, bool isReadOnly)
+{
+    close();
+    mName = std::string("/") + name;
+    const int fd = shm_open(mName.c_str(), isReadOnly ? O_RDONLY : O_RDWR, 0);
+    if (fd < 0)
+        return false;
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(status.st_size);
+    void *data = mmap(nullptr, size, isReadOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    mData = data;
+    mSize = size;
+    return true;
+}
+
+void FUSharedMemory::close()
+{
+    if (mData != nullptr)
+        munmap(mData, mSize);
+    if (mIsOwner)
+        shm_unlink(mName.c_str());
+    mData = nullptr;
+    mSize = 0;
+    mIsOwner = false;
+}
+
+uint32_t FUSharedMemory::getProcessID()
+{
+    return static_cast<uint32_t>(getpid());
+}
+
+bool FUSharedMemory::isProcessAlive(uint32_t processID)
+{
+    //EPERM means that it exists but belongs to another user
+    return kill(static_cast<pid_t>(processID), 0) == 0 || errno != ESRCH;
+}
+#endif
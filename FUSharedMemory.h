@@ -0,0 +1,60 @@
+#pragma once
+//STL Includes
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief A named shared memory segment that other processes on the machine can map, a file mapping on Windows and a POSIX
+ * shared memory object elsewhere. The creator owns the name: it's removed when the creator closes the segment, the processes
+ * that still have it mapped keep their mapping.
+ */
+class FUSharedMemory
+{
+public:
+    FUSharedMemory();
+    ~FUSharedMemory();
+    /**
+     * @brief Creates the segment, or takes over a segment that a crashed process left behind. The memory is zero filled when
+     * the segment is new.
+     * @param name --> A plain name without slashes, e.g. "FUKinectSkeletons"
+     * @param size --> Size in bytes
+     * @return false if the segment can't be created
+     */
+    bool create(const char *name, size_t size);
+    /**
+     * @brief Maps a segment that another process created.
+     * @param name
+     * @param isReadOnly
+     * @return false if there's no segment with that name
+     */
+    bool open(const char *name, bool isReadOnly = true);
+    void close();
+    bool isOpen() const {return mData != nullptr;}
+    void* getData() const {return mData;}
+    /**
+     * @brief Returns the size of the mapping. For an opened segment this can be rounded up to the page size on Windows.
+     * @return
+     */
+    size_t getSize() const {return mSize;}
+    static uint32_t getProcessID();
+    /**
+     * @brief Returns false if the process exited, used to clean up after the readers that crashed.
+     * @param processID
+     * @return
+     */
+    static bool isProcessAlive(uint32_t processID);
+
+private:
+    void *mData;
+    size_t mSize;
+    std::string mName;
+    bool mIsOwner;
+#ifdef _WIN32
+    void *mHandle;
+#endif
+
+private:
+    FUSharedMemory(const FUSharedMemory&);
+    FUSharedMemory& operator=(const FUSharedMemory&);
+};
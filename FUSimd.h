@@ -0,0 +1,22 @@
+#pragma once
+/**
+ * FU_SSE2 is defined when SSE2 intrinsics are available. Everything that uses them has a scalar fallback.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FU_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/**
+ * FU_AVX2 is defined when AVX2 code can be compiled alongside the baseline code. Functions that use AVX2 intrinsics must be
+ * marked with FU_TARGET_AVX2 and must only be called after checking that the CPU supports it at runtime.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FU_AVX2 1
+#define FU_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && _MSC_VER >= 1700 && (defined(_M_X64) || defined(_M_IX86))
+#define FU_AVX2 1
+#define FU_TARGET_AVX2
+#include <immintrin.h>
+#endif
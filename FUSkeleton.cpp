@@ -0,0 +1,65 @@
+#include "FUSkeleton.h"
+//STL Includes
+#include <cmath>
+
+namespace FUSkeleton {
+//Once a bone is settled, measurements that differ more than this ratio from it are ignored
+static const float OUTLIER_RATIO = 0.3f;
+
+FUBodyScale::FUBodyScale()
+{
+    reset();
+}
+
+void FUBodyScale::reset()
+{
+    for (int bone = 0; bone < BONE_COUNT; bone++) {
+        mBones[bone].length = 0.f;
+        mBones[bone].sampleCount = 0;
+        mBones[bone].outlierCount = 0;
+    }
+    mScale = 1.f;
+    mIsCalibrated = false;
+}
+
+void FUBodyScale::update(const FUMath::FUVector3<float> *positions, const JOINT_TRACKING_STATE *trackingStates)
+{
+    float measuredLength = 0.f;
+    float referenceLength = 0.f;
+    int measuredBoneCount = 0;
+    for (int bone = 0; bone < BONE_COUNT; bone++) {
+        const JOINT child = getBoneChild(bone);
+        const JOINT parent = getBoneParent(bone);
+        BoneEstimate &estimate = mBones[bone];
+        if (trackingStates[child] == JOINT_TRACKED && trackingStates[parent] == JOINT_TRACKED) {
+            const float length = (positions[child] - positions[parent]).length();
+            const bool isOutlier = estimate.sampleCount >= MIN_SAMPLE_COUNT && std::abs(length - estimate.length) > OUTLIER_RATIO * estimate.length;
+            if (isOutlier && length > 0.f && ++estimate.outlierCount >= MAX_OUTLIER_COUNT) {
+                //The measurements disagree for too long, so the estimate was the wrong one
+                estimate.length = length;
+                estimate.sampleCount = 1;
+                estimate.outlierCount = 0;
+            }
+            else if (length > 0.f && !isOutlier) {
+                if (estimate.sampleCount < MAX_SAMPLE_COUNT)
+                    estimate.sampleCount++;
+                estimate.length += (length - estimate.length) / estimate.sampleCount;
+                estimate.outlierCount = 0;
+            }
+        }
+        if (estimate.sampleCount >= MIN_SAMPLE_COUNT) {
+            measuredLength += estimate.length;
+            referenceLength += REFERENCE_BONE_LENGTHS[bone];
+            measuredBoneCount++;
+        }
+    }
+    mIsCalibrated = measuredBoneCount >= MIN_BONE_COUNT;
+    mScale = mIsCalibrated ? measuredLength / referenceLength : 1.f;
+}
+
+float FUBodyScale::getBoneLength(int bone) const
+{
+    const BoneEstimate &estimate = mBones[bone];
+    return estimate.sampleCount >= MIN_SAMPLE_COUNT ? estimate.length : REFERENCE_BONE_LENGTHS[bone] * mScale;
+}
+}
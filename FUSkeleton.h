@@ -0,0 +1,208 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+//Local Includes
+#include "FUMath.h"
+
+/**
+ * The skeleton topology of the Kinect SDK, independent of the SDK. The joints are in the order of NUI_SKELETON_POSITION_INDEX,
+ * and every joint except HIP_CENTER is the child end of one bone, so bone b connects joint b + 1 to its parent.
+ */
+namespace FUSkeleton {
+enum JOINT {
+    HIP_CENTER = 0,
+    SPINE,
+    SHOULDER_CENTER,
+    HEAD,
+    SHOULDER_LEFT,
+    ELBOW_LEFT,
+    WRIST_LEFT,
+    HAND_LEFT,
+    SHOULDER_RIGHT,
+    ELBOW_RIGHT,
+    WRIST_RIGHT,
+    HAND_RIGHT,
+    HIP_LEFT,
+    KNEE_LEFT,
+    ANKLE_LEFT,
+    FOOT_LEFT,
+    HIP_RIGHT,
+    KNEE_RIGHT,
+    ANKLE_RIGHT,
+    FOOT_RIGHT,
+    JOINT_COUNT
+};
+
+/**
+ * Same values as NUI_SKELETON_POSITION_TRACKING_STATE
+ */
+enum JOINT_TRACKING_STATE {
+    JOINT_NOT_TRACKED = 0,
+    JOINT_INFERRED,
+    JOINT_TRACKED
+};
+
+/**
+ * Same values as NUI_SKELETON_TRACKING_STATE
+ */
+enum SKELETON_TRACKING_STATE {
+    SKELETON_NOT_TRACKED = 0,
+    SKELETON_POSITION_ONLY,
+    SKELETON_TRACKED
+};
+
+const int BONE_COUNT = JOINT_COUNT - 1;
+/**
+ * Same as NUI_SKELETON_COUNT
+ */
+const int MAX_SKELETONS = 6;
+
+/**
+ * @brief A skeleton in skeleton space, in meters. The counterpart of NUI_SKELETON_DATA.
+ */
+struct SkeletonData {
+    uint32_t trackingID;
+    SKELETON_TRACKING_STATE trackingState;
+    FUMath::FUVector3<float> position;
+    FUMath::FUVector3<float> joints[JOINT_COUNT];
+    JOINT_TRACKING_STATE jointStates[JOINT_COUNT];
+};
+
+/**
+ * @brief The counterpart of NUI_SKELETON_FRAME.
+ */
+struct SkeletonFrame {
+    int64_t timeStamp;
+    uint32_t frameNumber;
+    /**
+     * @brief ax + by + cz + w = 0 with (a, b, c) pointing up, all zero when the floor isn't known.
+     */
+    FUMath::FUVector4<float> floorPlane;
+    SkeletonData skeletons[MAX_SKELETONS];
+};
+
+/**
+ * Parent of every joint, the root is its own parent.
+ */
+constexpr JOINT PARENTS[JOINT_COUNT] = {
+    HIP_CENTER, HIP_CENTER, SPINE, SHOULDER_CENTER,
+    SHOULDER_CENTER, SHOULDER_LEFT, ELBOW_LEFT, WRIST_LEFT,
+    SHOULDER_CENTER, SHOULDER_RIGHT, ELBOW_RIGHT, WRIST_RIGHT,
+    HIP_CENTER, HIP_LEFT, KNEE_LEFT, ANKLE_LEFT,
+    HIP_CENTER, HIP_RIGHT, KNEE_RIGHT, ANKLE_RIGHT
+};
+
+/**
+ * Bone lengths of an adult of about 1.75 m in meters, as measured between the Kinect joints. Indexed by bone.
+ */
+constexpr float REFERENCE_BONE_LENGTHS[BONE_COUNT] = {
+    0.09f, 0.30f, 0.18f,//Spine, upper spine, neck
+    0.17f, 0.28f, 0.25f, 0.08f,//Left collarbone, upper arm, forearm, hand
+    0.17f, 0.28f, 0.25f, 0.08f,//Right collarbone, upper arm, forearm, hand
+    0.08f, 0.42f, 0.39f, 0.08f,//Left pelvis, thigh, shin, foot
+    0.08f, 0.42f, 0.39f, 0.08f//Right pelvis, thigh, shin, foot
+};
+
+constexpr JOINT getParent(JOINT joint)
+{
+    return PARENTS[joint];
+}
+
+constexpr JOINT getBoneChild(int bone)
+{
+    return static_cast<JOINT>(bone + 1);
+}
+
+constexpr JOINT getBoneParent(int bone)
+{
+    return PARENTS[bone + 1];
+}
+
+/**
+ * @brief Returns the number of bones between a joint and the root.
+ */
+constexpr int getDepth(JOINT joint)
+{
+    return joint == HIP_CENTER ? 0 : 1 + getDepth(getParent(joint));
+}
+
+/**
+ * @brief Returns true if ancestor is on the path from joint to the root, or is the joint itself.
+ */
+constexpr bool isAncestor(JOINT ancestor, JOINT joint)
+{
+    return joint == ancestor || (joint != HIP_CENTER && isAncestor(ancestor, getParent(joint)));
+}
+
+/**
+ * @brief Returns true if every parent comes before its children, so the joints can be walked from the root in index order.
+ */
+constexpr bool isTopologicallySorted(int joint = 1)
+{
+    return joint == JOINT_COUNT || (PARENTS[joint] < joint && isTopologicallySorted(joint + 1));
+}
+
+static_assert(isTopologicallySorted(), "The parents must come before their children");
+static_assert(getDepth(HAND_RIGHT) == 6 && getDepth(FOOT_LEFT) == 4, "Unexpected skeleton topology");
+
+/**
+ * @brief Estimates the bone lengths of one player from the tracked joints of every frame, and a body scale factor relative to
+ * the reference adult. Distances divided by the scale can be compared with thresholds that are tuned for an adult, so that
+ * the detectors work the same for children. Every bone length is a running average that is settled after MAX_SAMPLE_COUNT
+ * measurements. After that it moves slowly, and measurements that are far from it are ignored.
+ */
+class FUBodyScale
+{
+public:
+    /**
+     * @brief A bone needs this many measurements before it is used.
+     */
+    static const int MIN_SAMPLE_COUNT = 10;
+    static const int MAX_SAMPLE_COUNT = 120;
+    /**
+     * @brief A settled bone starts over from the new measurements when this many of them in a row were outliers, so bad
+     * first samples, e.g. inferred joints while the player walks in, don't stick.
+     */
+    static const int MAX_OUTLIER_COUNT = 30;
+    /**
+     * @brief The scale is 1 until this many bones are measured.
+     */
+    static const int MIN_BONE_COUNT = 6;
+
+public:
+    FUBodyScale();
+    /**
+     * @brief Forgets the measurements, e.g. when the player changes.
+     */
+    void reset();
+    /**
+     * @brief Measures the bones whose both joints are tracked.
+     * @param positions --> JOINT_COUNT positions in meters
+     * @param trackingStates --> JOINT_COUNT tracking states
+     */
+    void update(const FUMath::FUVector3<float> *positions, const JOINT_TRACKING_STATE *trackingStates);
+    /**
+     * @brief Returns the estimated body scale, 1 for the reference adult.
+     * @return
+     */
+    float getScale() const {return mScale;}
+    bool isCalibrated() const {return mIsCalibrated;}
+    /**
+     * @brief Returns the measured length of a bone, or the reference length times the scale if it isn't measured yet.
+     * @param bone --> 0 to BONE_COUNT - 1
+     * @return Length in meters
+     */
+    float getBoneLength(int bone) const;
+
+private:
+    struct BoneEstimate {
+        float length;
+        int sampleCount;
+        int outlierCount;//Consecutive outliers
+    };
+
+    BoneEstimate mBones[BONE_COUNT];
+    float mScale;
+    bool mIsCalibrated;
+};
+}
@@ -0,0 +1,391 @@
+#include "FUSkeletonCodec.h"
+//STL Includes
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+//Local Includes
+#include "FUSimd.h"
+#include "FUTrace.h"
+
+using namespace FUSkeleton;
+using namespace FUSkeletonCodec;
+
+static_assert(sizeof(FUMath::FUVector3<float>) == 16, "The SIMD paths load the joints as 4 floats");
+static_assert(JOINT_COUNT % 2 == 0 && HIP_CENTER == 0, "The joints are quantized in pairs");
+static_assert(MAX_PACKET_SIZE <= 1472, "A packet must fit into a single UDP datagram on Ethernet");
+
+template<typename T>
+static void write(uint8_t *&data, const T &value)
+{
+    std::memcpy(data, &value, sizeof(T));
+    data += sizeof(T);
+}
+
+template<typename T>
+static bool read(const uint8_t *&data, const uint8_t *end, T &value)
+{
+    if (end - data < static_cast<ptrdiff_t>(sizeof(T)))
+        return false;
+    std::memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+
+static void writeVarint(uint8_t *&data, int32_t value)
+{
+    //Zigzag, so that small negative numbers are small too
+    uint32_t bits = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    while (bits >= 0x80) {
+        *data++ = static_cast<uint8_t>(bits | 0x80);
+        bits >>= 7;
+    }
+    *data++ = static_cast<uint8_t>(bits);
+}
+
+static size_t getVarintSize(int32_t value)
+{
+    uint32_t bits = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    size_t size = 1;
+    while (bits >= 0x80) {
+        bits >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static bool readVarint(const uint8_t *&data, const uint8_t *end, int32_t &value)
+{
+    uint32_t bits = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (data == end)
+            return false;
+        const uint8_t byte = *data++;
+        bits |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            value = static_cast<int32_t>(bits >> 1) ^ -static_cast<int32_t>(bits & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static int16_t toFixed(float value, float scale)
+{
+    //lrint() rounds like the SIMD conversion
+    const long fixed = std::lrint(value * scale);
+    return static_cast<int16_t>(fixed > 32767 ? 32767 : (fixed < -32768 ? -32768 : fixed));
+}
+
+static void setFixed(int16_t *value, const FUMath::FUVector3<float> &vector, float scale)
+{
+    value[0] = toFixed(vector.x, scale);
+    value[1] = toFixed(vector.y, scale);
+    value[2] = toFixed(vector.z, scale);
+    value[3] = 0;
+}
+
+static FUMath::FUVector3<float> getVector(const int16_t *value, float scale)
+{
+    return FUMath::FUVector3<float>(value[0] / scale, value[1] / scale, value[2] / scale);
+}
+
+namespace FUSkeletonCodec
+{
+void quantize(const SkeletonData &skeleton, QuantizedPlayer &output)
+{
+    output.trackingID = skeleton.trackingID;
+    output.trackingState = skeleton.trackingState;
+    if (skeleton.trackingState != SKELETON_TRACKED)
+        std::memset(output.values, 0, sizeof(int16_t) * 4 * JOINT_COUNT);
+    else {
+#ifdef FU_SSE2
+        const __m128 hip = _mm_load_ps(&skeleton.joints[HIP_CENTER].x);
+        const __m128 scale = _mm_set1_ps(RELATIVE_SCALE);
+        const __m128 xyz = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+        for (int i = 0; i < JOINT_COUNT; i += 2) {
+            const __m128 a = _mm_and_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(&skeleton.joints[i].x), hip), scale), xyz);
+            const __m128 b = _mm_and_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(&skeleton.joints[i + 1].x), hip), scale), xyz);
+            //packs saturates the joints that are farther than the range
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output.values[i]), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+        }
+#else
+        const FUMath::FUVector3<float> &hip = skeleton.joints[HIP_CENTER];
+        for (int i = 1; i < JOINT_COUNT; i++)
+            setFixed(output.values[i], skeleton.joints[i] - hip, RELATIVE_SCALE);
+#endif
+        setFixed(output.values[HIP_CENTER], skeleton.joints[HIP_CENTER], POSITION_SCALE);
+    }
+    setFixed(output.values[JOINT_COUNT], skeleton.position, POSITION_SCALE);
+}
+
+void dequantize(const QuantizedPlayer &player, SkeletonData &output)
+{
+    output.trackingID = player.trackingID;
+    output.trackingState = player.trackingState;
+    output.position = getVector(player.values[JOINT_COUNT], POSITION_SCALE);
+    if (player.trackingState != SKELETON_TRACKED) {
+        for (int i = 0; i < JOINT_COUNT; i++)
+            output.joints[i] = FUMath::FUVector3<float>();
+        return;
+    }
+    const FUMath::FUVector3<float> hip = getVector(player.values[HIP_CENTER], POSITION_SCALE);
+#ifdef FU_SSE2
+    const __m128 hipVector = _mm_set_ps(0.f, hip.z, hip.y, hip.x);
+    const __m128 scale = _mm_set1_ps(1.f / RELATIVE_SCALE);
+    for (int i = 0; i < JOINT_COUNT; i += 2) {
+        const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(player.values[i]));
+        //Sign extends the int16s to int32s
+        const __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+        const __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+        _mm_store_ps(&output.joints[i].x, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(a), scale), hipVector));
+        _mm_store_ps(&output.joints[i + 1].x, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(b), scale), hipVector));
+    }
+#else
+    for (int i = 1; i < JOINT_COUNT; i++)
+        output.joints[i] = getVector(player.values[i], RELATIVE_SCALE) + hip;
+#endif
+    output.joints[HIP_CENTER] = hip;
+}
+
+uint32_t getChangedValues(const QuantizedPlayer &a, const QuantizedPlayer &b)
+{
+    uint32_t changed = 0;
+#ifdef FU_SSE2
+    for (int i = 0; i < JOINT_COUNT; i += 2) {
+        const __m128i equal = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a.values[i])),
+                                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.values[i])));
+        const int mask = _mm_movemask_epi8(equal);
+        if ((mask & 0xFF) != 0xFF)
+            changed |= 1u << i;
+        if ((mask & 0xFF00) != 0xFF00)
+            changed |= 1u << (i + 1);
+    }
+#else
+    for (int i = 0; i < JOINT_COUNT; i++) {
+        if (std::memcmp(a.values[i], b.values[i], sizeof(a.values[i])) != 0)
+            changed |= 1u << i;
+    }
+#endif
+    if (std::memcmp(a.values[JOINT_COUNT], b.values[JOINT_COUNT], sizeof(a.values[JOINT_COUNT])) != 0)
+        changed |= 1u << JOINT_COUNT;
+    return changed;
+}
+}
+
+FUSkeletonEncoder::FUSkeletonEncoder(int keyFrameInterval)
+    : mPlayerCount(0)
+    , mFloorPlane()
+    , mSession(0)
+    , mSequence(0)
+    , mKeyFrameInterval(keyFrameInterval > 0 ? keyFrameInterval : 1)
+    , mPacketsSinceKeyFrame(mKeyFrameInterval)
+{
+    //random_device can be deterministic on some platforms, the clock keeps two runs apart anyway
+    std::random_device device;
+    mSession = device() ^ static_cast<uint32_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+}
+
+size_t FUSkeletonEncoder::encode(const SkeletonFrame &frame, uint8_t *buffer)
+{
+    FU_TRACE_SCOPE(FUTrace::SKELETON, "FUSkeletonEncoder::encode");
+    const bool isKeyFrame = mPacketsSinceKeyFrame >= mKeyFrameInterval;
+    mPacketsSinceKeyFrame = isKeyFrame ? 1 : mPacketsSinceKeyFrame + 1;
+    const bool hasFloor = isKeyFrame || std::memcmp(&frame.floorPlane, &mFloorPlane, sizeof(float) * 4) != 0;
+    uint8_t *data = buffer;
+    write(data, MAGIC);
+    write(data, VERSION);
+    write(data, static_cast<uint8_t>((isKeyFrame ? KEY_FRAME : 0) | (hasFloor ? HAS_FLOOR : 0)));
+    write(data, mSession);
+    write(data, mSequence++);
+    write(data, frame.frameNumber);
+    write(data, frame.timeStamp);
+    if (hasFloor) {
+        write(data, frame.floorPlane.x);
+        write(data, frame.floorPlane.y);
+        write(data, frame.floorPlane.z);
+        write(data, frame.floorPlane.w);
+        mFloorPlane = frame.floorPlane;
+    }
+    uint8_t *playerCount = data++;
+    QuantizedPlayer players[MAX_SKELETONS];
+    int count = 0;
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        const SkeletonData &skeleton = frame.skeletons[i];
+        if (skeleton.trackingState == SKELETON_NOT_TRACKED)
+            continue;
+        QuantizedPlayer &player = players[count++];
+        quantize(skeleton, player);
+        const QuantizedPlayer *previous = nullptr;
+        for (int j = 0; j < mPlayerCount && !isKeyFrame && previous == nullptr; j++) {
+            if (mPlayers[j].trackingID == player.trackingID)
+                previous = &mPlayers[j];
+        }
+        const int firstKeyValue = player.trackingState == SKELETON_TRACKED ? 0 : JOINT_COUNT;
+        uint32_t changed = 0;
+        if (previous) {
+            //Large moves can make the delta larger than the key, which would overflow MAX_PACKET_SIZE
+            changed = getChangedValues(player, *previous);
+            size_t deltaSize = DELTA_MASK_SIZE;
+            for (int j = 0; j < VALUE_COUNT; j++) {
+                if ((changed & (1u << j)) == 0)
+                    continue;
+                for (int k = 0; k < 3; k++)
+                    deltaSize += getVarintSize(player.values[j][k] - previous->values[j][k]);
+            }
+            if (deltaSize > static_cast<size_t>(VALUE_COUNT - firstKeyValue) * 6)
+                previous = nullptr;
+        }
+        write(data, player.trackingID);
+        write(data, static_cast<uint8_t>(player.trackingState | (previous ? 0 : KEY_PLAYER)));
+        std::memset(data, 0, JOINT_STATE_SIZE);
+        for (int j = 0; j < JOINT_COUNT; j++)
+            data[j / 4] |= static_cast<uint8_t>((skeleton.jointStates[j] & 3) << (j % 4 * 2));
+        data += JOINT_STATE_SIZE;
+        if (previous == nullptr) {
+            for (int j = firstKeyValue; j < VALUE_COUNT; j++) {
+                write(data, player.values[j][0]);
+                write(data, player.values[j][1]);
+                write(data, player.values[j][2]);
+            }
+            continue;
+        }
+        for (int j = 0; j < DELTA_MASK_SIZE; j++)
+            *data++ = static_cast<uint8_t>(changed >> (j * 8));
+        for (int j = 0; j < VALUE_COUNT; j++) {
+            if ((changed & (1u << j)) == 0)
+                continue;
+            for (int k = 0; k < 3; k++)
+                writeVarint(data, player.values[j][k] - previous->values[j][k]);
+        }
+    }
+    *playerCount = static_cast<uint8_t>(count);
+    std::memcpy(mPlayers, players, sizeof(QuantizedPlayer) * count);
+    mPlayerCount = count;
+    return data - buffer;
+}
+
+FUSkeletonDecoder::FUSkeletonDecoder()
+    : mPlayerCount(0)
+    , mFloorPlane()
+    , mSession(0)
+    , mSequence(0)
+    , mHasSequence(false)
+    , mHasReference(false)
+    , mLostPacketCount(0)
+    , mLatePacketCount(0)
+    , mRestartCount(0)
+{
+}
+
+bool FUSkeletonDecoder::decode(const uint8_t *packet, size_t size, SkeletonFrame &frame)
+{
+    const uint8_t *data = packet;
+    const uint8_t *end = packet + size;
+    uint16_t magic = 0;
+    uint8_t version = 0;
+    uint8_t flags = 0;
+    uint32_t session = 0;
+    uint32_t sequence = 0;
+    if (!read(data, end, magic) || !read(data, end, version) || !read(data, end, flags) || !read(data, end, session)
+            || !read(data, end, sequence) || magic != MAGIC || version != VERSION)
+        return false;
+    //A new session means the sender restarted its sequence, so the decoder starts over from it. Late packets of the same
+    //session are ignored, they would be deltas of older packets.
+    if (mHasSequence && session != mSession) {
+        mHasSequence = false;
+        mHasReference = false;
+        mLostPacketCount = 0;
+        mRestartCount++;
+    }
+    int32_t distance = static_cast<int32_t>(sequence - mSequence);
+    if (mHasSequence && distance <= 0) {
+        mLatePacketCount++;
+        return false;
+    }
+    if (mHasSequence)
+        mLostPacketCount += distance - 1;
+    else
+        distance = 1;
+    mSession = session;
+    mSequence = sequence;
+    mHasSequence = true;
+    if ((flags & KEY_FRAME) == 0 && (!mHasReference || distance != 1)) {
+        //The deltas until the next key frame are lost too
+        mHasReference = false;
+        mLostPacketCount++;
+        return false;
+    }
+    mHasReference = false;
+
+    SkeletonFrame output = SkeletonFrame();
+    FUMath::FUVector4<float> floorPlane = mFloorPlane;
+    if (!read(data, end, output.frameNumber) || !read(data, end, output.timeStamp))
+        return false;
+    if ((flags & HAS_FLOOR) && (!read(data, end, floorPlane.x) || !read(data, end, floorPlane.y) || !read(data, end, floorPlane.z)
+                                || !read(data, end, floorPlane.w)))
+        return false;
+    output.floorPlane = floorPlane;
+    uint8_t count = 0;
+    if (!read(data, end, count) || count > MAX_SKELETONS)
+        return false;
+    QuantizedPlayer players[MAX_SKELETONS];
+    for (int i = 0; i < count; i++) {
+        QuantizedPlayer &player = players[i];
+        uint8_t playerFlags = 0;
+        if (!read(data, end, player.trackingID) || !read(data, end, playerFlags) || end - data < JOINT_STATE_SIZE)
+            return false;
+        player.trackingState = static_cast<SKELETON_TRACKING_STATE>(playerFlags & TRACKING_STATE_MASK);
+        SkeletonData &skeleton = output.skeletons[i];
+        for (int j = 0; j < JOINT_COUNT; j++)
+            skeleton.jointStates[j] = static_cast<JOINT_TRACKING_STATE>((data[j / 4] >> (j % 4 * 2)) & 3);
+        data += JOINT_STATE_SIZE;
+        if (playerFlags & KEY_PLAYER) {
+            std::memset(player.values, 0, sizeof(player.values));
+            for (int j = (player.trackingState == SKELETON_TRACKED ? 0 : JOINT_COUNT); j < VALUE_COUNT; j++) {
+                if (!read(data, end, player.values[j][0]) || !read(data, end, player.values[j][1]) || !read(data, end, player.values[j][2]))
+                    return false;
+            }
+        }
+        else {
+            const QuantizedPlayer *previous = nullptr;
+            for (int j = 0; j < mPlayerCount && previous == nullptr; j++) {
+                if (mPlayers[j].trackingID == player.trackingID)
+                    previous = &mPlayers[j];
+            }
+            if (previous == nullptr || end - data < DELTA_MASK_SIZE)
+                return false;
+            uint32_t changed = 0;
+            for (int j = 0; j < DELTA_MASK_SIZE; j++)
+                changed |= static_cast<uint32_t>(*data++) << (j * 8);
+            std::memcpy(player.values, previous->values, sizeof(player.values));
+            for (int j = 0; j < VALUE_COUNT; j++) {
+                if ((changed & (1u << j)) == 0)
+                    continue;
+                for (int k = 0; k < 3; k++) {
+                    int32_t difference = 0;
+                    if (!readVarint(data, end, difference))
+                        return false;
+                    player.values[j][k] = static_cast<int16_t>(player.values[j][k] + difference);
+                }
+            }
+        }
+        dequantize(player, skeleton);
+    }
+    std::memcpy(mPlayers, players, sizeof(QuantizedPlayer) * count);
+    mPlayerCount = count;
+    mFloorPlane = floorPlane;
+    mHasReference = true;
+    frame = output;
+    return true;
+}
+
+void FUSkeletonDecoder::reset()
+{
+    mPlayerCount = 0;
+    mHasSequence = false;
+    mHasReference = false;
+    mLostPacketCount = 0;
+    mLatePacketCount = 0;
+    mRestartCount = 0;
+}
@@ -0,0 +1,171 @@
+#pragma once
+//STL Includes
+#include <cstddef>
+#include <cstdint>
+//Local Includes
+#include "FUSkeleton.h"
+
+/**
+ * @brief The wire format of FUSkeletonEncoder. Everything is little endian.
+ * A packet is the magic (uint16), the version (uint8), PACKET_FLAGS (uint8), the session (uint32) that the encoder picks at
+ * random when it's created, the packet sequence (uint32), the frame number (uint32), the time stamp (int64), the floor plane (4 floats) if HAS_FLOOR is set, the player count (uint8) and the players.
+ * A player is its tracking ID (uint32), a flags byte with the tracking state in the lower two bits and KEY_PLAYER, and the joint
+ * tracking states as 2 bit fields (JOINT_STATE_SIZE bytes). Then its values:
+ * - Position and the hip center in millimeters, and the other joints relative to the hip center in RELATIVE_SCALE units, all
+ * as int16. Position only players only have their position.
+ * - In a delta, a VALUE_COUNT bit mask (DELTA_MASK_SIZE bytes) of the values that changed since the previous packet, then the
+ * x, y and z differences of every changed value as zigzag varints. Only the players that were in the previous packet can be
+ * deltas, the others are sent with KEY_PLAYER. A player whose delta would be larger than its key is sent with KEY_PLAYER too,
+ * so a packet is never larger than a key frame.
+ */
+namespace FUSkeletonCodec
+{
+enum PACKET_FLAGS {
+    KEY_FRAME = 1 << 0,//Every player is a key, the decoder can start from this packet
+    HAS_FLOOR = 1 << 1
+};
+
+enum PLAYER_FLAGS {
+    TRACKING_STATE_MASK = 3,
+    KEY_PLAYER = 1 << 2
+};
+
+const uint16_t MAGIC = 0x5346;//"FS"
+const uint8_t VERSION = 2;
+/**
+ * @brief Joint offsets are in 1/RELATIVE_SCALE meters, so they cover +-16 m with half a millimeter resolution.
+ */
+const float RELATIVE_SCALE = 2000.f;
+const float POSITION_SCALE = 1000.f;
+/**
+ * @brief The joints, then the position
+ */
+const int VALUE_COUNT = FUSkeleton::JOINT_COUNT + 1;
+const int JOINT_STATE_SIZE = (FUSkeleton::JOINT_COUNT * 2 + 7) / 8;
+const int DELTA_MASK_SIZE = (VALUE_COUNT + 7) / 8;
+/**
+ * @brief The size of a tracked player with KEY_PLAYER, no player is encoded larger than this.
+ */
+const size_t MAX_PLAYER_SIZE = 4 + 1 + JOINT_STATE_SIZE + VALUE_COUNT * 6;
+/**
+ * @brief The size of a key frame with MAX_SKELETONS players, which is the largest packet. It fits into a single Ethernet frame.
+ */
+const size_t MAX_PACKET_SIZE = 2 + 1 + 1 + 4 + 4 + 4 + 8 + 16 + 1 + FUSkeleton::MAX_SKELETONS * MAX_PLAYER_SIZE;
+
+/**
+ * @brief The quantized values of a player. The fourth lane of every value is padding that is kept at 0.
+ */
+struct QuantizedPlayer {
+    uint32_t trackingID;
+    FUSkeleton::SKELETON_TRACKING_STATE trackingState;
+    int16_t values[VALUE_COUNT][4];
+};
+
+/**
+ * @brief Quantizes the joints of a skeleton relative to its hip center, and its position.
+ * @param skeleton
+ * @param output
+ */
+void quantize(const FUSkeleton::SkeletonData &skeleton, QuantizedPlayer &output);
+/**
+ * @brief The inverse of quantize(), the joint tracking states aren't touched.
+ * @param player
+ * @param output
+ */
+void dequantize(const QuantizedPlayer &player, FUSkeleton::SkeletonData &output);
+/**
+ * @brief Returns a VALUE_COUNT bit mask of the values that differ.
+ * @param a
+ * @param b
+ * @return
+ */
+uint32_t getChangedValues(const QuantizedPlayer &a, const QuantizedPlayer &b);
+}
+
+/**
+ * @brief Encodes skeleton frames into compact packets for the network. The joints are quantized to 16 bits and sent as
+ * differences from the previous packet, with a key frame every few packets so that a receiver can recover from a lost packet.
+ */
+class FUSkeletonEncoder
+{
+public:
+    /**
+     * @param keyFrameInterval --> A key frame is sent every keyFrameInterval packets, 1 sends only key frames
+     */
+    explicit FUSkeletonEncoder(int keyFrameInterval = 30);
+    void setKeyFrameInterval(int keyFrameInterval) {mKeyFrameInterval = keyFrameInterval > 0 ? keyFrameInterval : 1;}
+    /**
+     * @brief Makes the next packet a key frame, e.g. when a receiver joins.
+     */
+    void forceKeyFrame() {mPacketsSinceKeyFrame = mKeyFrameInterval;}
+    /**
+     * @brief Encodes a frame. The skeletons that aren't tracked are skipped.
+     * @param frame
+     * @param buffer --> Output, has room for at least MAX_PACKET_SIZE bytes
+     * @return The size of the packet in bytes
+     */
+    size_t encode(const FUSkeleton::SkeletonFrame &frame, uint8_t *buffer);
+
+private:
+    FUSkeletonCodec::QuantizedPlayer mPlayers[FUSkeleton::MAX_SKELETONS];
+    int mPlayerCount;
+    FUMath::FUVector4<float> mFloorPlane;
+    /**
+     * @brief Tells the decoder that a new encoder started, since the sequence starts over with it
+     */
+    uint32_t mSession;
+    uint32_t mSequence;
+    int mKeyFrameInterval;
+    int mPacketsSinceKeyFrame;
+};
+
+/**
+ * @brief Decodes the packets of an FUSkeletonEncoder. A delta can only be decoded right after the packet before it, so after
+ * a lost packet the deltas are rejected until the next key frame. A packet with a different session than the last one comes
+ * from a restarted sender, and the decoder starts over from it. Reordered and duplicated packets of the same session are late.
+ */
+class FUSkeletonDecoder
+{
+public:
+    FUSkeletonDecoder();
+    /**
+     * @brief Decodes a packet into a frame. The players are packed into the first skeleton slots.
+     * @param packet
+     * @param size
+     * @param frame --> Output
+     * @return false if the packet is broken or it's a delta that can't be decoded
+     */
+    bool decode(const uint8_t *packet, size_t size, FUSkeleton::SkeletonFrame &frame);
+    /**
+     * @brief Returns the number of packets that were missing, or that were deltas that couldn't be decoded because a packet
+     * before them was missing. It starts over when the sender restarts.
+     * @return
+     */
+    uint32_t getLostPacketCount() const {return mLostPacketCount;}
+    /**
+     * @brief Returns the number of packets that were dropped because they came after a newer packet.
+     * @return
+     */
+    uint32_t getLatePacketCount() const {return mLatePacketCount;}
+    /**
+     * @brief Returns the number of times the sender restarted its sequence.
+     * @return
+     */
+    uint32_t getRestartCount() const {return mRestartCount;}
+    void reset();
+
+private:
+    FUSkeletonCodec::QuantizedPlayer mPlayers[FUSkeleton::MAX_SKELETONS];
+    int mPlayerCount;
+    FUMath::FUVector4<float> mFloorPlane;
+    uint32_t mSession;
+    uint32_t mSequence;
+    bool mHasSequence;
+    /**
+     * @brief False when the last packet couldn't be decoded, so a delta can't be decoded either
+     */
+    bool mHasReference;
+    uint32_t mLostPacketCount;
+    uint32_t mLatePacketCount;
+    uint32_t mRestartCount;
+};
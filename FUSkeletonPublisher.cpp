@@ -0,0 +1,244 @@
+#include "FUSkeletonPublisher.h"
+//STL Includes
+#include <cstring>
+#include <new>
+
+using namespace FUSkeleton;
+using namespace FUSharedSkeleton;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "The shared memory needs address free atomics");
+
+static const size_t SEGMENT_SIZE = sizeof(Header) + sizeof(Slot) * SLOT_COUNT;
+/**
+ * @brief The detectors that FUFrameProcessor::evaluateDetectors() evaluates for the postures
+ */
+static const unsigned int POSTURE_DETECTORS = FUGesture::ALL_DETECTORS & ~(FUGesture::PUSH | FUGesture::GRIP | FUGesture::JUMPING);
+
+static const Slot* getSlots(const Header *header)
+{
+    return reinterpret_cast<const Slot*>(header + 1);
+}
+
+static void copyVector(const FUMath::FUVector3<float> &vector, float *output)
+{
+    output[0] = vector.x;
+    output[1] = vector.y;
+    output[2] = vector.z;
+}
+
+FUSkeletonPublisher::FUSkeletonPublisher()
+    : mSharedMemory()
+    , mHeader(nullptr)
+    , mSlots(nullptr)
+    , mPublishedCount(0)
+{
+}
+
+FUSkeletonPublisher::~FUSkeletonPublisher()
+{
+    close();
+}
+
+bool FUSkeletonPublisher::open(const char *name)
+{
+    close();
+    if (!mSharedMemory.create(name, SEGMENT_SIZE))
+        return false;
+    uint8_t *data = static_cast<uint8_t*>(mSharedMemory.getData());
+    mHeader = new (data) Header;
+    //The readers that are still mapping a segment from a previous run ignore it until it's initialized again
+    mHeader->magic.store(0, std::memory_order_release);
+    mHeader->version = VERSION;
+    mHeader->slotCount = SLOT_COUNT;
+    mHeader->frameSize = sizeof(Frame);
+    mHeader->publishedCount.store(0, std::memory_order_relaxed);
+    mSlots = reinterpret_cast<Slot*>(data + sizeof(Header));
+    for (uint32_t i = 0; i < SLOT_COUNT; i++) {
+        Slot *slot = new (mSlots + i) Slot;
+        slot->sequence.store(0, std::memory_order_relaxed);
+        slot->reserved = 0;
+        std::memset(&slot->frame, 0, sizeof(Frame));
+    }
+    mPublishedCount = 0;
+    mHeader->magic.store(MAGIC, std::memory_order_release);
+    return true;
+}
+
+void FUSkeletonPublisher::close()
+{
+    if (mHeader != nullptr)
+        mHeader->magic.store(0, std::memory_order_release);
+    mSharedMemory.close();
+    mHeader = nullptr;
+    mSlots = nullptr;
+}
+
+Frame* FUSkeletonPublisher::beginFrame()
+{
+    if (mSlots == nullptr)
+        return nullptr;
+    Slot &slot = mSlots[mPublishedCount % SLOT_COUNT];
+    slot.sequence.store(mPublishedCount * 2 + 1, std::memory_order_relaxed);
+    //Keeps the writes to the frame after the odd sequence
+    std::atomic_thread_fence(std::memory_order_release);
+    return &slot.frame;
+}
+
+void FUSkeletonPublisher::endFrame()
+{
+    if (mSlots == nullptr)
+        return;
+    Slot &slot = mSlots[mPublishedCount % SLOT_COUNT];
+    slot.sequence.store(mPublishedCount * 2 + 2, std::memory_order_release);
+    mPublishedCount++;
+    mHeader->publishedCount.store(mPublishedCount, std::memory_order_release);
+}
+
+void FUSkeletonPublisher::fillFrame(Frame &frame, const SkeletonFrame &skeletonFrame, const FUFrameProcessor &processor)
+{
+    frame.timeStamp = skeletonFrame.timeStamp;
+    frame.frameNumber = skeletonFrame.frameNumber;
+    frame.floorPlane[0] = skeletonFrame.floorPlane.x;
+    frame.floorPlane[1] = skeletonFrame.floorPlane.y;
+    frame.floorPlane[2] = skeletonFrame.floorPlane.z;
+    frame.floorPlane[3] = skeletonFrame.floorPlane.w;
+    uint32_t playerCount = 0;
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        const SkeletonData &skeleton = skeletonFrame.skeletons[i];
+        if (skeleton.trackingState == SKELETON_NOT_TRACKED)
+            continue;
+        Player &player = frame.players[playerCount++];
+        std::memset(player.hands, 0, sizeof(player.hands));
+        player.trackingID = skeleton.trackingID;
+        player.trackingState = skeleton.trackingState;
+        player.bodyScale = processor.getBodyScale(skeleton.trackingID);
+        player.postures = 0;
+        if (skeleton.trackingState == SKELETON_TRACKED) {
+            player.postures = FUFrameProcessor::evaluateDetectors(skeleton, POSTURE_DETECTORS, player.bodyScale);
+            if (processor.isAirborne(skeleton.trackingID))
+                player.postures |= FUGesture::JUMPING;
+        }
+        copyVector(skeleton.position, player.position);
+        for (int j = 0; j < JOINT_COUNT; j++) {
+            copyVector(skeleton.joints[j], player.joints[j]);
+            player.jointStates[j] = static_cast<uint8_t>(skeleton.jointStates[j]);
+        }
+    }
+    frame.playerCount = playerCount;
+}
+
+void FUSkeletonPublisher::publish(const SkeletonFrame &skeletonFrame, const FUFrameProcessor &processor)
+{
+    Frame *frame = beginFrame();
+    if (frame == nullptr)
+        return;
+    fillFrame(*frame, skeletonFrame, processor);
+    endFrame();
+}
+
+FUSkeletonReader::FUSkeletonReader()
+    : mSharedMemory()
+    , mHeader(nullptr)
+    , mSlots(nullptr)
+    , mNextFrame(0)
+    , mMissedFrameCount(0)
+{
+}
+
+bool FUSkeletonReader::open(const char *name)
+{
+    close();
+    if (!mSharedMemory.open(name) || mSharedMemory.getSize() < SEGMENT_SIZE)
+        return false;
+    const Header *header = static_cast<const Header*>(mSharedMemory.getData());
+    if (header->magic.load(std::memory_order_acquire) != MAGIC || header->version != VERSION
+            || header->slotCount != SLOT_COUNT || header->frameSize != sizeof(Frame)) {
+        mSharedMemory.close();
+        return false;
+    }
+    mHeader = header;
+    mSlots = getSlots(header);
+    mNextFrame = header->publishedCount.load(std::memory_order_acquire);
+    mMissedFrameCount = 0;
+    return true;
+}
+
+void FUSkeletonReader::close()
+{
+    mSharedMemory.close();
+    mHeader = nullptr;
+    mSlots = nullptr;
+}
+
+bool FUSkeletonReader::readNext(Frame &frame)
+{
+    if (mHeader == nullptr)
+        return false;
+    uint64_t publishedCount = mHeader->publishedCount.load(std::memory_order_acquire);
+    //The publisher started over
+    if (publishedCount < mNextFrame)
+        mNextFrame = publishedCount;
+    while (mNextFrame < publishedCount) {
+        if (publishedCount - mNextFrame > SLOT_COUNT) {
+            mMissedFrameCount += publishedCount - SLOT_COUNT - mNextFrame;
+            mNextFrame = publishedCount - SLOT_COUNT;
+        }
+        if (readFrame(mNextFrame++, frame))
+            return true;
+        //Overwritten while it was copied
+        mMissedFrameCount++;
+        publishedCount = mHeader->publishedCount.load(std::memory_order_acquire);
+    }
+    return false;
+}
+
+bool FUSkeletonReader::readLatest(Frame &frame)
+{
+    View view;
+    while (beginRead(view)) {
+        std::memcpy(&frame, view.frame, sizeof(Frame));
+        if (endRead(view))
+            return true;
+        mMissedFrameCount++;
+    }
+    return false;
+}
+
+bool FUSkeletonReader::beginRead(View &view)
+{
+    if (mHeader == nullptr)
+        return false;
+    const uint64_t publishedCount = mHeader->publishedCount.load(std::memory_order_acquire);
+    if (publishedCount < mNextFrame)
+        mNextFrame = publishedCount;
+    if (publishedCount == mNextFrame)
+        return false;
+    const uint64_t index = publishedCount - 1;
+    const Slot &slot = mSlots[index % SLOT_COUNT];
+    view.frame = &slot.frame;
+    view.sequence = index * 2 + 2;
+    mMissedFrameCount += index - mNextFrame;
+    mNextFrame = index + 1;
+    //If the slot is already taken by a newer frame endRead() fails
+    return true;
+}
+
+bool FUSkeletonReader::endRead(const View &view)
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (mSlots == nullptr)
+        return false;
+    const Slot &slot = mSlots[(view.sequence / 2 - 1) % SLOT_COUNT];
+    return slot.sequence.load(std::memory_order_relaxed) == view.sequence;
+}
+
+bool FUSkeletonReader::readFrame(uint64_t index, Frame &frame) const
+{
+    const Slot &slot = mSlots[index % SLOT_COUNT];
+    const uint64_t sequence = index * 2 + 2;
+    if (slot.sequence.load(std::memory_order_acquire) != sequence)
+        return false;
+    std::memcpy(&frame, &slot.frame, sizeof(Frame));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == sequence;
+}
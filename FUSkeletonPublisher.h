@@ -0,0 +1,207 @@
+#pragma once
+//STL Includes
+#include <atomic>
+#include <cstdint>
+//Local Includes
+#include "FUFrameProcessor.h"
+#include "FUSharedMemory.h"
+#include "FUSkeleton.h"
+
+/**
+ * @brief The layout of the shared memory segment of FUSkeletonPublisher. Everything is plain data so that readers written in
+ * other languages can map it too. The segment is a Header followed by SLOT_COUNT Slots. Frame n is written to slot
+ * n % SLOT_COUNT; the sequence of its slot is 2n + 1 while it's written and 2n + 2 when it's done. publishedCount is the number
+ * of frames that were published, so the last one is publishedCount - 1.
+ */
+namespace FUSharedSkeleton
+{
+enum HAND_FLAGS {
+    HAND_TRACKED = 1 << 0,
+    HAND_PRIMARY = 1 << 1,
+    HAND_PRESSED = 1 << 2,
+    HAND_GRIPPING = 1 << 3
+};
+
+struct Hand {
+    uint32_t handType;//FUGesture::HAND_TYPE
+    uint32_t flags;//HAND_FLAGS
+    float x;
+    float y;
+    float pressExtent;
+};
+
+struct Player {
+    uint32_t trackingID;
+    uint32_t trackingState;//FUSkeleton::SKELETON_TRACKING_STATE
+    /**
+     * @brief The detectors that are active in this frame as FUGesture::DETECTORS flags. JUMPING is set while the player is
+     * airborne, PUSH and GRIP are set while a hand is pressed or gripping.
+     */
+    uint32_t postures;
+    float bodyScale;
+    float position[3];
+    float joints[FUSkeleton::JOINT_COUNT][3];
+    uint8_t jointStates[FUSkeleton::JOINT_COUNT];//FUSkeleton::JOINT_TRACKING_STATE
+    /**
+     * @brief Hand pointers from the last interaction frame, HAND_TYPE_NONE when there aren't any.
+     */
+    Hand hands[2];
+};
+
+/**
+ * @brief The players are packed into the first playerCount slots.
+ */
+struct Frame {
+    int64_t timeStamp;
+    uint32_t frameNumber;
+    uint32_t playerCount;
+    float floorPlane[4];
+    Player players[FUSkeleton::MAX_SKELETONS];
+};
+
+struct Header {
+    std::atomic<uint32_t> magic;//Set last, readers ignore the segment until it's MAGIC
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t frameSize;//sizeof(Frame), to catch readers built with a different layout
+    std::atomic<uint64_t> publishedCount;
+};
+
+struct Slot {
+    std::atomic<uint64_t> sequence;
+    uint64_t reserved;
+    Frame frame;
+};
+
+const uint32_t MAGIC = 0x534B5546;//"FUKS"
+const uint32_t VERSION = 1;
+/**
+ * @brief Two seconds at 30 frames per second, how far behind a reader can be before it misses frames.
+ */
+const uint32_t SLOT_COUNT = 64;
+const char* const DEFAULT_NAME = "FUKinectSkeletons";
+}
+
+/**
+ * @brief Publishes skeleton frames and their detector results to other processes through a named shared memory segment. Writing
+ * a frame never waits for the readers: every slot is a seqlock, so the readers check that the slot didn't change while they
+ * read it, and any number of them can read at the same time.
+ */
+class FUSkeletonPublisher
+{
+public:
+    FUSkeletonPublisher();
+    ~FUSkeletonPublisher();
+    /**
+     * @brief Creates the shared memory segment.
+     * @param name
+     * @return false if the segment can't be created
+     */
+    bool open(const char *name = FUSharedSkeleton::DEFAULT_NAME);
+    void close();
+    bool isOpen() const {return mSharedMemory.isOpen();}
+    /**
+     * @brief Returns the slot of the next frame to be filled in place. The readers skip the slot until endFrame().
+     * @return nullptr if the publisher isn't open
+     */
+    FUSharedSkeleton::Frame* beginFrame();
+    /**
+     * @brief Publishes the frame that beginFrame() returned.
+     */
+    void endFrame();
+    /**
+     * @brief Fills a frame with the skeletons, and the postures and body scales the processor has for them. The hands are
+     * cleared.
+     * @param frame
+     * @param skeletonFrame
+     * @param processor --> Must have processed skeletonFrame
+     */
+    static void fillFrame(FUSharedSkeleton::Frame &frame, const FUSkeleton::SkeletonFrame &skeletonFrame, const FUFrameProcessor &processor);
+    /**
+     * @brief Publishes a frame without hand pointers, beginFrame(), fillFrame() and endFrame() in one.
+     * @param skeletonFrame
+     * @param processor
+     */
+    void publish(const FUSkeleton::SkeletonFrame &skeletonFrame, const FUFrameProcessor &processor);
+    uint64_t getPublishedCount() const {return mPublishedCount;}
+
+private:
+    FUSharedMemory mSharedMemory;
+    FUSharedSkeleton::Header *mHeader;
+    FUSharedSkeleton::Slot *mSlots;
+    uint64_t mPublishedCount;
+
+private:
+    FUSkeletonPublisher(const FUSkeletonPublisher&);
+    FUSkeletonPublisher& operator=(const FUSkeletonPublisher&);
+};
+
+/**
+ * @brief Reads the frames of an FUSkeletonPublisher in another process. Every reader is independent, a slow reader only
+ * misses frames.
+ */
+class FUSkeletonReader
+{
+public:
+    /**
+     * @brief A frame that is read in place. It's only valid if endRead() returns true.
+     */
+    struct View {
+        const FUSharedSkeleton::Frame *frame;
+        uint64_t sequence;
+    };
+
+public:
+    FUSkeletonReader();
+    /**
+     * @brief Maps the segment of a publisher and starts reading from its next frame.
+     * @param name
+     * @return false if there's no publisher with that name or it has a different layout
+     */
+    bool open(const char *name = FUSharedSkeleton::DEFAULT_NAME);
+    void close();
+    bool isOpen() const {return mSharedMemory.isOpen();}
+    /**
+     * @brief Copies the oldest frame that this reader hasn't read yet. When the reader fell more than SLOT_COUNT frames behind,
+     * the frames that were overwritten are skipped and counted.
+     * @param frame --> Output
+     * @return false if there is no new frame
+     */
+    bool readNext(FUSharedSkeleton::Frame &frame);
+    /**
+     * @brief Copies the last published frame and skips the ones before it.
+     * @param frame --> Output
+     * @return false if there is no new frame
+     */
+    bool readLatest(FUSharedSkeleton::Frame &frame);
+    /**
+     * @brief Starts reading the last published frame without copying it. The frame can be overwritten while it's read, so
+     * nothing read from it can be trusted until endRead() returns true.
+     * @param view --> Output
+     * @return false if there is no new frame
+     */
+    bool beginRead(View &view);
+    /**
+     * @brief Returns true if the frame of the view wasn't overwritten while it was read.
+     * @param view
+     * @return
+     */
+    bool endRead(const View &view);
+    /**
+     * @brief Returns the number of frames that were overwritten before this reader could read them.
+     * @return
+     */
+    uint64_t getMissedFrameCount() const {return mMissedFrameCount;}
+
+private:
+    FUSharedMemory mSharedMemory;
+    const FUSharedSkeleton::Header *mHeader;
+    const FUSharedSkeleton::Slot *mSlots;
+    uint64_t mNextFrame;
+    uint64_t mMissedFrameCount;
+
+private:
+    bool readFrame(uint64_t index, FUSharedSkeleton::Frame &frame) const;
+    FUSkeletonReader(const FUSkeletonReader&);
+    FUSkeletonReader& operator=(const FUSkeletonReader&);
+};
@@ -0,0 +1,179 @@
+#include "FUSkeletonStream.h"
+//STL Includes
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(sockaddr_storage) <= 128, "FUSkeletonSender::mAddress is too small");
+
+#ifdef _WIN32
+/**
+ * @brief Winsock has to be started once per process before any socket call
+ */
+static bool startSockets()
+{
+    static const bool isStarted = []() {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return isStarted;
+}
+
+static void closeSocket(intptr_t socket)
+{
+    closesocket(static_cast<SOCKET>(socket));
+}
+#else
+static bool startSockets()
+{
+    return true;
+}
+
+static void closeSocket(intptr_t socket)
+{
+    ::close(static_cast<int>(socket));
+}
+#endif
+
+FUSkeletonSender::FUSkeletonSender(int keyFrameInterval)
+    : mEncoder(keyFrameInterval)
+    , mSocket(-1)
+    , mAddressSize(0)
+    , mSentByteCount(0)
+    , mSentPacketCount(0)
+{
+}
+
+FUSkeletonSender::~FUSkeletonSender()
+{
+    close();
+}
+
+bool FUSkeletonSender::open(const char *host, uint16_t port)
+{
+    close();
+    if (!startSockets())
+        return false;
+    char service[8];
+    std::snprintf(service, sizeof(service), "%u", static_cast<unsigned int>(port));
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+    addrinfo *addresses = nullptr;
+    if (getaddrinfo(host, service, &hints, &addresses) != 0)
+        return false;
+    for (addrinfo *address = addresses; address != nullptr && mSocket == -1; address = address->ai_next) {
+        const intptr_t socket = static_cast<intptr_t>(::socket(address->ai_family, address->ai_socktype, address->ai_protocol));
+        if (socket == -1)
+            continue;
+        std::memcpy(mAddress, address->ai_addr, address->ai_addrlen);
+        mAddressSize = static_cast<int>(address->ai_addrlen);
+        mSocket = socket;
+    }
+    freeaddrinfo(addresses);
+    //The first packet has to be a key frame for a receiver that starts with it
+    mEncoder.forceKeyFrame();
+    return mSocket != -1;
+}
+
+void FUSkeletonSender::close()
+{
+    if (mSocket != -1)
+        closeSocket(mSocket);
+    mSocket = -1;
+}
+
+bool FUSkeletonSender::send(const FUSkeleton::SkeletonFrame &frame)
+{
+    if (mSocket == -1)
+        return false;
+    const size_t size = mEncoder.encode(frame, mBuffer);
+    const int sentSize = static_cast<int>(sendto(mSocket, reinterpret_cast<const char*>(mBuffer), static_cast<int>(size), 0,
+                                                 reinterpret_cast<const sockaddr*>(mAddress), static_cast<socklen_t>(mAddressSize)));
+    if (sentSize != static_cast<int>(size))
+        return false;
+    mSentByteCount += size;
+    mSentPacketCount++;
+    return true;
+}
+
+FUSkeletonReceiver::FUSkeletonReceiver()
+    : mDecoder()
+    , mSocket(-1)
+{
+}
+
+FUSkeletonReceiver::~FUSkeletonReceiver()
+{
+    close();
+}
+
+bool FUSkeletonReceiver::open(uint16_t port)
+{
+    close();
+    if (!startSockets())
+        return false;
+    const intptr_t socket = static_cast<intptr_t>(::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+    if (socket == -1)
+        return false;
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        closeSocket(socket);
+        return false;
+    }
+    mSocket = socket;
+    mDecoder.reset();
+    return true;
+}
+
+void FUSkeletonReceiver::close()
+{
+    if (mSocket != -1)
+        closeSocket(mSocket);
+    mSocket = -1;
+}
+
+bool FUSkeletonReceiver::receive(FUSkeleton::SkeletonFrame &frame, int timeout)
+{
+    if (mSocket == -1)
+        return false;
+    while (true) {
+        fd_set sockets;
+        FD_ZERO(&sockets);
+        FD_SET(mSocket, &sockets);
+        timeval time;
+        time.tv_sec = timeout / 1000;
+        time.tv_usec = timeout % 1000 * 1000;
+        //Only the first wait uses the timeout, the packets after it have arrived already
+        timeout = 0;
+        if (select(static_cast<int>(mSocket + 1), &sockets, nullptr, nullptr, &time) <= 0)
+            return false;
+        const int size = static_cast<int>(recv(mSocket, reinterpret_cast<char*>(mBuffer), sizeof(mBuffer), 0));
+        if (size > 0 && mDecoder.decode(mBuffer, static_cast<size_t>(size), frame))
+            return true;
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+//Local Includes
+#include "FUSkeletonCodec.h"
+
+/**
+ * @brief Sends skeleton frames to a render node as FUSkeletonCodec packets over UDP, one packet per frame.
+ */
+class FUSkeletonSender
+{
+public:
+    /**
+     * @param keyFrameInterval --> See FUSkeletonEncoder
+     */
+    explicit FUSkeletonSender(int keyFrameInterval = 30);
+    ~FUSkeletonSender();
+    /**
+     * @brief Creates the socket and resolves the receiver.
+     * @param host --> Host name or IPv4/IPv6 address of the receiver
+     * @param port
+     * @return false if the host can't be resolved or the socket can't be created
+     */
+    bool open(const char *host, uint16_t port);
+    void close();
+    bool isOpen() const {return mSocket != -1;}
+    /**
+     * @brief Encodes and sends a frame. It doesn't wait for anything, a packet that the network can't take is lost.
+     * @param frame
+     * @return false if the packet couldn't be sent
+     */
+    bool send(const FUSkeleton::SkeletonFrame &frame);
+    /**
+     * @brief Makes the next packet a key frame, e.g. when a receiver joins.
+     */
+    void forceKeyFrame() {mEncoder.forceKeyFrame();}
+    uint64_t getSentByteCount() const {return mSentByteCount;}
+    uint64_t getSentPacketCount() const {return mSentPacketCount;}
+
+private:
+    FUSkeletonEncoder mEncoder;
+    intptr_t mSocket;
+    uint8_t mAddress[128];//sockaddr_storage
+    int mAddressSize;
+    uint8_t mBuffer[FUSkeletonCodec::MAX_PACKET_SIZE];
+    uint64_t mSentByteCount;
+    uint64_t mSentPacketCount;
+
+private:
+    FUSkeletonSender(const FUSkeletonSender&);
+    FUSkeletonSender& operator=(const FUSkeletonSender&);
+};
+
+/**
+ * @brief Receives the packets of an FUSkeletonSender and decodes them.
+ */
+class FUSkeletonReceiver
+{
+public:
+    FUSkeletonReceiver();
+    ~FUSkeletonReceiver();
+    /**
+     * @brief Binds a socket to the port on every IPv4 interface.
+     * @param port
+     * @return false if the port can't be bound
+     */
+    bool open(uint16_t port);
+    void close();
+    bool isOpen() const {return mSocket != -1;}
+    /**
+     * @brief Receives and decodes the next packet. Packets that can't be decoded are skipped.
+     * @param frame --> Output
+     * @param timeout --> Milliseconds to wait for a packet, 0 only takes the packets that already arrived
+     * @return false if no frame could be decoded in time
+     */
+    bool receive(FUSkeleton::SkeletonFrame &frame, int timeout = 0);
+    /**
+     * @brief See FUSkeletonDecoder::getLostPacketCount()
+     * @return
+     */
+    uint32_t getLostPacketCount() const {return mDecoder.getLostPacketCount();}
+    /**
+     * @brief See FUSkeletonDecoder::getLatePacketCount()
+     * @return
+     */
+    uint32_t getLatePacketCount() const {return mDecoder.getLatePacketCount();}
+
+private:
+    FUSkeletonDecoder mDecoder;
+    intptr_t mSocket;
+    uint8_t mBuffer[FUSkeletonCodec::MAX_PACKET_SIZE];
+
+private:
+    FUSkeletonReceiver(const FUSkeletonReceiver&);
+    FUSkeletonReceiver& operator=(const FUSkeletonReceiver&);
+};
@@ -0,0 +1,132 @@
+#include "FUStreamScheduler.h"
+//STL Includes
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief The cost estimate moves 1 / 2^COST_SHIFT of the way to every new processing time
+ */
+static const int COST_SHIFT = 3;
+
+FUStreamScheduler::FUStreamScheduler()
+    : mBudget(0)
+    , mFrameInterval(0)
+    , mIntervalStartTime(0)
+    , mUsedTime(0)
+    , mHasInterval(false)
+    , mOverBudgetCount(0)
+    , mIntervalCount(0)
+{
+    const PRIORITY priorities[FULatency::STREAM_COUNT] = {CRITICAL_PRIORITY, CRITICAL_PRIORITY, NORMAL_PRIORITY, LOW_PRIORITY};
+    for (int i = 0; i < FULatency::STREAM_COUNT; i++) {
+        mStreams[i].targetRate = 0;
+        mStreams[i].priority = priorities[i];
+    }
+    setBudget(0);
+    reset();
+    updateOrder();
+}
+
+void FUStreamScheduler::setStream(FULatency::STREAM stream, double targetRate, PRIORITY priority)
+{
+    mStreams[stream].targetRate = std::max(targetRate, 0.0);
+    mStreams[stream].priority = priority;
+    updateOrder();
+}
+
+void FUStreamScheduler::setBudget(double budget, double frameInterval)
+{
+    mBudget = static_cast<int64_t>(std::max(budget, 0.0) * 1000000);
+    mFrameInterval = static_cast<int64_t>(std::max(frameInterval, 1.0) * 1000000);
+}
+
+FUStreamScheduler::DECISION FUStreamScheduler::decide(FULatency::STREAM stream, int64_t now, bool isForced, bool canDefer)
+{
+    updateInterval(now);
+    Stream &state = mStreams[stream];
+    //The frames come at multiples of the frame interval, so a frame that is up to half an interval early is on time
+    const int64_t rateInterval = state.targetRate > 0 ? static_cast<int64_t>(1000000000.0 / state.targetRate) : 0;
+    if (!isForced && state.hasProcessed && now - state.lastProcessTime < rateInterval - mFrameInterval / 2) {
+        state.isDeferred = false;
+        state.counters.skippedCount++;
+        return SKIP;
+    }
+
+    const bool hasWaited = state.isHeldBack && now - state.heldBackTime >= mFrameInterval;
+    if (!isForced && !hasWaited && state.priority != CRITICAL_PRIORITY && mBudget > 0
+            && mUsedTime + state.counters.estimatedCost > mBudget) {
+        if (!state.isHeldBack) {
+            state.isHeldBack = true;
+            state.heldBackTime = now;
+        }
+        if (!canDefer) {
+            state.isDeferred = false;
+            state.counters.budgetSkippedCount++;
+            return SKIP;
+        }
+        //A deferred frame is asked for again until it's processed, it's counted once
+        if (!state.isDeferred) {
+            state.isDeferred = true;
+            state.counters.deferredCount++;
+        }
+        return DEFER;
+    }
+
+    state.isHeldBack = false;
+    state.isDeferred = false;
+    state.hasProcessed = true;
+    state.lastProcessTime = now;
+    state.counters.processedCount++;
+    state.counters.forcedCount += isForced;
+    return PROCESS;
+}
+
+void FUStreamScheduler::record(FULatency::STREAM stream, int64_t processingTime)
+{
+    Counters &counters = mStreams[stream].counters;
+    if (counters.processingTime == 0)
+        counters.estimatedCost = processingTime;
+    else
+        counters.estimatedCost += (processingTime - counters.estimatedCost) / (1 << COST_SHIFT);
+    counters.processingTime += processingTime;
+    mUsedTime += processingTime;
+}
+
+void FUStreamScheduler::reset()
+{
+    for (int i = 0; i < FULatency::STREAM_COUNT; i++) {
+        Stream &state = mStreams[i];
+        state.lastProcessTime = 0;
+        state.hasProcessed = false;
+        state.heldBackTime = 0;
+        state.isHeldBack = false;
+        state.isDeferred = false;
+        std::memset(&state.counters, 0, sizeof(state.counters));
+    }
+    mIntervalStartTime = 0;
+    mUsedTime = 0;
+    mHasInterval = false;
+    mOverBudgetCount = 0;
+    mIntervalCount = 0;
+}
+
+void FUStreamScheduler::updateInterval(int64_t now)
+{
+    if (mHasInterval && now - mIntervalStartTime < mFrameInterval)
+        return;
+    if (mHasInterval && mBudget > 0 && mUsedTime > mBudget)
+        mOverBudgetCount++;
+    mIntervalCount += mHasInterval;
+    mHasInterval = true;
+    mIntervalStartTime = now;
+    mUsedTime = 0;
+}
+
+void FUStreamScheduler::updateOrder()
+{
+    for (int i = 0; i < FULatency::STREAM_COUNT; i++)
+        mOrder[i] = static_cast<FULatency::STREAM>(i);
+    std::stable_sort(mOrder, mOrder + FULatency::STREAM_COUNT, [this](FULatency::STREAM first, FULatency::STREAM second) {
+        return mStreams[first].priority < mStreams[second].priority;
+    });
+}
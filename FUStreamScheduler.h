@@ -0,0 +1,127 @@
+#pragma once
+//STL Includes
+#include <cstdint>
+//Local Includes
+#include "FULatency.h"
+
+/**
+ * @brief Decides which of the signaled sensor streams are processed, so that the expensive streams can run slower than the
+ * sensor and can't delay the skeleton and the interaction streams. Every stream has a target rate and a priority, and the
+ * processing of all the streams shares a CPU budget per sensor frame interval.
+ *
+ * A frame that comes before the target rate allows it is skipped. A stream that isn't CRITICAL_PRIORITY is held back while
+ * its estimated cost doesn't fit in what is left of the budget: its frame is deferred, so it stays pending and is asked for
+ * again on the next update, or skipped if the caller can't leave it pending. A stream isn't held back for longer than a
+ * frame interval, so a stream that costs more than the whole budget still runs once per interval. The streams are updated
+ * in the order of their priorities so the important ones use the budget first. Only the thread that updates the streams can
+ * use the scheduler.
+ */
+class FUStreamScheduler
+{
+public:
+    enum PRIORITY {
+        CRITICAL_PRIORITY,//Never deferred
+        HIGH_PRIORITY,
+        NORMAL_PRIORITY,
+        LOW_PRIORITY
+    };
+
+    enum DECISION {
+        PROCESS,
+        SKIP,//The frame came too early for the target rate, or the budget is used up and it can't be deferred
+        DEFER//The budget is used up, the frame should be left for a later update
+    };
+
+    struct Counters {
+        uint64_t processedCount;
+        uint64_t forcedCount;//Processed regardless of the rate and the budget, these are counted in processedCount too
+        uint64_t skippedCount;//Frames that came too early for the target rate
+        uint64_t budgetSkippedCount;//Frames that didn't fit in the budget and couldn't be deferred
+        uint64_t deferredCount;//Frames that were deferred at least once
+        int64_t processingTime;//Total time of the processed frames in nanoseconds
+        int64_t estimatedCost;//Running average of the time of a frame in nanoseconds
+    };
+
+public:
+    FUStreamScheduler();
+    /**
+     * @brief Sets the target rate and the priority of a stream. By default every stream runs at the sensor rate, the skeleton
+     * and the interaction streams with CRITICAL_PRIORITY, the depth stream with NORMAL_PRIORITY and the color stream with
+     * LOW_PRIORITY.
+     * @param stream
+     * @param targetRate --> Frames per second, 0 processes every frame
+     * @param priority
+     */
+    void setStream(FULatency::STREAM stream, double targetRate, PRIORITY priority);
+    double getTargetRate(FULatency::STREAM stream) const {return mStreams[stream].targetRate;}
+    PRIORITY getPriority(FULatency::STREAM stream) const {return mStreams[stream].priority;}
+    /**
+     * @brief Sets the processing time that the streams can use in a frame interval together.
+     * @param budget --> In milliseconds, 0 doesn't limit the time. The default is 0.
+     * @param frameInterval --> In milliseconds, the default is 1000 / 30
+     */
+    void setBudget(double budget, double frameInterval = 1000.0 / 30);
+    /**
+     * @brief Returns the streams ordered by their priority, the streams with the same priority keep the order of
+     * FULatency::STREAM.
+     * @return
+     */
+    const FULatency::STREAM* getOrder() const {return mOrder;}
+    /**
+     * @brief Decides what to do with a signaled frame. Call record() after processing it.
+     * @param stream
+     * @param now --> See FULatency::getTime()
+     * @param isForced --> Processes the frame regardless of the rate and the budget, e.g. for a pending screenshot
+     * @param canDefer --> false if the frame can't be left pending, it is skipped instead when it doesn't fit in the budget
+     * @return
+     */
+    DECISION decide(FULatency::STREAM stream, int64_t now, bool isForced = false, bool canDefer = true);
+    /**
+     * @brief Records the time it took to process a frame of a stream.
+     * @param stream
+     * @param processingTime --> In nanoseconds
+     */
+    void record(FULatency::STREAM stream, int64_t processingTime);
+    const Counters& getCounters(FULatency::STREAM stream) const {return mStreams[stream].counters;}
+    /**
+     * @brief Returns the number of frame intervals that used more than the budget, because of the CRITICAL_PRIORITY streams,
+     * forced frames or frames that took longer than estimated.
+     * @return
+     */
+    uint64_t getOverBudgetCount() const {return mOverBudgetCount;}
+    uint64_t getIntervalCount() const {return mIntervalCount;}
+    /**
+     * @brief Clears the counters and the cost estimates.
+     */
+    void reset();
+
+private:
+    struct Stream {
+        double targetRate;
+        PRIORITY priority;
+        int64_t lastProcessTime;
+        bool hasProcessed;
+        int64_t heldBackTime;
+        bool isHeldBack;
+        bool isDeferred;
+        Counters counters;
+    };
+
+    Stream mStreams[FULatency::STREAM_COUNT];
+    FULatency::STREAM mOrder[FULatency::STREAM_COUNT];
+    int64_t mBudget;
+    int64_t mFrameInterval;
+    int64_t mIntervalStartTime;
+    int64_t mUsedTime;
+    bool mHasInterval;
+    uint64_t mOverBudgetCount;
+    uint64_t mIntervalCount;
+
+private:
+    /**
+     * @brief Starts a new interval with the whole budget when the current one has passed.
+     * @param now
+     */
+    void updateInterval(int64_t now);
+    void updateOrder();
+};
@@ -0,0 +1,103 @@
+#include "FUStreamStats.h"
+//STL Includes
+#include <cmath>
+//Local Includes
+#include "FULatency.h"
+
+FUStreamStats::FUStreamStats(double frameInterval, int bufferCount)
+    : mFrameInterval(frameInterval)
+    , mBufferCount(bufferCount)
+{
+    reset();
+}
+
+void FUStreamStats::configure(double frameInterval, int bufferCount)
+{
+    mFrameInterval = frameInterval;
+    mBufferCount = bufferCount;
+}
+
+void FUStreamStats::recordFrame(uint32_t frameNumber, int64_t sensorTimeStamp)
+{
+    uint64_t missedCount = 0;
+    //Frame numbers that go back mean the stream restarted
+    if (mHasPreviousFrame && frameNumber > mPreviousFrameNumber)
+        missedCount = frameNumber - mPreviousFrameNumber - 1;
+    mPreviousFrameNumber = frameNumber;
+    recordArrival(sensorTimeStamp, missedCount);
+}
+
+void FUStreamStats::recordFrame(int64_t sensorTimeStamp)
+{
+    uint64_t missedCount = 0;
+    if (mHasPreviousFrame && sensorTimeStamp > mPreviousTimeStamp) {
+        const double intervalCount = std::floor((sensorTimeStamp - mPreviousTimeStamp) / mFrameInterval + 0.5);
+        missedCount = intervalCount > 1 ? static_cast<uint64_t>(intervalCount) - 1 : 0;
+    }
+    recordArrival(sensorTimeStamp, missedCount);
+}
+
+void FUStreamStats::recordArrival(int64_t sensorTimeStamp, uint64_t missedCount)
+{
+    increment(mReceivedCount, 1);
+    increment(mIsPaused ? mSkippedCount : mDroppedCount, missedCount);
+    mIsPaused = false;
+    mHasPreviousFrame = true;
+    mPreviousTimeStamp = sensorTimeStamp;
+
+    //The age of the frame is how much longer it took to read it than the fastest frame
+    const int64_t now = FULatency::getTime() / 1000;
+    const int64_t offset = now - sensorTimeStamp * 1000;
+    if (!mHasClockOffset || offset < mClockOffset) {
+        mClockOffset = offset;
+        mHasClockOffset = true;
+    }
+    const double age = (offset - mClockOffset) / 1000.0;
+    int queueDepth = static_cast<int>(age / mFrameInterval);
+    queueDepth = queueDepth < mBufferCount ? queueDepth : mBufferCount;
+    if (age > mFrameInterval)
+        increment(mLateCount, 1);
+    mQueueDepth.store(queueDepth, std::memory_order_relaxed);
+    int maxQueueDepth = mMaxQueueDepth.load(std::memory_order_relaxed);
+    while (queueDepth > maxQueueDepth && !mMaxQueueDepth.compare_exchange_weak(maxQueueDepth, queueDepth, std::memory_order_relaxed)) {}
+}
+
+FUStreamStats::Snapshot FUStreamStats::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.time = FULatency::getTime();
+    snapshot.receivedCount = mReceivedCount.load(std::memory_order_relaxed);
+    snapshot.droppedCount = mDroppedCount.load(std::memory_order_relaxed);
+    snapshot.skippedCount = mSkippedCount.load(std::memory_order_relaxed);
+    snapshot.lateCount = mLateCount.load(std::memory_order_relaxed);
+    snapshot.failedReadCount = mFailedReadCount.load(std::memory_order_relaxed);
+    snapshot.failedLockCount = mFailedLockCount.load(std::memory_order_relaxed);
+    snapshot.queueDepth = mQueueDepth.load(std::memory_order_relaxed);
+    snapshot.maxQueueDepth = mMaxQueueDepth.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+FUStreamStats::Snapshot FUStreamStats::takeSnapshot()
+{
+    Snapshot snapshot = getSnapshot();
+    snapshot.maxQueueDepth = mMaxQueueDepth.exchange(0, std::memory_order_relaxed);
+    return snapshot;
+}
+
+void FUStreamStats::reset()
+{
+    mReceivedCount.store(0, std::memory_order_relaxed);
+    mDroppedCount.store(0, std::memory_order_relaxed);
+    mSkippedCount.store(0, std::memory_order_relaxed);
+    mLateCount.store(0, std::memory_order_relaxed);
+    mFailedReadCount.store(0, std::memory_order_relaxed);
+    mFailedLockCount.store(0, std::memory_order_relaxed);
+    mQueueDepth.store(0, std::memory_order_relaxed);
+    mMaxQueueDepth.store(0, std::memory_order_relaxed);
+    mHasPreviousFrame = false;
+    mPreviousFrameNumber = 0;
+    mPreviousTimeStamp = 0;
+    mHasClockOffset = false;
+    mClockOffset = 0;
+    mIsPaused = false;
+}
@@ -0,0 +1,97 @@
+#pragma once
+//STL Includes
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Counts what happens to the frames of a sensor stream: how many are read, dropped because they weren't read in time,
+ * skipped on purpose, read late or failed to be read or locked. Drops are found from the gaps in the frame numbers, or in the
+ * time stamps for streams without frame numbers. How long a frame waited is found like in FULatency, by mapping the sensor
+ * clock to the host clock with the smallest difference seen. Only one thread can record, any thread can read.
+ */
+class FUStreamStats
+{
+public:
+    /**
+     * @brief The counters since the stream was reset. maxQueueDepth is the deepest the queue was since the last
+     * takeSnapshot().
+     */
+    struct Snapshot {
+        int64_t time;//Host time of the snapshot in nanoseconds, see FULatency::getTime()
+        uint64_t receivedCount;
+        uint64_t droppedCount;//Frames that were overwritten before they were read
+        uint64_t skippedCount;//Frames that weren't read while the stream was paused
+        uint64_t lateCount;//Frames that were read more than a frame interval after they were produced
+        uint64_t failedReadCount;
+        uint64_t failedLockCount;
+        int queueDepth;//The frames that were produced after the last read one and were waiting when it was read
+        int maxQueueDepth;
+    };
+
+public:
+    /**
+     * @param frameInterval --> Nominal time between two frames in milliseconds
+     * @param bufferCount --> How many frames the sensor keeps for the stream, the queue depth can't be larger than this
+     */
+    explicit FUStreamStats(double frameInterval = 1000.0 / 30, int bufferCount = 2);
+    void configure(double frameInterval, int bufferCount);
+    /**
+     * @brief Records a frame that was read.
+     * @param frameNumber
+     * @param sensorTimeStamp --> In milliseconds, like liTimeStamp
+     */
+    void recordFrame(uint32_t frameNumber, int64_t sensorTimeStamp);
+    /**
+     * @brief Records a frame of a stream without frame numbers. The drops are estimated from the time stamps.
+     * @param sensorTimeStamp --> In milliseconds
+     */
+    void recordFrame(int64_t sensorTimeStamp);
+    void recordFailedRead() {increment(mFailedReadCount, 1);}
+    void recordFailedLock() {increment(mFailedLockCount, 1);}
+    /**
+     * @brief Marks the stream as paused, the frames that are missed until the next recordFrame() are counted as skipped
+     * instead of dropped.
+     */
+    void pause() {mIsPaused = true;}
+    Snapshot getSnapshot() const;
+    /**
+     * @brief Returns the counters and starts a new window for maxQueueDepth.
+     * @return
+     */
+    Snapshot takeSnapshot();
+    /**
+     * @brief Clears the counters. Only the thread that records can call this.
+     */
+    void reset();
+
+private:
+    double mFrameInterval;
+    int mBufferCount;
+    std::atomic<uint64_t> mReceivedCount;
+    std::atomic<uint64_t> mDroppedCount;
+    std::atomic<uint64_t> mSkippedCount;
+    std::atomic<uint64_t> mLateCount;
+    std::atomic<uint64_t> mFailedReadCount;
+    std::atomic<uint64_t> mFailedLockCount;
+    std::atomic<int> mQueueDepth;
+    std::atomic<int> mMaxQueueDepth;
+    //Only the recording thread uses these
+    bool mHasPreviousFrame;
+    uint32_t mPreviousFrameNumber;
+    int64_t mPreviousTimeStamp;
+    bool mHasClockOffset;
+    int64_t mClockOffset;
+    bool mIsPaused;
+
+private:
+    /**
+     * @brief There's a single writer, so the counters don't need a locked add.
+     */
+    static void increment(std::atomic<uint64_t> &counter, uint64_t count)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+    void recordArrival(int64_t sensorTimeStamp, uint64_t missedCount);
+    FUStreamStats(const FUStreamStats&);
+    FUStreamStats& operator=(const FUStreamStats&);
+};
@@ -0,0 +1,84 @@
+#include "FUThreadPool.h"
+//Local Includes
+#include "FUTrace.h"
+
+FUThreadPool::FUThreadPool(int workerCount)
+    : mTask(nullptr)
+    , mTaskCount(0)
+    , mNextTask(0)
+    , mBusyWorkerCount(0)
+    , mGeneration(0)
+    , mIsStopping(false)
+{
+    if (workerCount < 0) {
+        const int coreCount = static_cast<int>(std::thread::hardware_concurrency());
+        workerCount = coreCount > 1 ? coreCount - 1 : 0;
+    }
+    for (int i = 0; i < workerCount; i++)
+        mWorkers.push_back(std::thread(&FUThreadPool::workerLoop, this));
+}
+
+FUThreadPool::~FUThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = true;
+    }
+    mWakeCondition.notify_all();
+    for (size_t i = 0; i < mWorkers.size(); i++)
+        mWorkers[i].join();
+}
+
+void FUThreadPool::parallelFor(int taskCount, const std::function<void(int)> &task)
+{
+    if (taskCount <= 0)
+        return;
+    std::lock_guard<std::mutex> runLock(mRunMutex);
+    if (mWorkers.empty() || taskCount == 1) {
+        for (int i = 0; i < taskCount; i++)
+            task(i);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = &task;
+        mTaskCount = taskCount;
+        mNextTask.store(0);
+        mBusyWorkerCount = static_cast<int>(mWorkers.size());
+        mGeneration++;
+    }
+    mWakeCondition.notify_all();
+    runTasks();
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCondition.wait(lock, [this] {return mBusyWorkerCount == 0;});
+    mTask = nullptr;
+}
+
+void FUThreadPool::runTasks()
+{
+    for (int i = mNextTask.fetch_add(1); i < mTaskCount; i = mNextTask.fetch_add(1)) {
+        FU_TRACE_SCOPE(FUTrace::THREAD_POOL, "FUThreadPool task");
+        (*mTask)(i);
+    }
+}
+
+void FUThreadPool::workerLoop()
+{
+    FUTrace::setThreadName("FUThreadPool worker");
+    uint64_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeCondition.wait(lock, [this, generation] {return mIsStopping || mGeneration != generation;});
+            if (mIsStopping)
+                return;
+            generation = mGeneration;
+        }
+        runTasks();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mBusyWorkerCount--;
+        }
+        mDoneCondition.notify_one();
+    }
+}
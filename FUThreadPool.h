@@ -0,0 +1,54 @@
+#pragma once
+//STL Includes
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A fixed set of worker threads that run the tasks of a parallelFor() together with the calling thread.
+ * The threads are created once, so a parallelFor() only costs a wake up.
+ */
+class FUThreadPool
+{
+public:
+    /**
+     * @param workerCount --> Number of threads besides the caller. A negative value uses one less than the number of cores.
+     */
+    explicit FUThreadPool(int workerCount = -1);
+    ~FUThreadPool();
+    /**
+     * @brief Returns the number of threads that run the tasks, including the calling thread.
+     * @return
+     */
+    int getThreadCount() const {return static_cast<int>(mWorkers.size()) + 1;}
+    /**
+     * @brief Runs task(0) to task(taskCount - 1) on the workers and the calling thread, and returns when all of them are done.
+     * Only one parallelFor() runs at a time, calls from other threads wait for it.
+     * @param taskCount
+     * @param task
+     */
+    void parallelFor(int taskCount, const std::function<void(int)> &task);
+
+private:
+    std::vector<std::thread> mWorkers;
+    std::mutex mRunMutex;
+    std::mutex mMutex;
+    std::condition_variable mWakeCondition;
+    std::condition_variable mDoneCondition;
+    const std::function<void(int)> *mTask;
+    int mTaskCount;
+    std::atomic<int> mNextTask;
+    int mBusyWorkerCount;
+    uint64_t mGeneration;
+    bool mIsStopping;
+
+private:
+    void workerLoop();
+    void runTasks();
+    FUThreadPool(const FUThreadPool&);
+    FUThreadPool& operator=(const FUThreadPool&);
+};
@@ -0,0 +1,262 @@
+#include "FUTrace.h"
+//STL Includes
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+//Local Includes
+#include "FUEventQueue.h"
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define FU_THREAD_LOCAL __declspec(thread)
+#else
+#define FU_THREAD_LOCAL thread_local
+//__declspec(thread) can't have a destructor, so the buffers of the threads that exit are only recycled with thread_local
+#define FU_RECYCLE_THREAD_BUFFERS 1
+#endif
+
+static const size_t THREAD_BUFFER_SIZE = 8192;
+static const size_t WRITE_BUFFER_SIZE = 1 << 20;
+/**
+ * @brief How often the writer empties the thread buffers, in milliseconds. A buffer fills in about a second at 30 frames per
+ * second even with every category enabled, so this leaves plenty of room.
+ */
+static const int FLUSH_INTERVAL = 20;
+
+namespace {
+struct ThreadBuffer {
+    int threadID;
+    const char *name;
+    bool hasExited;//The thread exited, the buffer is recycled once its events are flushed
+    bool isFree;
+    FUEventQueue<FUTrace::Event, THREAD_BUFFER_SIZE> events;
+};
+
+/**
+ * @brief The buffers of the threads that recorded an event, and the capture that is in progress. The buffers are kept until
+ * the program exits since the threads keep pointers to them, and the buffer of a thread that exited is given to the next
+ * thread that records an event.
+ */
+struct TraceState {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    int nextThreadID;
+    std::mutex captureMutex;
+    std::condition_variable stopCondition;
+    std::thread writer;
+    std::FILE *file;
+    bool isStopping;
+    bool isFirstEvent;
+    int64_t startTime;
+    size_t droppedEventCountAtStart;
+};
+
+TraceState& getState()
+{
+    static TraceState state;
+    return state;
+}
+
+FU_THREAD_LOCAL ThreadBuffer *tThreadBuffer = nullptr;
+FU_THREAD_LOCAL const char *tThreadName = nullptr;
+
+#ifdef FU_RECYCLE_THREAD_BUFFERS
+/**
+ * @brief Marks the buffer of the thread as exited when the thread exits.
+ */
+struct ThreadExitHook {
+    bool isArmed;
+    ~ThreadExitHook()
+    {
+        if (!isArmed || tThreadBuffer == nullptr)
+            return;
+        TraceState &state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        tThreadBuffer->hasExited = true;
+        tThreadBuffer = nullptr;
+    }
+};
+
+thread_local ThreadExitHook tThreadExitHook = {false};
+#endif
+
+/**
+ * @brief Returns the buffer of the calling thread. It's only created when the thread records its first event, so the threads
+ * that never trace don't hold a buffer.
+ */
+ThreadBuffer& getThreadBuffer()
+{
+    if (tThreadBuffer == nullptr) {
+        TraceState &state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        for (size_t i = 0; i < state.buffers.size() && tThreadBuffer == nullptr; i++) {
+            if (state.buffers[i]->isFree)
+                tThreadBuffer = state.buffers[i].get();
+        }
+        if (tThreadBuffer == nullptr) {
+            state.buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+            tThreadBuffer = state.buffers.back().get();
+        }
+        //A recycled buffer gets a new ID so that the trace doesn't mix up the threads
+        tThreadBuffer->threadID = ++state.nextThreadID;
+        tThreadBuffer->name = tThreadName;
+        tThreadBuffer->hasExited = false;
+        tThreadBuffer->isFree = false;
+#ifdef FU_RECYCLE_THREAD_BUFFERS
+        tThreadExitHook.isArmed = true;
+#endif
+    }
+    return *tThreadBuffer;
+}
+
+const char* getCategoryName(unsigned int category)
+{
+    switch (category) {
+    case FUTrace::SENSOR: return "sensor";
+    case FUTrace::SKELETON: return "skeleton";
+    case FUTrace::INTERACTION: return "interaction";
+    case FUTrace::DEPTH: return "depth";
+    case FUTrace::COLOR: return "color";
+    case FUTrace::DETECTORS: return "detectors";
+    case FUTrace::IO: return "io";
+    case FUTrace::THREAD_POOL: return "thread pool";
+    default: return "";
+    }
+}
+
+void writeThreadName(TraceState &state, const ThreadBuffer &buffer)
+{
+    std::fprintf(state.file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                 state.isFirstEvent ? "" : ",", buffer.threadID, buffer.name);
+    state.isFirstEvent = false;
+}
+
+void writeEvent(TraceState &state, int threadID, const FUTrace::Event &event)
+{
+    //Chrome wants microseconds
+    std::fprintf(state.file, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                 state.isFirstEvent ? "" : ",", event.name, getCategoryName(event.category),
+                 (event.begin - state.startTime) / 1000.0, (event.end - event.begin) / 1000.0, threadID);
+    state.isFirstEvent = false;
+}
+
+/**
+ * @brief Writes the events in the buffers, or throws them away if there's no file. The buffers of the threads that exited
+ * are freed, and their names are written since stop() only names the live threads.
+ */
+void flushBuffers(TraceState &state)
+{
+    FUTrace::Event events[256];
+    std::lock_guard<std::mutex> lock(state.mutex);
+    for (size_t i = 0; i < state.buffers.size(); i++) {
+        ThreadBuffer &buffer = *state.buffers[i];
+        if (buffer.isFree)
+            continue;
+        for (size_t count = buffer.events.pop(events, 256); count > 0; count = buffer.events.pop(events, 256)) {
+            for (size_t j = 0; state.file && j < count; j++)
+                writeEvent(state, buffer.threadID, events[j]);
+        }
+        if (buffer.hasExited) {
+            if (state.file && buffer.name)
+                writeThreadName(state, buffer);
+            buffer.isFree = true;
+        }
+    }
+}
+
+void writerLoop()
+{
+    TraceState &state = getState();
+    std::unique_lock<std::mutex> lock(state.captureMutex);
+    while (!state.isStopping) {
+        state.stopCondition.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL));
+        flushBuffers(state);
+    }
+}
+
+size_t getTotalDroppedCount(TraceState &state)
+{
+    std::lock_guard<std::mutex> lock(state.mutex);
+    size_t droppedCount = 0;
+    for (size_t i = 0; i < state.buffers.size(); i++)
+        droppedCount += state.buffers[i]->events.getDroppedCount();
+    return droppedCount;
+}
+}
+
+std::atomic<unsigned int> FUTrace::sEnabledCategories(0);
+
+bool FUTrace::start(const char *filePath, unsigned int categories)
+{
+    stop();
+    TraceState &state = getState();
+    //Events of scopes that ended after the last capture stopped
+    flushBuffers(state);
+    state.file = std::fopen(filePath, "wb");
+    if (state.file == nullptr)
+        return false;
+    std::setvbuf(state.file, nullptr, _IOFBF, WRITE_BUFFER_SIZE);
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", state.file);
+    state.isStopping = false;
+    state.isFirstEvent = true;
+    state.startTime = FULatency::getTime();
+    state.droppedEventCountAtStart = getTotalDroppedCount(state);
+    state.writer = std::thread(&writerLoop);
+    sEnabledCategories.store(categories & ALL_CATEGORIES, std::memory_order_relaxed);
+    return true;
+}
+
+void FUTrace::stop()
+{
+    TraceState &state = getState();
+    if (!state.writer.joinable())
+        return;
+    sEnabledCategories.store(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(state.captureMutex);
+        state.isStopping = true;
+    }
+    state.stopCondition.notify_one();
+    state.writer.join();
+    flushBuffers(state);
+    //The thread names are written last, so the threads that started tracing during the capture are included
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        for (size_t i = 0; i < state.buffers.size(); i++) {
+            const ThreadBuffer &buffer = *state.buffers[i];
+            if (!buffer.isFree && buffer.name)
+                writeThreadName(state, buffer);
+        }
+    }
+    std::fputs("\n]}\n", state.file);
+    std::fclose(state.file);
+    state.file = nullptr;
+}
+
+void FUTrace::setCategories(unsigned int categories)
+{
+    if (getState().writer.joinable())
+        sEnabledCategories.store(categories & ALL_CATEGORIES, std::memory_order_relaxed);
+}
+
+void FUTrace::setThreadName(const char *name)
+{
+    tThreadName = name;
+    if (tThreadBuffer) {
+        std::lock_guard<std::mutex> lock(getState().mutex);
+        tThreadBuffer->name = name;
+    }
+}
+
+size_t FUTrace::getDroppedEventCount()
+{
+    TraceState &state = getState();
+    return getTotalDroppedCount(state) - state.droppedEventCountAtStart;
+}
+
+void FUTrace::record(const Event &event)
+{
+    getThreadBuffer().events.push(event);
+}
@@ -0,0 +1,121 @@
+#pragma once
+//STL Includes
+#include <atomic>
+#include <cstdint>
+//Local Includes
+#include "FULatency.h"
+
+/**
+ * FU_TRACE is defined unless the build defines FU_TRACE_DISABLED. When it isn't defined FU_TRACE_SCOPE compiles to nothing.
+ */
+#ifndef FU_TRACE_DISABLED
+#define FU_TRACE 1
+#endif
+
+#define FU_TRACE_CONCAT_IMPL(a, b) a##b
+#define FU_TRACE_CONCAT(a, b) FU_TRACE_CONCAT_IMPL(a, b)
+#ifdef FU_TRACE
+/**
+ * Traces the rest of the enclosing scope as an event. name must be a string literal.
+ */
+#define FU_TRACE_SCOPE(category, name) FUTrace::Scope FU_TRACE_CONCAT(fuTraceScope, __LINE__)(category, name)
+#else
+#define FU_TRACE_SCOPE(category, name)
+#endif
+
+/**
+ * @brief Records scoped events of the frame pipeline and writes them as a Chrome trace event JSON file, which Perfetto and
+ * chrome://tracing open. Every thread writes its events into its own lock-free buffer and a background thread writes the buffers
+ * to the file while the capture runs. A disabled category costs an atomic load, an enabled one two clock reads and a buffer
+ * push, so captures can be taken in production. When a buffer is full its new events are dropped and counted.
+ */
+class FUTrace
+{
+public:
+    enum CATEGORY {
+        SENSOR = 1 << 0,//updateSensor()
+        SKELETON = 1 << 1,
+        INTERACTION = 1 << 2,
+        DEPTH = 1 << 3,
+        COLOR = 1 << 4,
+        DETECTORS = 1 << 5,
+        IO = 1 << 6,//Files that are written while the frames are processed
+        THREAD_POOL = 1 << 7,//The tasks of FUThreadPool::parallelFor()
+        ALL_CATEGORIES = (1 << 8) - 1
+    };
+
+    /**
+     * @brief A complete event. Times are in nanoseconds on the FULatency::getTime() clock.
+     */
+    struct Event {
+        const char *name;
+        unsigned int category;
+        int64_t begin;
+        int64_t end;
+    };
+
+    /**
+     * @brief Records its lifetime as an event if its category is enabled when it's created. Use FU_TRACE_SCOPE instead.
+     */
+    class Scope
+    {
+    public:
+        Scope(CATEGORY category, const char *name)
+            : mName(name)
+            , mCategory(category)
+            , mBegin(isEnabled(category) ? FULatency::getTime() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (mBegin != 0) {
+                const Event event = {mName, mCategory, mBegin, FULatency::getTime()};
+                record(event);
+            }
+        }
+
+    private:
+        const char *mName;
+        CATEGORY mCategory;
+        int64_t mBegin;
+
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+    };
+
+public:
+    /**
+     * @brief Starts a capture. A capture that is in progress is stopped first.
+     * @param filePath --> The JSON file to write
+     * @param categories --> A combination of CATEGORY
+     * @return false if the file can't be created
+     */
+    static bool start(const char *filePath, unsigned int categories = ALL_CATEGORIES);
+    /**
+     * @brief Stops the capture, writes the remaining events and closes the file.
+     */
+    static void stop();
+    /**
+     * @brief Changes the categories of the capture that is in progress.
+     * @param categories --> A combination of CATEGORY
+     */
+    static void setCategories(unsigned int categories);
+    static bool isEnabled(CATEGORY category) {return (sEnabledCategories.load(std::memory_order_relaxed) & category) != 0;}
+    /**
+     * @brief Names the calling thread in the trace. It only keeps the pointer, the thread's buffer is created when it records
+     * its first event.
+     * @param name --> Must stay valid until the capture is stopped, e.g. a string literal
+     */
+    static void setThreadName(const char *name);
+    /**
+     * @brief Returns the number of events that were dropped in the current or the last capture because a buffer was full.
+     * @return
+     */
+    static size_t getDroppedEventCount();
+    static void record(const Event &event);
+
+private:
+    static std::atomic<unsigned int> sEnabledCategories;
+};
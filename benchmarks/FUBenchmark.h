@@ -0,0 +1,76 @@
+#pragma once
+//STL Includes
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief A minimal timing harness. Every benchmark is a function that is called repeatedly until a minimum time has passed,
+ * and the time per operation and the operations per second are printed.
+ */
+class FUBenchmark
+{
+public:
+    /**
+     * @param minimumSeconds --> Minimum time each benchmark runs for
+     */
+    explicit FUBenchmark(double minimumSeconds = 0.2)
+        : mMinimumSeconds(minimumSeconds)
+    {
+    }
+
+    void printHeader(const char *suite) const
+    {
+        std::printf("\n%-48s %14s %16s\n", suite, "ns/op", "op/s");
+    }
+
+    /**
+     * @brief Runs a benchmark.
+     * @param name
+     * @param operationCount --> Number of operations, e.g. joints or frames, in one call of function
+     * @param function --> Called without arguments
+     * @param unit --> Name of an operation in the output
+     * @return Nanoseconds per operation
+     */
+    template<class Function>
+    double run(const std::string &name, size_t operationCount, Function function, const char *unit = "op")
+    {
+        typedef std::chrono::steady_clock Clock;
+        //Warm up the caches and find how many calls fit in a millisecond. Functions that are optimized away stop at MAX_CALL_COUNT.
+        static const size_t MAX_CALL_COUNT = size_t(1) << 30;
+        size_t callCount = 1;
+        while (callCount < MAX_CALL_COUNT) {
+            const Clock::time_point start = Clock::now();
+            for (size_t i = 0; i < callCount; i++)
+                function();
+            if (std::chrono::duration<double>(Clock::now() - start).count() > 1e-3)
+                break;
+            callCount *= 2;
+        }
+        size_t totalCalls = 0;
+        const Clock::time_point start = Clock::now();
+        double elapsed = 0;
+        do {
+            for (size_t i = 0; i < callCount; i++)
+                function();
+            totalCalls += callCount;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (elapsed < mMinimumSeconds);
+        const double nanoseconds = elapsed * 1e9 / (static_cast<double>(totalCalls) * operationCount);
+        std::printf("%-48s %14.2f %14.0f %s/s\n", name.c_str(), nanoseconds, 1e9 / nanoseconds, unit);
+        return nanoseconds;
+    }
+
+    /**
+     * @brief Keeps the compiler from optimizing away a result that is otherwise unused.
+     */
+    template<class T>
+    static void keep(const T &value)
+    {
+        const volatile char *bytes = reinterpret_cast<const volatile char*>(&value);
+        (void)*bytes;
+    }
+
+private:
+    double mMinimumSeconds;
+};
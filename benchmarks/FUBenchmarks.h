@@ -0,0 +1,42 @@
+#pragma once
+//STL Includes
+#include <vector>
+//Local Includes
+#include "FUDepthFrame.h"
+#include "FUSkeleton.h"
+
+class FUBenchmark;
+
+/**
+ * @brief A depth frame and where the right hand of the first tracked player is in it.
+ */
+struct FUDepthSample {
+    FUDepthFrame frame;
+    int handX;
+    int handY;
+    int handDepth;//In millimeters, 0 if there is no tracked hand
+};
+
+/**
+ * The benchmark suites. Each one prints a table of its benchmarks.
+ */
+void runMathBenchmarks(FUBenchmark &benchmark);
+/**
+ * @brief The cost of the instrumentation that runs with every frame.
+ */
+void runInstrumentationBenchmarks(FUBenchmark &benchmark);
+/**
+ * @param frames --> Played in a loop
+ * @param source --> Where the frames come from, for the table title
+ */
+void runSkeletonBenchmarks(FUBenchmark &benchmark, const std::vector<FUSkeleton::SkeletonFrame> &frames, const char *source);
+/**
+ * @param samples --> Played in a loop. They must all have the same size.
+ * @param source --> Where the frames come from, for the table title
+ */
+void runDepthBenchmarks(FUBenchmark &benchmark, const std::vector<FUDepthSample> &samples, const char *source);
+/**
+ * The checks of the results on synthetic data. Each one prints its failures.
+ * @return false if a check failed
+ */
+bool runHandClassifierChecks();
@@ -0,0 +1,45 @@
+#include "FUBenchmarks.h"
+//STL Includes
+#include <cstdio>
+//Local Includes
+#include "FUHandClassifier.h"
+#include "FUSyntheticData.h"
+
+namespace {
+const int DEPTH_WIDTH = 640;
+const int DEPTH_HEIGHT = 480;
+
+const char* getShapeName(FUHandClassifier::HAND_SHAPE shape)
+{
+    switch (shape) {
+    case FUHandClassifier::HAND_OPEN: return "open";
+    case FUHandClassifier::HAND_CLOSED: return "closed";
+    case FUHandClassifier::HAND_POINTING: return "pointing";
+    default: return "unknown";
+    }
+}
+}
+
+bool runHandClassifierChecks()
+{
+    //The closest depths are sampled at every Nth pixel, the farthest ones are only a few pixels across
+    const float depths[] = {0.5f, 0.8f, 1.2f, 2.f, 3.f};
+    const FUHandClassifier::HAND_SHAPE shapes[] = {FUHandClassifier::HAND_OPEN, FUHandClassifier::HAND_CLOSED, FUHandClassifier::HAND_POINTING};
+    FUHandClassifier classifier;
+    std::vector<FUDepthPixel> pixels;
+    int failureCount = 0;
+    for (size_t i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        for (size_t j = 0; j < sizeof(shapes) / sizeof(shapes[0]); j++) {
+            FUSyntheticData::createHandFrame(shapes[j], depths[i], DEPTH_WIDTH, DEPTH_HEIGHT, pixels);
+            const FUDepthFrame frame = {&pixels[0], DEPTH_WIDTH, DEPTH_HEIGHT, 0};
+            const FUHandClassifier::Result result = classifier.classify(frame, DEPTH_WIDTH / 2, DEPTH_HEIGHT / 2,
+                                                                        static_cast<int>(depths[i] * 1000.f));
+            if (result.shape == shapes[j])
+                continue;
+            std::printf("FUHandClassifier: %s hand at %.1f m is classified as %s\n", getShapeName(shapes[j]), depths[i],
+                        getShapeName(result.shape));
+            failureCount++;
+        }
+    }
+    return failureCount == 0;
+}
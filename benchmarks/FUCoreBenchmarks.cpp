@@ -0,0 +1,421 @@
+#include "FUBenchmarks.h"
+//STL Includes
+#include <cstdio>
+#include <string>
+//Local Includes
+#include "FUBatchReplay.h"
+#include "FUBenchmark.h"
+#include "FUColorCropper.h"
+#include "FUDepthFilter.h"
+#include "FUDepthSegmentation.h"
+#include "FUFloorEstimator.h"
+#include "FUFrameProcessor.h"
+#include "FUFramePublisher.h"
+#include "FUHandClassifier.h"
+#include "FUJpegEncoder.h"
+#include "FULatency.h"
+#include "FUMotionGate.h"
+#include "FUPointCloud.h"
+#include "FURecording.h"
+#include "FURegistration.h"
+#include "FUSessionExporter.h"
+#include "FUSkeletonCodec.h"
+#include "FUSkeletonPublisher.h"
+#include "FUStreamScheduler.h"
+#include "FUStreamStats.h"
+#include "FUThreadPool.h"
+#include "FUTrace.h"
+
+using namespace FUSkeleton;
+
+namespace {
+const int COLOR_WIDTH = 1280;
+const int COLOR_HEIGHT = 960;
+
+/**
+ * @brief Plays the frames in a loop, one frame per call.
+ */
+template<class T>
+class FramePlayer
+{
+public:
+    explicit FramePlayer(const std::vector<T> &frames)
+        : mFrames(frames)
+        , mIndex(0)
+    {
+    }
+
+    const T& next()
+    {
+        const T &frame = mFrames[mIndex];
+        mIndex = mIndex + 1 == mFrames.size() ? 0 : mIndex + 1;
+        return frame;
+    }
+
+private:
+    const std::vector<T> &mFrames;
+    size_t mIndex;
+};
+
+typedef bool (*PostureDetector)(const SkeletonData&, float);
+
+bool detectLeftHandDown(const SkeletonData &skeleton, float)
+{
+    return FUPostureDetector::detectLeftHandDownPosture(skeleton);
+}
+
+bool detectRightHandDown(const SkeletonData &skeleton, float)
+{
+    return FUPostureDetector::detectRightHandDownPosture(skeleton);
+}
+
+struct NamedDetector {
+    const char *name;
+    PostureDetector detector;
+};
+
+const NamedDetector POSTURE_DETECTORS[] = {
+    {"detectRightHandUpPosture", &FUPostureDetector::detectRightHandUpPosture},
+    {"detectLeftHandUpPosture", &FUPostureDetector::detectLeftHandUpPosture},
+    {"detectBothHandsUp", &FUPostureDetector::detectBothHandsUp},
+    {"detectLeftHandDownPosture", &detectLeftHandDown},
+    {"detectRightHandDownPosture", &detectRightHandDown},
+    {"detectOpenRightArm", &FUPostureDetector::detectOpenRightArm},
+    {"detectOpenLeftArm", &FUPostureDetector::detectOpenLeftArm},
+    {"detectOpenArms", &FUPostureDetector::detectOpenArms},
+    {"detectLeanRight", &FUPostureDetector::detectLeanRight},
+    {"detectLeanLeft", &FUPostureDetector::detectLeanLeft}
+};
+
+/**
+ * @brief Registration tables of a sensor whose color camera is 2.5 cm to the side of the depth camera
+ */
+void buildRegistration(FURegistration &registration, int width, int height)
+{
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+    std::vector<FURegistration::ColorPoint> nearPoints(pixelCount);
+    std::vector<FURegistration::ColorPoint> farPoints(pixelCount);
+    const float colorFocalLength = getDepthFocalLength(width) * COLOR_WIDTH / width;
+    const int nearShift = static_cast<int>(colorFocalLength * 0.025f * 1000.f / FURegistration::CALIBRATION_NEAR_DEPTH);
+    const int farShift = static_cast<int>(colorFocalLength * 0.025f * 1000.f / FURegistration::CALIBRATION_FAR_DEPTH);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const size_t index = static_cast<size_t>(y) * width + x;
+            const FURegistration::ColorPoint nearPoint = {x * COLOR_WIDTH / width + nearShift, y * COLOR_HEIGHT / height};
+            const FURegistration::ColorPoint farPoint = {x * COLOR_WIDTH / width + farShift, y * COLOR_HEIGHT / height};
+            nearPoints[index] = nearPoint;
+            farPoints[index] = farPoint;
+        }
+    }
+    registration.rebuild(width, height, COLOR_WIDTH, COLOR_HEIGHT, 1, &nearPoints[0], &farPoints[0]);
+}
+
+/**
+ * @brief A BGRX color frame of smooth gradients with some noise, so the encoders don't see a flat image
+ */
+std::vector<uint8_t> makeColorFrame()
+{
+    std::vector<uint8_t> pixels(static_cast<size_t>(COLOR_WIDTH) * COLOR_HEIGHT * 4);
+    uint32_t random = 12345;
+    for (int y = 0; y < COLOR_HEIGHT; y++) {
+        for (int x = 0; x < COLOR_WIDTH; x++) {
+            random = random * 1664525u + 1013904223u;
+            const int noise = static_cast<int>(random >> 29);
+            uint8_t *pixel = &pixels[(static_cast<size_t>(y) * COLOR_WIDTH + x) * 4];
+            pixel[0] = static_cast<uint8_t>(x * 255 / COLOR_WIDTH + noise);
+            pixel[1] = static_cast<uint8_t>(y * 255 / COLOR_HEIGHT + noise);
+            pixel[2] = static_cast<uint8_t>((x + y) % 256);
+            pixel[3] = 255;
+        }
+    }
+    return pixels;
+}
+}
+
+void runSkeletonBenchmarks(FUBenchmark &benchmark, const std::vector<SkeletonFrame> &frames, const char *source)
+{
+    if (frames.empty())
+        return;
+    FramePlayer<SkeletonFrame> player(frames);
+    benchmark.printHeader((std::string("Skeleton, ") + source).c_str());
+
+    FUFrameProcessor processor;
+    processor.subscribe(FUGesture::ANY_PLAYER, FUGesture::ALL_DETECTORS);
+    FUGesture::GestureEvent events[64];
+    benchmark.run("FUFrameProcessor::processSkeletonFrame", 1, [&]() {
+        processor.processSkeletonFrame(player.next());
+        FUBenchmark::keep(processor.pollEvents(events, 64));
+    }, "frame");
+    benchmark.run("FUFrameProcessor::evaluateDetectors", 1, [&]() {
+        const SkeletonFrame &frame = player.next();
+        unsigned int active = 0;
+        for (int i = 0; i < MAX_SKELETONS; i++)
+            active |= FUFrameProcessor::evaluateDetectors(frame.skeletons[i], FUGesture::ALL_DETECTORS);
+        FUBenchmark::keep(active);
+    }, "frame");
+    for (size_t i = 0; i < sizeof(POSTURE_DETECTORS) / sizeof(POSTURE_DETECTORS[0]); i++) {
+        const PostureDetector detector = POSTURE_DETECTORS[i].detector;
+        benchmark.run(std::string("FUPostureDetector::") + POSTURE_DETECTORS[i].name, 1, [&]() {
+            const SkeletonFrame &frame = player.next();
+            int count = 0;
+            for (int j = 0; j < MAX_SKELETONS; j++)
+                count += detector(frame.skeletons[j], 1.f);
+            FUBenchmark::keep(count);
+        }, "frame");
+    }
+    benchmark.run("FUPostureDetector::getDistanceFromFloor", 1, [&]() {
+        const SkeletonFrame &frame = player.next();
+        float height = 0;
+        for (int i = 0; i < MAX_SKELETONS; i++)
+            height += FUPostureDetector::getDistanceFromFloor(frame.floorPlane, frame.skeletons[i].joints[FOOT_LEFT]);
+        FUBenchmark::keep(height);
+    }, "frame");
+    FUPostureDetector::JumpState jumpStates[MAX_SKELETONS] = {};
+    benchmark.run("FUPostureDetector::updateJump", 1, [&]() {
+        const SkeletonFrame &frame = player.next();
+        int jumpCount = 0;
+        for (int i = 0; i < MAX_SKELETONS; i++)
+            jumpCount += FUPostureDetector::updateJump(jumpStates[i], frame.skeletons[i], frame.floorPlane);
+        FUBenchmark::keep(jumpCount);
+    }, "frame");
+    FUSkeletonEncoder encoder;
+    uint8_t packet[FUSkeletonCodec::MAX_PACKET_SIZE];
+    size_t packetSize = 0;
+    benchmark.run("FUSkeletonEncoder::encode", 1, [&]() {
+        packetSize = encoder.encode(player.next(), packet);
+        FUBenchmark::keep(packet[0]);
+    }, "frame");
+    FUSkeletonEncoder keyFrameEncoder(1);
+    FUSkeletonDecoder decoder;
+    SkeletonFrame decodedFrame;
+    benchmark.run("FUSkeletonDecoder::decode, key frames", 1, [&]() {
+        packetSize = keyFrameEncoder.encode(player.next(), packet);
+        FUBenchmark::keep(decoder.decode(packet, packetSize, decodedFrame));
+    }, "frame");
+    FUSkeletonPublisher publisher;
+    FUSkeletonReader reader;
+    if (publisher.open("FUBenchmarksSkeletons") && reader.open("FUBenchmarksSkeletons")) {
+        FUSharedSkeleton::Frame sharedFrame;
+        benchmark.run("FUSkeletonPublisher::publish, readNext", 1, [&]() {
+            publisher.publish(player.next(), processor);
+            FUBenchmark::keep(reader.readNext(sharedFrame));
+        }, "frame");
+    }
+    std::vector<FUSharedSkeleton::Frame> sharedFrames(frames.size());
+    for (size_t i = 0; i < frames.size(); i++)
+        FUSkeletonPublisher::fillFrame(sharedFrames[i], frames[i], processor);
+    FramePlayer<FUSharedSkeleton::Frame> sharedPlayer(sharedFrames);
+    const char *sessionFilePath = "FUBenchmarks.session";
+    FUSessionExporter exporter;
+    if (exporter.open(sessionFilePath)) {
+        //The file is started over now and then so it doesn't grow to gigabytes, which adds the cost of the footer
+        int exportedFrameCount = 0;
+        benchmark.run("FUSessionExporter::write", 1, [&]() {
+            if (++exportedFrameCount % 10000 == 0)
+                exporter.open(sessionFilePath);
+            exporter.write(sharedPlayer.next());
+        }, "frame");
+        exporter.close();
+        FUSessionReader sessionReader;
+        if (sessionReader.open(sessionFilePath) && sessionReader.getRowGroupCount() > 0) {
+            const int column = sessionReader.findColumn("handRightY");
+            const uint32_t rowCount = sessionReader.getRowCount(0);
+            benchmark.run("FUSessionReader::readColumn, sum", rowCount, [&]() {
+                const float *values = static_cast<const float*>(sessionReader.readColumn(0, column));
+                float sum = 0;
+                for (uint32_t i = 0; i < rowCount; i++)
+                    sum += values[i];
+                FUBenchmark::keep(sum);
+            }, "row");
+        }
+        sessionReader.close();
+        std::remove(sessionFilePath);
+    }
+    std::vector<std::string> replayFilePaths;
+    for (int i = 0; i < 4; i++) {
+        char filePath[64];
+        std::snprintf(filePath, sizeof(filePath), "FUBenchmarks.replay%d", i);
+        FURecordingWriter writer;
+        if (!writer.open(filePath))
+            break;
+        for (size_t j = 0; j < frames.size(); j++)
+            writer.writeSkeletonFrame(frames[j]);
+        replayFilePaths.push_back(filePath);
+    }
+    FUBatchReplay batchReplay;
+    benchmark.run("FUBatchReplay::run, 4 recordings", frames.size() * replayFilePaths.size(), [&]() {
+        FUBenchmark::keep(batchReplay.run(replayFilePaths).size());
+    }, "frame");
+    for (size_t i = 0; i < replayFilePaths.size(); i++)
+        std::remove(replayFilePaths[i].c_str());
+    FURegistration registration;
+    buildRegistration(registration, 640, 480);
+    const std::vector<uint8_t> colorFrame = makeColorFrame();
+    FUColorCropper colorCropper;
+    benchmark.run("FUColorCropper::crop", 1, [&]() {
+        const FUColorCropper::Batch *batch = colorCropper.crop(player.next(), registration, &colorFrame[0], COLOR_WIDTH, COLOR_HEIGHT,
+                                                               COLOR_WIDTH * 4, 0, 0);
+        FUBenchmark::keep(batch->cropCount);
+        colorCropper.release(batch);
+    }, "frame");
+    colorCropper.configure(64, 2, FUColorCropper::ALL_REGIONS);
+    benchmark.run("FUColorCropper::crop, downscaled", 1, [&]() {
+        const FUColorCropper::Batch *batch = colorCropper.crop(player.next(), registration, &colorFrame[0], COLOR_WIDTH, COLOR_HEIGHT,
+                                                               COLOR_WIDTH * 4, 0, 0);
+        FUBenchmark::keep(batch->cropCount);
+        colorCropper.release(batch);
+    }, "frame");
+    FUBodyScale bodyScales[MAX_SKELETONS];
+    benchmark.run("FUBodyScale::update", 1, [&]() {
+        const SkeletonFrame &frame = player.next();
+        for (int i = 0; i < MAX_SKELETONS; i++) {
+            if (frame.skeletons[i].trackingState == SKELETON_TRACKED)
+                bodyScales[i].update(frame.skeletons[i].joints, frame.skeletons[i].jointStates);
+        }
+        FUBenchmark::keep(bodyScales[0].getScale());
+    }, "frame");
+}
+
+void runDepthBenchmarks(FUBenchmark &benchmark, const std::vector<FUDepthSample> &samples, const char *source)
+{
+    if (samples.empty())
+        return;
+    FramePlayer<FUDepthSample> player(samples);
+    const int width = samples[0].frame.width;
+    const int height = samples[0].frame.height;
+    FUThreadPool threadPool;
+    benchmark.printHeader((std::string("Depth, ") + source).c_str());
+
+    FUMotionGate motionGate;
+    benchmark.run("FUMotionGate::update", 1, [&]() {
+        FUBenchmark::keep(motionGate.update(player.next().frame, true));
+    }, "frame");
+    FUFramePublisher framePublisher;
+    FUFrameReader frameReader;
+    if (framePublisher.open("FUBenchmarksDepth", FUSharedFrame::DEPTH_PIXELS, width, height) && frameReader.open("FUBenchmarksDepth")) {
+        FUFrameReader::Frame sharedFrame;
+        benchmark.run("FUFramePublisher::publish, acquireLatest", 1, [&]() {
+            const FUDepthFrame &frame = player.next().frame;
+            framePublisher.publish(frame.pixels, frame.width * sizeof(FUDepthPixel), 0, frame.timeStamp);
+            FUBenchmark::keep(frameReader.acquireLatest(sharedFrame));
+        }, "frame");
+    }
+    FUDepthFilter depthFilter;
+    benchmark.run("FUDepthFilter::process", 1, [&]() {
+        FUBenchmark::keep(depthFilter.process(player.next().frame).pixels[0]);
+    }, "frame");
+    FUDepthFilter parallelDepthFilter(&threadPool);
+    benchmark.run("FUDepthFilter::process, thread pool", 1, [&]() {
+        FUBenchmark::keep(parallelDepthFilter.process(player.next().frame).pixels[0]);
+    }, "frame");
+    FUDepthSegmentation segmentation;
+    benchmark.run("FUDepthSegmentation::process", 1, [&]() {
+        segmentation.process(player.next().frame);
+        FUBenchmark::keep(segmentation);
+    }, "frame");
+    FUHandClassifier handClassifier;
+    benchmark.run("FUHandClassifier::classify", 1, [&]() {
+        const FUDepthSample &sample = player.next();
+        if (sample.handDepth > 0)
+            FUBenchmark::keep(handClassifier.classify(sample.frame, sample.handX, sample.handY, sample.handDepth).shape);
+    }, "hand");
+    FUPointCloud pointCloud;
+    pointCloud.resize(width, height);
+    benchmark.run("FUPointCloud::generate, all pixels", 1, [&]() {
+        FUBenchmark::keep(pointCloud.generate(player.next().frame));
+    }, "frame");
+    benchmark.run("FUPointCloud::generate, players", 1, [&]() {
+        FUBenchmark::keep(pointCloud.generate(player.next().frame, FUPointCloud::PLAYERS_ONLY));
+    }, "frame");
+    FURegistration registration;
+    buildRegistration(registration, width, height);
+    benchmark.run("FURegistration::mapDepthFrame", 1, [&]() {
+        registration.mapDepthFrame(player.next().frame);
+        FUBenchmark::keep(registration);
+    }, "frame");
+    const std::vector<uint8_t> colorPixels(static_cast<size_t>(COLOR_WIDTH) * COLOR_HEIGHT * 4, 128);
+    benchmark.run("FURegistration::registerColorFrame", 1, [&]() {
+        registration.registerColorFrame(&colorPixels[0], COLOR_WIDTH * 4);
+        FUBenchmark::keep(registration);
+    }, "frame");
+    const std::vector<uint8_t> colorFrame = makeColorFrame();
+    std::vector<uint8_t> jpegFile;
+    FUJpegEncoder jpegEncoder;
+    benchmark.run("FUJpegEncoder::encode", 1, [&]() {
+        FUBenchmark::keep(jpegEncoder.encode(&colorFrame[0], COLOR_WIDTH, COLOR_HEIGHT, COLOR_WIDTH * 4, jpegFile));
+    }, "frame");
+    FUJpegEncoder parallelJpegEncoder(&threadPool);
+    benchmark.run("FUJpegEncoder::encode, thread pool", 1, [&]() {
+        FUBenchmark::keep(parallelJpegEncoder.encode(&colorFrame[0], COLOR_WIDTH, COLOR_HEIGHT, COLOR_WIDTH * 4, jpegFile));
+    }, "frame");
+    FUFloorEstimator floorEstimator(&threadPool);
+    benchmark.run("FUFloorEstimator::update, first estimate", 1, [&]() {
+        floorEstimator.reset();
+        FUBenchmark::keep(floorEstimator.update(player.next().frame));
+    }, "frame");
+    benchmark.run("FUFloorEstimator::update, refine", 1, [&]() {
+        FUBenchmark::keep(floorEstimator.update(player.next().frame));
+    }, "frame");
+}
+
+void runInstrumentationBenchmarks(FUBenchmark &benchmark)
+{
+    benchmark.printHeader("Instrumentation");
+    FULatencyHistogram histogram;
+    uint64_t value = 12345;
+    benchmark.run("FULatencyHistogram::record", 1, [&]() {
+        histogram.record(value);
+        value = value * 3 % 100000007;
+    });
+    benchmark.run("FULatencyHistogram::getSummary", 1, [&]() {
+        FUBenchmark::keep(histogram.getSummary());
+    }, "summary");
+    FULatency latency;
+    int64_t sensorTimeStamp = 0;
+    benchmark.run("FULatency, stamps of a frame", 1, [&]() {
+        FULatency::Stamp stamp = latency.begin(FULatency::SKELETON_STREAM, sensorTimeStamp++);
+        latency.mark(stamp, FULatency::SKELETON_PROCESSING);
+        latency.mark(stamp, FULatency::SKELETON_DETECTORS);
+        latency.end(stamp, FULatency::SKELETON_RESULT);
+    }, "frame");
+    latency.setEnabled(false);
+    benchmark.run("FULatency, stamps of a frame, disabled", 1, [&]() {
+        FULatency::Stamp stamp = latency.begin(FULatency::SKELETON_STREAM, sensorTimeStamp++);
+        latency.mark(stamp, FULatency::SKELETON_PROCESSING);
+        latency.mark(stamp, FULatency::SKELETON_DETECTORS);
+        latency.end(stamp, FULatency::SKELETON_RESULT);
+    }, "frame");
+    FUStreamStats streamStats;
+    uint32_t frameNumber = 0;
+    benchmark.run("FUStreamStats::recordFrame", 1, [&]() {
+        frameNumber++;
+        streamStats.recordFrame(frameNumber, frameNumber * 33);
+    }, "frame");
+    //Every stream signals a frame per sensor frame and the color and depth frames cost more than the budget leaves them
+    FUStreamScheduler streamScheduler;
+    streamScheduler.setStream(FULatency::COLOR_STREAM, 5, FUStreamScheduler::LOW_PRIORITY);
+    streamScheduler.setBudget(10);
+    const int64_t streamCosts[FULatency::STREAM_COUNT] = {2000000, 1000000, 6000000, 8000000};
+    int64_t schedulerTime = 0;
+    benchmark.run("FUStreamScheduler::decide, 4 streams", 1, [&]() {
+        schedulerTime += 1000000000 / 30;
+        const FULatency::STREAM *order = streamScheduler.getOrder();
+        for (int i = 0; i < FULatency::STREAM_COUNT; i++) {
+            if (streamScheduler.decide(order[i], schedulerTime) == FUStreamScheduler::PROCESS)
+                streamScheduler.record(order[i], streamCosts[order[i]]);
+        }
+    }, "frame");
+    FUBenchmark::keep(streamScheduler.getCounters(FULatency::COLOR_STREAM).processedCount);
+    benchmark.run("FUTrace scope, no capture", 1, [&]() {
+        FU_TRACE_SCOPE(FUTrace::DETECTORS, "benchmark");
+    }, "scope");
+    //The scopes come faster than the writer empties the buffer, so this includes the drops of a full buffer
+    const char *traceFilePath = "FUBenchmarks.trace.json";
+    if (FUTrace::start(traceFilePath, FUTrace::DETECTORS)) {
+        benchmark.run("FUTrace scope, capturing", 1, [&]() {
+            FU_TRACE_SCOPE(FUTrace::DETECTORS, "benchmark");
+        }, "scope");
+        FUTrace::stop();
+        std::remove(traceFilePath);
+    }
+}
@@ -0,0 +1,125 @@
+#include "FUBenchmarks.h"
+//STL Includes
+#include <cstdlib>
+#include <vector>
+//Local Includes
+#include "FUBenchmark.h"
+#include "FUMathBatch.h"
+
+using namespace FUMath;
+using namespace FUMath::Batch;
+
+namespace {
+//Enough joints for a few seconds of skeleton frames
+const size_t POINT_COUNT = 1024;
+
+struct Points {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    //The same points for the per object API
+    std::vector<FUVector3<float>> vectors;
+
+    explicit Points(size_t count)
+        : x(count), y(count), z(count), vectors(count)
+    {
+        for (size_t i = 0; i < count; i++) {
+            x[i] = std::rand() / static_cast<float>(RAND_MAX) - 0.5f;
+            y[i] = std::rand() / static_cast<float>(RAND_MAX) - 0.2f;
+            z[i] = std::rand() / static_cast<float>(RAND_MAX) * 3.f + 1.f;
+            vectors[i] = FUVector3<float>(x[i], y[i], z[i]);
+        }
+    }
+
+    FUVector3Span span() {
+        FUVector3Span span = {&x[0], &y[0], &z[0], x.size()};
+        return span;
+    }
+};
+}
+
+void runMathBenchmarks(FUBenchmark &benchmark)
+{
+    Points a(POINT_COUNT);
+    Points b(POINT_COUNT);
+    Points output(POINT_COUNT);
+    std::vector<float> scalars(POINT_COUNT);
+    const FUMatrix4<float> matrix = FUMatrix4<float>::createRigidTransform(
+                FUQuaternion<float>::fromAxisAngle(FUVector3<float>(0.f, 1.f, 0.f), 0.5f), FUVector3<float>(0.1f, 0.2f, 0.3f));
+    const FUVector4<float> plane(0.f, 0.98f, 0.2f, 1.1f);
+
+    benchmark.printHeader("FUMath, per object");
+    benchmark.run("transform", POINT_COUNT, [&]() {
+        for (size_t i = 0; i < POINT_COUNT; i++)
+            output.vectors[i] = matrix.transformPoint(a.vectors[i]);
+        FUBenchmark::keep(output.vectors[0]);
+    });
+    benchmark.run("distance", POINT_COUNT, [&]() {
+        for (size_t i = 0; i < POINT_COUNT; i++)
+            scalars[i] = (a.vectors[i] - b.vectors[i]).length();
+        FUBenchmark::keep(scalars[0]);
+    });
+    benchmark.run("dot", POINT_COUNT, [&]() {
+        for (size_t i = 0; i < POINT_COUNT; i++)
+            scalars[i] = a.vectors[i].dot(b.vectors[i]);
+        FUBenchmark::keep(scalars[0]);
+    });
+    benchmark.run("length", POINT_COUNT, [&]() {
+        for (size_t i = 0; i < POINT_COUNT; i++)
+            scalars[i] = a.vectors[i].length();
+        FUBenchmark::keep(scalars[0]);
+    });
+    benchmark.run("normalize", POINT_COUNT, [&]() {
+        for (size_t i = 0; i < POINT_COUNT; i++)
+            output.vectors[i] = a.vectors[i].normalized();
+        FUBenchmark::keep(output.vectors[0]);
+    });
+    benchmark.run("lerp", POINT_COUNT, [&]() {
+        for (size_t i = 0; i < POINT_COUNT; i++)
+            output.vectors[i] = a.vectors[i].linearInterpolation(0.3f, b.vectors[i]);
+        FUBenchmark::keep(output.vectors[0]);
+    });
+    benchmark.run("plane distance", POINT_COUNT, [&]() {
+        for (size_t i = 0; i < POINT_COUNT; i++)
+            scalars[i] = plane.dot(FUVector4<float>(a.vectors[i], 1.f));
+        FUBenchmark::keep(scalars[0]);
+    });
+
+    const FUVector3Span spanA = a.span();
+    const FUVector3Span spanB = b.span();
+    const FUVector3Span spanOutput = output.span();
+    const INSTRUCTION_SET supported = getSupportedInstructionSet();
+    for (int set = SCALAR; set <= supported; set++) {
+        setInstructionSet(static_cast<INSTRUCTION_SET>(set));
+        benchmark.printHeader((std::string("FUMath::Batch, ") + getInstructionSetName(getInstructionSet())).c_str());
+        benchmark.run("transform", POINT_COUNT, [&]() {
+            transform(matrix, spanA, spanOutput);
+            FUBenchmark::keep(output.x[0]);
+        });
+        benchmark.run("distance", POINT_COUNT, [&]() {
+            distance(spanA, spanB, &scalars[0]);
+            FUBenchmark::keep(scalars[0]);
+        });
+        benchmark.run("dot", POINT_COUNT, [&]() {
+            dot(spanA, spanB, &scalars[0]);
+            FUBenchmark::keep(scalars[0]);
+        });
+        benchmark.run("length", POINT_COUNT, [&]() {
+            length(spanA, &scalars[0]);
+            FUBenchmark::keep(scalars[0]);
+        });
+        benchmark.run("normalize", POINT_COUNT, [&]() {
+            normalize(spanA, spanOutput);
+            FUBenchmark::keep(output.x[0]);
+        });
+        benchmark.run("lerp", POINT_COUNT, [&]() {
+            lerp(spanA, spanB, 0.3f, spanOutput);
+            FUBenchmark::keep(output.x[0]);
+        });
+        benchmark.run("plane distance", POINT_COUNT, [&]() {
+            planeDistance(plane, spanA, &scalars[0]);
+            FUBenchmark::keep(scalars[0]);
+        });
+    }
+    setInstructionSet(supported);
+}
@@ -0,0 +1,211 @@
+#include "FUSyntheticData.h"
+//STL Includes
+#include <cmath>
+
+using namespace FUSkeleton;
+using FUMath::FUVector3;
+
+namespace {
+const uint32_t SCENE_LENGTH = 180;
+const float WALL_DEPTH = 4.f;
+const float TORSO_HALF_WIDTH = 0.2f;
+const float HAND_RADIUS = 0.06f;
+//The hands are held in front of the body, so they can be told apart in the depth frames
+const float HAND_REACH = 0.25f;
+//The hand of createHandFrame(), in meters
+const float PALM_RADIUS = 0.045f;
+const float FOREARM_HALF_WIDTH = 0.03f;
+const float FINGER_LENGTH = 0.075f;
+const float FINGER_HALF_WIDTH = 0.009f;
+
+/**
+ * @brief Joint positions of an adult with the arms down, relative to the point on the floor between the feet
+ */
+const FUVector3<float> STANDING_POSE[JOINT_COUNT] = {
+    FUVector3<float>(0.f, 0.95f, 0.f),//HIP_CENTER
+    FUVector3<float>(0.f, 1.1f, 0.f),//SPINE
+    FUVector3<float>(0.f, 1.45f, 0.f),//SHOULDER_CENTER
+    FUVector3<float>(0.f, 1.65f, 0.f),//HEAD
+    FUVector3<float>(-0.18f, 1.42f, 0.f),//SHOULDER_LEFT
+    FUVector3<float>(-0.2f, 1.14f, 0.f),//ELBOW_LEFT
+    FUVector3<float>(-0.21f, 0.92f, -0.18f),//WRIST_LEFT
+    FUVector3<float>(-0.21f, 0.88f, -0.25f),//HAND_LEFT
+    FUVector3<float>(0.18f, 1.42f, 0.f),//SHOULDER_RIGHT
+    FUVector3<float>(0.2f, 1.14f, 0.f),//ELBOW_RIGHT
+    FUVector3<float>(0.21f, 0.92f, -0.18f),//WRIST_RIGHT
+    FUVector3<float>(0.21f, 0.88f, -0.25f),//HAND_RIGHT
+    FUVector3<float>(-0.1f, 0.9f, 0.f),//HIP_LEFT
+    FUVector3<float>(-0.1f, 0.5f, 0.f),//KNEE_LEFT
+    FUVector3<float>(-0.1f, 0.08f, 0.f),//ANKLE_LEFT
+    FUVector3<float>(-0.1f, 0.01f, -0.08f),//FOOT_LEFT
+    FUVector3<float>(0.1f, 0.9f, 0.f),//HIP_RIGHT
+    FUVector3<float>(0.1f, 0.5f, 0.f),//KNEE_RIGHT
+    FUVector3<float>(0.1f, 0.08f, 0.f),//ANKLE_RIGHT
+    FUVector3<float>(0.1f, 0.01f, -0.08f)//FOOT_RIGHT
+};
+
+void setPose(SkeletonData &skeleton, uint32_t trackingID, const FUVector3<float> &origin)
+{
+    skeleton.trackingID = trackingID;
+    skeleton.trackingState = SKELETON_TRACKED;
+    for (int joint = 0; joint < JOINT_COUNT; joint++) {
+        skeleton.joints[joint] = origin + STANDING_POSE[joint];
+        skeleton.jointStates[joint] = JOINT_TRACKED;
+    }
+}
+
+void setArm(SkeletonData &skeleton, JOINT shoulder, float side, float elbowHeight, float handHeight, float reach)
+{
+    const FUVector3<float> &shoulderPosition = skeleton.joints[shoulder];
+    const FUVector3<float> elbow = shoulderPosition + FUVector3<float>(side * reach * 0.5f, elbowHeight, 0.f);
+    const FUVector3<float> hand = shoulderPosition + FUVector3<float>(side * reach, handHeight, -HAND_REACH);
+    skeleton.joints[shoulder + 1] = elbow;
+    skeleton.joints[shoulder + 2] = elbow.linearInterpolation(0.8f, hand);
+    skeleton.joints[shoulder + 3] = hand;
+}
+
+/**
+ * @brief A fast deterministic noise source, the same for every run
+ */
+uint32_t nextRandom(uint32_t &state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+}
+
+void FUSyntheticData::createSkeletonFrame(uint32_t frameNumber, SkeletonFrame &frame)
+{
+    frame = SkeletonFrame();
+    frame.frameNumber = frameNumber;
+    frame.timeStamp = static_cast<int64_t>(frameNumber) * 1000 / 30;
+    frame.floorPlane = FUMath::FUVector4<float>(0.f, 1.f, 0.f, -FLOOR_HEIGHT);
+    const uint32_t sceneFrame = frameNumber % SCENE_LENGTH;
+    const float phase = sceneFrame * 6.2831853f / SCENE_LENGTH;
+
+    //The first player waves the right hand for a second every two seconds, and jumps at the end of the scene
+    SkeletonData &waving = frame.skeletons[0];
+    float jumpHeight = 0.f;
+    if (sceneFrame >= 150 && sceneFrame < 168) {
+        const float t = (sceneFrame - 150) / 18.f;
+        jumpHeight = 0.6f * t * (1.f - t);
+    }
+    setPose(waving, 1001, FUVector3<float>(-0.4f + 0.05f * std::sin(phase), FLOOR_HEIGHT + jumpHeight, 2.5f));
+    if ((sceneFrame / 30) % 2 == 1)
+        setArm(waving, SHOULDER_RIGHT, 1.f, 0.2f + 0.05f * std::sin(phase * 12.f), 0.5f, 0.15f);
+
+    //The second player leans and opens the arms in turns
+    SkeletonData &leaning = frame.skeletons[3];
+    setPose(leaning, 1002, FUVector3<float>(0.6f, FLOOR_HEIGHT, 3.f));
+    const float lean = 0.18f * std::sin(phase * 2.f);
+    for (int joint = SPINE; joint <= HAND_RIGHT; joint++)
+        leaning.joints[joint].x += lean * (leaning.joints[joint].y - leaning.joints[HIP_CENTER].y) / 0.7f;
+    if (sceneFrame >= 90 && sceneFrame < 130) {
+        setArm(leaning, SHOULDER_LEFT, -1.f, 0.02f, 0.f, 0.6f);
+        setArm(leaning, SHOULDER_RIGHT, 1.f, 0.02f, 0.f, 0.6f);
+    }
+
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        SkeletonData &skeleton = frame.skeletons[i];
+        if (skeleton.trackingState != SKELETON_NOT_TRACKED)
+            skeleton.position = skeleton.joints[HIP_CENTER];
+    }
+}
+
+void FUSyntheticData::createDepthFrame(const SkeletonFrame &skeletonFrame, int width, int height, std::vector<FUDepthPixel> &pixels)
+{
+    pixels.resize(static_cast<size_t>(width) * height);
+    const float focalLength = getDepthFocalLength(width);
+    const float centerX = width * 0.5f;
+    const float centerY = height * 0.5f;
+    uint32_t randomState = skeletonFrame.frameNumber;
+    for (int y = 0; y < height; y++) {
+        //The floor is hit where the ray goes down far enough to reach it before the wall
+        const float rayY = (centerY - y) / focalLength;
+        const float floorDepth = rayY < 0 ? FLOOR_HEIGHT / rayY : WALL_DEPTH;
+        const float depth = floorDepth < WALL_DEPTH ? floorDepth : WALL_DEPTH;
+        for (int x = 0; x < width; x++) {
+            FUDepthPixel &pixel = pixels[y * width + x];
+            const uint32_t random = nextRandom(randomState);
+            pixel.playerIndex = 0;
+            pixel.depth = random % 199 == 0 ? 0 : static_cast<uint16_t>(depth * 1000.f + (random & 3));
+        }
+    }
+
+    for (int i = 0; i < MAX_SKELETONS; i++) {
+        const SkeletonData &skeleton = skeletonFrame.skeletons[i];
+        if (skeleton.trackingState != SKELETON_TRACKED)
+            continue;
+        const uint16_t playerIndex = static_cast<uint16_t>(i + 1);
+        //The body is a box from the feet to the head, the hands are discs in front of it
+        const float bodyDepth = skeleton.joints[HIP_CENTER].z;
+        const float scale = focalLength / bodyDepth;
+        const int left = static_cast<int>(centerX + (skeleton.joints[HIP_CENTER].x - TORSO_HALF_WIDTH) * scale);
+        const int right = static_cast<int>(centerX + (skeleton.joints[HIP_CENTER].x + TORSO_HALF_WIDTH) * scale);
+        const int top = static_cast<int>(centerY - (skeleton.joints[HEAD].y + 0.1f) * scale);
+        const int bottom = static_cast<int>(centerY - skeleton.joints[FOOT_LEFT].y * scale);
+        for (int y = top < 0 ? 0 : top; y <= bottom && y < height; y++) {
+            for (int x = left < 0 ? 0 : left; x <= right && x < width; x++) {
+                FUDepthPixel &pixel = pixels[y * width + x];
+                pixel.playerIndex = playerIndex;
+                pixel.depth = static_cast<uint16_t>(bodyDepth * 1000.f);
+            }
+        }
+        const JOINT hands[2] = {HAND_LEFT, HAND_RIGHT};
+        for (int j = 0; j < 2; j++) {
+            const FUVector3<float> &hand = skeleton.joints[hands[j]];
+            int handX = 0, handY = 0;
+            if (!projectToDepth(hand, width, height, handX, handY))
+                continue;
+            const int radius = static_cast<int>(HAND_RADIUS * focalLength / hand.z);
+            for (int y = handY - radius; y <= handY + radius; y++) {
+                for (int x = handX - radius; x <= handX + radius; x++) {
+                    if (x < 0 || y < 0 || x >= width || y >= height || (x - handX) * (x - handX) + (y - handY) * (y - handY) > radius * radius)
+                        continue;
+                    FUDepthPixel &pixel = pixels[y * width + x];
+                    pixel.playerIndex = playerIndex;
+                    pixel.depth = static_cast<uint16_t>(hand.z * 1000.f);
+                }
+            }
+        }
+    }
+}
+
+void FUSyntheticData::createHandFrame(FUHandClassifier::HAND_SHAPE shape, float depth, int width, int height, std::vector<FUDepthPixel> &pixels)
+{
+    pixels.resize(static_cast<size_t>(width) * height);
+    const float scale = getDepthFocalLength(width) / depth;
+    const float centerX = width * 0.5f;
+    const float centerY = height * 0.5f;
+    //The open hand's fingers are spread over the upper half, the pointing one only has the middle one of them
+    const int fingerCount = shape == FUHandClassifier::HAND_OPEN ? 5 : (shape == FUHandClassifier::HAND_POINTING ? 1 : 0);
+    const float firstAngle = shape == FUHandClassifier::HAND_OPEN ? -2.4f : -1.5708f;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            //In meters from the center of the palm, y goes down
+            const float dx = (x - centerX) / scale;
+            const float dy = (y - centerY) / scale;
+            bool isHand = dx * dx + dy * dy < PALM_RADIUS * PALM_RADIUS || (dy > 0.f && std::fabs(dx) < FOREARM_HALF_WIDTH);
+            for (int i = 0; i < fingerCount && !isHand; i++) {
+                const float angle = firstAngle + i * 0.4f;
+                const float along = dx * std::cos(angle) + dy * std::sin(angle);
+                const float across = std::fabs(dy * std::cos(angle) - dx * std::sin(angle));
+                isHand = along > 0.f && along < PALM_RADIUS + FINGER_LENGTH && across < FINGER_HALF_WIDTH;
+            }
+            FUDepthPixel &pixel = pixels[y * width + x];
+            pixel.playerIndex = isHand ? 1 : 0;
+            //The forearm leans away from the sensor a little
+            pixel.depth = static_cast<uint16_t>(isHand ? depth * 1000.f + dy * 200.f : WALL_DEPTH * 1000.f);
+        }
+    }
+}
+
+bool FUSyntheticData::projectToDepth(const FUVector3<float> &point, int width, int height, int &x, int &y)
+{
+    if (point.z <= 0)
+        return false;
+    const float focalLength = getDepthFocalLength(width);
+    x = static_cast<int>(width * 0.5f + point.x * focalLength / point.z);
+    y = static_cast<int>(height * 0.5f - point.y * focalLength / point.z);
+    return x >= 0 && y >= 0 && x < width && y < height;
+}
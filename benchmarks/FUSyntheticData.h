@@ -0,0 +1,51 @@
+#pragma once
+//STL Includes
+#include <vector>
+//Local Includes
+#include "FUDepthFrame.h"
+#include "FUHandClassifier.h"
+#include "FUSkeleton.h"
+
+/**
+ * Deterministic data for the benchmarks. The scene is a room with the floor 1 m below the sensor and a wall 4 m in front of it.
+ * Two players stand in it: the first one waves the right hand and jumps every few seconds, the second one leans from side to
+ * side and opens the arms.
+ */
+namespace FUSyntheticData
+{
+/**
+ * @brief The floor plane of the scene, in the convention of vFloorClipPlane
+ */
+const float FLOOR_HEIGHT = -1.f;
+
+/**
+ * @brief Creates the skeleton frame at the given frame number. The scene repeats every 180 frames.
+ * @param frameNumber
+ * @param frame
+ */
+void createSkeletonFrame(uint32_t frameNumber, FUSkeleton::SkeletonFrame &frame);
+/**
+ * @brief Renders the depth frame of a skeleton frame. The players get their skeleton slot + 1 as the player index, and the
+ * frame has a little noise and a few holes like a real one.
+ * @param skeletonFrame
+ * @param width
+ * @param height
+ * @param pixels --> Resized to width * height
+ */
+void createDepthFrame(const FUSkeleton::SkeletonFrame &skeletonFrame, int width, int height, std::vector<FUDepthPixel> &pixels);
+/**
+ * @brief Renders a single hand facing the sensor at the center of the frame, with the forearm going down from it and the wall
+ * behind it. An open hand has five spread fingers, a pointing one has the index finger up and a closed one is a fist.
+ * @param shape --> HAND_OPEN, HAND_CLOSED or HAND_POINTING
+ * @param depth --> Depth of the hand in meters
+ * @param width
+ * @param height
+ * @param pixels --> Resized to width * height
+ */
+void createHandFrame(FUHandClassifier::HAND_SHAPE shape, float depth, int width, int height, std::vector<FUDepthPixel> &pixels);
+/**
+ * @brief Projects a point in skeleton space to the depth image with the nominal focal length.
+ * @return false if the point is behind the sensor or outside of the image
+ */
+bool projectToDepth(const FUMath::FUVector3<float> &point, int width, int height, int &x, int &y);
+}
@@ -0,0 +1,152 @@
+//STL Includes
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+//Local Includes
+#include "FUBenchmark.h"
+#include "FUBenchmarks.h"
+#include "FURecording.h"
+#include "FUSyntheticData.h"
+
+namespace {
+const int SYNTHETIC_SKELETON_FRAME_COUNT = 360;
+const int SYNTHETIC_DEPTH_FRAME_COUNT = 16;
+const int DEPTH_WIDTH = 640;
+const int DEPTH_HEIGHT = 480;
+/**
+ * @brief At most this many depth frames of a recording are loaded, they are 1.2 MB each
+ */
+const size_t MAX_RECORDED_DEPTH_FRAME_COUNT = 64;
+
+/**
+ * @brief Finds the right hand of the first tracked skeleton in the depth frame.
+ */
+void locateHand(const FUSkeleton::SkeletonFrame &skeletonFrame, FUDepthSample &sample)
+{
+    sample.handX = 0;
+    sample.handY = 0;
+    sample.handDepth = 0;
+    for (int i = 0; i < FUSkeleton::MAX_SKELETONS; i++) {
+        const FUSkeleton::SkeletonData &skeleton = skeletonFrame.skeletons[i];
+        if (skeleton.trackingState != FUSkeleton::SKELETON_TRACKED || skeleton.jointStates[FUSkeleton::HAND_RIGHT] == FUSkeleton::JOINT_NOT_TRACKED)
+            continue;
+        const FUMath::FUVector3<float> &hand = skeleton.joints[FUSkeleton::HAND_RIGHT];
+        if (FUSyntheticData::projectToDepth(hand, sample.frame.width, sample.frame.height, sample.handX, sample.handY)) {
+            sample.handDepth = static_cast<int>(hand.z * 1000.f);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Points the samples to their pixels. This is done after all of them are loaded, since the storage can move until then.
+ */
+void attachPixels(std::vector<FUDepthSample> &samples, std::vector<std::vector<FUDepthPixel>> &pixels)
+{
+    for (size_t i = 0; i < samples.size(); i++)
+        samples[i].frame.pixels = &pixels[i][0];
+}
+
+void createSyntheticData(std::vector<FUSkeleton::SkeletonFrame> &skeletonFrames, std::vector<FUDepthSample> &depthSamples,
+                         std::vector<std::vector<FUDepthPixel>> &depthPixels)
+{
+    skeletonFrames.resize(SYNTHETIC_SKELETON_FRAME_COUNT);
+    for (int i = 0; i < SYNTHETIC_SKELETON_FRAME_COUNT; i++)
+        FUSyntheticData::createSkeletonFrame(i, skeletonFrames[i]);
+    //Spread the depth frames over the scene, so they have both still and moving parts
+    depthSamples.resize(SYNTHETIC_DEPTH_FRAME_COUNT);
+    depthPixels.resize(SYNTHETIC_DEPTH_FRAME_COUNT);
+    for (int i = 0; i < SYNTHETIC_DEPTH_FRAME_COUNT; i++) {
+        const FUSkeleton::SkeletonFrame &skeletonFrame = skeletonFrames[i * SYNTHETIC_SKELETON_FRAME_COUNT / SYNTHETIC_DEPTH_FRAME_COUNT];
+        FUSyntheticData::createDepthFrame(skeletonFrame, DEPTH_WIDTH, DEPTH_HEIGHT, depthPixels[i]);
+        FUDepthSample &sample = depthSamples[i];
+        sample.frame.width = DEPTH_WIDTH;
+        sample.frame.height = DEPTH_HEIGHT;
+        sample.frame.timeStamp = skeletonFrame.timeStamp;
+        locateHand(skeletonFrame, sample);
+    }
+    attachPixels(depthSamples, depthPixels);
+}
+
+/**
+ * @brief Loads the skeleton frames and the first depth frames of a recording. Every depth frame is paired with the last skeleton
+ * frame before it to locate the hand.
+ * @return false if the recording can't be opened
+ */
+bool loadRecording(const char *filePath, std::vector<FUSkeleton::SkeletonFrame> &skeletonFrames, std::vector<FUDepthSample> &depthSamples,
+                   std::vector<std::vector<FUDepthPixel>> &depthPixels)
+{
+    FURecordingReader reader;
+    if (!reader.open(filePath))
+        return false;
+    FUSkeleton::SkeletonFrame lastSkeletonFrame = FUSkeleton::SkeletonFrame();
+    for (FURecording::RECORD_TYPE type = reader.readNext(); type != FURecording::NO_RECORD; type = reader.readNext()) {
+        if (type == FURecording::SKELETON_RECORD) {
+            lastSkeletonFrame = reader.getSkeletonFrame();
+            skeletonFrames.push_back(lastSkeletonFrame);
+            continue;
+        }
+        const FUDepthFrame &frame = reader.getDepthFrame();
+        const bool hasSameSize = depthSamples.empty() || (depthSamples[0].frame.width == frame.width && depthSamples[0].frame.height == frame.height);
+        if (depthSamples.size() == MAX_RECORDED_DEPTH_FRAME_COUNT || !hasSameSize)
+            continue;
+        depthPixels.push_back(std::vector<FUDepthPixel>(frame.pixels, frame.pixels + static_cast<size_t>(frame.width) * frame.height));
+        FUDepthSample sample = {frame, 0, 0, 0};
+        locateHand(lastSkeletonFrame, sample);
+        depthSamples.push_back(sample);
+    }
+    attachPixels(depthSamples, depthPixels);
+    return true;
+}
+}
+
+/**
+ * Usage: FUBenchmarks [--quick] [--check] [recording]
+ * The core benchmarks run on synthetic data, and on the recording too if one is given. See FUKinectTool::startRecording().
+ * The checks run first, and a failed check fails the run.
+ */
+int main(int argc, char *argv[])
+{
+    //--quick runs every benchmark for a short time, e.g. to check that they all work. --check only runs the checks.
+    bool isQuick = false;
+    bool isCheckOnly = false;
+    const char *recordingPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--quick") == 0)
+            isQuick = true;
+        else if (std::strcmp(argv[i], "--check") == 0)
+            isCheckOnly = true;
+        else
+            recordingPath = argv[i];
+    }
+    if (!runHandClassifierChecks()) {
+        std::fprintf(stderr, "The checks failed\n");
+        return EXIT_FAILURE;
+    }
+    if (isCheckOnly)
+        return EXIT_SUCCESS;
+    FUBenchmark benchmark(isQuick ? 0.01 : 0.2);
+    runMathBenchmarks(benchmark);
+    runInstrumentationBenchmarks(benchmark);
+
+    std::vector<FUSkeleton::SkeletonFrame> skeletonFrames;
+    std::vector<FUDepthSample> depthSamples;
+    std::vector<std::vector<FUDepthPixel>> depthPixels;
+    createSyntheticData(skeletonFrames, depthSamples, depthPixels);
+    runSkeletonBenchmarks(benchmark, skeletonFrames, "synthetic");
+    runDepthBenchmarks(benchmark, depthSamples, "synthetic");
+
+    if (recordingPath) {
+        skeletonFrames.clear();
+        depthSamples.clear();
+        depthPixels.clear();
+        if (!loadRecording(recordingPath, skeletonFrames, depthSamples, depthPixels)) {
+            std::fprintf(stderr, "Can't read the recording %s\n", recordingPath);
+            return EXIT_FAILURE;
+        }
+        runSkeletonBenchmarks(benchmark, skeletonFrames, "recorded");
+        runDepthBenchmarks(benchmark, depthSamples, "recorded");
+    }
+    return EXIT_SUCCESS;
+}